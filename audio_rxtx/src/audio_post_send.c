@@ -24,10 +24,23 @@
 #include <lo/lo.h>
 #include <sys/time.h>
 #include <getopt.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/epoll.h>
+#include <semaphore.h>
+#include <sys/timerfd.h>
 
 #include "jack_audio_common.h"
 #include "weak_libjack.h"
-#include "rb.h"
+#include "../../rb/rb.h"
+#include "audio_segments.h"
 
 //tb/130427/131206//131211//131216/131229/150523
 //gcc -o audio_post_send audio_post_send.c `pkg-config --cflags --libs liblo`
@@ -121,11 +134,146 @@ lo_address loa_tcp;
 
 //ms
 int delay_between_tcp_retries=700;
-int delay_between_tcp_sends=10;
 
 int last_lo_send_message_tcp_return=0;
 uint64_t total_bytes_successfully_sent=0;
 
+//use lo_send_message, one message per period (old path, for comparison)
+int use_lo_tcp=0; //param
+
+//forward all available periods with one sendmsg (up to this many)
+int max_batch_periods=64; //param
+
+//own TCP connection to the final receiver
+//messages are framed like liblo does it for TCP: 4 bytes length (network order), OSC message
+int tcp_socket=-1;
+//non-blocking connect in progress
+int tcp_connecting=0;
+//socket buffer full, wait for EPOLLOUT
+int tcp_waiting_writable=0;
+//message cut by a full socket buffer, copied out of the ring (the ring may drop it)
+char *tcp_partial_buffer=NULL;
+size_t tcp_partial_len=0;
+//bytes of tcp_partial_buffer that are already sent
+size_t tcp_partial_sent=0;
+//waiting for retry timer (connection failed)
+int tcp_retry_pending=0;
+
+//--lotcp: lo_send_message() blocks, so it runs in its own thread (the ring's only reader).
+//posted by the event loop when periods are in the ring
+pthread_t lotcp_thread;
+int lotcp_thread_started=0;
+sem_t lotcp_semaphore;
+
+//event loop: wakes on UDP ingress, TCP writability and timers.
+//the only thread that writes the ring: the UDP handlers (audio_handler) run in it,
+//as well as spool_drain(), forwarding, hub and segment collection
+int epoll_fd=-1;
+//one-shot, delay_between_tcp_retries
+int retry_timer_fd=-1;
+//periodic: display, spool catch-up
+int tick_timer_fd=-1;
+//ms
+int tick_interval=100;
+
+//epoll event tags
+#define EV_UDP 1
+#define EV_TCP 3
+#define EV_RETRY 4
+#define EV_TICK 5
+#define EV_HUB 6
+//+ subscriber index
+#define EV_SUBSCRIBER 100
+
+//length prefix + fixed part of /audio for every period of a batch.
+//blob data is taken directly from the ringbuffer (no copy)
+char *tcp_header_buffer=NULL;
+int tcp_header_size_max=0;
+struct iovec *tcp_iov=NULL;
+int tcp_iov_max=0;
+
+//overflow strategy 3: spill to disk above high watermark, drain after reconnect
+//(see doc/audio_post_send_TCP.txt)
+char *spool_dir=NULL; //param
+float spool_high_watermark=0.8; //param, fraction of ringbuffer size
+//kbit/s, 0: unlimited
+float catchup_rate=0; //param
+uint64_t spool_segment_size=100000000; //param, bytes
+
+//audio_handler and spool_drain (both in the event loop) write to rb.
+//which one is decided via spool_active
+//while the spool is not empty, all new data is appended to it (keep order)
+int spool_active=0;
+//committed bytes in the spool (not yet moved to rb)
+uint64_t spool_bytes=0;
+//bytes written by the current audio_handler call, not yet committed
+uint64_t spool_pending_bytes=0;
+int spool_write_error=0;
+
+//append-only segment files <spool_dir>/audio_post_send_<n>.spool
+int spool_write_segment=0;
+int spool_write_fd=-1;
+uint64_t spool_write_segment_bytes=0;
+int spool_read_segment=0;
+int spool_read_fd=-1;
+
+//catch-up token bucket, bytes
+double catchup_budget=0;
+double catchup_time_prev=0;
+
+//0: no single target ("-"), only hub subscribers. the ring drops oldest data when full
+int primary_enabled=1;
+//periods the single target lost because it was stalled while hub subscribers or segments were served
+uint64_t primary_lost_periods=0;
+
+//hub: any number of TCP subscribers, each with own cursor into the shared ring
+//listening port for subscribers
+char *hub_port=NULL; //param
+//where new subscribers start: 0: live, 1: oldest data available in ring
+int hub_join_oldest=0; //param
+int hub_socket=-1;
+
+//absolute position (bytes written to rb since start), rb->write_index corresponds to it
+uint64_t hub_write_position=0;
+
+#define MAX_HUB_SUBSCRIBERS 64
+typedef struct
+{
+	int fd;
+	//absolute ring position of next mc period to send
+	uint64_t position;
+	uint64_t message_number;
+	//bytes of the first message that are already sent (non-blocking socket)
+	size_t partial_sent;
+	//socket buffer full, wait for EPOLLOUT
+	int waiting_writable;
+	//timetag used for a partially sent message
+	struct timeval tv;
+	uint64_t lost_periods;
+	uint64_t bytes_sent;
+	//incoming /join message (length prefixed)
+	char in_buffer[256];
+	size_t in_count;
+} hub_subscriber_t;
+
+hub_subscriber_t hub_subscribers[MAX_HUB_SUBSCRIBERS];
+int hub_subscriber_count=0;
+
+//--segments: cursor of segment writer into the shared ring (like a hub subscriber)
+uint64_t segment_position=0;
+int segments_started=0;
+//copy of a period that wraps around the end of the ring
+char *segment_staging=NULL;
+size_t segment_staging_size=0;
+
+//throughput, updated once per second in print_info
+uint64_t periods_forwarded=0;
+uint64_t periods_forwarded_prev=0;
+uint64_t bytes_forwarded_prev=0;
+double rate_time_prev=0;
+float forward_periods_per_second=0;
+float forward_bytes_per_second=0;
+
 //ctrl+c etc
 static void signal_handler(int sig)
 {
@@ -151,6 +299,16 @@ static void signal_handler(int sig)
 	fprintf(stderr,"cleaning up...");
 
 	lo_server_thread_free(lo_st);
+	if(tcp_socket>=0)
+	{
+		close(tcp_socket);
+	}
+	if(lotcp_thread_started==1)
+	{
+		//may block in lo_send_message()
+		pthread_cancel(lotcp_thread);
+		pthread_join(lotcp_thread,NULL);
+	}
 	rb_free(rb);
 	rb_free(rb_helper);
 
@@ -175,140 +333,1228 @@ void print_info()
 {
 	uint64_t can_read_count=rb_can_read(rb);
 
-	char* offset_string;
-	if(channel_offset>0)
+	char* offset_string;
+	if(channel_offset>0)
+	{
+		asprintf(&offset_string, "(%d+)", (channel_offset));
+	}
+	else
+	{
+		offset_string="";
+	}
+
+	char *warn_string="";
+	if((float)can_read_count/max_buffer_size > 0.8)
+	{
+		warn_string="!";
+	}
+
+	char spool_info[64]="";
+	if(segments_started==1)
+	{
+		segments_status(spool_info,sizeof(spool_info));
+	}
+	else if(spool_dir!=NULL)
+	{
+		snprintf(spool_info,sizeof(spool_info)," spool: %.2f MB",(float)spool_bytes/1000/1000);
+	}
+	else if(hub_port!=NULL)
+	{
+		snprintf(spool_info,sizeof(spool_info)," hub: %d lost: %" PRId64,hub_subscriber_count,primary_lost_periods);
+	}
+
+	gettimeofday(&tv, NULL);
+	double time_now=tv.tv_sec+(double)tv.tv_usec/1000000;
+	if(time_now-rate_time_prev>=1)
+	{
+		forward_periods_per_second=(periods_forwarded-periods_forwarded_prev)/(time_now-rate_time_prev);
+		forward_bytes_per_second=(total_bytes_successfully_sent-bytes_forwarded_prev)/(time_now-rate_time_prev);
+		periods_forwarded_prev=periods_forwarded;
+		bytes_forwarded_prev=total_bytes_successfully_sent;
+		rate_time_prev=time_now;
+	}
+
+	if((message_number>0 && relaxed_display_counter>=update_display_every_nth_cycle*port_count)
+		|| last_test_cycle==1
+	)
+	{
+		fprintf(stderr,"\r# %" PRId64 " i: %s%d b: %.2f MB (%.2f%s) s: %.2f i: %.2f r: %" PRId64 
+			/*" l: %" PRId64 */" d: %" PRId64 " o: %" PRId64 " p: %.1f pf: %.2f # %" PRId64 ", %d (%d), %.2f MB %.0f p/s %.2f MB/s%s%s",
+			message_number,
+			offset_string,
+			input_port_count,
+			(float)can_read_count/1000/1000,
+			(float)can_read_count/max_buffer_size,
+			warn_string,
+			(float)can_read_count/(float)port_count/(float)bytes_per_sample/(float)sample_rate,
+			time_interval_avg*1000,
+			remote_xrun_counter,/*local_xrun_counter,*/
+			multi_channel_drop_counter,
+			buffer_overflow_counter,
+			(float)frames_since_cycle_start_avg/(float)period_size,
+			page_faults_per_cycle(message_number),
+			message_number_out,last_lo_send_message_tcp_return,
+			port_count,(float)total_bytes_successfully_sent/1000/1000,
+			forward_periods_per_second,forward_bytes_per_second/1000/1000,
+			spool_info,
+			"\033[0J"
+		);
+
+		fflush(stderr);
+
+		relaxed_display_counter=0;
+	}
+	relaxed_display_counter++;
+}//end print_info
+
+//add / modify / remove fd in event loop
+static inline void epoll_set(int fd, uint64_t tag, uint32_t events, int op)
+{
+	struct epoll_event ev;
+	memset(&ev,0,sizeof(ev));
+	ev.events=events;
+	ev.data.u64=tag;
+	epoll_ctl(epoll_fd,op,fd,&ev);
+}
+
+//arm one-shot timer
+static inline void timer_arm(int fd, int ms)
+{
+	struct itimerspec its;
+	memset(&its,0,sizeof(its));
+	its.it_value.tv_sec=ms/1000;
+	its.it_value.tv_nsec=(ms%1000)*1000000;
+	timerfd_settime(fd,0,&its,NULL);
+}
+
+//start non-blocking connect to remote_tcp_host:remote_tcp_port
+//EPOLLOUT signals completion (tcp_connect_finish)
+int tcp_connect()
+{
+	struct addrinfo hints;
+	struct addrinfo *ai;
+	memset(&hints,0,sizeof(hints));
+	hints.ai_family=AF_UNSPEC;
+	hints.ai_socktype=SOCK_STREAM;
+
+	if(getaddrinfo(remote_tcp_host,remote_tcp_port,&hints,&ai)!=0)
+	{
+		return -1;
+	}
+
+	tcp_socket=socket(ai->ai_family,ai->ai_socktype|SOCK_NONBLOCK,ai->ai_protocol);
+	if(tcp_socket<0)
+	{
+		freeaddrinfo(ai);
+		return -1;
+	}
+
+	//before connect: buffer sizes affect the window scale of the handshake
+	apply_net_socket_options(tcp_socket,"TCP target");
+
+	int ret=connect(tcp_socket,ai->ai_addr,ai->ai_addrlen);
+	freeaddrinfo(ai);
+
+	if(ret!=0 && errno!=EINPROGRESS)
+	{
+		close(tcp_socket);
+		tcp_socket=-1;
+		return -1;
+	}
+
+	tcp_connecting=1;
+	epoll_set(tcp_socket,EV_TCP,EPOLLOUT,EPOLL_CTL_ADD);
+	return 0;
+}//end tcp_connect
+
+//called on EPOLLOUT while connecting
+int tcp_connect_finish()
+{
+	int err=0;
+	socklen_t len=sizeof(err);
+	getsockopt(tcp_socket,SOL_SOCKET,SO_ERROR,&err,&len);
+	tcp_connecting=0;
+
+	if(err!=0)
+	{
+		return -1;
+	}
+
+	//the tail of a batch should leave immediately (TCP_CORK collects the rest)
+	int on=1;
+	setsockopt(tcp_socket,IPPROTO_TCP,TCP_NODELAY,&on,sizeof(on));
+
+	//EPOLLIN: notice when the receiver closes the connection
+	epoll_set(tcp_socket,EV_TCP,EPOLLIN|EPOLLRDHUP,EPOLL_CTL_MOD);
+
+	fprintf(stderr,"\nTCP connected to %s:%s\n",remote_tcp_host,remote_tcp_port);
+	return 0;
+}//end tcp_connect_finish
+
+//close connection, try again after delay_between_tcp_retries
+void tcp_fail(const char *reason)
+{
+	if(tcp_socket>=0)
+	{
+		if(tcp_connecting==0 && reason!=NULL)
+		{
+			fprintf(stderr,"\nTCP connection lost: %s. reconnecting.\n",reason);
+		}
+		close(tcp_socket);
+	}
+	tcp_socket=-1;
+	tcp_connecting=0;
+	tcp_waiting_writable=0;
+	//a partially sent message is sent again completely on the next connection
+	tcp_partial_sent=0;
+	last_lo_send_message_tcp_return=-1;
+
+	tcp_retry_pending=1;
+	timer_arm(retry_timer_fd,delay_between_tcp_retries);
+}
+
+//socket buffer full: continue on EPOLLOUT
+static inline void tcp_wait_writable()
+{
+	tcp_waiting_writable=1;
+	epoll_set(tcp_socket,EV_TCP,EPOLLIN|EPOLLRDHUP|EPOLLOUT,EPOLL_CTL_MOD);
+}
+
+//write big endian int32 / int64, return position after written bytes
+static inline char *put_int32(char *p, uint32_t v)
+{
+	v=htonl(v);
+	memcpy(p,&v,4);
+	return p+4;
+}
+
+static inline char *put_int64(char *p, uint64_t v)
+{
+	p=put_int32(p,(uint32_t)(v>>32));
+	return put_int32(p,(uint32_t)v);
+}
+
+//add iovec(s) for count bytes of ringbuffer data at offset (from read index), regions may wrap
+static inline int add_region_iov(struct iovec *iov, rb_region_t *regions, size_t offset, size_t count)
+{
+	int n=0;
+	if(offset<regions[0].size)
+	{
+		size_t len=MIN_(count,regions[0].size-offset);
+		iov[n].iov_base=regions[0].buffer+offset;
+		iov[n].iov_len=len;
+		n++;
+		count-=len;
+		offset=0;
+	}
+	else
+	{
+		offset-=regions[0].size;
+	}
+
+	if(count>0)
+	{
+		iov[n].iov_base=regions[1].buffer+offset;
+		iov[n].iov_len=count;
+		n++;
+	}
+	return n;
+}
+
+//build length-prefixed /audio messages for periods whole mc periods found in regions
+//(starting at offset 0) into tcp_iov. headers go to tcp_header_buffer.
+//msg_len is set to the OSC message size (without length prefix). returns iovec count
+int build_audio_iov(rb_region_t *regions, int periods, uint64_t first_message_number,
+	struct timeval *t, int *msg_len)
+{
+	int blob_size=period_size*bytes_per_sample;
+	int mc_period_bytes=port_count*blob_size;
+
+	//typetags ,hhti + one b per channel, 0-terminated and padded
+	int typetag_len=(5+port_count+1+3) & ~3;
+	int pad=(4-blob_size%4)%4;
+	//OSC message size without length prefix
+	*msg_len=8+typetag_len+8+8+8+4+port_count*(4+blob_size+pad);
+	//header: length prefix, path, typetags, metadata, size of first blob
+	int header_len=4+8+typetag_len+8+8+8+4+4;
+
+	static const char zero[4]={0,0,0,0};
+	static char blob_size_be[4];
+	put_int32(blob_size_be,blob_size);
+
+	int iovcnt=0;
+	int k;
+	for(k=0;k<periods;k++)
+	{
+		char *h=tcp_header_buffer+k*tcp_header_size_max;
+		char *p=h;
+		p=put_int32(p,*msg_len);
+		memcpy(p,"/audio\0\0",8);
+		p+=8;
+		memset(p,0,typetag_len);
+		memcpy(p,",hhti",5);
+		memset(p+5,'b',port_count);
+		p+=typetag_len;
+		p=put_int64(p,first_message_number+k);
+		p=put_int64(p,remote_xrun_counter);
+		p=put_int32(p,(uint32_t)t->tv_sec);
+		p=put_int32(p,(uint32_t)t->tv_usec);
+		p=put_int32(p,sample_rate);
+		p=put_int32(p,blob_size);
+
+		tcp_iov[iovcnt].iov_base=h;
+		tcp_iov[iovcnt].iov_len=header_len;
+		iovcnt++;
+
+		int i;
+		for(i=0;i<port_count;i++)
+		{
+			if(i>0)
+			{
+				tcp_iov[iovcnt].iov_base=blob_size_be;
+				tcp_iov[iovcnt].iov_len=4;
+				iovcnt++;
+			}
+			iovcnt+=add_region_iov(&tcp_iov[iovcnt],regions,
+				(size_t)k*mc_period_bytes+i*blob_size,blob_size);
+			if(pad>0)
+			{
+				tcp_iov[iovcnt].iov_base=(void*)zero;
+				tcp_iov[iovcnt].iov_len=pad;
+				iovcnt++;
+			}
+		}
+	}
+	return iovcnt;
+}//end build_audio_iov
+
+//max periods for one build_audio_iov() call
+static inline int max_iov_periods()
+{
+	//header, blob size + data (2 if wrapped) + pad for every channel
+	int iov_per_period=1+port_count*3+1;
+	return MIN_(max_batch_periods,tcp_iov_max/iov_per_period);
+}
+
+//skip count bytes in iovec array, returns new start. iovcnt is updated
+static inline struct iovec *skip_iov(struct iovec *iov, int *iovcnt, size_t count)
+{
+	while(*iovcnt>0 && count>=iov->iov_len)
+	{
+		count-=iov->iov_len;
+		iov++;
+		(*iovcnt)--;
+	}
+	if(*iovcnt>0)
+	{
+		iov->iov_base=(char*)iov->iov_base+count;
+		iov->iov_len-=count;
+	}
+	return iov;
+}
+
+//copy count bytes after skip bytes of an iovec array to dest
+static inline void copy_iov(char *dest, const struct iovec *iov, int iovcnt, size_t skip, size_t count)
+{
+	int i;
+	for(i=0;i<iovcnt && count>0;i++)
+	{
+		if(skip>=iov[i].iov_len)
+		{
+			skip-=iov[i].iov_len;
+			continue;
+		}
+		size_t len=MIN_(count,iov[i].iov_len-skip);
+		memcpy(dest,(const char*)iov[i].iov_base+skip,len);
+		dest+=len;
+		count-=len;
+		skip=0;
+	}
+}
+
+//send the rest of a message that was cut by a full socket buffer.
+//returns number of bytes sent or -1 on error
+int forward_partial()
+{
+	ssize_t ret=send(tcp_socket,tcp_partial_buffer+tcp_partial_sent,tcp_partial_len-tcp_partial_sent,
+		MSG_NOSIGNAL|MSG_DONTWAIT);
+	if(ret<0)
+	{
+		if(errno==EAGAIN || errno==EWOULDBLOCK || errno==EINTR)
+		{
+			tcp_wait_writable();
+			return 0;
+		}
+		tcp_fail(strerror(errno));
+		return -1;
+	}
+
+	tcp_partial_sent+=ret;
+	total_bytes_successfully_sent+=ret;
+	last_lo_send_message_tcp_return=ret;
+
+	if(tcp_partial_sent<tcp_partial_len)
+	{
+		tcp_wait_writable();
+		return ret;
+	}
+
+	tcp_partial_len=0;
+	tcp_partial_sent=0;
+	periods_forwarded++;
+	return ret;
+}//end forward_partial
+
+//forward whole mc periods available in the ringbuffer with one non-blocking sendmsg.
+//returns number of bytes sent or -1 on error
+int forward_periods()
+{
+	if(tcp_socket<0 || tcp_connecting==1 || tcp_waiting_writable==1)
+	{
+		return 0;
+	}
+
+	//complete a cut message first
+	if(tcp_partial_len>0)
+	{
+		return forward_partial();
+	}
+
+	int blob_size=period_size*bytes_per_sample;
+	int mc_period_bytes=port_count*blob_size;
+
+	struct timeval t;
+	gettimeofday(&t, NULL);
+
+	//whole periods that can be read
+	int periods=rb_can_read(rb)/mc_period_bytes;
+	if(periods<1)
+	{
+		return 0;
+	}
+
+	periods=MIN_(periods,max_iov_periods());
+
+	rb_region_t regions[2];
+	rb_get_read_regions(rb,regions);
+
+	int msg_len;
+	int iovcnt=build_audio_iov(regions,periods,message_number_out,&t,&msg_len);
+
+	size_t total=(size_t)periods*(4+msg_len);
+
+	struct msghdr mh;
+	memset(&mh,0,sizeof(mh));
+	mh.msg_iov=tcp_iov;
+	mh.msg_iovlen=MIN_(iovcnt,IOV_MAX);
+
+	ssize_t ret=sendmsg(tcp_socket,&mh,MSG_NOSIGNAL|MSG_DONTWAIT);
+	if(ret<0)
+	{
+		if(errno==EAGAIN || errno==EWOULDBLOCK || errno==EINTR)
+		{
+			tcp_wait_writable();
+			return 0;
+		}
+		tcp_fail(strerror(errno));
+		return -1;
+	}
+
+	//whole messages leave the ring. a cut message is copied and leaves it too:
+	//audio_handler may drop periods for this target (primary_may_drop())
+	int periods_sent=ret/(4+msg_len);
+	size_t cut=ret%(4+msg_len);
+	if(cut>0)
+	{
+		copy_iov(tcp_partial_buffer,tcp_iov,iovcnt,(size_t)periods_sent*(4+msg_len),4+msg_len);
+		tcp_partial_len=4+msg_len;
+		tcp_partial_sent=cut;
+	}
+
+	rb_advance_read_index(rb,(size_t)(periods_sent+(cut>0))*mc_period_bytes);
+	message_number_out+=periods_sent+(cut>0);
+
+	periods_forwarded+=periods_sent;
+	total_bytes_successfully_sent+=ret;
+
+	if((size_t)ret<total && mh.msg_iovlen==iovcnt)
+	{
+		//socket buffer full
+		tcp_wait_writable();
+	}
+
+	last_lo_send_message_tcp_return=ret;
+	return ret;
+}//end forward_periods
+
+//file name of spool segment n
+static void spool_segment_path(char *path, size_t size, int segment)
+{
+	snprintf(path,size,"%s/audio_post_send_%08d.spool",spool_dir,segment);
+}
+
+//called by audio_handler before writing one message worth of data
+//returns 1 if the data should go to the spool, 0 for the ringbuffer
+int spool_decide(int mc_period_bytes)
+{
+	if(spool_dir==NULL)
+	{
+		return 0;
+	}
+
+	if(spool_active==0 && rb_can_read(rb)+mc_period_bytes <= spool_high_watermark*rb_size(rb))
+	{
+		return 0;
+	}
+
+	if(spool_active==0)
+	{
+		fprintf(stderr,"\nbuffer above %.0f%%, spooling to %s\n",spool_high_watermark*100,spool_dir);
+		spool_active=1;
+	}
+
+	//start a new segment (first or full)
+	if(spool_write_fd<0 || spool_write_segment_bytes>=spool_segment_size)
+	{
+		if(spool_write_fd>=0)
+		{
+			close(spool_write_fd);
+			spool_write_segment++;
+		}
+
+		char path[PATH_MAX];
+		spool_segment_path(path,sizeof(path),spool_write_segment);
+		spool_write_fd=open(path,O_CREAT|O_TRUNC|O_WRONLY|O_APPEND,0644);
+		spool_write_segment_bytes=0;
+
+		if(spool_write_fd<0)
+		{
+			fprintf(stderr,"\ncould not create spool segment %s: %s\n",path,strerror(errno));
+			//behave like without spool for this message
+			spool_write_error=1;
+		}
+	}
+
+	spool_pending_bytes=0;
+	return 1;
+}//end spool_decide
+
+//write data of one channel period to the ringbuffer or the spool
+static inline void write_period_data(int to_spool, const void *data, size_t count)
+{
+	if(to_spool==0)
+	{
+		hub_write_position+=rb_write(rb,data,count);
+		return;
+	}
+
+	if(spool_write_error==1)
+	{
+		return;
+	}
+
+	size_t written=0;
+	while(written<count)
+	{
+		ssize_t ret=write(spool_write_fd,(const char*)data+written,count-written);
+		if(ret<0 && errno==EINTR)
+		{
+			continue;
+		}
+		if(ret<=0)
+		{
+			spool_write_error=1;
+			break;
+		}
+		written+=ret;
+	}
+	spool_pending_bytes+=written;
+}
+
+//called by audio_handler after all data of a message was written
+//a message is stored completely or not at all
+void spool_commit()
+{
+	if(spool_write_error==1)
+	{
+		buffer_overflow_counter++;
+		fprintf(stderr,"\nSPOOL WRITE FAILED (%s), dropping message%s\n",strerror(errno),"\033[0J");
+		if(spool_write_fd>=0)
+		{
+			//remove partial message
+			ftruncate(spool_write_fd,spool_write_segment_bytes);
+		}
+		spool_write_error=0;
+		spool_pending_bytes=0;
+		return;
+	}
+
+	spool_write_segment_bytes+=spool_pending_bytes;
+	spool_bytes+=spool_pending_bytes;
+	spool_pending_bytes=0;
+}
+
+//move whole mc periods from the spool to the ringbuffer (up to the high watermark),
+//limited by catch-up rate. called from the event loop before forwarding
+void spool_drain()
+{
+	if(spool_dir==NULL || spool_active==0)
+	{
+		return;
+	}
+
+	int mc_period_bytes=port_count*bytes_per_sample*period_size;
+
+	gettimeofday(&tv, NULL);
+	double time_now=tv.tv_sec+(double)tv.tv_usec/1000000;
+
+	double budget=spool_bytes;
+	if(catchup_rate>0)
+	{
+		//refill, allow at most one second worth of data at once
+		double rate=catchup_rate*1000/8;
+		catchup_budget=MIN_(rate,catchup_budget+(time_now-catchup_time_prev)*rate);
+		budget=catchup_budget;
+	}
+	catchup_time_prev=time_now;
+
+	//ringbuffer still above high watermark (i.e. TCP down): nothing to do
+	double space=fmax(0,spool_high_watermark*rb_size(rb)-rb_can_read(rb));
+
+	uint64_t count=MIN_(MIN_(budget,space),spool_bytes);
+	count-=count%mc_period_bytes;
+
+	while(count>0)
+	{
+		if(spool_read_fd<0)
+		{
+			char path[PATH_MAX];
+			spool_segment_path(path,sizeof(path),spool_read_segment);
+			spool_read_fd=open(path,O_RDONLY);
+			if(spool_read_fd<0)
+			{
+				fprintf(stderr,"\ncould not open spool segment %s: %s\n",path,strerror(errno));
+				break;
+			}
+		}
+
+		//read directly into the ringbuffer
+		rb_region_t regions[2];
+		rb_get_write_regions(rb,regions);
+
+		ssize_t ret=read(spool_read_fd,regions[0].buffer,MIN_(count,regions[0].size));
+		if(ret<0 && errno==EINTR)
+		{
+			continue;
+		}
+		if(ret<0)
+		{
+			fprintf(stderr,"\ncould not read spool: %s\n",strerror(errno));
+			break;
+		}
+		if(ret==0)
+		{
+			//end of segment. the segment currently written to is never finished here (count <= spool_bytes)
+			if(spool_read_segment==spool_write_segment)
+			{
+				break;
+			}
+
+			char path[PATH_MAX];
+			spool_segment_path(path,sizeof(path),spool_read_segment);
+			close(spool_read_fd);
+			unlink(path);
+			spool_read_fd=-1;
+			spool_read_segment++;
+			continue;
+		}
+
+		//don't keep sent data in the page cache
+		posix_fadvise(spool_read_fd,0,0,POSIX_FADV_DONTNEED);
+
+		rb_advance_write_index(rb,ret);
+		hub_write_position+=ret;
+		count-=ret;
+		spool_bytes-=ret;
+		catchup_budget-=ret;
+	}
+
+	if(spool_bytes==0)
+	{
+		//all caught up. remove last segment, write to ringbuffer again
+		char path[PATH_MAX];
+		spool_segment_path(path,sizeof(path),spool_write_segment);
+
+		if(spool_read_fd>=0)
+		{
+			close(spool_read_fd);
+		}
+		if(spool_write_fd>=0)
+		{
+			close(spool_write_fd);
+		}
+		unlink(path);
+
+		spool_read_fd=-1;
+		spool_write_fd=-1;
+		spool_write_segment++;
+		spool_read_segment=spool_write_segment;
+		spool_active=0;
+
+		fprintf(stderr,"\nspool drained\n");
+	}
+}//end spool_drain
+
+//drop oldest whole periods until count bytes can be written. returns number of periods dropped.
+//hub subscribers and the segment writer have own cursors, this only moves the single target's one.
+//called by audio_handler
+int ring_make_room(size_t count, int mc_period_bytes)
+{
+	size_t can_write=rb_can_write(rb);
+	if(can_write>=count)
+	{
+		return 0;
+	}
+	size_t drop=count-can_write;
+	drop+=(mc_period_bytes-drop%mc_period_bytes)%mc_period_bytes;
+	drop=MIN_(drop,rb_can_read(rb));
+	rb_advance_read_index(rb,drop);
+	return drop/mc_period_bytes;
+}
+
+//a stalled single target must not hold back hub subscribers or segments:
+//drop for the target only. not for --lotcp (reads the ring in lotcp_thread)
+static inline int primary_may_drop()
+{
+	return primary_enabled==1 && use_lo_tcp==0 && (hub_subscriber_count>0 || segments_started==1);
+}
+
+//oldest position a subscriber may read from.
+//keep a guard zone: a subscriber with a partially sent message is not overtaken by the next message
+static inline uint64_t hub_oldest_position(uint64_t write_position, int mc_period_bytes)
+{
+	uint64_t history=rb_size(rb)-rb_size(rb)/8;
+	if(write_position<=history)
+	{
+		return 0;
+	}
+	uint64_t oldest=write_position-history;
+	//round up to whole mc period
+	return oldest+(mc_period_bytes-oldest%mc_period_bytes)%mc_period_bytes;
+}
+
+//listen for subscribers on hub_port
+int hub_start()
+{
+	struct addrinfo hints;
+	struct addrinfo *ai;
+	memset(&hints,0,sizeof(hints));
+	hints.ai_family=AF_INET6;
+	hints.ai_socktype=SOCK_STREAM;
+	hints.ai_flags=AI_PASSIVE;
+
+	if(getaddrinfo(NULL,hub_port,&hints,&ai)!=0)
+	{
+		hints.ai_family=AF_INET;
+		if(getaddrinfo(NULL,hub_port,&hints,&ai)!=0)
+		{
+			return -1;
+		}
+	}
+
+	hub_socket=socket(ai->ai_family,ai->ai_socktype|SOCK_NONBLOCK,ai->ai_protocol);
+	int on=1;
+	int off=0;
+	setsockopt(hub_socket,SOL_SOCKET,SO_REUSEADDR,&on,sizeof(on));
+	if(ai->ai_family==AF_INET6)
+	{
+		//accept IPv4 too
+		setsockopt(hub_socket,IPPROTO_IPV6,IPV6_V6ONLY,&off,sizeof(off));
+	}
+
+	//accepted subscriber sockets inherit the options
+	apply_net_socket_options(hub_socket,"hub");
+
+	if(hub_socket<0 || bind(hub_socket,ai->ai_addr,ai->ai_addrlen)!=0 || listen(hub_socket,16)!=0)
+	{
+		freeaddrinfo(ai);
+		return -1;
+	}
+	freeaddrinfo(ai);
+
+	int i;
+	for(i=0;i<MAX_HUB_SUBSCRIBERS;i++)
+	{
+		hub_subscribers[i].fd=-1;
+	}
+	return 0;
+}//end hub_start
+
+//set position of subscriber to live or oldest
+void hub_join(hub_subscriber_t *sub, int oldest)
+{
+	int mc_period_bytes=port_count*bytes_per_sample*period_size;
+
+	uint64_t write_position=hub_write_position;
+
+	if(oldest==1)
+	{
+		sub->position=hub_oldest_position(write_position,mc_period_bytes);
+	}
+	else
+	{
+		sub->position=write_position;
+	}
+}
+
+//accept new subscribers
+void hub_accept()
+{
+	int fd;
+	while((fd=accept4(hub_socket,NULL,NULL,SOCK_NONBLOCK))>=0)
+	{
+		int i;
+		for(i=0;i<MAX_HUB_SUBSCRIBERS;i++)
+		{
+			if(hub_subscribers[i].fd<0)
+			{
+				break;
+			}
+		}
+		if(i==MAX_HUB_SUBSCRIBERS)
+		{
+			fprintf(stderr,"\nhub: max. %d subscribers, rejecting\n",MAX_HUB_SUBSCRIBERS);
+			close(fd);
+			continue;
+		}
+
+		int on=1;
+		setsockopt(fd,IPPROTO_TCP,TCP_NODELAY,&on,sizeof(on));
+
+		hub_subscriber_t *sub=&hub_subscribers[i];
+		memset(sub,0,sizeof(hub_subscriber_t));
+		sub->fd=fd;
+		epoll_set(fd,EV_SUBSCRIBER+i,EPOLLIN|EPOLLRDHUP,EPOLL_CTL_ADD);
+		hub_join(sub,hub_join_oldest);
+		hub_subscriber_count++;
+
+		fprintf(stderr,"\nhub: subscriber %d joined (%s)\n",i,hub_join_oldest==1 ? "oldest" : "live");
+	}
+}
+
+void hub_close(hub_subscriber_t *sub, const char *reason)
+{
+	fprintf(stderr,"\nhub: subscriber %d left (%s). sent: %.2f MB lost: %" PRId64 " periods\n",
+		(int)(sub-hub_subscribers),reason,(float)sub->bytes_sent/1000/1000,sub->lost_periods);
+	close(sub->fd);
+	sub->fd=-1;
+	hub_subscriber_count--;
+}
+
+//read /join s ("live" or "oldest") from subscriber. returns -1 if connection closed
+int hub_read(hub_subscriber_t *sub)
+{
+	while(1)
+	{
+		ssize_t ret=recv(sub->fd,sub->in_buffer+sub->in_count,sizeof(sub->in_buffer)-sub->in_count,0);
+		if(ret==0)
+		{
+			return -1;
+		}
+		if(ret<0)
+		{
+			return (errno==EAGAIN || errno==EWOULDBLOCK || errno==EINTR) ? 0 : -1;
+		}
+		sub->in_count+=ret;
+
+		while(sub->in_count>=4)
+		{
+			uint32_t len;
+			memcpy(&len,sub->in_buffer,4);
+			len=ntohl(len);
+			if(len>sizeof(sub->in_buffer)-4)
+			{
+				return -1;
+			}
+			if(sub->in_count<4+len)
+			{
+				break;
+			}
+
+			char *data=sub->in_buffer+4;
+			if(len>6 && !strncmp(data,"/join",6))
+			{
+				int result;
+				lo_message msg=lo_message_deserialise(data,len,&result);
+				if(msg!=NULL)
+				{
+					if(!strcmp(lo_message_get_types(msg),"s"))
+					{
+						int oldest=!strcmp(&(lo_message_get_argv(msg)[0]->s),"oldest");
+						hub_join(sub,oldest);
+						sub->partial_sent=0;
+					}
+					lo_message_free(msg);
+				}
+			}
+			memmove(sub->in_buffer,sub->in_buffer+4+len,sub->in_count-4-len);
+			sub->in_count-=4+len;
+		}
+	}
+}//end hub_read
+
+//socket buffer full: continue on EPOLLOUT
+static inline void hub_wait_writable(hub_subscriber_t *sub)
+{
+	sub->waiting_writable=1;
+	epoll_set(sub->fd,EV_SUBSCRIBER+(sub-hub_subscribers),EPOLLIN|EPOLLRDHUP|EPOLLOUT,EPOLL_CTL_MOD);
+}
+
+//send as much as possible to subscriber without blocking.
+//data is sent directly from the shared ring, no copy per subscriber
+void hub_send(hub_subscriber_t *sub)
+{
+	int mc_period_bytes=port_count*bytes_per_sample*period_size;
+
+	uint64_t write_position=hub_write_position;
+	uint64_t write_index=rb->write_index;
+
+	uint64_t oldest=hub_oldest_position(write_position,mc_period_bytes);
+
+	//slow subscriber: data was overwritten. continue at oldest (strategy 2)
+	if(sub->position<oldest)
+	{
+		if(sub->partial_sent>0)
+		{
+			//can't complete the message
+			hub_close(sub,"too slow");
+			return;
+		}
+		sub->lost_periods+=(oldest-sub->position)/mc_period_bytes;
+		sub->position=oldest;
+	}
+
+	int periods=MIN_((write_position-sub->position)/mc_period_bytes,max_iov_periods());
+	if(periods<1)
+	{
+		return;
+	}
+
+	//locate position in ring
+	size_t size=rb_size(rb);
+	size_t start=(write_index+size-(write_position-sub->position)%size)%size;
+	size_t count=(size_t)periods*mc_period_bytes;
+
+	rb_region_t regions[2];
+	regions[0].buffer=(char*)buf_ptr(rb)+start;
+	regions[0].size=MIN_(count,size-start);
+	regions[1].buffer=(char*)buf_ptr(rb);
+	regions[1].size=count-regions[0].size;
+
+	//same timetag until a partially sent message is complete
+	if(sub->partial_sent==0)
+	{
+		gettimeofday(&sub->tv, NULL);
+	}
+
+	int msg_len;
+	int iovcnt=build_audio_iov(regions,periods,sub->message_number,&sub->tv,&msg_len);
+	struct iovec *iov=skip_iov(tcp_iov,&iovcnt,sub->partial_sent);
+
+	struct msghdr mh;
+	memset(&mh,0,sizeof(mh));
+	mh.msg_iov=iov;
+	mh.msg_iovlen=MIN_(iovcnt,IOV_MAX);
+
+	ssize_t ret=sendmsg(sub->fd,&mh,MSG_NOSIGNAL|MSG_DONTWAIT);
+	if(ret<0)
+	{
+		if(errno!=EAGAIN && errno!=EWOULDBLOCK && errno!=EINTR)
+		{
+			hub_close(sub,strerror(errno));
+		}
+		else
+		{
+			hub_wait_writable(sub);
+		}
+		return;
+	}
+	if(mh.msg_iovlen==iovcnt && (size_t)ret<(size_t)periods*(4+msg_len)-sub->partial_sent)
+	{
+		//socket buffer full
+		hub_wait_writable(sub);
+	}
+
+	size_t sent=sub->partial_sent+ret;
+	int whole=sent/(4+msg_len);
+	sub->partial_sent=sent%(4+msg_len);
+	sub->position+=(uint64_t)whole*mc_period_bytes;
+	sub->message_number+=whole;
+	sub->bytes_sent+=ret;
+}//end hub_send
+
+//event for subscriber: readable (/join, closed) or writable again
+void hub_event(int index, uint32_t events)
+{
+	hub_subscriber_t *sub=&hub_subscribers[index];
+	if(sub->fd<0)
+	{
+		return;
+	}
+
+	if(events & EPOLLOUT)
+	{
+		sub->waiting_writable=0;
+		epoll_set(sub->fd,EV_SUBSCRIBER+index,EPOLLIN|EPOLLRDHUP,EPOLL_CTL_MOD);
+	}
+
+	if((events & (EPOLLIN|EPOLLRDHUP|EPOLLHUP|EPOLLERR)) && hub_read(sub)<0)
 	{
-		asprintf(&offset_string, "(%d+)", (channel_offset));
+		hub_close(sub,"closed");
 	}
-	else
+}
+
+//send to all subscribers that can take data
+void hub_process()
+{
+	if(hub_socket<0 || process_enabled==0 || port_count<1)
 	{
-		offset_string="";
+		return;
 	}
 
-	char *warn_string="";
-	if((float)can_read_count/max_buffer_size > 0.8)
+	int i;
+	for(i=0;i<MAX_HUB_SUBSCRIBERS;i++)
 	{
-		warn_string="!";
+		hub_subscriber_t *sub=&hub_subscribers[i];
+		if(sub->fd<0 || sub->waiting_writable==1)
+		{
+			continue;
+		}
+		hub_send(sub);
 	}
+}//end hub_process
 
-	if((message_number>0 && relaxed_display_counter>=update_display_every_nth_cycle*port_count)
-		|| last_test_cycle==1
-	)
+//hand new whole periods in the ring to the segment writer
+void segment_collect()
+{
+	if(segment_dir==NULL || process_enabled==0 || port_count<1)
 	{
-		fprintf(stderr,"\r# %" PRId64 " i: %s%d b: %.2f MB (%.2f%s) s: %.2f i: %.2f r: %" PRId64 
-			/*" l: %" PRId64 */" d: %" PRId64 " o: %" PRId64 " p: %.1f # %" PRId64 ", %d (%d), %.2f MB%s",
-			message_number,
-			offset_string,
-			input_port_count,
-			(float)can_read_count/1000/1000,
-			(float)can_read_count/max_buffer_size,
-			warn_string,
-			(float)can_read_count/(float)port_count/(float)bytes_per_sample/(float)sample_rate,
-			time_interval_avg*1000,
-			remote_xrun_counter,/*local_xrun_counter,*/
-			multi_channel_drop_counter,
-			buffer_overflow_counter,
-			(float)frames_since_cycle_start_avg/(float)period_size,
-			message_number_out,last_lo_send_message_tcp_return,
-			port_count,(float)total_bytes_successfully_sent/1000/1000,
-			"\033[0J"
-		);
+		return;
+	}
 
-		fflush(stderr);
+	int mc_period_bytes=port_count*bytes_per_sample*period_size;
 
-		relaxed_display_counter=0;
+	uint64_t write_position=hub_write_position;
+	uint64_t write_index=rb->write_index;
+
+	if(segments_started==0)
+	{
+		if(segments_start(remote_sample_rate>0 ? remote_sample_rate : sample_rate,port_count)!=0)
+		{
+			fprintf(stderr,"not writing segments.\n");
+			segment_dir=NULL;
+			return;
+		}
+		segments_started=1;
+		segment_position=write_position-write_position%mc_period_bytes;
 	}
-	relaxed_display_counter++;
-}//end print_info
 
-//this is not a JACK process cylce
-int process()
-{
-	if(shutdown_in_progress==1)
+	//fell behind (should not happen, called after every event)
+	uint64_t oldest=hub_oldest_position(write_position,mc_period_bytes);
+	if(segment_position<oldest)
 	{
-		return 0;
+		segment_position=oldest;
+	}
+
+	if(segment_staging_size<mc_period_bytes)
+	{
+		rb_free_scratch(segment_staging,segment_staging_size);
+		segment_staging=rb_alloc_scratch(mc_period_bytes);
+		segment_staging_size=mc_period_bytes;
 	}
 
-	if(process_enabled==1)
+	size_t size=rb_size(rb);
+	while(segment_position+mc_period_bytes<=write_position)
 	{
+		size_t start=(write_index+size-(write_position-segment_position)%size)%size;
+		const char *period=(char*)buf_ptr(rb)+start;
+
+		if(start+mc_period_bytes>size)
+		{
+			memcpy(segment_staging,period,size-start);
+			memcpy(segment_staging+size-start,buf_ptr(rb),mc_period_bytes-(size-start));
+			period=segment_staging;
+		}
+
+		segments_add_period(period,port_count,period_size,bytes_per_sample);
+		segment_position+=mc_period_bytes;
+	}
+}//end segment_collect
 
-		//as long as there is data ready to be sent, read and try to send
-		//need: handle case where receiver can not read data fast enough
+//--lotcp: forward whole periods in the ring, one blocking lo_send_message() per period.
+//runs in lotcp_thread. returns <0 if a send failed
+int lotcp_send()
+{
+	//as long as there is data ready to be sent, read and try to send
+	//need: handle case where receiver can not read data fast enough
 //		while(rb_can_read(rb)
 //			>=input_port_count*bytes_per_sample*period_size)
 //		{
 
-		while(rb_can_read(rb)
-			>=port_count*bytes_per_sample*period_size)
-		{
-			//fake consume
+	while(rb_can_read(rb)
+		>=port_count*bytes_per_sample*period_size)
+	{
+		//fake consume
 //			rb_advance_read_pointer(rb,port_count*bytes_per_sample*period_size);
 
-			lo_message mm=lo_message_new();
+		lo_message mm=lo_message_new();
 
-			//add message counter
-			lo_message_add_int64(mm,message_number_out);
+		//add message counter
+		lo_message_add_int64(mm,message_number_out);
 
-			//indicate how many xruns (in sender's JACK)
-			lo_message_add_int64(mm,remote_xrun_counter);
+		//indicate how many xruns (in sender's JACK)
+		lo_message_add_int64(mm,remote_xrun_counter);
 
-			gettimeofday(&tv, NULL);
-			lo_timetag tt;
-			tt.sec=(long)tv.tv_sec;
-			tt.frac=(long)tv.tv_usec;
-			lo_message_add_timetag(mm,tt);
-			lo_message_add_int32(mm,sample_rate);
+		//tv belongs to the event loop
+		struct timeval t;
+		gettimeofday(&t, NULL);
+		lo_timetag tt;
+		tt.sec=(long)t.tv_sec;
+		tt.frac=(long)t.tv_usec;
+		lo_message_add_timetag(mm,tt);
+		lo_message_add_int32(mm,sample_rate);
 
 
-			//blob array, holding one period per channel
+		//blob array, holding one period per channel
 //			lo_blob blob[input_port_count];
-			lo_blob blob[port_count];
+		lo_blob blob[port_count];
 
-			void* membuf = malloc(period_size*bytes_per_sample);
+		void* membuf = malloc(period_size*bytes_per_sample);
 
-			int i;
-			for( i=0; i<port_count; i++ )
-			{
-				//void* membuf = malloc(period_size*bytes_per_sample);
-				rb_read (rb, (char*)membuf, period_size*bytes_per_sample);
-				blob[i]=lo_blob_new(period_size*bytes_per_sample,membuf);
-				lo_message_add_blob(mm,blob[i]);
-			}
-			int ret=lo_send_message(loa_tcp,"/audio",mm);
-			last_lo_send_message_tcp_return=ret;
+		int i;
+		for( i=0; i<port_count; i++ )
+		{
+			//void* membuf = malloc(period_size*bytes_per_sample);
+			rb_read (rb, (char*)membuf, period_size*bytes_per_sample);
+			blob[i]=lo_blob_new(period_size*bytes_per_sample,membuf);
+			lo_message_add_blob(mm,blob[i]);
+		}
+		int ret=lo_send_message(loa_tcp,"/audio",mm);
+		last_lo_send_message_tcp_return=ret;
 
-			if(ret<0)
-			{
+		if(ret<0)
+		{
 //				fprintf(stderr," TCP WARN: msg no: %" PRId64 " size: %" PRId64 " ret: %d ",message_number_out,lo_message_length(mm,"/audio"),ret);
-			}
-			else
-			{
-				total_bytes_successfully_sent+=ret;
+		}
+		else
+		{
+			total_bytes_successfully_sent+=ret;
+			periods_forwarded++;
 
 //				fprintf(stderr," msg no: %" PRId64 " size: %" PRId64 " ret: %d ",message_number_out,lo_message_length(mm,"/audio"),ret);
-				message_number_out++;
-			}
+			message_number_out++;
+		}
 
-			//free
-			//lo_free(membuf);
-			lo_message_free(mm);
-			free(membuf);
-			//free blobls ...
-			for( i=0; i<port_count; i++ )
-			{
-				free(blob[i]);
-			}
+		//free
+		//lo_free(membuf);
+		lo_message_free(mm);
+		free(membuf);
+		//free blobls ...
+		for( i=0; i<port_count; i++ )
+		{
+			free(blob[i]);
+		}
 
-			if(ret<0)
-			{
-				return ret;
-			}
+		if(ret<0)
+		{
+			return ret;
+		}
+
+
+	}//end while has data
+
+	return 0;
+}//end lotcp_send
+
+static void *lotcp_thread_func(void *arg)
+{
+	while(shutdown_in_progress==0)
+	{
+		sem_wait(&lotcp_semaphore);
+		if(shutdown_in_progress==0 && lotcp_send()<0)
+		{
+			//try again after delay_between_tcp_retries
+			usleep(delay_between_tcp_retries*1000);
+		}
+	}
+	return NULL;
+}
+
+//this is not a JACK process cylce
+int process()
+{
+	if(shutdown_in_progress==1)
+	{
+		return 0;
+	}
 
+	//refill ringbuffer from spool if there is room
+	spool_drain();
 
-		}//end while has data
+	hub_process();
 
+	segment_collect();
+
+	if(primary_enabled==0)
+	{
 		return 0;
+	}
+	else if(process_enabled==1 && use_lo_tcp==0)
+	{
+		if(tcp_socket<0 && tcp_retry_pending==0 && tcp_connect()<0)
+		{
+			tcp_fail(NULL);
+		}
+
+		if(tcp_socket<0 || tcp_connecting==1 || tcp_waiting_writable==1)
+		{
+			return 0;
+		}
 
+		//cork: don't send partial segments while more than one batch is available
+		int cork=rb_can_read(rb)>(size_t)max_iov_periods()*port_count*bytes_per_sample*period_size;
+		if(cork)
+		{
+			setsockopt(tcp_socket,IPPROTO_TCP,TCP_CORK,&cork,sizeof(cork));
+		}
+
+		//as long as there is data ready to be sent, forward in batches
+		int ret;
+		do
+		{
+			ret=forward_periods();
+		}
+		while(ret>0 && tcp_waiting_writable==0
+			&& rb_can_read(rb)>=port_count*bytes_per_sample*period_size);
+
+		if(cork && tcp_socket>=0)
+		{
+			cork=0;
+			setsockopt(tcp_socket,IPPROTO_TCP,TCP_CORK,&cork,sizeof(cork));
+		}
+
+		return ret<0 ? ret : 0;
+	}
+	else if(process_enabled==1)
+	{
+		//--lotcp: wake up lotcp_thread
+		int pending;
+		sem_getvalue(&lotcp_semaphore,&pending);
+		if(pending<1 && rb_can_read(rb)>=port_count*bytes_per_sample*period_size)
+		{
+			sem_post(&lotcp_semaphore);
+		}
+		return 0;
 	}//end if process enabled
 	//process not yet enabled, buffering
 	else
@@ -349,11 +1595,28 @@ static void print_help (void)
 	fprintf (stderr, "  Number of channels to forward  (2) --out    <integer>\n");
 	fprintf (stderr, "  Channel Offset                 (0) --offset <integer>\n");
 	fprintf (stderr, "  Max buffer size (>= init) [MB](10) --max    <integer>\n");
+	fprintf (stderr, "  Max periods per TCP write     (64) --batch  <integer>\n");
+	fprintf (stderr, "  Forward via lo_send_message        --lotcp\n");
+	fprintf (stderr, "  Serve TCP subscribers on port      --hub    <string>\n");
+	fprintf (stderr, "     Subscribers start at       (live) --join   <live|oldest>\n");
+	fprintf (stderr, "  Write rolling segments + playlist  --segments <string>\n");
+	fprintf (stderr, "     Segment duration [s]        (4) --segdur <float>\n");
+	fprintf (stderr, "     Segments in playlist        (6) --seglist <integer>\n");
+	fprintf (stderr, "     Group first:count[:fmt[:q]] (all:wav) --group <string>\n");
+	fprintf (stderr, "     Encoder threads             (2) --workers <integer>\n");
+	fprintf (stderr, "  Spool to disk if buffer full       --spool  <string>\n");
+	fprintf (stderr, "     High watermark [%%]         (80) --high   <integer>\n");
+	fprintf (stderr, "     Catch-up rate [kbit/s] (unlim.) --catchup <float>\n");
+	fprintf (stderr, "     Segment size [MB]         (100) --segment <integer>\n");
 	fprintf (stderr, "  Update info every nth cycle   (99) --update <integer>\n");
 	fprintf (stderr, "  Limit processing count             --limit  <integer>\n");
+	print_net_help();
+	print_alloc_help();
 	fprintf (stderr, "listening_port:   <integer>\n\n");
 	fprintf (stderr, "target_host:      <string>\n\n");
 	fprintf (stderr, "target_port:      <integer>\n\n");
+	fprintf (stderr, "If target_host is \"-\": no single target, only --hub subscribers / --segments.\n");
+	fprintf (stderr, "Segment formats: wav, flac, vorbis, opus (1-2 channels). q: quality 0..1\n");
 
 	fprintf (stderr, "Example: jack_audio_receive --out 8 --connect --pre 200 1234\n");
 	fprintf (stderr, "One message corresponds to one multi-channel (mc) period.\n");
@@ -388,6 +1651,21 @@ main (int argc, char *argv[])
 		{"offset",	required_argument, 	0, 'f'},
 		{"16",          no_argument,            0, 'y'},
 		{"max",		required_argument,	0, 'm'},//max (allocate) buffer
+		{"batch",	required_argument,	0, 'b'},//max periods per sendmsg
+		{"lotcp",	no_argument,		&use_lo_tcp, 1},
+		NET_LONG_OPTIONS,
+		ALLOC_LONG_OPTIONS,
+		{"hub",		required_argument,	0, 'p'},//listening port for subscribers
+		{"join",	required_argument,	0, 'j'},//live or oldest
+		{"segments",	required_argument,	0, 'e'},//segment directory
+		{"segdur",	required_argument,	0, 'r'},//segment duration
+		{"seglist",	required_argument,	0, 'i'},//playlist size
+		{"group",	required_argument,	0, 'g'},//channel group, format (repeatable)
+		{"workers",	required_argument,	0, 'k'},//encoder threads
+		{"spool",	required_argument,	0, 'd'},//spool directory
+		{"high",	required_argument,	0, 'w'},//high watermark percent
+		{"catchup",	required_argument,	0, 'c'},//max kbit/s when draining spool
+		{"segment",	required_argument,	0, 's'},//spool segment size MB
 		{"update",	required_argument,	0, 'u'},//screen info update every nth cycle
 		{"limit",	required_argument,	0, 'l'},//test, stop after n processed
 		{0, 0, 0, 0}
@@ -461,6 +1739,58 @@ main (int argc, char *argv[])
 				max_buffer_size=fmax(1,(uint64_t)atoll(optarg)*1000*1000);
 				break;
 
+			case 'b':
+				max_batch_periods=fmax(1,atoi(optarg));
+				break;
+
+			case 'p':
+				hub_port=optarg;
+				break;
+
+			case 'j':
+				hub_join_oldest=!strcmp(optarg,"oldest");
+				break;
+
+			case 'e':
+				segment_dir=optarg;
+				break;
+
+			case 'r':
+				segment_duration=fmax(0.1,atof(optarg));
+				break;
+
+			case 'i':
+				segment_list_size=fmax(1,atoi(optarg));
+				break;
+
+			case 'g':
+				if(segments_add_group(optarg)!=0)
+				{
+					exit(1);
+				}
+				break;
+
+			case 'k':
+				segment_workers=fmax(1,atoi(optarg));
+				break;
+
+			case 'd':
+				spool_dir=optarg;
+				break;
+
+			case 'w':
+				spool_high_watermark=fmin(100,fmax(1,atoi(optarg)))/100;
+				break;
+
+			case 'c':
+				catchup_rate=fmax(0,atof(optarg));
+				break;
+
+			case 's':
+				//min 1 MB
+				spool_segment_size=fmax(1,(uint64_t)atoll(optarg))*1000*1000;
+				break;
+
 			case 'u':
 				update_display_every_nth_cycle=fmax(1,(uint64_t)atoll(optarg));
 				break;
@@ -472,6 +1802,26 @@ main (int argc, char *argv[])
 
 				break;
 
+			case NET_OPT_RCVBUF:
+			case NET_OPT_SNDBUF:
+			case NET_OPT_BUSY_POLL:
+			case NET_OPT_DSCP:
+			case NET_OPT_SOCK_PRIORITY:
+			case NET_OPT_CPU:
+			case NET_OPT_RT_PRIORITY:
+				if(net_option(opt,optarg)!=0)
+				{
+					exit(1);
+				}
+				break;
+
+			case OPT_ALLOC:
+				if(alloc_option(optarg)!=0)
+				{
+					exit(1);
+				}
+				break;
+
 			case '?': //invalid commands
 				/* getopt_long already printed an error message. */
 				fprintf (stderr, "Wrong arguments, see --help.\n\n");
@@ -505,12 +1855,45 @@ main (int argc, char *argv[])
 
 	listenPort=argv[optind];
 
+	if(check_net_options()!=0)
+	{
+		exit(1);
+	}
+
+	rb_set_alloc_policy(alloc_policy);
+
 	//tcp target
 	remote_tcp_host=argv[optind+1];
 	remote_tcp_port=argv[optind+2];
 
+	if(!strcmp(remote_tcp_host,"-"))
+	{
+		primary_enabled=0;
+		if(hub_port==NULL && segment_dir==NULL)
+		{
+			fprintf(stderr,"no target, no --hub and no --segments, nothing to do.\n");
+			exit(1);
+		}
+		if(spool_dir!=NULL)
+		{
+			fprintf(stderr,"--spool needs a target, ignoring.\n");
+			spool_dir=NULL;
+		}
+	}
+
 	loa_tcp = lo_address_new_with_proto(LO_TCP, remote_tcp_host, remote_tcp_port);
 
+	if(primary_enabled==1 && use_lo_tcp==1)
+	{
+		sem_init(&lotcp_semaphore,0,0);
+		if(pthread_create(&lotcp_thread,NULL,lotcp_thread_func,NULL)!=0)
+		{
+			fprintf(stderr,"could not start --lotcp thread.\n");
+			exit(1);
+		}
+		lotcp_thread_started=1;
+	}
+
 	//initialize time
 	gettimeofday(&tv, NULL);
 	tt_prev.sec=tv.tv_sec;
@@ -525,11 +1908,25 @@ main (int argc, char *argv[])
 	fprintf(stderr,"channels (forward): %d\n",output_port_count);
 	fprintf(stderr,"channel offset: %d\n",channel_offset);
 
-	fprintf(stderr, "TCP target: %s:%s\n",remote_tcp_host,remote_tcp_port);
+	if(primary_enabled==1)
+	{
+		fprintf(stderr, "TCP target: %s:%s\n",remote_tcp_host,remote_tcp_port);
+	}
+	else
+	{
+		fprintf(stderr, "TCP target: none (hub only)\n");
+	}
 
 	fprintf(stderr, "period size (TCP forward): %d samples\n",period_size);
 
-	fprintf(stderr, "delay between TCP sends: %d ms\n",delay_between_tcp_sends);
+	if(use_lo_tcp==1)
+	{
+		fprintf(stderr, "TCP forwarding: lo_send_message, one message per period\n");
+	}
+	else
+	{
+		fprintf(stderr, "TCP forwarding: sendmsg, up to %d periods per call\n",max_batch_periods);
+	}
 	fprintf(stderr, "delay between TCP retries on broken connection: %d ms\n",delay_between_tcp_retries);
 
 	//ringbuffer size bytes
@@ -548,11 +1945,27 @@ main (int argc, char *argv[])
 
 	fprintf(stderr,"allocated buffer size: %" PRId64 " bytes (%.2f MB)\n",max_buffer_size,(float)max_buffer_size/1000/1000);
 
+	if(spool_dir!=NULL)
+	{
+		if(access(spool_dir,W_OK)!=0)
+		{
+			fprintf(stderr,"spool directory %s not writable: %s\n",spool_dir,strerror(errno));
+			exit(1);
+		}
+		fprintf(stderr,"spool to disk above %.0f%% buffer fill: %s (segments of %.0f MB)\n",
+			spool_high_watermark*100,spool_dir,(float)spool_segment_size/1000/1000);
+		if(catchup_rate>0)
+		{
+			fprintf(stderr,"catch-up rate: %.1f kbit/s\n",catchup_rate);
+		}
+	}
+
 	//====================================
 	//main ringbuffer osc blobs -> jack output
-	rb = rb_new (rb_size);
+	//mirrored: periods crossing the buffer end are still one piece for sendmsg()
+	rb = rb_new_mirrored (rb_size);
 	//helper ringbuffer: used when remote period size < local period size
-	rb_helper = rb_new (rb_size);
+	rb_helper = rb_new_mirrored (rb_size);
 
 	if(rb==NULL)
 	{
@@ -561,6 +1974,32 @@ main (int argc, char *argv[])
 		exit(1);
 	}
 
+	//allocate once for the max channel count, forward_periods() doesn't malloc
+	tcp_header_size_max=4+8+((5+max_channel_count+1+3) & ~3)+8+8+8+4+4;
+	tcp_header_buffer=rb_alloc_scratch(max_batch_periods*tcp_header_size_max);
+	tcp_iov_max=max_batch_periods*(1+max_channel_count*3+1);
+	tcp_iov=rb_alloc_scratch(tcp_iov_max*sizeof(struct iovec));
+
+	//one message of max channel count, max 4 bytes per sample
+	tcp_partial_buffer=rb_alloc_scratch(tcp_header_size_max+max_channel_count*(4+period_size*4+3));
+
+	if(tcp_header_buffer==NULL || tcp_iov==NULL || tcp_partial_buffer==NULL)
+	{
+		fprintf(stderr,"could not allocate TCP send buffers.\n");
+		exit(1);
+	}
+
+	if(hub_port!=NULL)
+	{
+		if(hub_start()!=0)
+		{
+			fprintf(stderr,"could not listen for subscribers on TCP port %s: %s\n",hub_port,strerror(errno));
+			exit(1);
+		}
+		fprintf(stderr,"serving subscribers on TCP port: %s (join at %s, history: %.2f MB)\n",
+			hub_port,hub_join_oldest==1 ? "oldest" : "live",(float)(rb_size-rb_size/8)/1000/1000);
+	}
+
 	/* install a signal handler to properly quits jack client */
 #ifndef _WIN
 	signal(SIGQUIT, signal_handler);
@@ -569,14 +2008,43 @@ main (int argc, char *argv[])
 	signal(SIGTERM, signal_handler);
 	signal(SIGINT, signal_handler);
 
-	//add osc hooks & start UDP server
+	//add osc hooks, UDP server is served by the event loop (not started as thread)
 	registerOSCMessagePatterns(listenPort);
-	lo_server_thread_start(lo_st);
+	lo_server lo_s=lo_server_thread_get_server(lo_st);
+
+	apply_net_socket_options(lo_server_get_socket_fd(lo_s),"UDP");
+	//the event loop is the network thread
+	apply_net_thread_options("event loop");
+	print_net_properties();
+	print_alloc_properties();
 
 	//start TCP server, for forwarding to final receiver
 	lo_st_tcp = lo_server_thread_new_with_proto(listenPort, LO_TCP, error);
 	lo_server_thread_start(lo_st_tcp);
 
+	epoll_fd=epoll_create1(0);
+	retry_timer_fd=timerfd_create(CLOCK_MONOTONIC,TFD_NONBLOCK);
+	tick_timer_fd=timerfd_create(CLOCK_MONOTONIC,TFD_NONBLOCK);
+
+	if(epoll_fd<0 || retry_timer_fd<0 || tick_timer_fd<0)
+	{
+		fprintf(stderr,"could not set up event loop: %s\n",strerror(errno));
+		exit(1);
+	}
+
+	struct itimerspec its;
+	its.it_value.tv_sec=its.it_interval.tv_sec=0;
+	its.it_value.tv_nsec=its.it_interval.tv_nsec=tick_interval*1000000;
+	timerfd_settime(tick_timer_fd,0,&its,NULL);
+
+	epoll_set(lo_server_get_socket_fd(lo_s),EV_UDP,EPOLLIN,EPOLL_CTL_ADD);
+	epoll_set(retry_timer_fd,EV_RETRY,EPOLLIN,EPOLL_CTL_ADD);
+	epoll_set(tick_timer_fd,EV_TICK,EPOLLIN,EPOLL_CTL_ADD);
+	if(hub_socket>=0)
+	{
+		epoll_set(hub_socket,EV_HUB,EPOLLIN,EPOLL_CTL_ADD);
+	}
+
 	fflush(stderr);
 
 	/* keep running until the Ctrl+C */
@@ -588,27 +2056,80 @@ main (int argc, char *argv[])
 			signal_handler(42);
 		}
 
-		//if tcp message could not be sent
-		if(process()<0)
-		{
-			//wait x and update info
-			int i;
-			for(i=0;i<delay_between_tcp_retries;i++)
-			{
-				usleep(1000);
-				print_info();
-			}
-		}
-		else
+		struct epoll_event events[16];
+		int n=epoll_wait(epoll_fd,events,16,-1);
+
+		int i;
+		for(i=0;i<n;i++)
 		{
-			//wait y and update info
-			int i;
-			for(i=0;i<delay_between_tcp_sends;i++)
+			uint64_t tag=events[i].data.u64;
+			uint64_t value;
+
+			switch(tag)
 			{
-				usleep(1000);
-				print_info();
+				case EV_UDP:
+					//handlers run here, new periods are forwarded by process() below
+					while(lo_server_recv_noblock(lo_s,0)>0)
+					{
+						print_info();
+					}
+					break;
+
+				case EV_TCP:
+					if(tcp_socket<0)
+					{
+						//closed earlier in this round
+						break;
+					}
+					else if(tcp_connecting==1)
+					{
+						if(tcp_connect_finish()<0)
+						{
+							tcp_fail(NULL);
+						}
+					}
+					else if(events[i].events & (EPOLLRDHUP|EPOLLHUP|EPOLLERR))
+					{
+						tcp_fail("closed by receiver");
+					}
+					else if(events[i].events & EPOLLOUT)
+					{
+						tcp_waiting_writable=0;
+						epoll_set(tcp_socket,EV_TCP,EPOLLIN|EPOLLRDHUP,EPOLL_CTL_MOD);
+					}
+					else if(events[i].events & EPOLLIN)
+					{
+						//receiver doesn't send anything, discard
+						char buf[256];
+						if(recv(tcp_socket,buf,sizeof(buf),MSG_DONTWAIT)==0)
+						{
+							tcp_fail("closed by receiver");
+						}
+					}
+					break;
+
+				case EV_RETRY:
+					read(retry_timer_fd,&value,sizeof(value));
+					tcp_retry_pending=0;
+					break;
+
+				case EV_TICK:
+					read(tick_timer_fd,&value,sizeof(value));
+					print_info();
+					break;
+
+				case EV_HUB:
+					hub_accept();
+					break;
+
+				default:
+					hub_event(tag-EV_SUBSCRIBER,events[i].events);
+					break;
 			}
 		}
+
+		//spool catch-up, forward to target and subscribers
+		process();
 	}
 	exit (0);
 }
@@ -632,42 +2153,27 @@ void registerOSCMessagePatterns(const char *port)
 */
 
 	lo_server_thread_add_method(lo_st, "/offer", "fiiiifh", offer_handler, NULL);
+	//8) s: socket options of sender (--rcvbuf etc.)
+	lo_server_thread_add_method(lo_st, "/offer", "fiiiifhs", offer_handler, NULL);
 
 /*
-	/audio hhtib*
+	/audio hhtihib*
 
 	1) h: message number
 	2) h: xrun counter (sender side, as all the following meta data)
 	3) t: timetag (seconds since Jan 1st 1900 in the UTC, fraction 1/2^32nds of a second)
 	4) i: sampling rate
-	5) b: blob of channel 1 (period size * bytes per sample) bytes long
+	5) h: sender JACK frame time of the period (64 bit)
+	6) i: frames since period start when the timetag was taken
+	7) b: blob of channel 1 (period size * bytes per sample) bytes long
 	...
 	...b: up to n channels
-*/
-
-	char typetag_string[1024];
-	int v=0;
-	for(v=0;v<1024;v++)
-	{
-		typetag_string[v]='\0';
-	}
-
-	//char *prefix="hhti";
-	typetag_string[0]='h';
-	typetag_string[1]='h';
-	typetag_string[2]='t';
-	typetag_string[3]='i';
 
-	/////////////////
-	int data_offset=4;
+	/audio hhtib* (without 5, 6) is accepted too
+*/
 
-	v=0;
-	for(v=0;v<max_channel_count;v++)
-	{
-		typetag_string[data_offset+v]='b';
-		lo_server_thread_add_method(lo_st, "/audio", typetag_string, audio_handler, NULL);
-	}
 	//the max possible channel count depends on JACK period size, SR, liblo version (fixmax), 16/32 bit, 100/1000 mbit/s network
+	register_audio_methods(audio_handler);
 
 }//end registerocsmessages
 
@@ -706,6 +2212,10 @@ int offer_handler(const char *path, const char *types, lo_arg **argv, int argc,
 
 	fprintf(stderr,"\nsender sample rate: %d\n",offered_sample_rate);
 	fprintf(stderr,"sender bytes per sample: %d\n",offered_bytes_per_sample);
+	if(argc>7)
+	{
+		fprintf(stderr,"sender network: %s\n",&argv[7]->s);
+	}
 
 	//re-use for forwarding
 	sample_rate=offered_sample_rate;
@@ -782,7 +2292,7 @@ int audio_handler(const char *path, const char *types, lo_arg **argv, int argc,
 	gettimeofday(&tv, NULL);
 
 	//first blob is at data_offset+1 (one-based)
-	int data_offset=4;
+	int data_offset=audio_data_offset(types);
 
 	//ignore first n channels/blobs
 	data_offset+=channel_offset;
@@ -817,6 +2327,12 @@ int audio_handler(const char *path, const char *types, lo_arg **argv, int argc,
 
 	//need to warn when offset + outchannels limited
 
+	//all channels silent (empty blobs) and no /offer seen: can't know remote period size yet
+	if(remote_period_size==0 && first_blob_datasize(argv,data_offset,argc)==0)
+	{
+		return 0;
+	}
+
 	//check sample rate and period size if sender (re)started or values not yet initialized (=no /offer received)
 	if(message_number_prev>message_number || message_number==1 || remote_sample_rate==0 || remote_period_size==0 )
 	{
@@ -829,7 +2345,12 @@ int audio_handler(const char *path, const char *types, lo_arg **argv, int argc,
 
 		remote_sample_rate=argv[3]->i;
 
-		remote_period_size=lo_blob_datasize((lo_blob)argv[0+data_offset])/bytes_per_sample;
+		//silent channels are empty, use first non-empty blob. keep value from /offer if all silent
+		int blob_size=first_blob_datasize(argv,data_offset,argc);
+		if(blob_size>0)
+		{
+			remote_period_size=blob_size/bytes_per_sample;
+		}
 		fprintf(stderr,"\nsender was (re)started. ");
 
 		if(remote_period_size!=period_size)
@@ -872,9 +2393,26 @@ int audio_handler(const char *path, const char *types, lo_arg **argv, int argc,
 
 	int mc_period_bytes=period_size*bytes_per_sample*port_count;
 
+	//all data of this message goes either to the ringbuffer or to the spool
+	int to_spool=spool_decide(mc_period_bytes);
+
+	//room for all periods this message can complete
+	size_t room=mc_period_bytes*MAX_(1,remote_period_size/period_size);
+	if(primary_enabled==0)
+	{
+		ring_make_room(room,mc_period_bytes);
+	}
+	else if(to_spool==0 && primary_may_drop())
+	{
+		//the target sees the gap in the message numbers
+		int lost=ring_make_room(room,mc_period_bytes);
+		message_number_out+=lost;
+		primary_lost_periods+=lost;
+	}
+
 	//check if a whole mc period can be written to the ringbuffer
 	uint64_t can_write_count=rb_can_write(rb);
-	if(can_write_count < mc_period_bytes)
+	if(to_spool==0 && can_write_count < mc_period_bytes)
 	{
 			buffer_overflow_counter++;
 			/////////////////
@@ -892,12 +2430,13 @@ int audio_handler(const char *path, const char *types, lo_arg **argv, int argc,
 		for(i=0;i < port_count;i++)
 		{
 			//get blob (=one period of one channel)
-			unsigned char *data = lo_blob_dataptr((lo_blob)argv[i+data_offset]);
+			unsigned char *data = blob_data_local((lo_blob)argv[i+data_offset],
+				remote_period_size,i);
 			//fprintf(stderr,"size %d\n",lo_blob_datasize((lo_blob)argv[i+data_offset]));
 
 			//write to ringbuffer
 			//==========================================
-			int cnt=rb_write(rb, (void *) data, 
+			write_period_data(to_spool, (void *) data,
 				period_size*bytes_per_sample);
 		}
 	}
@@ -908,7 +2447,8 @@ int audio_handler(const char *path, const char *types, lo_arg **argv, int argc,
 		for(i=0;i < port_count;i++)
 		{
 			//get blob (=one period of one channel)
-			unsigned char *data = lo_blob_dataptr((lo_blob)argv[i+data_offset]);
+			unsigned char *data = blob_data_local((lo_blob)argv[i+data_offset],
+				remote_period_size,i);
 			//fprintf(stderr,"size %d\n",lo_blob_datasize((lo_blob)argv[i+data_offset]));
 
 			//write to temporary ringbuffer until there is enough data
@@ -920,14 +2460,21 @@ int audio_handler(const char *path, const char *types, lo_arg **argv, int argc,
 		//if enough data collected for one larger multichannel period
 
 		while(rb_can_read(rb_helper)	>=mc_period_bytes
-		&& rb_can_write(rb)		>=mc_period_bytes)
+		&& (to_spool==1 || rb_can_write(rb)	>=mc_period_bytes))
 		{
-			//transfer from helper to main ringbuffer
+			//transfer from helper to main ringbuffer, reading the helper in place
+			rb_region_t regions[2];
+			rb_read_reserve(rb_helper,mc_period_bytes,regions);
 			unsigned char* data;
-			data=malloc(				mc_period_bytes);
 			//store orig pointer
-			unsigned char* orig_data=data;
-			rb_read(rb_helper,data,	mc_period_bytes);
+			unsigned char* orig_data=(unsigned char*)regions[0].buffer;
+			if(regions[1].size>0)
+			{
+				//period wraps around the end of a plain (not mirrored) helper buffer
+				orig_data=malloc(mc_period_bytes);
+				memcpy(orig_data,regions[0].buffer,regions[0].size);
+				memcpy(orig_data+regions[0].size,regions[1].buffer,regions[1].size);
+			}
 
 			for(i=0;i < port_count;i++)
 			{
@@ -941,11 +2488,14 @@ int audio_handler(const char *path, const char *types, lo_arg **argv, int argc,
 							+ i*remote_period_size*bytes_per_sample;
 
 					//write one channel snipped (remote_period_size) to main buffer
-					int w=rb_write(rb,(void *)data,remote_period_size*bytes_per_sample);
+					write_period_data(to_spool,(void *)data,remote_period_size*bytes_per_sample);
 				}
 			}
-			data=orig_data;
-			free(data);
+			if(regions[1].size>0)
+			{
+				free(orig_data);
+			}
+			rb_read_commit(rb_helper,mc_period_bytes);
 		}
 	}
 	else if(period_size<remote_period_size)
@@ -959,19 +2509,25 @@ int audio_handler(const char *path, const char *types, lo_arg **argv, int argc,
 			for(i=0;i < port_count;i++)
 			{
 				//get blob (=one period of one channel)
-				unsigned char *data = lo_blob_dataptr((lo_blob)argv[i+data_offset]);
+				unsigned char *data = blob_data_local((lo_blob)argv[i+data_offset],
+					remote_period_size,i);
 				//fprintf(stderr,"size %d\n",lo_blob_datasize((lo_blob)argv[i+data_offset]));
 
 				//write to ringbuffer
 				//==========================================
 				data+=k*period_size*bytes_per_sample;
 
-				int cnt=rb_write(rb, (void *) data, 
+				write_period_data(to_spool, (void *) data,
 					period_size*bytes_per_sample);
 			}
 		}
 	}
 
+	if(to_spool==1)
+	{
+		spool_commit();
+	}
+
 	return 0;
 }//end audio_handler
 
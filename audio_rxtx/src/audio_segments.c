@@ -0,0 +1,724 @@
+/* part of audio_rxtx
+ *
+ * This program is free software; feel free to redistribute it and/or
+ * modify it.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. bla.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+#include <limits.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sndfile.h>
+#include <opus/opus.h>
+#include <ogg/ogg.h>
+#include <lo/lo.h>
+
+#include "jack_audio_common.h"
+#include "audio_segments.h"
+
+//audio_post_send collects periods into segment buffers (segments_add_period).
+//a full buffer becomes one job per group, encoded in parallel by the workers.
+//workers may finish out of order, the playlist of a group only lists contiguous segments.
+
+#define MAX_SEGMENT_GROUPS 8
+//one collecting, the others queued or being encoded
+#define MAX_SEGMENT_BUFFERS 16
+//completed segments are tracked in a ring (per group)
+#define SEGMENT_DONE_RING 256
+
+char *segment_dir=NULL; //param
+float segment_duration=4; //param
+int segment_workers=2; //param
+int segment_list_size=6; //param
+
+//segments older than the playlist window + this are deleted
+int segment_keep_extra=2;
+
+//full buffer but no free one to continue
+uint64_t segments_dropped=0;
+
+enum
+{
+	SEGMENT_WAV,
+	SEGMENT_FLAC,
+	SEGMENT_VORBIS,
+	SEGMENT_OPUS
+};
+
+static const char *segment_format_names[]={"wav","flac","vorbis","opus"};
+static const char *segment_extensions[]={"wav","flac","ogg","opus"};
+
+typedef struct
+{
+	int first_channel;
+	int channel_count;
+	int format;
+	//0..1, <0: default
+	double quality;
+	char dir[PATH_MAX];
+
+	pthread_mutex_t lock;
+	//first sequence number not yet in playlist
+	uint64_t next_listed;
+	//sequence+1 if done
+	uint64_t done[SEGMENT_DONE_RING];
+	char failed[SEGMENT_DONE_RING];
+
+	//encode time / segment duration
+	float last_rt;
+	float max_rt;
+	uint64_t encoded_count;
+} segment_group_t;
+
+typedef struct
+{
+	//interleaved float, all channels
+	float *data;
+	uint64_t sequence;
+	//groups not yet done with this buffer (protected by job_lock)
+	int pending;
+} segment_buffer_t;
+
+typedef struct
+{
+	int buffer;
+	int group;
+} segment_job_t;
+
+static segment_group_t groups[MAX_SEGMENT_GROUPS];
+static int group_count=0;
+
+static segment_buffer_t buffers[MAX_SEGMENT_BUFFERS];
+static int buffer_count=0;
+//buffer collecting incoming periods, -1: none
+static int collecting=-1;
+static int collecting_frames=0;
+
+static int frames_per_segment=0;
+static int segment_channels=0;
+static int segment_sample_rate=0;
+static uint64_t next_sequence=0;
+
+static segment_job_t jobs[MAX_SEGMENT_BUFFERS*MAX_SEGMENT_GROUPS];
+static int job_head=0;
+static int job_count=0;
+static pthread_mutex_t job_lock=PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t job_cond=PTHREAD_COND_INITIALIZER;
+
+//================================================================
+int segments_add_group(const char *spec)
+{
+	if(group_count>=MAX_SEGMENT_GROUPS)
+	{
+		fprintf(stderr,"max. %d segment groups\n",MAX_SEGMENT_GROUPS);
+		return 1;
+	}
+
+	segment_group_t *g=&groups[group_count];
+	memset(g,0,sizeof(segment_group_t));
+
+	char format[16]="wav";
+	g->quality=-1;
+	if(sscanf(spec,"%d:%d:%15[^:]:%lf",&g->first_channel,&g->channel_count,format,&g->quality)<2)
+	{
+		fprintf(stderr,"invalid group '%s', use first_channel:channel_count[:format[:quality]]\n",spec);
+		return 1;
+	}
+
+	g->format=-1;
+	int i;
+	for(i=0;i<4;i++)
+	{
+		if(!strcmp(format,segment_format_names[i]))
+		{
+			g->format=i;
+		}
+	}
+	if(g->format<0)
+	{
+		fprintf(stderr,"unknown segment format '%s' (wav, flac, vorbis, opus)\n",format);
+		return 1;
+	}
+
+	group_count++;
+	return 0;
+}//end segments_add_group
+
+//================================================================
+static void segment_path(char *path, size_t size, segment_group_t *g, uint64_t sequence)
+{
+	snprintf(path,size,"%s/seg%08" PRIu64 ".%s",g->dir,sequence,segment_extensions[g->format]);
+}
+
+//================================================================
+//rough bits per second for master playlist
+static int group_bandwidth(segment_group_t *g)
+{
+	int pcm=segment_sample_rate*g->channel_count*16;
+	double q=g->quality<0 ? 0.5 : g->quality;
+
+	switch(g->format)
+	{
+		case SEGMENT_FLAC:
+			return pcm*0.6;
+		case SEGMENT_VORBIS:
+		case SEGMENT_OPUS:
+			return g->channel_count*(16000+q*112000);
+		default:
+			return pcm;
+	}
+}
+
+//================================================================
+static void write_master_playlist()
+{
+	char path[PATH_MAX];
+	snprintf(path,sizeof(path),"%s/master.m3u8",segment_dir);
+
+	FILE *f=fopen(path,"w");
+	if(f==NULL)
+	{
+		fprintf(stderr,"could not write %s: %s\n",path,strerror(errno));
+		return;
+	}
+
+	fprintf(f,"#EXTM3U\n");
+	int i;
+	for(i=0;i<group_count;i++)
+	{
+		fprintf(f,"#EXT-X-STREAM-INF:BANDWIDTH=%d\ng%d/index.m3u8\n",group_bandwidth(&groups[i]),i);
+	}
+	fclose(f);
+}
+
+//================================================================
+//called with group lock held. list contiguous done segments, delete old ones
+static void update_playlist(segment_group_t *g)
+{
+	uint64_t listed_before=g->next_listed;
+
+	while(g->done[g->next_listed%SEGMENT_DONE_RING]==g->next_listed+1)
+	{
+		g->next_listed++;
+	}
+
+	if(g->next_listed==listed_before)
+	{
+		return;
+	}
+
+	char path[PATH_MAX];
+	char tmp[PATH_MAX];
+	snprintf(path,sizeof(path),"%s/index.m3u8",g->dir);
+	snprintf(tmp,sizeof(tmp),"%s/index.m3u8.tmp",g->dir);
+
+	FILE *f=fopen(tmp,"w");
+	if(f==NULL)
+	{
+		return;
+	}
+
+	uint64_t first=g->next_listed>segment_list_size ? g->next_listed-segment_list_size : 0;
+
+	fprintf(f,"#EXTM3U\n#EXT-X-VERSION:3\n#EXT-X-TARGETDURATION:%d\n#EXT-X-MEDIA-SEQUENCE:%" PRIu64 "\n",
+		(int)ceil(segment_duration),first);
+
+	int discontinuity=0;
+	uint64_t seq;
+	for(seq=first;seq<g->next_listed;seq++)
+	{
+		if(g->failed[seq%SEGMENT_DONE_RING])
+		{
+			discontinuity=1;
+			continue;
+		}
+		if(discontinuity)
+		{
+			fprintf(f,"#EXT-X-DISCONTINUITY\n");
+			discontinuity=0;
+		}
+		fprintf(f,"#EXTINF:%.3f,\nseg%08" PRIu64 ".%s\n",segment_duration,seq,segment_extensions[g->format]);
+	}
+	fclose(f);
+
+	//replace atomically, the http server never sees a partial playlist
+	rename(tmp,path);
+
+	for(seq=listed_before;seq<g->next_listed;seq++)
+	{
+		if(seq>=segment_list_size+segment_keep_extra)
+		{
+			char old[PATH_MAX];
+			segment_path(old,sizeof(old),g,seq-segment_list_size-segment_keep_extra);
+			unlink(old);
+		}
+	}
+}//end update_playlist
+
+//================================================================
+static inline void put_le16(unsigned char *p, int v)
+{
+	p[0]=v & 0xff;
+	p[1]=(v>>8) & 0xff;
+}
+
+static inline void put_le32(unsigned char *p, uint32_t v)
+{
+	put_le16(p,v & 0xffff);
+	put_le16(p+2,v>>16);
+}
+
+//================================================================
+static int write_ogg_pages(ogg_stream_state *os, FILE *f, int flush)
+{
+	ogg_page og;
+	while(flush ? ogg_stream_flush(os,&og) : ogg_stream_pageout(os,&og))
+	{
+		if(fwrite(og.header,1,og.header_len,f)!=og.header_len
+			|| fwrite(og.body,1,og.body_len,f)!=og.body_len)
+		{
+			return -1;
+		}
+	}
+	return 0;
+}
+
+//================================================================
+//Ogg Opus (RFC 7845), channel mapping family 0 (1 or 2 channels)
+static int write_opus_segment(const char *path, const float *data, int frames, int channels,
+	double quality, uint64_t sequence)
+{
+	int err;
+	OpusEncoder *enc=opus_encoder_create(segment_sample_rate,channels,OPUS_APPLICATION_AUDIO,&err);
+	if(err!=OPUS_OK)
+	{
+		return -1;
+	}
+
+	if(quality>=0)
+	{
+		opus_encoder_ctl(enc,OPUS_SET_BITRATE((opus_int32)(channels*(16000+quality*112000))));
+	}
+
+	opus_int32 lookahead=0;
+	opus_encoder_ctl(enc,OPUS_GET_LOOKAHEAD(&lookahead));
+
+	//granule positions are in 48 kHz units
+	int scale=48000/segment_sample_rate;
+	int pre_skip=lookahead*scale;
+
+	FILE *f=fopen(path,"wb");
+	if(f==NULL)
+	{
+		opus_encoder_destroy(enc);
+		return -1;
+	}
+
+	ogg_stream_state os;
+	ogg_stream_init(&os,(int)sequence);
+
+	unsigned char head[19];
+	memcpy(head,"OpusHead",8);
+	head[8]=1;
+	head[9]=channels;
+	put_le16(head+10,pre_skip);
+	put_le32(head+12,segment_sample_rate);
+	put_le16(head+16,0);
+	head[18]=0;
+
+	ogg_packet op;
+	memset(&op,0,sizeof(op));
+	op.packet=head;
+	op.bytes=sizeof(head);
+	op.b_o_s=1;
+	ogg_stream_packetin(&os,&op);
+	int ret=write_ogg_pages(&os,f,1);
+
+	const char *vendor="audio_rxtx";
+	unsigned char tags[8+4+16+4];
+	int vendor_len=strlen(vendor);
+	memcpy(tags,"OpusTags",8);
+	put_le32(tags+8,vendor_len);
+	memcpy(tags+12,vendor,vendor_len);
+	put_le32(tags+12+vendor_len,0);
+
+	op.packet=tags;
+	op.bytes=12+vendor_len+4;
+	op.b_o_s=0;
+	op.packetno=1;
+	ogg_stream_packetin(&os,&op);
+	ret|=write_ogg_pages(&os,f,1);
+
+	//20 ms frames. encode lookahead more (zeros) so that the last samples come out
+	int frame_size=segment_sample_rate/50;
+	float pcm[frame_size*channels];
+	unsigned char packet[4000];
+
+	int pos;
+	for(pos=0;pos<frames+lookahead && ret==0;pos+=frame_size)
+	{
+		int n=MAX_(0,MIN_(frame_size,frames-pos));
+		memset(pcm,0,sizeof(pcm));
+		if(n>0)
+		{
+			memcpy(pcm,data+pos*channels,n*channels*sizeof(float));
+		}
+
+		int len=opus_encode_float(enc,pcm,frame_size,packet,sizeof(packet));
+		if(len<0)
+		{
+			ret=-1;
+			break;
+		}
+
+		int last=(pos+frame_size>=frames+lookahead);
+
+		op.packet=packet;
+		op.bytes=len;
+		op.packetno++;
+		op.e_o_s=last;
+		//end trimming: last granule position marks the real end
+		op.granulepos=last ? (ogg_int64_t)pre_skip+(ogg_int64_t)frames*scale
+			: (ogg_int64_t)(pos+frame_size)*scale;
+		ogg_stream_packetin(&os,&op);
+		ret|=write_ogg_pages(&os,f,last);
+	}
+
+	ogg_stream_clear(&os);
+	opus_encoder_destroy(enc);
+	if(fclose(f)!=0)
+	{
+		ret=-1;
+	}
+	return ret;
+}//end write_opus_segment
+
+//================================================================
+static int write_sndfile_segment(const char *path, const float *data, int frames, int channels,
+	int format, double quality)
+{
+	SF_INFO info;
+	memset(&info,0,sizeof(info));
+	info.samplerate=segment_sample_rate;
+	info.channels=channels;
+
+	switch(format)
+	{
+		case SEGMENT_FLAC:
+			info.format=SF_FORMAT_FLAC | SF_FORMAT_PCM_16;
+			break;
+		case SEGMENT_VORBIS:
+			info.format=SF_FORMAT_OGG | SF_FORMAT_VORBIS;
+			break;
+		default:
+			info.format=SF_FORMAT_WAV | SF_FORMAT_PCM_16;
+	}
+
+	SNDFILE *sf=sf_open(path,SFM_WRITE,&info);
+	if(sf==NULL)
+	{
+		return -1;
+	}
+
+	if(quality>=0)
+	{
+		sf_command(sf,format==SEGMENT_VORBIS ? SFC_SET_VBR_ENCODING_QUALITY : SFC_SET_COMPRESSION_LEVEL,
+			&quality,sizeof(double));
+	}
+
+	int ret=(sf_writef_float(sf,data,frames)==frames) ? 0 : -1;
+	sf_close(sf);
+	return ret;
+}
+
+//================================================================
+static void encode_segment(segment_group_t *g, segment_buffer_t *b, float *group_data)
+{
+	struct timespec start;
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC,&start);
+
+	//pick channels of group
+	int i;
+	for(i=0;i<frames_per_segment;i++)
+	{
+		memcpy(group_data+i*g->channel_count,
+			b->data+i*segment_channels+g->first_channel,
+			g->channel_count*sizeof(float));
+	}
+
+	char path[PATH_MAX];
+	char tmp[PATH_MAX];
+	segment_path(path,sizeof(path),g,b->sequence);
+	snprintf(tmp,sizeof(tmp),"%s.tmp",path);
+
+	int ret;
+	if(g->format==SEGMENT_OPUS)
+	{
+		ret=write_opus_segment(tmp,group_data,frames_per_segment,g->channel_count,g->quality,b->sequence);
+	}
+	else
+	{
+		ret=write_sndfile_segment(tmp,group_data,frames_per_segment,g->channel_count,g->format,g->quality);
+	}
+
+	if(ret==0)
+	{
+		ret=rename(tmp,path);
+	}
+	else
+	{
+		unlink(tmp);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC,&end);
+	float rt=((end.tv_sec-start.tv_sec)+(end.tv_nsec-start.tv_nsec)/1e9)/segment_duration;
+
+	pthread_mutex_lock(&g->lock);
+	g->done[b->sequence%SEGMENT_DONE_RING]=b->sequence+1;
+	g->failed[b->sequence%SEGMENT_DONE_RING]=(ret!=0);
+	g->last_rt=rt;
+	g->max_rt=MAX_(g->max_rt,rt);
+	g->encoded_count++;
+	update_playlist(g);
+	pthread_mutex_unlock(&g->lock);
+
+	if(ret!=0)
+	{
+		fprintf(stderr,"\ncould not write segment %s\n",path);
+	}
+}//end encode_segment
+
+//================================================================
+static void *segment_worker(void *arg)
+{
+	//largest group can be all channels
+	float *group_data=malloc(frames_per_segment*segment_channels*sizeof(float));
+
+	while(1)
+	{
+		pthread_mutex_lock(&job_lock);
+		while(job_count==0)
+		{
+			pthread_cond_wait(&job_cond,&job_lock);
+		}
+		segment_job_t job=jobs[job_head];
+		job_head=(job_head+1)%(MAX_SEGMENT_BUFFERS*MAX_SEGMENT_GROUPS);
+		job_count--;
+		pthread_mutex_unlock(&job_lock);
+
+		encode_segment(&groups[job.group],&buffers[job.buffer],group_data);
+
+		pthread_mutex_lock(&job_lock);
+		buffers[job.buffer].pending--;
+		pthread_mutex_unlock(&job_lock);
+	}
+	return NULL;
+}
+
+//================================================================
+int segments_start(int sample_rate, int channels)
+{
+	segment_sample_rate=sample_rate;
+	segment_channels=channels;
+	frames_per_segment=segment_duration*sample_rate;
+
+	if(group_count==0)
+	{
+		char spec[32];
+		snprintf(spec,sizeof(spec),"0:%d:wav",channels);
+		segments_add_group(spec);
+	}
+
+	mkdir(segment_dir,0755);
+
+	int i;
+	for(i=0;i<group_count;i++)
+	{
+		segment_group_t *g=&groups[i];
+		if(g->channel_count<1 || g->first_channel<0 || g->first_channel+g->channel_count>channels)
+		{
+			fprintf(stderr,"\nsegment group %d: channels %d-%d not available (%d channels)\n",
+				i,g->first_channel,g->first_channel+g->channel_count-1,channels);
+			return 1;
+		}
+		if(g->format==SEGMENT_OPUS && (g->channel_count>2 || 48000%sample_rate!=0 || sample_rate<8000))
+		{
+			fprintf(stderr,"\nsegment group %d: opus needs 1 or 2 channels and 8/12/16/24/48 kHz\n",i);
+			return 1;
+		}
+
+		snprintf(g->dir,sizeof(g->dir),"%s/g%d",segment_dir,i);
+		if(mkdir(g->dir,0755)!=0 && errno!=EEXIST)
+		{
+			fprintf(stderr,"\ncould not create %s: %s\n",g->dir,strerror(errno));
+			return 1;
+		}
+		pthread_mutex_init(&g->lock,NULL);
+	}
+
+	//enough buffers to keep all workers busy while collecting the next segment
+	buffer_count=MIN_(MAX_SEGMENT_BUFFERS,segment_workers*2+2);
+	for(i=0;i<buffer_count;i++)
+	{
+		buffers[i].data=malloc(frames_per_segment*channels*sizeof(float));
+		buffers[i].pending=0;
+		if(buffers[i].data==NULL)
+		{
+			fprintf(stderr,"\ncould not allocate segment buffers\n");
+			return 1;
+		}
+	}
+
+	write_master_playlist();
+
+	for(i=0;i<segment_workers;i++)
+	{
+		pthread_t thread;
+		if(pthread_create(&thread,NULL,segment_worker,NULL)!=0)
+		{
+			fprintf(stderr,"\ncould not start segment worker\n");
+			return 1;
+		}
+		pthread_detach(thread);
+	}
+
+	fprintf(stderr,"\nwriting %.1f s segments to %s (%d group(s), %d workers)\n",
+		segment_duration,segment_dir,group_count,segment_workers);
+
+	return 0;
+}//end segments_start
+
+//================================================================
+//find a buffer that is not used by any job. -1 if none
+static int free_buffer()
+{
+	int found=-1;
+	pthread_mutex_lock(&job_lock);
+	int i;
+	for(i=0;i<buffer_count;i++)
+	{
+		if(buffers[i].pending==0)
+		{
+			found=i;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&job_lock);
+	return found;
+}
+
+//================================================================
+//queue full buffer for all groups
+static void queue_segment(int b)
+{
+	pthread_mutex_lock(&job_lock);
+	buffers[b].sequence=next_sequence++;
+	buffers[b].pending=group_count;
+
+	int i;
+	for(i=0;i<group_count;i++)
+	{
+		int slot=(job_head+job_count)%(MAX_SEGMENT_BUFFERS*MAX_SEGMENT_GROUPS);
+		jobs[slot].buffer=b;
+		jobs[slot].group=i;
+		job_count++;
+	}
+	pthread_cond_broadcast(&job_cond);
+	pthread_mutex_unlock(&job_lock);
+}
+
+//================================================================
+void segments_add_period(const char *mc_period, int channels, int nframes, int bytes_per_sample)
+{
+	if(channels!=segment_channels)
+	{
+		return;
+	}
+
+	int pos=0;
+	while(pos<nframes)
+	{
+		//new segment
+		if(collecting<0 && collecting_frames==0)
+		{
+			collecting=free_buffer();
+		}
+
+		int n=MIN_(nframes-pos,frames_per_segment-collecting_frames);
+
+		if(collecting>=0)
+		{
+			float *out=buffers[collecting].data+collecting_frames*channels;
+			float tmp[256];
+
+			int c;
+			for(c=0;c<channels;c++)
+			{
+				const char *in=mc_period+(c*nframes+pos)*bytes_per_sample;
+				int k;
+				for(k=0;k<n;k+=256)
+				{
+					int m=MIN_(256,n-k);
+					convert_samples(in+k*bytes_per_sample,bytes_per_sample,tmp,4,m);
+					int j;
+					for(j=0;j<m;j++)
+					{
+						out[(k+j)*channels+c]=tmp[j];
+					}
+				}
+			}
+		}
+
+		collecting_frames+=n;
+		pos+=n;
+
+		if(collecting_frames>=frames_per_segment)
+		{
+			if(collecting>=0)
+			{
+				queue_segment(collecting);
+			}
+			else
+			{
+				//all buffers busy, workers too slow
+				segments_dropped++;
+			}
+			collecting=-1;
+			collecting_frames=0;
+		}
+	}
+}//end segments_add_period
+
+//================================================================
+void segments_status(char *buf, size_t size)
+{
+	uint64_t encoded=0;
+	float last_rt=0;
+	float max_rt=0;
+
+	int i;
+	for(i=0;i<group_count;i++)
+	{
+		pthread_mutex_lock(&groups[i].lock);
+		encoded+=groups[i].encoded_count;
+		last_rt=MAX_(last_rt,groups[i].last_rt);
+		max_rt=MAX_(max_rt,groups[i].max_rt);
+		pthread_mutex_unlock(&groups[i].lock);
+	}
+
+	snprintf(buf,size," seg: %" PRIu64 " enc: %.3f (%.3f) x rt%s",
+		encoded,last_rt,max_rt,segments_dropped>0 ? " DROP" : "");
+}
@@ -0,0 +1,45 @@
+/* part of audio_rxtx
+ *
+ * This program is free software; feel free to redistribute it and/or
+ * modify it.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. bla.
+*/
+
+#ifndef AUDIO_SEGMENTS_H_INCLUDED
+#define AUDIO_SEGMENTS_H_INCLUDED
+
+//audio_segments.h
+
+//rolling segment files with playlist (HLS style), written by a pool of worker threads
+//<segment_dir>/master.m3u8
+//<segment_dir>/g<n>/index.m3u8, seg<sequence>.<ext> for every group (channels, format)
+
+extern char *segment_dir; //param
+//seconds
+extern float segment_duration; //param
+extern int segment_workers; //param
+//number of segments in playlist
+extern int segment_list_size; //param
+
+extern uint64_t segments_dropped;
+
+//add a group from spec first_channel:channel_count[:format[:quality]]
+//format: wav, flac, vorbis, opus. quality: 0..1
+//returns 0 on success
+int segments_add_group(const char *spec);
+
+//create directories, write master playlist and start workers
+//if no group was added, all channels are written as wav
+//returns 0 on success
+int segments_start(int sample_rate, int channels);
+
+//add one multi-channel period: channel after channel, nframes samples each
+void segments_add_period(const char *mc_period, int channels, int nframes, int bytes_per_sample);
+
+//short info for running display
+void segments_status(char *buf, size_t size);
+
+#endif //AUDIO_SEGMENTS_H_INCLUDED
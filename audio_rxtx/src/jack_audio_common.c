@@ -12,13 +12,27 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <math.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
 //#include <jack/jack.h>//weak
 #include <lo/lo.h>
 
 #include "jack_audio_common.h"
+#include "../../rb/rb.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 float version = 0.86f;
-float format_version = 1.1f;
+float format_version = 1.3f;
 
 lo_server_thread lo_st;
 
@@ -37,6 +51,7 @@ int sample_rate=44100;
 int period_size=1024;
 
 //2 bytes per sample: 16 bit (PCM wave)
+//3 bytes per sample: 24 bit (PCM wave, packed)
 //4 bytes per sample: 32 bit float
 int bytes_per_sample=4;
 
@@ -91,6 +106,21 @@ lo_address loio;
 //local xrun counter (since start of this jack client)
 uint64_t local_xrun_counter=0;
 
+int net_rcvbuf=-1;
+int net_sndbuf=-1;
+int net_busy_poll=-1;
+int net_dscp=-1;
+int net_sock_priority=-1;
+int net_cpu=-1;
+int net_rt_priority=-1;
+
+//RB_ALLOC_* flags for ringbuffers and scratch buffers (--alloc)
+int alloc_policy=0;
+
+//as read back from the first socket the options were applied to (kernel doubles buffer sizes)
+static int net_rcvbuf_effective=-1;
+static int net_sndbuf_effective=-1;
+
 //=========================================================
 void print_header (char *prgname)
 {
@@ -162,6 +192,375 @@ void print_common_jack_properties()
 	fprintf(stderr,"period size: %d samples (%s, %d bytes)\n",period_size,
 		buf,period_size*bytes_per_sample
 	);
+
+	print_net_properties();
+	print_alloc_properties();
+}
+
+//=========================================================
+void print_net_help()
+{
+	fprintf (stderr, "  Socket receive buffer [bytes]       --rcvbuf   <integer>\n");
+	fprintf (stderr, "  Socket send buffer [bytes]          --sndbuf   <integer>\n");
+	fprintf (stderr, "  Busy poll on receive [us]           --busypoll <integer>\n");
+	fprintf (stderr, "  DSCP mark for QoS (46: EF)  (0..63) --dscp     <integer>\n");
+	fprintf (stderr, "  Socket priority (SO_PRIORITY, 0..6) --sockprio <integer>\n");
+	fprintf (stderr, "  Pin network thread to CPU           --netcpu   <integer>\n");
+	fprintf (stderr, "  SCHED_FIFO prio. of network thread  --netprio  <integer>\n");
+}
+
+//=========================================================
+//parse a whole decimal integer in min..max. returns 0 and sets value on success
+int parse_int_option(const char *name, const char *arg, long min, long max, int *value)
+{
+	char *end=NULL;
+	errno=0;
+	long v=strtol(arg,&end,10);
+	if(end==arg || *end!='\0' || errno==ERANGE || v<min || v>max)
+	{
+		fprintf(stderr,"--%s '%s': expected an integer %ld..%ld\n",name,arg,min,max);
+		return 1;
+	}
+	*value=(int)v;
+	return 0;
+}
+
+//=========================================================
+int net_option(int opt, const char *arg)
+{
+	switch(opt)
+	{
+		case NET_OPT_RCVBUF:
+			return parse_int_option("rcvbuf",arg,1,INT_MAX,&net_rcvbuf);
+		case NET_OPT_SNDBUF:
+			return parse_int_option("sndbuf",arg,1,INT_MAX,&net_sndbuf);
+		case NET_OPT_BUSY_POLL:
+			return parse_int_option("busypoll",arg,0,INT_MAX,&net_busy_poll);
+		case NET_OPT_DSCP:
+			return parse_int_option("dscp",arg,0,63,&net_dscp);
+		case NET_OPT_SOCK_PRIORITY:
+			return parse_int_option("sockprio",arg,0,INT_MAX,&net_sock_priority);
+		case NET_OPT_CPU:
+			return parse_int_option("netcpu",arg,0,CPU_SETSIZE-1,&net_cpu);
+		case NET_OPT_RT_PRIORITY:
+			//range of the scheduler is checked in check_net_options()
+			return parse_int_option("netprio",arg,0,INT_MAX,&net_rt_priority);
+	}
+	return 1;
+}
+
+//=========================================================
+int net_options_set()
+{
+	return net_rcvbuf!=-1 || net_sndbuf!=-1 || net_busy_poll!=-1 || net_dscp!=-1
+		|| net_sock_priority!=-1 || net_cpu!=-1 || net_rt_priority!=-1;
+}
+
+//=========================================================
+int check_net_options()
+{
+	int ret=0;
+
+	if(net_rcvbuf!=-1 && net_rcvbuf<=0)
+	{
+		fprintf(stderr,"--rcvbuf must be > 0\n");
+		ret=1;
+	}
+	if(net_sndbuf!=-1 && net_sndbuf<=0)
+	{
+		fprintf(stderr,"--sndbuf must be > 0\n");
+		ret=1;
+	}
+	if(net_busy_poll!=-1 && net_busy_poll<0)
+	{
+		fprintf(stderr,"--busypoll must be >= 0\n");
+		ret=1;
+	}
+#ifndef SO_BUSY_POLL
+	if(net_busy_poll!=-1)
+	{
+		fprintf(stderr,"--busypoll: SO_BUSY_POLL not supported by this build\n");
+		ret=1;
+	}
+#endif
+	if(net_dscp!=-1 && (net_dscp<0 || net_dscp>63))
+	{
+		fprintf(stderr,"--dscp must be 0..63\n");
+		ret=1;
+	}
+	if(net_sock_priority!=-1 && net_sock_priority<0)
+	{
+		fprintf(stderr,"--sockprio must be >= 0\n");
+		ret=1;
+	}
+	else if(net_sock_priority>6 && shutup==0)
+	{
+		fprintf(stderr,"--sockprio %d: values above 6 need CAP_NET_ADMIN\n",net_sock_priority);
+	}
+
+	if(net_cpu!=-1)
+	{
+		cpu_set_t allowed;
+		CPU_ZERO(&allowed);
+		sched_getaffinity(0,sizeof(allowed),&allowed);
+		if(net_cpu<0 || net_cpu>=CPU_SETSIZE || !CPU_ISSET(net_cpu,&allowed))
+		{
+			fprintf(stderr,"--netcpu %d: not an available CPU (online: %ld)\n",
+				net_cpu,sysconf(_SC_NPROCESSORS_ONLN));
+			ret=1;
+		}
+	}
+
+	if(net_rt_priority!=-1)
+	{
+		int min=sched_get_priority_min(SCHED_FIFO);
+		int max=sched_get_priority_max(SCHED_FIFO);
+		if(net_rt_priority<min || net_rt_priority>max)
+		{
+			fprintf(stderr,"--netprio must be %d..%d\n",min,max);
+			ret=1;
+		}
+	}
+	return ret;
+}
+
+//=========================================================
+//set buffer size, try to exceed rmem_max / wmem_max if allowed to
+static int set_socket_buffer(int fd, int force_option, int option, int size, int *effective, const char *name)
+{
+	int ret=0;
+	if(setsockopt(fd,SOL_SOCKET,force_option,&size,sizeof(size))!=0
+		&& setsockopt(fd,SOL_SOCKET,option,&size,sizeof(size))!=0)
+	{
+		fprintf(stderr,"%s %d: %s\n",name,size,strerror(errno));
+		ret=1;
+	}
+
+	int value=0;
+	socklen_t len=sizeof(value);
+	if(getsockopt(fd,SOL_SOCKET,option,&value,&len)==0)
+	{
+		//linux reports twice the requested size (bookkeeping overhead)
+		//sockets that are re-created (reconnect) warn only once
+		if(*effective==-1 && value/2<size && shutup==0)
+		{
+			fprintf(stderr,"%s: got %d of %d bytes, see /proc/sys/net/core/%s\n",
+				name,value/2,size,option==SO_RCVBUF ? "rmem_max" : "wmem_max");
+		}
+		if(*effective==-1)
+		{
+			*effective=value;
+		}
+	}
+	return ret;
+}
+
+//=========================================================
+int apply_net_socket_options(int fd, const char *what)
+{
+	int ret=0;
+
+	if(fd<0)
+	{
+		return 0;
+	}
+
+	if(net_rcvbuf!=-1)
+	{
+		ret+=set_socket_buffer(fd,SO_RCVBUFFORCE,SO_RCVBUF,net_rcvbuf,&net_rcvbuf_effective,"rcvbuf");
+	}
+	if(net_sndbuf!=-1)
+	{
+		ret+=set_socket_buffer(fd,SO_SNDBUFFORCE,SO_SNDBUF,net_sndbuf,&net_sndbuf_effective,"sndbuf");
+	}
+#ifdef SO_BUSY_POLL
+	if(net_busy_poll!=-1 && setsockopt(fd,SOL_SOCKET,SO_BUSY_POLL,&net_busy_poll,sizeof(net_busy_poll))!=0)
+	{
+		fprintf(stderr,"busypoll %d: %s\n",net_busy_poll,strerror(errno));
+		ret++;
+	}
+#endif
+	if(net_dscp!=-1)
+	{
+		int tos=net_dscp<<2;
+		struct sockaddr_storage local;
+		socklen_t len=sizeof(local);
+		int family=AF_INET;
+		if(getsockname(fd,(struct sockaddr*)&local,&len)==0)
+		{
+			family=local.ss_family;
+		}
+
+		int r;
+		if(family==AF_INET6)
+		{
+			r=setsockopt(fd,IPPROTO_IPV6,IPV6_TCLASS,&tos,sizeof(tos));
+		}
+		else
+		{
+			r=setsockopt(fd,IPPROTO_IP,IP_TOS,&tos,sizeof(tos));
+		}
+		if(r!=0)
+		{
+			fprintf(stderr,"dscp %d: %s\n",net_dscp,strerror(errno));
+			ret++;
+		}
+	}
+	//after IP_TOS, which also sets the priority
+	if(net_sock_priority!=-1 && setsockopt(fd,SOL_SOCKET,SO_PRIORITY,&net_sock_priority,sizeof(net_sock_priority))!=0)
+	{
+		fprintf(stderr,"sockprio %d: %s\n",net_sock_priority,strerror(errno));
+		ret++;
+	}
+
+	if(ret>0)
+	{
+		fprintf(stderr,"(%s socket)\n",what);
+	}
+	return ret;
+}
+
+//=========================================================
+int apply_net_thread_options(const char *what)
+{
+	return apply_net_thread_options_cpu(what,net_cpu);
+}
+
+//=========================================================
+int apply_net_thread_options_cpu(const char *what, int cpu)
+{
+	int ret=0;
+
+	if(cpu!=-1)
+	{
+		cpu_set_t cpus;
+		CPU_ZERO(&cpus);
+		CPU_SET(cpu,&cpus);
+		//0: calling thread
+		if(sched_setaffinity(0,sizeof(cpus),&cpus)!=0)
+		{
+			fprintf(stderr,"%s thread: could not pin to CPU %d: %s\n",what,cpu,strerror(errno));
+			ret=1;
+		}
+	}
+
+	if(net_rt_priority!=-1)
+	{
+		struct sched_param param;
+		memset(&param,0,sizeof(param));
+		param.sched_priority=net_rt_priority;
+		int err=pthread_setschedparam(pthread_self(),SCHED_FIFO,&param);
+		if(err!=0)
+		{
+			fprintf(stderr,"%s thread: could not set SCHED_FIFO %d: %s%s\n",what,net_rt_priority,strerror(err),
+				err==EPERM ? " (check RLIMIT_RTPRIO / limits.conf)" : "");
+			ret=1;
+		}
+	}
+	return ret;
+}
+
+//=========================================================
+void net_options_string(char *buf, size_t size)
+{
+	buf[0]='\0';
+	size_t len=0;
+
+	#define NET_APPEND(name,value) \
+		if(value!=-1 && len<size) \
+		{ \
+			len+=snprintf(buf+len,size-len,"%s%s=%d",len>0 ? " " : "",name,value); \
+		}
+
+	NET_APPEND("rcvbuf",net_rcvbuf);
+	NET_APPEND("sndbuf",net_sndbuf);
+	NET_APPEND("busypoll",net_busy_poll);
+	NET_APPEND("dscp",net_dscp);
+	NET_APPEND("sockprio",net_sock_priority);
+	NET_APPEND("netcpu",net_cpu);
+	NET_APPEND("netprio",net_rt_priority);
+
+	#undef NET_APPEND
+}
+
+//=========================================================
+void print_net_properties()
+{
+	if(!net_options_set())
+	{
+		return;
+	}
+
+	char buf[256];
+	net_options_string(buf,sizeof(buf));
+	fprintf(stderr,"network: %s\n",buf);
+
+	if(net_rcvbuf_effective!=-1)
+	{
+		fprintf(stderr,"socket receive buffer (kernel): %d bytes\n",net_rcvbuf_effective);
+	}
+	if(net_sndbuf_effective!=-1)
+	{
+		fprintf(stderr,"socket send buffer (kernel): %d bytes\n",net_sndbuf_effective);
+	}
+}
+
+//=========================================================
+void print_alloc_help()
+{
+	fprintf (stderr, "  Prefault/hugepages/mlock buffers    --alloc    <list>\n");
+	fprintf (stderr, "  (comma separated, i.e. prefault,mlock or none)\n");
+}
+
+//=========================================================
+int alloc_option(const char *arg)
+{
+	int policy=rb_parse_alloc_policy(arg);
+	if(policy<0)
+	{
+		fprintf(stderr,"--alloc '%s': use a comma separated list of prefault, hugepages, mlock or none\n",arg);
+		return 1;
+	}
+	alloc_policy=policy;
+	return 0;
+}
+
+//=========================================================
+void print_alloc_properties()
+{
+	if(alloc_policy==0)
+	{
+		return;
+	}
+
+	char buf[64];
+	rb_alloc_policy_string(alloc_policy,buf,sizeof(buf));
+	fprintf(stderr,"buffer allocation: %s\n",buf);
+}
+
+//=========================================================
+//page faults of the calling thread per cycle since the previous call
+//(call from one thread only, i.e. process())
+float page_faults_per_cycle(uint64_t cycles)
+{
+	static uint64_t faults_prev=0;
+	static uint64_t cycles_prev=0;
+
+	uint64_t minor=0;
+	uint64_t major=0;
+	if(!rb_page_faults(&minor,&major))
+	{
+		return 0;
+	}
+
+	float ret=0;
+	if(cycles>cycles_prev && cycles_prev>0)
+	{
+		ret=(float)(minor+major-faults_prev)/(cycles-cycles_prev);
+	}
+	faults_prev=minor+major;
+	cycles_prev=cycles;
+	return ret;
 }
 
 //=========================================================
@@ -171,6 +570,10 @@ void print_bytes_per_sample()
 	{
 		fprintf(stderr,"bytes per sample: %d (32 bit float)\n",bytes_per_sample);
 	}
+	else if(bytes_per_sample==3)
+	{
+		fprintf(stderr,"bytes per sample: %d (24 bit PCM)\n",bytes_per_sample);
+	}
 	else
 	{
 		fprintf(stderr,"bytes per sample: %d (16 bit PCM)\n",bytes_per_sample);
@@ -229,6 +632,226 @@ int check_lo_props(int debug)
 	return ret;
 }
 
+//=========================================================
+int period_is_silent(const sample_t *buffer, int nframes, float threshold)
+{
+	int i=0;
+#ifdef __SSE2__
+	//|x|>threshold, NaN counts as not silent
+	const __m128 abs_mask=_mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+	const __m128 thresh=_mm_set1_ps(threshold);
+
+	//16 samples per round, stop at first non-silent block
+	for(;i+16<=nframes;i+=16)
+	{
+		__m128 a=_mm_cmpnle_ps(_mm_and_ps(_mm_loadu_ps(buffer+i),abs_mask),thresh);
+		__m128 b=_mm_cmpnle_ps(_mm_and_ps(_mm_loadu_ps(buffer+i+4),abs_mask),thresh);
+		__m128 c=_mm_cmpnle_ps(_mm_and_ps(_mm_loadu_ps(buffer+i+8),abs_mask),thresh);
+		__m128 d=_mm_cmpnle_ps(_mm_and_ps(_mm_loadu_ps(buffer+i+12),abs_mask),thresh);
+
+		if(_mm_movemask_ps(_mm_or_ps(_mm_or_ps(a,b),_mm_or_ps(c,d))))
+		{
+			return 0;
+		}
+	}
+#endif
+	for(;i<nframes;i++)
+	{
+		if(!(fabsf(buffer[i])<=threshold))
+		{
+			return 0;
+		}
+	}
+	return 1;
+}
+
+//=========================================================
+//zeroed memory standing in for empty (silent) blobs
+static char *silence_buffer=NULL;
+static int silence_buffer_size=0;
+
+static void *silence_data(int size)
+{
+	//only grows, not called from process()
+	if(size>silence_buffer_size)
+	{
+		free(silence_buffer);
+		silence_buffer=calloc(1,size);
+		silence_buffer_size=(silence_buffer==NULL) ? 0 : size;
+	}
+	return silence_buffer;
+}
+
+//=========================================================
+//16 bit: same scaling as in jack_audio_send / jack_audio_receive process()
+void float_to_pcm16(const sample_t *in, int16_t *out, int nframes)
+{
+	int i;
+	for(i=0;i<nframes;i++)
+	{
+		out[i]=MIN_(MAX_(in[i],-1.0f),1.0f)*32760;
+	}
+}
+
+//=========================================================
+void pcm16_to_float(const int16_t *in, sample_t *out, int nframes)
+{
+	int i;
+	for(i=0;i<nframes;i++)
+	{
+		out[i]=(float)MIN_(MAX_((float)in[i]/32760,-1.0f),1.0f);
+	}
+}
+
+//=========================================================
+void convert_samples(const void *in, int in_bytes_per_sample,
+	void *out, int out_bytes_per_sample, int nframes)
+{
+	if(in_bytes_per_sample==out_bytes_per_sample)
+	{
+		memcpy(out,in,nframes*in_bytes_per_sample);
+		return;
+	}
+
+	//via float, chunked to keep the stack small
+	sample_t tmp[256];
+	int done=0;
+	while(done<nframes)
+	{
+		int count=MIN_(256,nframes-done);
+		const unsigned char *src=(const unsigned char*)in+done*in_bytes_per_sample;
+		unsigned char *dst=(unsigned char*)out+done*out_bytes_per_sample;
+		const sample_t *f=tmp;
+
+		if(in_bytes_per_sample==4)
+		{
+			f=(const sample_t*)src;
+		}
+		else if(in_bytes_per_sample==3)
+		{
+			pcm24_to_float(src,tmp,count);
+		}
+		else
+		{
+			pcm16_to_float((const int16_t*)src,tmp,count);
+		}
+
+		if(out_bytes_per_sample==4)
+		{
+			memcpy(dst,f,count*4);
+		}
+		else if(out_bytes_per_sample==3)
+		{
+			float_to_pcm24(f,dst,count);
+		}
+		else
+		{
+			float_to_pcm16(f,(int16_t*)dst,count);
+		}
+		done+=count;
+	}
+}
+
+//=========================================================
+//converted channel data, one period per channel
+static char *convert_buffer=NULL;
+static int convert_buffer_size=0;
+
+void *blob_data_local(lo_blob blob, int nframes, int channel)
+{
+	int size=lo_blob_datasize(blob);
+	if(size==0)
+	{
+		return silence_data(nframes*bytes_per_sample);
+	}
+
+	//sender changed format (jack_audio_send --adapt)
+	int remote_bytes_per_sample=size/nframes;
+	if(remote_bytes_per_sample==bytes_per_sample
+		|| size%nframes!=0
+		|| remote_bytes_per_sample<2 || remote_bytes_per_sample>4)
+	{
+		return lo_blob_dataptr(blob);
+	}
+
+	int period_bytes=nframes*bytes_per_sample;
+
+	//only grows, not called from process()
+	if((channel+1)*period_bytes>convert_buffer_size)
+	{
+		char *resized=realloc(convert_buffer,(channel+1)*period_bytes);
+		if(resized==NULL)
+		{
+			return silence_data(period_bytes);
+		}
+		convert_buffer=resized;
+		convert_buffer_size=(channel+1)*period_bytes;
+	}
+
+	char *out=convert_buffer+channel*period_bytes;
+	convert_samples(lo_blob_dataptr(blob),remote_bytes_per_sample,out,bytes_per_sample,nframes);
+	return out;
+}
+
+//=========================================================
+int first_blob_datasize(lo_arg **argv, int first, int count)
+{
+	int i;
+	for(i=first;i<count;i++)
+	{
+		int size=lo_blob_datasize((lo_blob)argv[i]);
+		if(size>0)
+		{
+			return size;
+		}
+	}
+	return 0;
+}
+
+//=========================================================
+int audio_data_offset(const char *types)
+{
+	//hhtihi: sender frame time and timetag offset
+	if(strncmp(types,"hhtihi",6)==0)
+	{
+		return 6;
+	}
+	return 4;
+}
+
+//=========================================================
+void register_audio_methods(lo_method_handler handler)
+{
+	//support 1-n blobs / channels per message
+	//"hhtib", "hhtibb", .. and "hhtihib", "hhtihibb", ..
+	char typetag_string[1024];
+	memset(typetag_string,0,sizeof(typetag_string));
+
+	const char *prefixes[2]={"hhti","hhtihi"};
+	int k;
+	for(k=0;k<2;k++)
+	{
+		int data_offset=strlen(prefixes[k]);
+		memcpy(typetag_string,prefixes[k],data_offset);
+
+		int v;
+		for(v=0;v<max_channel_count;v++)
+		{
+			typetag_string[data_offset+v]='b';
+			lo_server_thread_add_method(lo_st, "/audio", typetag_string, handler, NULL);
+		}
+		memset(typetag_string,0,sizeof(typetag_string));
+	}
+}
+
+//=========================================================
+uint64_t frame_time_64(uint64_t *last, jack_nframes_t frame_time)
+{
+	//difference modulo 2^32, valid as long as calls are less than ~1 day apart
+	*last+=(jack_nframes_t)(frame_time-(jack_nframes_t)*last);
+	return *last;
+}
+
 //=========================================================
 int io_()
 {
@@ -14,6 +14,8 @@
 #define JACK_AUDIO_COMMON_H_INCLUDED
 
 #include "weak_libjack.h"
+#include "pcm24.h"
+#include "test_signal.h"
 
 //jack_audio_common.h
 
@@ -95,6 +97,40 @@ void print_common_jack_properties();
 
 int check_lo_props();
 
+//1 if all samples of the period are <= threshold (absolute), 0 otherwise
+//returns at the first non-silent block of samples
+int period_is_silent(const sample_t *buffer, int nframes, float threshold);
+
+//packed 24 bit PCM (--24): see pcm24.h
+
+//16 bit PCM
+void float_to_pcm16(const sample_t *in, int16_t *out, int nframes);
+void pcm16_to_float(const int16_t *in, sample_t *out, int nframes);
+
+//convert between sample formats (2, 3 or 4 bytes per sample)
+void convert_samples(const void *in, int in_bytes_per_sample,
+	void *out, int out_bytes_per_sample, int nframes);
+
+//test signal (jack_audio_send --testsig, jack_audio_receive --check): see test_signal.h
+
+//one period (nframes) of blob data in local sample format (bytes_per_sample)
+//expands empty blobs (--silence), converts if the sender uses another format (--adapt)
+//channel selects the conversion buffer. data is valid until the next call for this channel
+void *blob_data_local(lo_blob blob, int nframes, int channel);
+
+//datasize of first non-empty blob in argv[first..count-1], 0 if all are empty
+int first_blob_datasize(lo_arg **argv, int first, int count);
+
+//number of metadata arguments before the first blob of /audio
+//hhti, or hhtihi with sender frame time (jack_audio_send, format 1.3)
+int audio_data_offset(const char *types);
+
+//register /audio for 1..max_channel_count blobs, both layouts
+void register_audio_methods(lo_method_handler handler);
+
+//extend a 32 bit JACK frame time to 64 bit. *last holds the previous result (0 initially)
+uint64_t frame_time_64(uint64_t *last, jack_nframes_t frame_time);
+
 int io_();
 void io_simple(char *path);
 void io_simple_string(char *path, const char *string);
@@ -122,4 +158,83 @@ extern lo_address loio;
 
 extern uint64_t local_xrun_counter;
 
+//socket / network thread tuning, same options for all programs
+//-1: not set, leave the system default
+extern int net_rcvbuf; //param bytes
+extern int net_sndbuf; //param bytes
+extern int net_busy_poll; //param microseconds
+extern int net_dscp; //param 0..63 (IP_TOS / IPV6_TCLASS = dscp << 2)
+extern int net_sock_priority; //param SO_PRIORITY 0..6 (higher needs CAP_NET_ADMIN)
+extern int net_cpu; //param pin network thread to this CPU
+extern int net_rt_priority; //param SCHED_FIFO priority of network thread
+
+//long option values (no short options)
+enum
+{
+	NET_OPT_RCVBUF=1000,
+	NET_OPT_SNDBUF,
+	NET_OPT_BUSY_POLL,
+	NET_OPT_DSCP,
+	NET_OPT_SOCK_PRIORITY,
+	NET_OPT_CPU,
+	NET_OPT_RT_PRIORITY
+};
+
+#define NET_LONG_OPTIONS \
+	{"rcvbuf",      required_argument,      0, NET_OPT_RCVBUF}, \
+	{"sndbuf",      required_argument,      0, NET_OPT_SNDBUF}, \
+	{"busypoll",    required_argument,      0, NET_OPT_BUSY_POLL}, \
+	{"dscp",        required_argument,      0, NET_OPT_DSCP}, \
+	{"sockprio",    required_argument,      0, NET_OPT_SOCK_PRIORITY}, \
+	{"netcpu",      required_argument,      0, NET_OPT_CPU}, \
+	{"netprio",     required_argument,      0, NET_OPT_RT_PRIORITY}
+
+void print_net_help();
+
+//parse a whole decimal integer in min..max (prints an error for --name otherwise).
+//returns 0 and sets value on success
+int parse_int_option(const char *name, const char *arg, long min, long max, int *value);
+
+//store value of one of the NET_OPT_* options. returns 0 if arg is usable
+int net_option(int opt, const char *arg);
+
+//1 if any socket / thread option was given
+int net_options_set();
+
+//check values given on command line. returns 0 if all are usable
+int check_net_options();
+
+//apply socket options to fd. returns number of options that could not be set
+int apply_net_socket_options(int fd, const char *what);
+
+//pin the calling thread and set its scheduling. returns 0 on success
+int apply_net_thread_options(const char *what);
+//same, pin to cpu (-1: don't pin). used for one thread per flow (--flows)
+int apply_net_thread_options_cpu(const char *what, int cpu);
+
+//compact description, i.e. for /offer
+void net_options_string(char *buf, size_t size);
+
+void print_net_properties();
+
+//RB_ALLOC_* flags for ringbuffers and scratch buffers, same option for all programs
+//pass to rb_set_alloc_policy() in each source file creating buffers (rb.h is header-only)
+extern int alloc_policy; //param
+
+#define OPT_ALLOC 1100
+
+#define ALLOC_LONG_OPTIONS \
+	{"alloc",       required_argument,      0, OPT_ALLOC}
+
+void print_alloc_help();
+
+//parse --alloc list into alloc_policy. returns 0 if usable
+int alloc_option(const char *arg);
+
+void print_alloc_properties();
+
+//page faults of the calling thread per cycle since the previous call (getrusage)
+//always call from the same thread. cycles: count of cycles so far. returns 0 on the first call
+float page_faults_per_cycle(uint64_t cycles);
+
 #endif //JACK_AUDIO_COMMON_H_INCLUDED
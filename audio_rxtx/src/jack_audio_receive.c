@@ -16,18 +16,21 @@
 #include <string.h>
 #include <math.h>
 #include <signal.h>
+#include <stdarg.h>
 //#include <jack/jack.h>//weak
 //#include <jack/ringbuffer.h>//weak
 #include <lo/lo.h>
 #include <sys/time.h>
 #include <getopt.h>
 #include <unistd.h>
+#include <pthread.h>
+#include <netdb.h>
+#include <sys/socket.h>
 
 #include "jack_audio_common.h"
+#include "../../rb/rb.h"
 #include "jack_audio_receive.h"
 
-#include "rb.h"
-
 //tb/130427/131206//131211//131216/131229/150523
 //gcc -o jack_audio_receiver jack_audio_receiver.c `pkg-config --cflags --libs jack liblo`
 
@@ -39,9 +42,24 @@
 
 //between incoming osc messages and jack process() callbacks
 rb_t *rb;
+//the buffer the osc server thread writes to. differs from rb while a resize is pending
+rb_t *rb_in;
 
 rb_t *rb_helper;
 
+//live resize of rb via /buffer ii
+//osc_buffer_handler() (writer) prepares rb_pending and continues writing to it (rb_in).
+//process() (reader) claims and swaps it in at the start of a cycle.
+//the osc server thread frees the old buffer when it sees the swap done
+//0: idle 1: rb_pending published 3: process() swapping 2: swapped, rb_retired can be freed
+volatile int rb_swap_state=0;
+rb_t *rb_pending=NULL;
+rb_t *rb_retired=NULL;
+
+//bytes readable in rb when rb_pending was filled, oldest bytes not migrated
+uint64_t rb_swap_readable=0;
+uint64_t rb_swap_dropped=0;
+
 //will be updated according to blob count in messages
 int input_port_count=2; //can't know yet
 int output_port_count=2; //param
@@ -114,6 +132,19 @@ char sender_port[10];
 
 int remote_period_size=0;
 int remote_sample_rate=0;
+//as offered, can change during transmission (jack_audio_send --adapt)
+//blobs are converted to local bytes_per_sample
+int remote_bytes_per_sample=0;
+
+//report to sender about once per second (/report)
+uint64_t report_message_counter=0;
+//lost messages, jitter sum since last report
+uint64_t report_lost_counter=0;
+double report_jitter_sum=0;
+//underflows since program start, not reset by /buffer
+uint64_t total_underflow_counter=0;
+uint64_t report_underflow_counter_prev=0;
+struct timeval tv_prev;
 
 /*
 int close_on_incomp=0; //param
@@ -132,6 +163,63 @@ int not_yet_ready=1;
 //osc
 const char *localPort=NULL;
 
+//--flows: the sender stripes channel groups across n UDP flows (/audio_flow)
+//to listening_port+1..n. one thread per port, each writes to its own ringbuffer
+flow_t *flows=NULL;
+//flows with a running thread, joined by stop_flows()
+int flows_started=0;
+//used by gather_flows() in process(), allocated by start_flows()
+char *flow_covered=NULL;
+char *flow_convert_buffer=NULL;
+
+//sender frame time (/audio hhtihi), 0: none received yet
+uint64_t sender_frame_prev=0;
+//message number belonging to sender_frame_prev (messages taken in order only)
+uint64_t sender_message_prev=0;
+//messages arriving late by less than this (UDP reordering) are skipped, more means the sender restarted
+#define SENDER_REORDER_WINDOW 64
+//frames the sender didn't send (xruns on sender)
+uint64_t sender_gap_counter=0;
+uint64_t sender_gap_frames=0;
+
+//jack_frame_time() at arrival, extended to 64 bit
+uint64_t local_frame_time=0;
+
+//sample clock ratio receiver/sender: least squares fit of local arrival frame over sender frame
+//running (Welford) sums relative to the first point, reset on sender restart
+uint64_t clock_fit_count=0;
+double clock_fit_x0=0;
+double clock_fit_y0=0;
+double clock_fit_mean_x=0;
+double clock_fit_mean_y=0;
+double clock_fit_m_xx=0;
+double clock_fit_c_xy=0;
+//local frames per sender frame, 0: not yet known
+double clock_ratio=0;
+
+//--check: periods as played, process() -> checker thread
+rb_t *rb_check=NULL;
+//wakes the checker thread once a whole period is in rb_check
+rb_notifier_t *check_notifier=NULL;
+pthread_t check_thread;
+uint64_t check_cycle=0;
+//periods not checked because rb_check was full
+uint64_t check_skipped=0;
+
+//written by the checker thread
+uint64_t check_periods=0;
+uint64_t check_missing=0;
+uint64_t check_repeated=0;
+uint64_t check_discontinuities=0;
+uint64_t check_swapped=0;
+uint64_t check_wrong_samples=0;
+uint64_t check_silent=0;
+//cycles without data after lock (buffer underflow in this receiver)
+uint64_t check_underflows=0;
+//limit output if everything is broken
+uint64_t check_printed=0;
+#define CHECK_PRINT_MAX 1000
+
 //================================================================
 int main(int argc, char *argv[])
 {
@@ -205,6 +293,10 @@ int main(int argc, char *argv[])
 				bytes_per_sample=2;
 				break;
 
+			case 'z':
+				bytes_per_sample=3;
+				break;
+
 			case 'n':
 				client_name=optarg;
 				break;
@@ -244,6 +336,30 @@ int main(int argc, char *argv[])
 				remote_tcp_server_port=optarg;
 				break;
 
+			case 'q':
+				flow_count=fmax(0,atoi(optarg));
+				break;
+
+			case NET_OPT_RCVBUF:
+			case NET_OPT_SNDBUF:
+			case NET_OPT_BUSY_POLL:
+			case NET_OPT_DSCP:
+			case NET_OPT_SOCK_PRIORITY:
+			case NET_OPT_CPU:
+			case NET_OPT_RT_PRIORITY:
+				if(net_option(opt,optarg)!=0)
+				{
+					exit(1);
+				}
+				break;
+
+			case OPT_ALLOC:
+				if(alloc_option(optarg)!=0)
+				{
+					exit(1);
+				}
+				break;
+
 			case '?': //invalid commands
 				/* getopt_long already printed an error message. */
 				print_header("jack_audio_receive");
@@ -268,6 +384,19 @@ int main(int argc, char *argv[])
 
 	localPort=argv[optind];
 
+	if(check_net_options()!=0)
+	{
+		exit(1);
+	}
+
+	rb_set_alloc_policy(alloc_policy);
+
+	if(flow_count>0 && (use_tcp==1 || atoi(localPort)==0))
+	{
+		fprintf(stderr,"--flows needs UDP and a fixed listening port.\n");
+		exit(1);
+	}
+
 	//for commuication with a gui / other controller / visualizer
 	loio=lo_address_new_with_proto(LO_UDP, io_host, io_port);
 
@@ -281,6 +410,9 @@ int main(int argc, char *argv[])
 	//add osc hooks & start osc server early (~right after cmdline parsing)
 	registerOSCMessagePatterns(localPort);
 
+	//with --tcp, accepted connections inherit the options of the listening socket
+	apply_net_socket_options(lo_server_get_socket_fd(lo_server_thread_get_server(lo_st)),"osc server");
+
 	lo_server_thread_start(lo_st);
 
 	//read back port (in case of random)
@@ -530,8 +662,9 @@ int main(int argc, char *argv[])
 	//====================================
 	//main ringbuffer osc blobs -> jack output
 	rb=rb_new(rb_size);
+	rb_in=rb;
 	//helper ringbuffer: used when remote period size < local period size
-	rb_helper=rb_new(rb_size);
+	rb_helper=rb_new_mirrored(rb_size);
 
 	if(rb==NULL)
 	{
@@ -541,6 +674,30 @@ int main(int argc, char *argv[])
 		exit(1);
 	}
 
+	if(check_enabled==1)
+	{
+		if(start_checker()!=0)
+		{
+			io_quit("cannot_start_checker");
+			exit(1);
+		}
+	}
+
+	if(flow_count>0)
+	{
+		if(start_flows(atoi(localPort))!=0)
+		{
+			io_quit("cannot_start_flows");
+			exit(1);
+		}
+
+		if(shutup==0)
+		{
+			fprintf(stderr,"receiving %d flows on UDP ports %d-%d\n",
+				flow_count,atoi(localPort)+1,atoi(localPort)+flow_count);
+		}
+	}
+
 	//JACK will call process() for every cycle (given by JACK)
 	//NULL could be config/data struct
 	jack_set_process_callback(client, process, NULL);
@@ -720,7 +877,18 @@ int process(jack_nframes_t nframes, void *arg)
 		return 0;
 	}
 
-	if(process_enabled==1)
+	//resized buffer published by osc_buffer_handler()
+	if(rb_swap_state==1 && __sync_bool_compare_and_swap(&rb_swap_state,1,3))
+	{
+		swap_ringbuffer();
+	}
+
+	//--flows: gather from the flows' ringbuffers
+	if(flow_count>0)
+	{
+		gather_flows(nframes);
+	}
+	else if(process_enabled==1)
 	{
 		//if no data for this cycle(all channels) 
 		//is available(!), fill buffers with 0 or re-use old buffers and return
@@ -747,6 +915,7 @@ int process(jack_nframes_t nframes, void *arg)
 			}
 
 			multi_channel_drop_counter++;
+			total_underflow_counter++;
 
 			if(rebuffer_on_underflow==1)
 			{
@@ -759,6 +928,11 @@ int process(jack_nframes_t nframes, void *arg)
 			msg_received_counter=0;
 			fscs_avg_counter=0;
 
+			if(check_enabled==1)
+			{
+				check_feed(nframes,1);
+			}
+
 			return 0;
 		}//end not enough data available in ringbuffer
 
@@ -794,21 +968,25 @@ int process(jack_nframes_t nframes, void *arg)
 			sample_t *o1;
 			o1=(sample_t*)jack_port_get_buffer(ioPortArray[i], nframes);
 
-			int16_t *o1_16;
-
-			if(bytes_per_sample==2)
-			{
-				o1_16=malloc(bytes_per_sample*nframes);
-			}
-
 			//32 bit float
 			if(bytes_per_sample==4)
 			{
 				rb_read(rb, (char*)o1, bytes_per_sample*nframes);
 			}
+			//24 bit pcm
+			else if(bytes_per_sample==3)
+			{
+				unsigned char o1_24[nframes*3];
+
+				rb_read(rb, (char*)o1_24, bytes_per_sample*nframes);
+
+				pcm24_to_float(o1_24,o1,nframes);
+			}
 			//16 bit pcm
 			else
 			{
+				int16_t o1_16[nframes];
+
 				rb_read(rb, (char*)o1_16, bytes_per_sample*nframes);
 
 				int x;
@@ -816,8 +994,6 @@ int process(jack_nframes_t nframes, void *arg)
 				{
 					o1[x]=(float)MIN_(MAX_((float)o1_16[x]/32760,-1.0f),1.0f);
 				}
-
-				free(o1_16);
 			}
 
 			/*
@@ -830,6 +1006,11 @@ int process(jack_nframes_t nframes, void *arg)
 
 		}//end for i < port_count
 
+		if(check_enabled==1)
+		{
+			check_feed(nframes,0);
+		}
+
 		//requested via /buffer, for test purposes (make buffer "tight")
 		if(requested_drop_count>0)
 		{
@@ -946,6 +1127,19 @@ void print_info()
 {
 	uint64_t can_read_count=rb_can_read(rb);
 
+	if(flow_count>0)
+	{
+		can_read_count=0;
+		int i;
+		for(i=0;i<flow_count;i++)
+		{
+			if(flows[i].rb!=NULL)
+			{
+				can_read_count+=rb_can_read(flows[i].rb);
+			}
+		}
+	}
+
 	char* offset_string;
 	if(channel_offset>0)
 	{
@@ -965,7 +1159,7 @@ void print_info()
 		if(shutup==0 && quiet==0)
 		{
 			fprintf(stderr,"\r# %" PRId64 " i: %s%d f: %.1f b: %" PRId64 " s: %.4f i: %.2f r: %" PRId64 
-				" l: %" PRId64 " d: %" PRId64 " o: %" PRId64 " p: %.1f%s",
+				" l: %" PRId64 " d: %" PRId64 " o: %" PRId64 " p: %.1f g: %" PRId64 " c: %+.3f pf: %.2f%s",
 				message_number,
 				offset_string,
 				input_port_count,
@@ -978,6 +1172,9 @@ void print_info()
 				multi_channel_drop_counter,
 				buffer_overflow_counter,
 				(float)frames_since_cycle_start_avg/(float)period_size,
+				sender_gap_counter,
+				clock_ratio>0 ? (clock_ratio-1)*1000000 : 0,
+				page_faults_per_cycle(process_cycle_counter),
 				"\033[0J"
 			);
 		}
@@ -1011,6 +1208,9 @@ void print_info()
 				(float)frames_since_cycle_start_avg/(float)period_size
 			);
 
+			lo_message_add_int64(msgio,sender_gap_counter);
+			lo_message_add_double(msgio,clock_ratio>0 ? (clock_ratio-1)*1000000 : 0);
+
 			lo_send_message(loio, "/status", msgio);
 			lo_message_free(msgio);
 		}
@@ -1044,6 +1244,8 @@ void registerOSCMessagePatterns(const char *port)
 */
 
 	lo_server_thread_add_method(lo_st, "/offer", "fiiiifh", osc_offer_handler, NULL);
+	//8) s: socket options of sender (--rcvbuf etc.), only sent if any is set
+	lo_server_thread_add_method(lo_st, "/offer", "fiiiifhs", osc_offer_handler, NULL);
 
 /*
 	experimental
@@ -1060,46 +1262,35 @@ void registerOSCMessagePatterns(const char *port)
 	lo_server_thread_add_method(lo_st, "/buffer", "ii", osc_buffer_handler, NULL);
 
 /*
-	/audio hhtib*
+	/audio hhtihib*
 
 	1) h: message number
 	2) h: xrun counter (sender side, as all the following meta data)
 	3) t: timetag (seconds since Jan 1st 1900 in the UTC, fraction 1/2^32nds of a second)
 	4) i: sampling rate
-	5) b: blob of channel 1 (period size * bytes per sample) bytes long
+	5) h: sender JACK frame time of the period (64 bit)
+	6) i: frames since period start when the timetag was taken
+	7) b: blob of channel 1 (period size * bytes per sample) bytes long
 	...
 	...b: up to n channels
+
+	/audio hhtib* (without 5, 6) is accepted too (audio_post_send --tcp)
 */
 
-	char typetag_string[1024];
-	int v=0;
-	for(v=0;v<1024;v++)
-	{
-		typetag_string[v]='\0';
-	}
+//the max possible channel count depends on JACK period size, SR, liblo version (fixmax), 16/32 bit, 100/1000 mbit/s network
+	register_audio_methods(osc_audio_handler);
 
-	//char *prefix="hhti";
-	typetag_string[0]='h';
-	typetag_string[1]='h';
-	typetag_string[2]='t';
-	typetag_string[3]='i';
+/*
+	/audio_frag hiib
 
-	/////////////////
-	int data_offset=4;
+	1) h: id of the fragmented message, increasing. starts at 1 again when the sender restarts
+	2) i: byte offset of this chunk in the message
+	3) i: message length
+	4) b: chunk of the serialized /audio message
 
-//the max possible channel count depends on JACK period size, SR, liblo version (fixmax), 16/32 bit, 100/1000 mbit/s network
-/*
-	//support 1-n blobs / channels per message
-	lo_server_thread_add_method(lo_st, "/audio", "hhtib", audio_handler, NULL);
-	lo_server_thread_add_method(lo_st, "/audio", "hhtibb", audio_handler, NULL);
-..
+	jack_audio_send --pace sends messages larger than one datagram (1452 bytes) this way
 */
-	v=0;
-	for(v=0;v<max_channel_count;v++)
-	{
-		typetag_string[data_offset+v]='b';
-		lo_server_thread_add_method(lo_st, "/audio", typetag_string, osc_audio_handler, NULL);
-	}
+	lo_server_thread_add_method(lo_st, "/audio_frag", "hiib", osc_frag_handler, NULL);
 
 //GUI I/O, CONTROL RELATED==============================
 
@@ -1134,6 +1325,12 @@ int osc_offer_handler(const char *path, const char *types, lo_arg **argv, int ar
 //	float offered_data_rate=argv[5]->f;
 //	uint64_t request_counter=argv[6]->h;
 
+	//fiiiifhs: socket options of sender
+	const char *offered_net_options=(argc>7) ? &argv[7]->s : NULL;
+
+	//(re)started sender numbers /audio_frag from 1
+	frag_stream++;
+
 	lo_message msg=lo_message_new();
 
 	//send back to host that offered audio
@@ -1155,7 +1352,8 @@ int osc_offer_handler(const char *path, const char *types, lo_arg **argv, int ar
 	//could check more stuff (channel count, data rate, sender host/port, ...)
 	if(
 		offered_sample_rate==sample_rate
-		&& offered_bytes_per_sample==bytes_per_sample
+		//other formats are converted
+		&& offered_bytes_per_sample>=2 && offered_bytes_per_sample<=4
 		&& offered_format_version==format_version
 
 		//new: support non-matching period sizes
@@ -1164,6 +1362,7 @@ int osc_offer_handler(const char *path, const char *types, lo_arg **argv, int ar
 	{
 		remote_sample_rate=sample_rate;
 		remote_period_size=offered_period_size;
+		remote_bytes_per_sample=offered_bytes_per_sample;
 
 		strcpy(sender_host,lo_address_get_hostname(loa));
 		strcpy(sender_port,lo_address_get_port(loa));
@@ -1171,6 +1370,11 @@ int osc_offer_handler(const char *path, const char *types, lo_arg **argv, int ar
 		//sending accept will tell the sender to start transmission
 		lo_send_message(loa, "/accept", msg);
 
+		if(offered_net_options!=NULL && starting_transmission==0 && shutup==0)
+		{
+			fprintf(stderr,"\nsender network: %s\n",offered_net_options);
+		}
+
 		/*
 		fprintf(stderr,"\nreceiving from %s:%s",
 			lo_address_get_hostname(loa),lo_address_get_port(loa));
@@ -1221,13 +1425,24 @@ int osc_audio_handler(const char *path, const char *types, lo_arg **argv, int ar
 		return 0;
 	}
 
+	finish_ringbuffer_swap();
+
+	//this handler runs in the osc server thread (created by liblo)
+	static int net_thread_tuned=0;
+	if(net_thread_tuned==0)
+	{
+		apply_net_thread_options("osc server");
+		net_thread_tuned=1;
+	}
+
 	//init to 0, increment before use
 	msg_received_counter++;
 
 	gettimeofday(&tv, NULL);
 
 	//first blob is at data_offset+1 (one-based)
-	int data_offset=4;
+	int data_offset=audio_data_offset(types);
+	int has_frame_time=(data_offset==6);
 
 	//ignore first n channels/blobs
 	data_offset+=channel_offset;
@@ -1237,11 +1452,18 @@ int osc_audio_handler(const char *path, const char *types, lo_arg **argv, int ar
 	//the messages are numbered sequentially. first msg is numberd 1
 	message_number=argv[0]->h;
 
+	if(message_number==1)
+	{
+		frag_stream++;
+	}
+
 	if(message_number_prev<message_number-1)
 	{
 		fprintf(stderr,"\ngap in message sequence! possibly lost %" PRId64" message(s) on the way.\n"
 			,message_number-message_number_prev-1);
 		fflush(stderr);
+
+		report_lost_counter+=message_number-message_number_prev-1;
 	}
 
 	//total args count minus metadata args count = number of blobs
@@ -1260,6 +1482,12 @@ int osc_audio_handler(const char *path, const char *types, lo_arg **argv, int ar
 		return 0;
 	}
 
+	//all channels silent (empty blobs) and no /offer seen: can't know remote period size yet
+	if(remote_period_size==0 && first_blob_datasize(argv,data_offset,argc)==0)
+	{
+		return 0;
+	}
+
 	//check sample rate and period size if sender (re)started or values not yet initialized (=no /offer received)
 	if(message_number_prev>message_number || message_number==1 || remote_sample_rate==0 || remote_period_size==0 )
 	{
@@ -1281,7 +1509,7 @@ int osc_audio_handler(const char *path, const char *types, lo_arg **argv, int ar
 		//option --rebuff
 		if(rebuffer_on_restart==1)
 		{
-			uint64_t can_read_count=rb_can_read(rb);
+			uint64_t can_read_count=rb_can_read(rb_in);
 			pre_buffer_counter=fmax(0,(float)can_read_count/(float)bytes_per_sample/(float)period_size/(float)port_count);
 			//start buffering
 			process_enabled=0;
@@ -1346,7 +1574,12 @@ int osc_audio_handler(const char *path, const char *types, lo_arg **argv, int ar
 			}
 		}
 
-		remote_period_size=lo_blob_datasize((lo_blob)argv[0+data_offset])/bytes_per_sample;
+		//silent channels are empty, use first non-empty blob. keep value from /offer if all silent
+		int blob_size=first_blob_datasize(argv,data_offset,argc);
+		if(blob_size>0)
+		{
+			remote_period_size=blob_size/(remote_bytes_per_sample>0 ? remote_bytes_per_sample : bytes_per_sample);
+		}
 
 		if(shutup==0 && quiet==0)
 		{
@@ -1376,6 +1609,11 @@ int osc_audio_handler(const char *path, const char *types, lo_arg **argv, int ar
 
 	remote_xrun_counter=argv[1]->h;
 
+	if(has_frame_time==1)
+	{
+		sender_frame_time_received(argv[4]->h,argv[5]->i);
+	}
+
 	lo_timetag tt=argv[2]->t;
 
 	double msg_time=tt.sec+(double)tt.frac/1000000;
@@ -1397,6 +1635,20 @@ int osc_audio_handler(const char *path, const char *types, lo_arg **argv, int ar
 		time_interval_sum=0;
 	}
 
+	//arrival jitter: deviation from nominal message interval
+	if(tv_prev.tv_sec>0)
+	{
+		double arrival_interval=(tv.tv_sec-tv_prev.tv_sec)+(double)(tv.tv_usec-tv_prev.tv_usec)/1000000;
+		report_jitter_sum+=fabs(arrival_interval-(double)remote_period_size/sample_rate);
+	}
+	tv_prev=tv;
+
+	report_message_counter++;
+	if(report_message_counter>=MAX_(1,sample_rate/remote_period_size))
+	{
+		send_report(data);
+	}
+
 	if(pre_buffer_counter>=pre_buffer_size && process_enabled==0)
 	{
 		//if buffer filled, start to output audio in process()
@@ -1406,7 +1658,7 @@ int osc_audio_handler(const char *path, const char *types, lo_arg **argv, int ar
 	int mc_period_bytes=period_size*bytes_per_sample*port_count;
 
 	//check if a whole mc period can be written to the ringbuffer
-	uint64_t can_write_count=rb_can_write(rb);
+	uint64_t can_write_count=rb_can_write(rb_in);
 	if(can_write_count < mc_period_bytes)
 	{
 			buffer_overflow_counter++;
@@ -1428,13 +1680,14 @@ int osc_audio_handler(const char *path, const char *types, lo_arg **argv, int ar
 		for(i=0;i < port_count;i++)
 		{
 			//get blob (=one period of one channel)
-			unsigned char *data=lo_blob_dataptr((lo_blob)argv[i+data_offset]);
+			unsigned char *data=blob_data_local((lo_blob)argv[i+data_offset],
+				remote_period_size,i);
 			//fprintf(stderr,"size %d\n",lo_blob_datasize((lo_blob)argv[i+data_offset]));
 
 			//write to ringbuffer
 			//==========================================
 			//int cnt=
-			rb_write(rb, (void *) data, 
+			rb_write(rb_in, (void *) data, 
 				period_size*bytes_per_sample);
 		}
 		pre_buffer_counter++;
@@ -1446,7 +1699,8 @@ int osc_audio_handler(const char *path, const char *types, lo_arg **argv, int ar
 		for(i=0;i < port_count;i++)
 		{
 			//get blob (=one period of one channel)
-			unsigned char *data=lo_blob_dataptr((lo_blob)argv[i+data_offset]);
+			unsigned char *data=blob_data_local((lo_blob)argv[i+data_offset],
+				remote_period_size,i);
 			//fprintf(stderr,"size %d\n",lo_blob_datasize((lo_blob)argv[i+data_offset]));
 
 			//write to temporary ringbuffer until there is enough data
@@ -1459,14 +1713,21 @@ int osc_audio_handler(const char *path, const char *types, lo_arg **argv, int ar
 		//if enough data collected for one larger multichannel period
 
 		while(rb_can_read(rb_helper)	>=mc_period_bytes
-		&& rb_can_write(rb)		>=mc_period_bytes)
+		&& rb_can_write(rb_in)		>=mc_period_bytes)
 		{
-			//transfer from helper to main ringbuffer
+			//transfer from helper to main ringbuffer, reading the helper in place
+			rb_region_t regions[2];
+			rb_read_reserve(rb_helper,mc_period_bytes,regions);
 			unsigned char* data;
-			data=malloc(				mc_period_bytes);
 			//store orig pointer
-			unsigned char* orig_data=data;
-			rb_read(rb_helper,data,	mc_period_bytes);
+			unsigned char* orig_data=(unsigned char*)regions[0].buffer;
+			if(regions[1].size>0)
+			{
+				//period wraps around the end of a plain (not mirrored) helper buffer
+				orig_data=malloc(mc_period_bytes);
+				memcpy(orig_data,regions[0].buffer,regions[0].size);
+				memcpy(orig_data+regions[0].size,regions[1].buffer,regions[1].size);
+			}
 
 			for(i=0;i < port_count;i++)
 			{
@@ -1481,11 +1742,14 @@ int osc_audio_handler(const char *path, const char *types, lo_arg **argv, int ar
 
 					//write one channel snipped (remote_period_size) to main buffer
 					//int w=
-					rb_write(rb,(void *)data,remote_period_size*bytes_per_sample);
+					rb_write(rb_in,(void *)data,remote_period_size*bytes_per_sample);
 				}
 			}
-			data=orig_data;
-			free(data);
+			if(regions[1].size>0)
+			{
+				free(orig_data);
+			}
+			rb_read_commit(rb_helper,mc_period_bytes);
 
 			pre_buffer_counter++;
 		}
@@ -1501,7 +1765,8 @@ int osc_audio_handler(const char *path, const char *types, lo_arg **argv, int ar
 			for(i=0;i < port_count;i++)
 			{
 				//get blob (=one period of one channel)
-				unsigned char *data=lo_blob_dataptr((lo_blob)argv[i+data_offset]);
+				unsigned char *data=blob_data_local((lo_blob)argv[i+data_offset],
+					remote_period_size,i);
 				//fprintf(stderr,"size %d\n",lo_blob_datasize((lo_blob)argv[i+data_offset]));
 
 				//write to ringbuffer
@@ -1509,7 +1774,7 @@ int osc_audio_handler(const char *path, const char *types, lo_arg **argv, int ar
 				data+=k*period_size*bytes_per_sample;
 
 				//int cnt=
-				rb_write(rb, (void *) data, 
+				rb_write(rb_in, (void *) data, 
 					period_size*bytes_per_sample);
 			}
 			pre_buffer_counter++;
@@ -1519,6 +1784,264 @@ int osc_audio_handler(const char *path, const char *types, lo_arg **argv, int ar
 	return 0;
 }//end osc_audio_handler
 
+//================================================================
+void clock_fit_reset()
+{
+	clock_fit_count=0;
+	clock_ratio=0;
+}
+
+//================================================================
+//x: sender frame, y: local frame
+void clock_fit_add(double x, double y)
+{
+	if(clock_fit_count==0)
+	{
+		clock_fit_x0=x;
+		clock_fit_y0=y;
+		clock_fit_mean_x=0;
+		clock_fit_mean_y=0;
+		clock_fit_m_xx=0;
+		clock_fit_c_xy=0;
+	}
+
+	x-=clock_fit_x0;
+	y-=clock_fit_y0;
+
+	clock_fit_count++;
+	double dx=x-clock_fit_mean_x;
+	clock_fit_mean_x+=dx/clock_fit_count;
+	clock_fit_mean_y+=(y-clock_fit_mean_y)/clock_fit_count;
+	clock_fit_m_xx+=dx*(x-clock_fit_mean_x);
+	clock_fit_c_xy+=dx*(y-clock_fit_mean_y);
+
+	//arrival jitter averages out over time. show after 10 seconds
+	if(x>=10*sample_rate && clock_fit_m_xx>0)
+	{
+		clock_ratio=clock_fit_c_xy/clock_fit_m_xx;
+	}
+}//end clock_fit_add
+
+//================================================================
+//called by osc_audio_handler() with the sender's frame time of the period
+//and the offset of the timetag in frames
+void sender_frame_time_received(uint64_t frame, int timetag_offset)
+{
+	uint64_t local=frame_time_64(&local_frame_time,jack_frame_time(client));
+
+	//first message or sender restarted
+	if(sender_frame_prev==0 || message_number==1
+		|| message_number+SENDER_REORDER_WINDOW<=sender_message_prev)
+	{
+		clock_fit_reset();
+	}
+	else if(message_number<=sender_message_prev)
+	{
+		//late (reordered) or duplicate message: keep the fit, it only takes messages in order
+		return;
+	}
+	else
+	{
+		//lost messages (network) are accounted for by the message number
+		uint64_t expected=sender_frame_prev+(message_number-sender_message_prev)*remote_period_size;
+		int64_t gap=(int64_t)(frame-expected);
+
+		if(gap>0)
+		{
+			sender_gap_counter++;
+			sender_gap_frames+=gap;
+
+			if(shutup==0)
+			{
+				fprintf(stderr,"\nsender discontinuity at sender frame %" PRId64 ": %" PRId64 " frames not sent (# %" PRId64 ", remote xruns: %" PRId64 ")\n",
+					expected,gap,message_number,remote_xrun_counter);
+			}
+			io_simple_long("/sender_gap",gap);
+		}
+		else if(gap<0)
+		{
+			if(shutup==0)
+			{
+				fprintf(stderr,"\nsender frame time went back %" PRId64 " frames (# %" PRId64 ")\n",
+					-gap,message_number);
+			}
+			clock_fit_reset();
+		}
+	}
+	sender_frame_prev=frame;
+	sender_message_prev=message_number;
+
+	clock_fit_add((double)(frame+timetag_offset),(double)local);
+}//end sender_frame_time_received
+
+//================================================================
+// /report ifii, about once per second
+//jack_audio_send --adapt uses this to step down or up in sample format
+void send_report(lo_message data)
+{
+	lo_address loa;
+
+	if(use_tcp==1)
+	{
+		lo_address loa_=lo_message_get_source(data);
+		loa=lo_address_new_with_proto(lo_proto,lo_address_get_hostname(loa_),remote_tcp_server_port);
+	}
+	else
+	{
+		loa=lo_message_get_source(data);
+	}
+
+	/*
+	1) i: lost messages since last report
+	2) f: average arrival jitter in ms
+	3) i: buffer fill in mc periods
+	4) i: buffer underflows since last report
+	*/
+	lo_message msg=lo_message_new();
+	lo_message_add_int32(msg,report_lost_counter);
+	lo_message_add_float(msg,1000*report_jitter_sum/report_message_counter);
+	lo_message_add_int32(msg,rb_can_read(rb_in)/(port_count*period_size*bytes_per_sample));
+	lo_message_add_int32(msg,total_underflow_counter-report_underflow_counter_prev);
+
+	lo_send_message(loa, "/report", msg);
+	lo_message_free(msg);
+
+	if(use_tcp==1)
+	{
+		lo_address_free(loa);
+	}
+
+	report_message_counter=0;
+	report_lost_counter=0;
+	report_jitter_sum=0;
+	report_underflow_counter_prev=total_underflow_counter;
+}//end send_report
+
+//================================================================
+int frag_add(frag_t *frag, lo_arg **argv)
+{
+	uint64_t id=argv[0]->h;
+	uint32_t offset=argv[1]->i;
+	uint32_t length=argv[2]->i;
+	uint32_t size=lo_blob_datasize((lo_blob)argv[3]);
+
+	if(length>LO_MAX_UDP_MSG_SIZE || offset>length || size>length-offset)
+	{
+		return 0;
+	}
+
+	if(frag->buffer==NULL)
+	{
+		frag->buffer=rb_alloc_scratch(LO_MAX_UDP_MSG_SIZE);
+		if(frag->buffer==NULL)
+		{
+			return 0;
+		}
+	}
+
+	//new sender stream: drop whatever was assembled
+	if(frag->stream!=frag_stream || id+FRAG_ID_WINDOW<frag->id)
+	{
+		frag->stream=frag_stream;
+		frag->id=0;
+		frag->length=0;
+		frag->received=0;
+		frag->count=0;
+	}
+
+	//older message: already complete or given up
+	if(id<frag->id)
+	{
+		return 0;
+	}
+
+	//fragments of the previous message still missing are lost with it
+	if(id>frag->id)
+	{
+		frag->id=id;
+		frag->length=length;
+		frag->received=0;
+		frag->count=0;
+	}
+
+	int i;
+	for(i=0;i<frag->count;i++)
+	{
+		if(frag->offsets[i]==offset)
+		{
+			return 0;
+		}
+	}
+	if(frag->count>=FRAG_MAX_COUNT || length!=frag->length)
+	{
+		return 0;
+	}
+	frag->offsets[frag->count]=offset;
+	frag->count++;
+
+	memcpy(frag->buffer+offset,lo_blob_dataptr((lo_blob)argv[3]),size);
+	frag->received+=size;
+
+	return frag->received==frag->length;
+}//end frag_add
+
+//================================================================
+//hhti or hhtihi followed by 1..max_channel_count blobs, as registered for /audio
+int audio_types_valid(const char *types)
+{
+	if(strncmp(types,"hhti",4)!=0)
+	{
+		return 0;
+	}
+
+	int data_offset=audio_data_offset(types);
+	int blobs=strlen(types)-data_offset;
+	if(blobs<1 || blobs>max_channel_count)
+	{
+		return 0;
+	}
+
+	int i;
+	for(i=data_offset;types[i]!='\0';i++)
+	{
+		if(types[i]!='b')
+		{
+			return 0;
+		}
+	}
+	return 1;
+}
+
+//================================================================
+// /audio_frag
+int osc_frag_handler(const char *path, const char *types, lo_arg **argv, int argc,
+	void *data, void *user_data)
+{
+	static frag_t frag;
+
+	if(shutdown_in_progress==1 || not_yet_ready==1 || frag_add(&frag,argv)==0)
+	{
+		return 0;
+	}
+
+	int result;
+	lo_message msg=lo_message_deserialise(frag.buffer,frag.length,&result);
+	if(msg==NULL)
+	{
+		return 0;
+	}
+
+	//path is the first OSC string
+	const char *msg_types=lo_message_get_types(msg);
+	if(strcmp(frag.buffer,"/audio")==0 && audio_types_valid(msg_types))
+	{
+		//data: the message of the last fragment, same source as the whole
+		osc_audio_handler("/audio",msg_types,lo_message_get_argv(msg),lo_message_get_argc(msg),data,user_data);
+	}
+	lo_message_free(msg);
+	return 0;
+}//end osc_frag_handler
+
 //================================================================
 // /buffer
 int osc_buffer_handler(const char *path, const char *types, lo_arg **argv, int argc,
@@ -1535,6 +2058,15 @@ int osc_buffer_handler(const char *path, const char *types, lo_arg **argv, int a
 		return 0;
 	}
 
+	//the flow buffers are created and written by the flow threads, there is no swap for them
+	if(flow_count>0)
+	{
+		fprintf(stderr,"\n/buffer ii is not supported with --flows! ignoring.\n");
+		return 0;
+	}
+
+	finish_ringbuffer_swap();
+
 	int pre_buffer_periods=fmax(1,argv[0]->i);
 	int max_buffer_periods=fmax(pre_buffer_periods,argv[1]->i);
 
@@ -1545,7 +2077,11 @@ int osc_buffer_handler(const char *path, const char *types, lo_arg **argv, int a
 
 	//create new buffer if not equal to current max
 	//the current buffer will be lost
-	if(max_buffer_periods!=max_buffer_size)
+	if(max_buffer_periods!=max_buffer_size && rb_swap_state!=0)
+	{
+		fprintf(stderr,"previous resize not yet done (process() not running?). keeping current buffer.\n");
+	}
+	else if(max_buffer_periods!=max_buffer_size)
 	{
 		char buf[64];
 		format_seconds(buf,(float)max_buffer_periods*period_size/(float)sample_rate);
@@ -1557,14 +2093,20 @@ int osc_buffer_handler(const char *path, const char *types, lo_arg **argv, int a
 			(float)rb_size/1000/1000
 		);
 
-		max_buffer_size=max_buffer_periods;
-
-		rb=rb_new(rb_size);
-		// /buffer is experimental, it can segfault
+		rb_t *rb_resized=rb_new(rb_size);
+		if(rb_resized==NULL)
+		{
+			fprintf(stderr,"could not create a ringbuffer with that size. keeping current buffer.\n");
+		}
+		else
+		{
+			resize_ringbuffer(rb_resized);
+			max_buffer_size=max_buffer_periods;
+		}
 	}
 
 	//current size
-	uint64_t can_read_count=rb_can_read(rb);
+	uint64_t can_read_count=rb_can_read(rb_in);
 	uint64_t can_read_periods_count=can_read_count/port_count/period_size/bytes_per_sample;
 
 	if(pre_buffer_periods>can_read_periods_count)
@@ -1589,7 +2131,105 @@ int osc_buffer_handler(const char *path, const char *types, lo_arg **argv, int a
 }//end osc_buffer_handler
 
 //================================================================
-// /quit
+//called by osc_buffer_handler() (writer side, no concurrent rb_write())
+//migrate unread whole mc periods to rb_resized and publish it for process() to swap in.
+//the writer continues with rb_resized, so nothing is written to rb after the copy
+void resize_ringbuffer(rb_t *rb_resized)
+{
+	uint64_t mc_period_bytes=period_size*bytes_per_sample*port_count;
+
+	//consistent snapshot, the reader can only advance read_index while we're copying
+	uint64_t readable;
+	uint64_t read_index;
+	do
+	{
+		read_index=rb->read_index;
+		readable=rb_can_read(rb);
+	}
+	while(read_index!=rb->read_index);
+
+	//keep newest data. the write index is always on a mc period boundary
+	uint64_t keep=MIN_(readable,rb_size(rb_resized));
+	keep-=keep%mc_period_bytes;
+	uint64_t dropped=readable-keep;
+
+	//data between read_index and write_index isn't touched by the reader
+	size_t start=(read_index+dropped)%rb_size(rb);
+	size_t copy_count_1=MIN_(keep,rb_size(rb)-start);
+
+	rb_write(rb_resized,(char*)buf_ptr(rb)+start,copy_count_1);
+	if(keep>copy_count_1)
+	{
+		rb_write(rb_resized,(char*)buf_ptr(rb),keep-copy_count_1);
+	}
+
+	rb_swap_readable=readable;
+	rb_swap_dropped=dropped;
+	rb_pending=rb_resized;
+	rb_in=rb_resized;
+
+	__sync_synchronize();
+	rb_swap_state=1;
+
+	if(dropped>0)
+	{
+		fprintf(stderr,"dropping %" PRId64 " bytes not fitting into new buffer\n",dropped);
+	}
+}//end resize_ringbuffer
+
+//================================================================
+//called by process() at start of cycle after claiming rb_swap_state 1 -> 3.
+//realtime safe, no allocation
+void swap_ringbuffer()
+{
+	//rb isn't written anymore, so any difference was consumed by process()
+	uint64_t consumed=rb_swap_readable-rb_can_read(rb);
+
+	if(consumed>rb_swap_dropped)
+	{
+		rb_advance_read_index(rb_pending,consumed-rb_swap_dropped);
+	}
+
+	rb_retired=rb;
+	rb=rb_pending;
+	rb_pending=NULL;
+
+	__sync_synchronize();
+	rb_swap_state=2;
+}//end swap_ringbuffer
+
+//================================================================
+//called by the osc server thread before using rb_in.
+//frees the old buffer once process() has swapped
+void finish_ringbuffer_swap()
+{
+	if(rb_swap_state!=2)
+	{
+		return;
+	}
+	__sync_synchronize();
+	rb_free(rb_retired);
+	rb_retired=NULL;
+	rb_swap_state=0;
+}//end finish_ringbuffer_swap
+
+//================================================================
+//process() isn't running anymore. free what a pending resize left over
+void free_ringbuffers()
+{
+	//only a published, not yet claimed buffer can be taken back
+	if(__sync_bool_compare_and_swap(&rb_swap_state,1,0))
+	{
+		rb_free(rb_pending);
+		rb_pending=NULL;
+	}
+	finish_ringbuffer_swap();
+	rb_free(rb);
+	rb_free(rb_helper);
+}//end free_ringbuffers
+
+//================================================================
+// /quit
 int osc_quit_handler(const char *path, const char *types, lo_arg **argv, int argc,
 	void *data, void *user_data)
 {
@@ -1617,10 +2257,11 @@ void osc_error_handler(int num, const char *msg, const char *path)
 
 		fprintf(stderr,"cleaning up...");
 
+		shutdown_in_progress=1;
 		jack_client_close(client);
 		//lo_server_thread_free(lo_st);
-		rb_free(rb);
-		rb_free(rb_helper);
+		stop_flows();
+		free_ringbuffers();
 		fprintf(stderr," done.\n");
 
 		exit(1);
@@ -1668,11 +2309,19 @@ static void signal_handler(int sig)
 
 	jack_client_close(client);
 //      lo_server_thread_free(lo_st);
-	rb_free(rb);
-	rb_free(rb_helper);
+	stop_flows();
+	free_ringbuffers();
 
 	fprintf(stderr," done.\n");
 
+	fprintf(stderr,"buffer underflows: %" PRId64 ", buffer overflows: %" PRId64 "\n",
+		total_underflow_counter,buffer_overflow_counter);
+
+	if(check_enabled==1)
+	{
+		print_check_summary();
+	}
+
 	exit(0);
 }//end signal_handler
 
@@ -1731,3 +2380,751 @@ void io_dump_config()
 		lo_message_free(msgio);
 	}//end if io_
 }//end io_dump_config
+
+//================================================================
+int start_flows(int base_port)
+{
+	flows=calloc(flow_count,sizeof(flow_t));
+	flow_covered=rb_alloc_scratch(output_port_count);
+	//one period of one channel, at most 4 bytes per sample
+	flow_convert_buffer=rb_alloc_scratch(period_size*4);
+	if(flows==NULL || flow_covered==NULL || flow_convert_buffer==NULL)
+	{
+		fprintf(stderr,"could not allocate flows\n");
+		return 1;
+	}
+
+	int i;
+	for(i=0;i<flow_count;i++)
+	{
+		flow_t *flow=&flows[i];
+		flow->index=i;
+
+		char port[16];
+		snprintf(port,sizeof(port),"%d",base_port+1+i);
+
+		struct addrinfo hints;
+		struct addrinfo *ai;
+		memset(&hints,0,sizeof(hints));
+		hints.ai_family=AF_INET6;
+		hints.ai_socktype=SOCK_DGRAM;
+		hints.ai_flags=AI_PASSIVE;
+
+		//prefer dual stack, fall back to IPv4 only
+		if(getaddrinfo(NULL,port,&hints,&ai)!=0)
+		{
+			hints.ai_family=AF_INET;
+			if(getaddrinfo(NULL,port,&hints,&ai)!=0)
+			{
+				fprintf(stderr,"flow %d: can't resolve port %s\n",i,port);
+				return 1;
+			}
+		}
+
+		flow->socket=socket(ai->ai_family,ai->ai_socktype,ai->ai_protocol);
+		if(ai->ai_family==AF_INET6)
+		{
+			int off=0;
+			setsockopt(flow->socket,IPPROTO_IPV6,IPV6_V6ONLY,&off,sizeof(off));
+		}
+
+		if(flow->socket<0 || bind(flow->socket,ai->ai_addr,ai->ai_addrlen)!=0)
+		{
+			fprintf(stderr,"flow %d: can't bind UDP port %s: %s\n",i,port,strerror(errno));
+			freeaddrinfo(ai);
+			return 1;
+		}
+		freeaddrinfo(ai);
+
+		apply_net_socket_options(flow->socket,"flow");
+
+		//stop_flows() wakes recv() with shutdown(). the timeout is for systems where that doesn't
+		struct timeval timeout;
+		timeout.tv_sec=1;
+		timeout.tv_usec=0;
+		setsockopt(flow->socket,SOL_SOCKET,SO_RCVTIMEO,&timeout,sizeof(timeout));
+
+		if(pthread_create(&flow->thread,NULL,flow_thread_func,flow)!=0)
+		{
+			fprintf(stderr,"flow %d: could not start thread\n",i);
+			return 1;
+		}
+		flows_started++;
+	}
+	return 0;
+}//end start_flows
+
+//================================================================
+//called after process() stopped (shutdown_in_progress set).
+//wake up and join the flow threads, then free their buffers
+void stop_flows()
+{
+	int i;
+	for(i=0;i<flows_started;i++)
+	{
+		shutdown(flows[i].socket,SHUT_RDWR);
+	}
+
+	for(i=0;i<flows_started;i++)
+	{
+		flow_t *flow=&flows[i];
+		pthread_join(flow->thread,NULL);
+		close(flow->socket);
+		if(flow->rb!=NULL)
+		{
+			rb_free(flow->rb);
+			flow->rb=NULL;
+		}
+		if(flow->scratch!=NULL)
+		{
+			rb_free_scratch(flow->scratch,flow->slot_bytes);
+			flow->scratch=NULL;
+		}
+	}
+	flows_started=0;
+}//end stop_flows
+
+//================================================================
+static void *flow_thread_func(void *arg)
+{
+	flow_t *flow=(flow_t*)arg;
+
+	char name[16];
+	snprintf(name,sizeof(name),"flow %d",flow->index);
+	apply_net_thread_options_cpu(name,net_cpu!=-1 ? net_cpu+flow->index : -1);
+
+	char *buffer=rb_alloc_scratch(LO_MAX_UDP_MSG_SIZE);
+
+	while(shutdown_in_progress==0)
+	{
+		ssize_t len=recv(flow->socket,buffer,LO_MAX_UDP_MSG_SIZE,0);
+
+		//path is the first OSC string
+		int is_frag=(len>=16 && strncmp(buffer,"/audio_frag",12)==0);
+		if(len<16 || not_yet_ready==1 || (is_frag==0 && strncmp(buffer,"/audio_flow",12)!=0))
+		{
+			continue;
+		}
+
+		int result;
+		lo_message msg=lo_message_deserialise(buffer,len,&result);
+		if(msg==NULL)
+		{
+			continue;
+		}
+
+		//jack_audio_send --pace: continue with the reassembled message once complete
+		if(is_frag==1)
+		{
+			lo_message whole=NULL;
+			if(strncmp(lo_message_get_types(msg),"hiib",5)==0
+				&& frag_add(&flow->frag,lo_message_get_argv(msg))==1
+				&& strcmp(flow->frag.buffer,"/audio_flow")==0)
+			{
+				whole=lo_message_deserialise(flow->frag.buffer,flow->frag.length,&result);
+			}
+			lo_message_free(msg);
+			msg=whole;
+			if(msg==NULL)
+			{
+				continue;
+			}
+		}
+
+		if(strncmp(lo_message_get_types(msg),"hhtiii",6)==0)
+		{
+			flow_message(flow,lo_message_get_argv(msg),lo_message_get_argc(msg));
+		}
+		lo_message_free(msg);
+	}
+
+	rb_free_scratch(buffer,LO_MAX_UDP_MSG_SIZE);
+	if(flow->frag.buffer!=NULL)
+	{
+		rb_free_scratch(flow->frag.buffer,LO_MAX_UDP_MSG_SIZE);
+	}
+	return NULL;
+}//end flow_thread_func
+
+//================================================================
+// /audio_flow hhtiiib*
+//like osc_audio_handler(), for one channel group. called from the flow's thread
+void flow_message(flow_t *flow, lo_arg **argv, int argc)
+{
+	//no /offer seen yet: sample format unknown
+	if(remote_sample_rate==0 || argv[3]->i!=sample_rate)
+	{
+		return;
+	}
+
+	uint64_t number=argv[0]->h;
+	int first=argv[4]->i-channel_offset;
+	int total=argv[5]->i-channel_offset;
+	int blobs=argc-6;
+
+	//all flows carry the same totals. only flow 0 writes the shared state
+	//(flow 0 stands for all in the running info)
+	if(flow->index==0)
+	{
+		input_port_count=total;
+		port_count=MIN_(total,output_port_count);
+
+		message_number_prev=message_number;
+		message_number=number;
+		remote_xrun_counter=argv[1]->h;
+	}
+
+	//local channel range of this flow (--offset, --out)
+	int skip=MAX_(0,-first);
+	int first_local=first+skip;
+	int count=MIN_(first+blobs,output_port_count)-first_local;
+
+	if(count<1)
+	{
+		//no used channels in this flow
+		return;
+	}
+
+	int period_bytes=period_size*bytes_per_sample;
+	int slot_bytes=sizeof(uint64_t)+count*period_bytes;
+
+	int blob_size=first_blob_datasize(argv,6,argc);
+	if(blob_size>0 && blob_size!=period_size*(remote_bytes_per_sample>0 ? remote_bytes_per_sample : bytes_per_sample))
+	{
+		if(flow->period_size_warned==0)
+		{
+			fprintf(stderr,"\nflow %d: --flows needs the same period size on sender and receiver\n",flow->index);
+			flow->period_size_warned=1;
+		}
+		return;
+	}
+
+	if(flow->rb==NULL)
+	{
+		flow->first_channel=first_local;
+		flow->channel_count=count;
+		flow->slot_bytes=slot_bytes;
+		flow->scratch=rb_alloc_scratch(slot_bytes);
+
+		rb_t *rb_flow=rb_new(max_buffer_size*slot_bytes);
+		if(rb_flow==NULL || flow->scratch==NULL)
+		{
+			fprintf(stderr,"\nflow %d: could not create ringbuffer\n",flow->index);
+			shutdown_in_progress=1;
+			return;
+		}
+		//process() starts to read once rb is set
+		__sync_synchronize();
+		flow->rb=rb_flow;
+	}
+	else if(first_local!=flow->first_channel || count!=flow->channel_count)
+	{
+		if(flow->layout_warned==0)
+		{
+			fprintf(stderr,"\nflow %d: sender changed channel layout, ignoring flow. restart receiver.\n",flow->index);
+			flow->layout_warned=1;
+		}
+		return;
+	}
+
+	//lost messages: write silence, the other flows don't need to drop the period
+	if(flow->message_number>0 && number>flow->message_number+1)
+	{
+		uint64_t lost=number-flow->message_number-1;
+		flow->lost_counter+=lost;
+		memset(flow->scratch,0,slot_bytes);
+
+		uint64_t i;
+		for(i=0;i<lost && rb_can_write(flow->rb)>=slot_bytes;i++)
+		{
+			uint64_t lost_number=flow->message_number+1+i;
+			memcpy(flow->scratch,&lost_number,sizeof(uint64_t));
+			rb_write(flow->rb,flow->scratch,slot_bytes);
+		}
+	}
+	flow->message_number=number;
+
+	if(rb_can_write(flow->rb)<slot_bytes)
+	{
+		flow->overflow_counter++;
+		return;
+	}
+
+	memcpy(flow->scratch,&number,sizeof(uint64_t));
+
+	int i;
+	for(i=0;i<count;i++)
+	{
+		lo_blob blob=(lo_blob)argv[6+skip+i];
+		int size=lo_blob_datasize(blob);
+		char *out=flow->scratch+sizeof(uint64_t)+i*period_bytes;
+
+		if(size==0)
+		{
+			//--silence
+			memset(out,0,period_bytes);
+		}
+		else
+		{
+			//--adapt: sender changed format
+			convert_samples(lo_blob_dataptr(blob),size/period_size,out,bytes_per_sample,period_size);
+		}
+	}
+	rb_write(flow->rb,flow->scratch,slot_bytes);
+}//end flow_message
+
+//================================================================
+//fill of the emptiest flow, mc periods
+uint64_t flows_fill()
+{
+	uint64_t fill=0;
+	int active=0;
+
+	int i;
+	for(i=0;i<flow_count;i++)
+	{
+		rb_t *rb_flow=flows[i].rb;
+		if(rb_flow==NULL)
+		{
+			continue;
+		}
+
+		uint64_t periods=rb_can_read(rb_flow)/flows[i].slot_bytes;
+		if(active==0 || periods<fill)
+		{
+			fill=periods;
+		}
+		active++;
+	}
+	return fill;
+}//end flows_fill
+
+//================================================================
+//1 if every active flow has a slot for message number target (or newer) ready.
+//slots older than target are dropped. sets target to the newest first slot
+int align_flows(uint64_t *target)
+{
+	int ready=1;
+	int i;
+
+	for(i=0;i<flow_count;i++)
+	{
+		flow_t *flow=&flows[i];
+		rb_t *rb_flow=flow->rb;
+		if(rb_flow==NULL)
+		{
+			continue;
+		}
+
+		uint64_t number=0;
+		while(rb_can_read(rb_flow)>=flow->slot_bytes)
+		{
+			rb_peek(rb_flow,(char*)&number,sizeof(uint64_t));
+			if(number>=*target)
+			{
+				break;
+			}
+			rb_advance_read_index(rb_flow,flow->slot_bytes);
+			flow->resync_counter++;
+		}
+
+		if(rb_can_read(rb_flow)<flow->slot_bytes)
+		{
+			ready=0;
+		}
+		else if(number>*target)
+		{
+			*target=number;
+			ready=0;
+		}
+	}
+	return ready;
+}//end align_flows
+
+//================================================================
+//process() for --flows: only gathers from the flows' ringbuffers.
+//all flows deliver the same message number or none is read in this cycle
+void gather_flows(jack_nframes_t nframes)
+{
+	int period_bytes=nframes*bytes_per_sample;
+
+	int i;
+	int c;
+
+	pre_buffer_counter=flows_fill();
+	if(process_enabled==0 && pre_buffer_counter>=pre_buffer_size)
+	{
+		process_enabled=1;
+	}
+
+	//channels not (yet) covered by a flow stay silent
+	char *covered=flow_covered;
+	memset(covered,0,output_port_count);
+
+	if(process_enabled==1)
+	{
+		process_cycle_counter++;
+
+		if(process_cycle_counter>receive_max-1 && test_mode==1)
+		{
+			last_test_cycle=1;
+		}
+
+		//a second round is needed if a flow was ahead of the target
+		uint64_t target=0;
+		int ready=align_flows(&target) || align_flows(&target);
+
+		for(i=0;i<flow_count;i++)
+		{
+			flow_t *flow=&flows[i];
+			rb_t *rb_flow=flow->rb;
+			if(rb_flow==NULL)
+			{
+				continue;
+			}
+
+			if(ready==0)
+			{
+				if(rb_can_read(rb_flow)<flow->slot_bytes)
+				{
+					flow->underflow_counter++;
+				}
+				if(zero_on_underflow==0)
+				{
+					//keep last output
+					memset(covered+flow->first_channel,1,flow->channel_count);
+				}
+				continue;
+			}
+
+			rb_advance_read_index(rb_flow,sizeof(uint64_t));
+			for(c=0;c<flow->channel_count;c++)
+			{
+				sample_t *o1=(sample_t*)jack_port_get_buffer(ioPortArray[flow->first_channel+c],nframes);
+
+				if(bytes_per_sample==4)
+				{
+					rb_read(rb_flow,(char*)o1,period_bytes);
+				}
+				else
+				{
+					rb_read(rb_flow,flow_convert_buffer,period_bytes);
+					convert_samples(flow_convert_buffer,bytes_per_sample,o1,4,nframes);
+				}
+				covered[flow->first_channel+c]=1;
+			}
+		}
+
+		if(ready==0)
+		{
+			multi_channel_drop_counter++;
+			total_underflow_counter++;
+
+			if(rebuffer_on_underflow==1)
+			{
+				pre_buffer_counter=0;
+				process_enabled=0;
+			}
+		}
+		if(check_enabled==1)
+		{
+			check_feed(nframes,ready==0);
+		}
+	}
+	else if(relaxed_display_counter>=update_display_every_nth_cycle && shutup==0 && quiet==0)
+	{
+		fprintf(stderr,"\r# %" PRId64 " buffering %d flows... mc periods to go: %" PRId64 "%s",
+			message_number,
+			flow_count,
+			pre_buffer_size-MIN_(pre_buffer_counter,pre_buffer_size),
+			"\033[0J"
+		);
+		relaxed_display_counter=0;
+	}
+
+	for(i=0;i<output_port_count;i++)
+	{
+		if(covered[i]==0)
+		{
+			sample_t *o1=(sample_t*)jack_port_get_buffer(ioPortArray[i],nframes);
+			memset(o1,0,4*nframes);
+		}
+	}
+
+	if(process_enabled==1)
+	{
+		//print_info() counts per channel
+		relaxed_display_counter+=port_count-1;
+		print_info();
+	}
+	else
+	{
+		relaxed_display_counter++;
+	}
+}//end gather_flows
+
+//================================================================
+int start_checker()
+{
+	//0.5 seconds of all channels
+	uint64_t periods=ceil(0.5*(float)sample_rate/period_size)+1;
+	rb_check=rb_new(periods*(sizeof(check_header_t)+output_port_count*period_size*sizeof(sample_t)));
+	check_notifier=rb_notifier_new();
+	if(rb_check==NULL || check_notifier==NULL)
+	{
+		fprintf(stderr,"could not create checker ringbuffer.\n");
+		return 1;
+	}
+
+	if(pthread_create(&check_thread,NULL,check_thread_func,NULL)!=0)
+	{
+		fprintf(stderr,"could not start checker thread.\n");
+		return 1;
+	}
+
+	if(shutup==0)
+	{
+		fprintf(stderr,"checking test signal (jack_audio_send --testsig)\n");
+	}
+	return 0;
+}//end start_checker
+
+//================================================================
+//called from process() after the output ports were filled from received data.
+//underflow: no data was available in this cycle, only the header is passed (channels 0)
+void check_feed(jack_nframes_t nframes, int underflow)
+{
+	check_header_t header;
+	header.cycle=check_cycle;
+	header.frame_time=jack_last_frame_time(client);
+	header.nframes=nframes;
+	header.channels=(underflow==1) ? 0 : port_count;
+	header.bytes_per_sample=bytes_per_sample;
+
+	check_cycle++;
+
+	uint64_t period_bytes=nframes*sizeof(sample_t);
+	if(rb_can_write(rb_check)<sizeof(check_header_t)+header.channels*period_bytes)
+	{
+		//checker can't keep up. it will notice the gap in cycles
+		check_skipped++;
+		return;
+	}
+
+	rb_write(rb_check,(char*)&header,sizeof(check_header_t));
+
+	int i;
+	for(i=0;i<header.channels;i++)
+	{
+		rb_write(rb_check,(char*)jack_port_get_buffer(ioPortArray[i],nframes),period_bytes);
+	}
+	rb_notify(check_notifier);
+}//end check_feed
+
+//================================================================
+static void *check_thread_func(void *arg)
+{
+	sample_t *data=NULL;
+	uint64_t data_size=0;
+	uint64_t next_cycle=0;
+
+	while(shutdown_in_progress==0)
+	{
+		check_header_t header;
+		//wait for process() (timeout to notice shutdown)
+		if(!rb_wait_readable(rb_check,check_notifier,sizeof(check_header_t),100))
+		{
+			continue;
+		}
+		rb_peek(rb_check,(char*)&header,sizeof(check_header_t));
+
+		//process() writes header and channels separately, notifies after the last channel
+		uint64_t bytes=header.channels*header.nframes*sizeof(sample_t);
+		if(!rb_wait_readable(rb_check,check_notifier,sizeof(check_header_t)+bytes,100))
+		{
+			continue;
+		}
+
+		if(bytes>data_size)
+		{
+			free(data);
+			data=malloc(bytes);
+			data_size=bytes;
+		}
+
+		rb_advance_read_index(rb_check,sizeof(check_header_t));
+		//no channels on underflow
+		if(bytes>0)
+		{
+			rb_read(rb_check,(char*)data,bytes);
+		}
+
+		//periods skipped by check_feed() are not a transmission error
+		int resync=(header.cycle!=next_cycle);
+		next_cycle=header.cycle+1;
+
+		check_period(&header,data,resync);
+	}
+	free(data);
+	return NULL;
+}//end check_thread_func
+
+//================================================================
+static void check_report(uint32_t frame, const char *format, ...)
+{
+	check_printed++;
+	if(check_printed>CHECK_PRINT_MAX || shutup==1)
+	{
+		return;
+	}
+
+	char buf[256];
+	va_list args;
+	va_start(args,format);
+	vsnprintf(buf,sizeof(buf),format,args);
+	va_end(args);
+
+	fprintf(stderr,"\r\033[0Jcheck: frame %u: %s\n",frame,buf);
+	if(check_printed==CHECK_PRINT_MAX)
+	{
+		fprintf(stderr,"check: too many errors, no further reports until summary\n");
+	}
+}
+
+//================================================================
+//one period of all channels, channel after channel
+//expected: sender frame (mod TEST_SIGNAL_LENGTH) of the next period
+void check_period(const check_header_t *header, const sample_t *data, int resync)
+{
+	static int locked=0;
+	static uint64_t expected=0;
+
+	int nframes=header->nframes;
+	float tolerance=test_signal_tolerance(header->bytes_per_sample);
+
+	//resync after periods the checker didn't see
+	if(resync==1)
+	{
+		locked=0;
+	}
+
+	//nothing played in this cycle. the stream continues where it stopped
+	if(header->channels==0)
+	{
+		if(locked==1)
+		{
+			check_underflows++;
+			check_report(header->frame_time,"receiver underflow");
+		}
+		return;
+	}
+
+	check_periods++;
+
+	//--flows fill lost messages with silence
+	if(period_is_silent(data,nframes,0))
+	{
+		if(locked==1)
+		{
+			check_silent++;
+			check_report(header->frame_time,"silent period (lost before the receiver)");
+			expected=(expected+nframes)%TEST_SIGNAL_LENGTH;
+		}
+		return;
+	}
+
+	//position of output port 0. which channel it carries is checked below
+	int channel;
+	uint64_t position;
+	if(test_signal_locate(data,nframes,&channel,&position)==0)
+	{
+		if(locked==0)
+		{
+			//can't lock to this
+			return;
+		}
+		position=expected;
+	}
+
+	if(locked==0)
+	{
+		locked=1;
+		if(check_periods==1)
+		{
+			check_report(header->frame_time,"locked to test signal");
+		}
+	}
+	else if(position!=expected)
+	{
+		//-TEST_SIGNAL_LENGTH/2 .. TEST_SIGNAL_LENGTH/2-1 (about 23 minutes at 48 kHz)
+		int64_t delta=(int64_t)((position-expected+TEST_SIGNAL_LENGTH+TEST_SIGNAL_LENGTH/2)%TEST_SIGNAL_LENGTH)
+			-(int64_t)(TEST_SIGNAL_LENGTH/2);
+
+		if(delta>0 && delta%nframes==0)
+		{
+			check_missing+=delta/nframes;
+			check_report(header->frame_time,"%" PRId64 " period(s) missing",delta/nframes);
+		}
+		else if(delta<0 && delta%nframes==0)
+		{
+			check_repeated+=-delta/nframes;
+			check_report(header->frame_time,"period repeated (%" PRId64 " back)",-delta/nframes);
+		}
+		else
+		{
+			check_discontinuities++;
+			check_report(header->frame_time,"discontinuity, %+" PRId64 " frames",delta);
+		}
+	}
+	expected=position;
+
+	int c;
+	for(c=0;c<header->channels;c++)
+	{
+		const sample_t *channel_data=data+c*nframes;
+		int first=0;
+
+		int mismatches=test_signal_mismatches(channel_data,c+channel_offset,expected,nframes,tolerance,&first);
+		if(mismatches==0)
+		{
+			continue;
+		}
+
+		//whose channel is this. the channel is encoded independently of the position
+		int source;
+		uint64_t source_position;
+		if(mismatches==nframes
+			&& test_signal_locate(channel_data,nframes,&source,&source_position)==1
+			&& source!=c+channel_offset
+			&& test_signal_mismatches(channel_data,source,expected,nframes,tolerance,NULL)==0)
+		{
+			check_swapped++;
+			check_report(header->frame_time,"output %d carries sender channel %d instead of %d",
+				c+1,source+1,c+channel_offset+1);
+		}
+		else
+		{
+			sample_t want;
+			test_signal_fill(&want,c+channel_offset,expected+first,1);
+
+			check_wrong_samples+=mismatches;
+			check_report(header->frame_time+first,"output %d: %d wrong sample(s), %.9f instead of %.9f",
+				c+1,mismatches,channel_data[first],want);
+		}
+	}
+
+	expected=(expected+nframes)%TEST_SIGNAL_LENGTH;
+}//end check_period
+
+//================================================================
+void print_check_summary()
+{
+	fprintf(stderr,"check: %" PRId64 " periods checked, %" PRId64 " missing, %" PRId64 " repeated, %" PRId64 " silent, %" PRId64 " underflows\n",
+		check_periods,check_missing,check_repeated,check_silent,check_underflows);
+	fprintf(stderr,"check: %" PRId64 " discontinuities, %" PRId64 " swapped channels, %" PRId64 " wrong samples\n",
+		check_discontinuities,check_swapped,check_wrong_samples);
+	if(check_skipped>0)
+	{
+		fprintf(stderr,"check: %" PRId64 " periods not checked (checker too slow)\n",check_skipped);
+	}
+}//end print_check_summary
@@ -41,6 +41,68 @@ int rebuffer_on_underflow=0; //param
 
 int channel_offset=0; //param
 
+//receive channel groups on listening_port+1..n, one thread each
+int flow_count=0; //param
+
+//reassembly of /audio_frag (jack_audio_send --pace)
+#define FRAG_MAX_COUNT 64
+//an id further back than this is a restarted sender (ids count from 1 again), not reordering
+#define FRAG_ID_WINDOW 64
+//incremented on /offer and message number 1, every frag_t starts over
+volatile unsigned int frag_stream=0;
+typedef struct
+{
+	unsigned int stream;
+	//message being assembled, fragments of older ids are ignored
+	uint64_t id;
+	uint32_t length;
+	uint32_t received;
+	//offsets seen, against duplicates
+	uint32_t offsets[FRAG_MAX_COUNT];
+	int count;
+	//LO_MAX_UDP_MSG_SIZE, allocated with the first fragment
+	char *buffer;
+} frag_t;
+
+typedef struct
+{
+	int index;
+	int socket;
+	pthread_t thread;
+	//created by the flow thread with the first message, then read by process()
+	rb_t * volatile rb;
+	//local channels (after --offset) carried by this flow
+	int first_channel;
+	int channel_count;
+	//message number (uint64_t) followed by channel_count periods
+	int slot_bytes;
+	uint64_t message_number;
+	uint64_t lost_counter;
+	uint64_t overflow_counter;
+	uint64_t underflow_counter;
+	//slots dropped by process() to align with the other flows
+	uint64_t resync_counter;
+	//one converted message (slot)
+	char *scratch;
+	frag_t frag;
+	int period_size_warned;
+	int layout_warned;
+} flow_t;
+
+//verify the test signal of jack_audio_send --testsig in a separate thread
+int check_enabled=0; //param
+
+//written by process() for every period played, read by the checker thread
+typedef struct
+{
+	uint64_t cycle;
+	//jack_last_frame_time() of the cycle
+	uint32_t frame_time;
+	int32_t nframes;
+	int32_t channels;
+	int32_t bytes_per_sample;
+} check_header_t;
+
 //if set to 0, /buffer ii messages are ignored
 extern int allow_remote_buffer_control; //param
 
@@ -62,6 +124,7 @@ static void print_help (void)
 	fprintf (stderr, "  Channel Offset                 (0) --offset <integer>\n");
 	fprintf (stderr, "  Autoconnect ports                  --connect\n");
 	fprintf (stderr, "  Send 16 bit samples (32 bit float) --16\n");
+	fprintf (stderr, "  Send 24 bit samples (32 bit float) --24\n");
 	fprintf (stderr, "  JACK client name         (receive) --name   <string>\n");
 	fprintf (stderr, "  JACK server name         (default) --sname  <string>\n");
 	fprintf (stderr, "  Initial buffer size (4 mc periods) --pre    <integer>\n");
@@ -79,6 +142,10 @@ static void print_help (void)
 	fprintf (stderr, "     GUI host            (localhost) --iohost <string>\n");
 	fprintf (stderr, "     GUI port(UDP)           (20220) --ioport <string>\n");
 	fprintf (stderr, "  Quit on incompatibility            --close\n");
+	fprintf (stderr, "  Receive n flows on port+1..n   (0) --flows  <integer>\n");
+	fprintf (stderr, "  Verify sender's test signal        --check\n");
+	print_net_help();
+	print_alloc_help();
 //      fprintf (stderr, "  Use TCP instead of UDP       (UDP) --tcp    <integer>\n");
 //still borked
 //to test: --tcp (port of remote tcp host)
@@ -102,6 +169,7 @@ static struct option long_options[] =
 	{"offset",      required_argument,      0, 'f'},
 	{"connect",     no_argument,    &autoconnect, 1},
 	{"16",          no_argument,            0, 'y'},
+	{"24",          no_argument,            0, 'z'},
 	{"name",        required_argument,      0, 'n'},
 	{"sname",       required_argument,      0, 's'},
 	{"pre",         required_argument,      0, 'b'},//pre (delay before playback) buffer
@@ -120,6 +188,10 @@ static struct option long_options[] =
 	{"iohost",      required_argument,      0, 'a'},
 	{"ioport",      required_argument,      0, 'c'},
 	{"tcp",         required_argument,      0, 't'}, //server port of remote host
+	{"flows",       required_argument,      0, 'q'},
+	{"check",       no_argument,    &check_enabled, 1},
+	NET_LONG_OPTIONS,
+	ALLOC_LONG_OPTIONS,
 	{0, 0, 0, 0}
 };
 
@@ -144,9 +216,28 @@ int osc_offer_handler(const char *path, const char *types, lo_arg **argv, int ar
 int osc_audio_handler(const char *path, const char *types, lo_arg **argv, int argc,
 	void *data, void *user_data);
 
+//reassemble /audio_frag hiib, 1 if the message is complete in frag->buffer
+int frag_add(frag_t *frag, lo_arg **argv);
+int audio_types_valid(const char *types);
+int osc_frag_handler(const char *path, const char *types, lo_arg **argv, int argc,
+	void *data, void *user_data);
+
+//tell sender about loss, jitter and buffer fill
+void send_report(lo_message data);
+
+void clock_fit_reset();
+void clock_fit_add(double x, double y);
+void sender_frame_time_received(uint64_t frame, int timetag_offset);
+
 int osc_buffer_handler(const char *path, const char *types, lo_arg **argv, int argc,
 	void *data, void *user_data);
 
+//swap main ringbuffer when /buffer changes its size
+void resize_ringbuffer(rb_t *rb_resized);
+void swap_ringbuffer();
+void finish_ringbuffer_swap();
+void free_ringbuffers();
+
 int osc_quit_handler(const char *path, const char *types, lo_arg **argv, int argc,
 	void *data, void *user_data);
 
@@ -156,6 +247,21 @@ void osc_error_handler(int num, const char *msg, const char *path);
 //ctrl+c etc
 static void signal_handler(int sig);
 
+//--flows
+int start_flows(int base_port);
+void stop_flows();
+static void *flow_thread_func(void *arg);
+void flow_message(flow_t *flow, lo_arg **argv, int argc);
+uint64_t flows_fill();
+int align_flows(uint64_t *target);
+void gather_flows(jack_nframes_t nframes);
+
+int start_checker();
+void check_feed(jack_nframes_t nframes, int underflow);
+static void *check_thread_func(void *arg);
+void check_period(const check_header_t *header, const sample_t *data, int resync);
+void print_check_summary();
+
 //send config to osc gui
 void io_dump_config();
 
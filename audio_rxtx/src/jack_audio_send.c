@@ -20,10 +20,20 @@
 #include <lo/lo.h>
 #include <getopt.h>
 #include <unistd.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <time.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#ifdef __linux__
+#include <linux/net_tstamp.h>
+#endif
 
 #include "jack_audio_common.h"
 #include "jack_audio_send.h"
 
+#include "../../rb/rb.h"
+
 //tb/130427/131206/131211/140523
 //gcc -o jack_audio_send jack_audio_send.c `pkg-config --cflags --libs jack liblo`
 
@@ -51,6 +61,12 @@ int msg_size=0;
 
 //msg_size + more
 int transfer_size=0;
+
+//transfer_size for 2, 3, 4 bytes per sample (--adapt)
+int transfer_size_for_format[5]={0,0,0,0,0};
+
+//sum of transfer sizes of /audio messages sent
+uint64_t total_bytes_transferred=0;
 //int max_transfer_size=32000;
 //int max_transfer_size=65535;
 int max_transfer_size=LO_MAX_MSG_SIZE;
@@ -64,6 +80,57 @@ int receiver_accepted=-1;
 int drop_every_nth_message=0; //param
 int drop_counter=0;
 
+//absolute sample value, 0: only digital silence
+float silence_threshold=0; //param
+
+//payload bytes not sent because of silent channels (--silence)
+uint64_t silence_saved_bytes=0;
+
+//--testsig: frames of test signal sent
+uint64_t test_signal_frame=0;
+
+//jack_last_frame_time() of the current period, extended to 64 bit
+uint64_t period_frame_time=0;
+
+//--adapt: float, 24 bit, 16 bit. never above the format given on command line
+int format_ladder[]={4,3,2};
+int format_ladder_top=0;
+int format_ladder_index=0;
+
+//process() switches to this format at the start of the next period
+volatile int requested_bytes_per_sample=0;
+
+//step down after n bad reports in a row, so that a single burst (or reordering) doesn't switch
+int adapt_down_after=3;
+int bad_report_counter=0;
+//a report is bad above this fraction of lost messages (reordered messages count as lost)
+float adapt_loss_rate=0.01;
+//step up again after n reports without loss (about n seconds)
+int adapt_up_after=10;
+int clean_report_counter=0;
+//messages sent up to the previous report, for the loss rate
+uint64_t report_sequence_prev=0;
+
+//--pace: process() puts serialized /audio messages to rb_send (length, data)
+//pacing thread sends them on the osc socket, not faster than pacing_rate.
+//with a rate, messages are sent as /audio_frag datagrams and each datagram is paced
+float pacing_rate=0; //param kbit/s, 0: 1.5 x expected_network_data_rate
+rb_t *rb_send=NULL;
+//serialize buffer, msg_size bytes
+void *send_buffer=NULL;
+sem_t send_semaphore;
+pthread_t pacing_thread;
+int send_socket=-1;
+//--flows
+int *flow_sockets=NULL;
+struct sockaddr_storage send_address;
+socklen_t send_address_length=0;
+//datagrams that had to wait for tokens, messages that didn't fit the queue
+uint64_t pacing_delayed_counter=0;
+uint64_t pacing_dropped_counter=0;
+//datagrams sent by the pacing thread
+uint64_t pacing_datagram_counter=0;
+
 int lo_proto=LO_UDP;
 
 //osc
@@ -173,6 +240,44 @@ int main(int argc, char *argv[])
 				drop_every_nth_message=atoi(optarg);
 				break;
 
+			case 'o':
+				bytes_per_sample=3;
+				break;
+
+			case 'p':
+				pacing_rate=fmax(0,atof(optarg));
+				pacing_enabled=1;
+				break;
+
+			case 'n':
+				silence_threshold=pow(10,atof(optarg)/20);
+				suppress_silence=1;
+				break;
+
+			case 'q':
+				flow_count=fmax(0,atoi(optarg));
+				break;
+
+			case NET_OPT_RCVBUF:
+			case NET_OPT_SNDBUF:
+			case NET_OPT_BUSY_POLL:
+			case NET_OPT_DSCP:
+			case NET_OPT_SOCK_PRIORITY:
+			case NET_OPT_CPU:
+			case NET_OPT_RT_PRIORITY:
+				if(net_option(opt,optarg)!=0)
+				{
+					exit(1);
+				}
+				break;
+
+			case OPT_ALLOC:
+				if(alloc_option(optarg)!=0)
+				{
+					exit(1);
+				}
+				break;
+
 			case '?': //invalid commands
 				//getopt_long already printed an error message
 				print_header("jack_audio_send");
@@ -196,6 +301,33 @@ int main(int argc, char *argv[])
 	sendToHost=argv[optind];
 	sendToPort=argv[++optind];
 
+	if(check_net_options()!=0)
+	{
+		exit(1);
+	}
+
+	rb_set_alloc_policy(alloc_policy);
+
+	if(flow_count>0 && lo_proto!=LO_UDP)
+	{
+		fprintf(stderr,"--flows needs UDP\n");
+		exit(1);
+	}
+
+	//lo_send_message() uses a socket inside liblo that can't be tuned.
+	//socket options need the sender thread that sends on the osc server socket
+	if(net_options_set() && pacing_enabled==0)
+	{
+		if(lo_proto!=LO_UDP)
+		{
+			fprintf(stderr,"socket options are only supported with UDP\n");
+			exit(1);
+		}
+		pacing_enabled=1;
+		//no rate limit
+		pacing_rate=-1;
+	}
+
 	//destination address
 	loa=lo_address_new_with_proto(lo_proto, sendToHost, sendToPort);
 
@@ -218,6 +350,8 @@ int main(int argc, char *argv[])
 	//add osc hooks & start osc server early (~right after cmdline parsing)
 	registerOSCMessagePatterns(localPort);
 
+	apply_net_socket_options(lo_server_get_socket_fd(lo_server_thread_get_server(lo_st)),"osc server");
+
 	lo_server_thread_start(lo_st);
 
 	//read back port (in case of random)
@@ -256,6 +390,10 @@ int main(int argc, char *argv[])
 		{
 			fprintf(stderr,"/!\\ limiting number of messages: %" PRId64 "\n",send_max);
 		}
+		if(test_signal==1)
+		{
+			fprintf(stderr,"/!\\ sending test signal instead of capture ports\n");
+		}
 	}
 
 	//check for default jack server env var
@@ -351,6 +489,29 @@ int main(int argc, char *argv[])
 			fprintf(stderr, "artificial message drops: every %d\n",drop_every_nth_message);
 		}
 
+		if(adaptive_format==1)
+		{
+			fprintf(stderr, "adapt sample format to receiver reports: yes\n");
+		}
+
+		if(use_txtime==1 && pacing_enabled==0)
+		{
+			fprintf(stderr, "/!\\ --txtime has no effect without --pace\n");
+		}
+
+		if(suppress_silence==1)
+		{
+			if(silence_threshold>0)
+			{
+				fprintf(stderr, "send silent channels as empty blobs: yes (threshold %.1f dBFS)\n",
+					20*log10(silence_threshold));
+			}
+			else
+			{
+				fprintf(stderr, "send silent channels as empty blobs: yes (digital silence)\n");
+			}
+		}
+
 		fprintf(stderr,"multi-channel period size: %d bytes\n",
 			input_port_count*period_size*bytes_per_sample
 		);
@@ -361,7 +522,7 @@ int main(int argc, char *argv[])
 	}//end if shutup==0
 
 	//message size in bytes, including all metadata and blobs
-	msg_size=message_size();
+	msg_size=message_size(bytes_per_sample);
 
 	//size in bytes totally used to send over network
 	//experimental, compared with iptraf, wireshark
@@ -396,9 +557,23 @@ int main(int argc, char *argv[])
 	//= 3028 + 1188 = 4216
 	//+ 14 + 20 + 8 = 4258 total transfer
 
-	transfer_size=floor(msg_size / 1480) * 1514
-			+fmod(msg_size,1480)
-			+14+20+8;
+	transfer_size=transfer_length(msg_size);
+
+	int f;
+	for(f=2;f<=4;f++)
+	{
+		transfer_size_for_format[f]=(f==bytes_per_sample) ? transfer_size : transfer_length(message_size(f));
+	}
+
+	requested_bytes_per_sample=bytes_per_sample;
+	for(f=0;f<3;f++)
+	{
+		if(format_ladder[f]==bytes_per_sample)
+		{
+			format_ladder_top=f;
+			format_ladder_index=f;
+		}
+	}
 
 	if(shutup==0) //print even if quiet
 	{
@@ -414,9 +589,26 @@ int main(int argc, char *argv[])
 			fprintf(stderr,"/!\\ receiver(s) must support message size > %d\n",LO_MAX_MSG_SIZE);
 		}
 	}
-	if(transfer_size>max_transfer_size)
+	if(flow_count>input_port_count)
+	{
+		flow_count=input_port_count;
+	}
+
+	//with --flows every flow message has to fit, not the sum
+	int max_transfer_size_needed=transfer_size;
+	if(flow_count>0)
+	{
+		max_transfer_size_needed=transfer_length(flow_message_size(bytes_per_sample));
+		if(shutup==0)
+		{
+			fprintf(stderr,"flows: %d, max. message length: %d bytes\n",
+				flow_count,flow_message_size(bytes_per_sample));
+		}
+	}
+
+	if(max_transfer_size_needed>max_transfer_size)
 	{
-		fprintf(stderr,"sry, can't do. max transfer length: %d. reduce input channel count or use 16 bit.\n",max_transfer_size);
+		fprintf(stderr,"sry, can't do. max transfer length: %d. reduce input channel count, use 16 or 24 bit or --flows.\n",max_transfer_size);
 		io_quit("transfer_size_too_large");
 
 		exit(1);
@@ -439,7 +631,37 @@ int main(int argc, char *argv[])
 		{
 			fprintf(stderr,"/!\\ high data rate (OK on localhost), use GigE\n");
 		}
+	}
+
+	if(pacing_enabled==1)
+	{
+		if(pacing_rate==0)
+		{
+			pacing_rate=1.5*expected_network_data_rate;
+		}
+		else if(pacing_rate>0 && pacing_rate<expected_network_data_rate && shutup==0)
+		{
+			fprintf(stderr,"/!\\ pacing rate below expected data rate, messages will be dropped\n");
+		}
+
+		if(start_pacing()!=0)
+		{
+			io_quit("cannot_start_pacing");
+			exit(1);
+		}
+	}
+
+	if(flow_count>0)
+	{
+		if(start_flows()!=0)
+		{
+			io_quit("cannot_start_flows");
+			exit(1);
+		}
+	}
 
+	if(shutup==0)
+	{
 		fprintf(stderr,"\n");
 	}
 
@@ -660,15 +882,24 @@ int process(jack_nframes_t nframes, void *arg)
 			last_test_cycle=1;
 		}
 
+		//sample format switch requested by osc_report_handler(), whole periods only
+		if(requested_bytes_per_sample!=bytes_per_sample)
+		{
+			bytes_per_sample=requested_bytes_per_sample;
+		}
+
 //don't forget to update the dummy message in message_size()
 /*
-		/audio hhtib*
+		/audio hhtihib*
 
 		1) h: message number
 		2) h: xrun counter (sender side, as all the following meta data)
 		3) t: timetag (seconds since Jan 1st 1900 in the UTC, fraction 1/2^32nds of a second)
 		4) i: sampling rate
-		5) b: blob of channel 1 (period size * bytes per sample) bytes long
+		5) h: JACK frame time of the first sample in this period (jack_last_frame_time(), 64 bit)
+		6) i: frames since period start when the timetag was taken
+		7) b: blob of channel 1 (period size * bytes per sample) bytes long
+		      or empty blob if channel is silent (--silence)
 		...
 		...) b: up to n channels
 */
@@ -682,12 +913,20 @@ int process(jack_nframes_t nframes, void *arg)
 		//current timestamp
 		lo_timetag tt;
 		lo_timetag_now(&tt);
+		jack_nframes_t timetag_offset=jack_frames_since_cycle_start(client);
 		lo_message_add_timetag(msg,tt);
 		lo_message_add_int32(msg,sample_rate);
 
+		//position in the sender's sample timeline, a gap means lost frames (xrun) on the sender
+		lo_message_add_int64(msg,frame_time_64(&period_frame_time,jack_last_frame_time(client)));
+		lo_message_add_int32(msg,timetag_offset);
+
 		//blob array, holding one period per channel
 		lo_blob blob[input_port_count];
 
+		//--testsig: one period, replaces capture port buffers
+		sample_t test_buffer[test_signal==1 ? nframes : 1];
+
 		//add blob to message for every input channel
 		int i;
 		for(i=0; i<input_port_count; i++)
@@ -700,14 +939,38 @@ int process(jack_nframes_t nframes, void *arg)
 			sample_t *o1;
 
 			//get "the" buffer
-			o1=(sample_t*)jack_port_get_buffer(ioPortArray[i],nframes);
+			if(test_signal==1)
+			{
+				test_signal_fill(test_buffer,i,test_signal_frame,nframes);
+				o1=test_buffer;
+			}
+			else
+			{
+				o1=(sample_t*)jack_port_get_buffer(ioPortArray[i],nframes);
+			}
 
+			//silent channel: empty blob, receiver will expand to zeros
+			if(suppress_silence==1 && period_is_silent(o1,nframes,silence_threshold))
+			{
+				blob[i]=lo_blob_new(0,o1);
+				silence_saved_bytes+=bytes_per_sample*nframes;
+			}
 			//32 bit float
-			if(bytes_per_sample==4)
+			else if(bytes_per_sample==4)
 			{
 				//fill blob from buffer
 				blob[i]=lo_blob_new(bytes_per_sample*nframes,o1);
 			}
+			//24 bit pcm
+			else if(bytes_per_sample==3)
+			{
+				unsigned char o1_24[nframes*3];
+
+				float_to_pcm24(o1,o1_24,nframes);
+
+				//fill blob from buffer
+				blob[i]=lo_blob_new(bytes_per_sample*nframes,o1_24);
+			}
 			//16 bit pcm
 			else
 			{
@@ -723,8 +986,13 @@ int process(jack_nframes_t nframes, void *arg)
 				blob[i]=lo_blob_new(bytes_per_sample*nframes,o1_16);
 			}
 
-			lo_message_add_blob(msg,blob[i]);		
+			//--flows: blobs go to the flow messages
+			if(flow_count==0)
+			{
+				lo_message_add_blob(msg,blob[i]);
+			}
 		}
+		test_signal_frame+=nframes;
 
 		//drop messages for test purposes
 		if(drop_every_nth_message>0)
@@ -735,19 +1003,29 @@ int process(jack_nframes_t nframes, void *arg)
 			{
 				drop_counter=0;
 			}
+			else if(flow_count>0)
+			{
+				send_flows(blob,tt);
+			}
 			else
 			{
-				lo_send_message(loa, "/audio", msg);
+				send_audio_message(msg);
 			}
 		}
+		else if(flow_count>0)
+		{
+			send_flows(blob,tt);
+		}
 		else
 		{
 			//==================================
-			lo_send_message(loa, "/audio", msg);
+			send_audio_message(msg);
 		}
 
 		//fprintf(stderr,"msg size %zu\n",lo_message_length(msg,"/audio"));
 
+		total_bytes_transferred+=transfer_size_for_format[bytes_per_sample];
+
 		//free resources to keep memory clean
 		lo_message_free(msg);
 		for(i=0;i<input_port_count;i++)
@@ -762,8 +1040,10 @@ int process(jack_nframes_t nframes, void *arg)
 			char hms[16];
 			periods_to_HMS(hms,msg_sequence_number);
 
+			uint64_t total_bytes_sent=total_bytes_transferred-silence_saved_bytes;
+
 			char *units="MB";
-			float total_size_transferred_mb=(float)(transfer_size*msg_sequence_number)/1000/1000;
+			float total_size_transferred_mb=(float)total_bytes_sent/1000/1000;
 			float total_size_transferred=total_size_transferred_mb;
 			//if > 10 gig
 			if(total_size_transferred_mb>=10000)
@@ -776,17 +1056,32 @@ int process(jack_nframes_t nframes, void *arg)
 			{
 				//print info "in-place" with \r
 				fprintf(stderr,"\r# %" PRId64 
-					" (%s) xruns: %" PRId64 " tx: %" PRId64 " bytes (%.2f %s) p: %.1f%s",
+					" (%s) xruns: %" PRId64 " tx: %" PRId64 " bytes (%.2f %s) p: %.1f pf: %.2f",
 					msg_sequence_number,
 					hms,
 					local_xrun_counter,
-					transfer_size*msg_sequence_number,/*+140, //140: minimal offer/accept*/
+					total_bytes_sent,/*+140, //140: minimal offer/accept*/
 					/*(float)(transfer_size*msg_sequence_number)/1000/1000,+140)/1000/1000*/
 					total_size_transferred,
 					units,
 					(float)frames_since_cycle_start_avg/(float)period_size,
-					"\033[0J"
+					page_faults_per_cycle(msg_sequence_number)
 				);
+				if(suppress_silence==1)
+				{
+					fprintf(stderr," saved: %.1f%%",
+						100*(float)silence_saved_bytes/(float)total_bytes_transferred
+					);
+				}
+				if(pacing_enabled==1)
+				{
+					fprintf(stderr," dgrams: %" PRId64 " paced: %" PRId64 " qdrop: %" PRId64,
+						pacing_datagram_counter,
+						pacing_delayed_counter,
+						pacing_dropped_counter
+					);
+				}
+				fprintf(stderr,"%s","\033[0J");
 				fflush(stderr);
 			}
 			if(io_())
@@ -796,11 +1091,12 @@ int process(jack_nframes_t nframes, void *arg)
 				lo_message_add_int64(msgio, msg_sequence_number);//0
 				lo_message_add_string(msgio, hms);		//1
 				lo_message_add_int64(msgio, local_xrun_counter); //2
-				lo_message_add_int64(msgio, transfer_size*msg_sequence_number); //3
+				lo_message_add_int64(msgio, total_bytes_sent); //3
 				lo_message_add_float(msgio, total_size_transferred); //4
 				lo_message_add_string(msgio, units); 		//5
 				lo_message_add_float(msgio,			//6
 					(float)frames_since_cycle_start_avg/(float)period_size);
+				lo_message_add_int64(msgio, silence_saved_bytes); //7
 
 				lo_send_message(loio, "/sending", msgio);
 				lo_message_free(msgio);
@@ -850,6 +1146,7 @@ void offer_audio_to_receiver()
 	5) i: channel count
 	6) f: expected network data rate
 	7) h: send / request counter
+	8) s: socket options (--rcvbuf etc.), only if any is set
 
 	receiver should answer with /accept or /deny
 	*/
@@ -868,6 +1165,14 @@ void offer_audio_to_receiver()
 	//add message counter
 	lo_message_add_int64(msg,msg_sequence_number);
 
+	//only then, receivers not knowing fiiiifhs stay compatible
+	if(net_options_set())
+	{
+		char net_options[256];
+		net_options_string(net_options,sizeof(net_options));
+		lo_message_add_string(msg,net_options);
+	}
+
 	lo_send_message(loa, "/offer", msg);
 
 	//free resources to keep memory clean
@@ -887,6 +1192,7 @@ void registerOSCMessagePatterns(const char *port)
 	lo_server_thread_add_method(lo_st, "/accept", "", osc_accept_handler, NULL);
 	lo_server_thread_add_method(lo_st, "/deny", "fii", osc_deny_handler, NULL);
 	lo_server_thread_add_method(lo_st, "/pause", "", osc_pause_handler, NULL);
+	lo_server_thread_add_method(lo_st, "/report", "ifii", osc_report_handler, NULL);
 	lo_server_thread_add_method(lo_st, "/quit", "", osc_quit_handler, NULL);
 
 }//
@@ -903,6 +1209,8 @@ int osc_accept_handler(const char *path, const char *types, lo_arg **argv, int a
 	io_simple("/receiver_accepted_transmission");
 	receiver_accepted=1;
 	msg_sequence_number=1;
+	total_bytes_transferred=0;
+	silence_saved_bytes=0;
 	return 0;
 }
 
@@ -945,6 +1253,474 @@ int osc_deny_handler(const char *path, const char *types, lo_arg **argv, int arg
 	return 0;
 }
 
+//================================================================
+void send_audio_message(lo_message msg)
+{
+	if(pacing_enabled==0)
+	{
+		lo_send_message(loa, "/audio", msg);
+		return;
+	}
+
+	queue_message(msg,"/audio",-1);
+}
+
+//================================================================
+void queue_message(lo_message msg, const char *path, int flow)
+{
+	size_t len=lo_message_length(msg,path);
+	uint32_t len_=len;
+	int32_t flow_=flow;
+
+	if(len>(size_t)msg_size+FLOW_EXTRA_BYTES || rb_can_write(rb_send) < 2*sizeof(uint32_t)+len)
+	{
+		pacing_dropped_counter++;
+		return;
+	}
+
+	lo_message_serialise(msg,path,send_buffer,&len);
+
+	rb_write(rb_send,(char*)&len_,sizeof(uint32_t));
+	rb_write(rb_send,(char*)&flow_,sizeof(int32_t));
+	rb_write(rb_send,send_buffer,len);
+
+	//wake up pacing thread
+	sem_post(&send_semaphore);
+}//end send_audio_message
+
+//================================================================
+int start_pacing()
+{
+	//send on the osc server socket so that replies (/pause etc.) find their way back
+	send_socket=lo_server_get_socket_fd(lo_server_thread_get_server(lo_st));
+
+	struct addrinfo hints;
+	struct addrinfo *ai;
+	memset(&hints,0,sizeof(hints));
+	hints.ai_family=AF_UNSPEC;
+	hints.ai_socktype=SOCK_DGRAM;
+
+	if(send_socket<0 || getaddrinfo(sendToHost,sendToPort,&hints,&ai)!=0)
+	{
+		fprintf(stderr,"could not set up pacing for %s:%s\n",sendToHost,sendToPort);
+		return 1;
+	}
+	memcpy(&send_address,ai->ai_addr,ai->ai_addrlen);
+	send_address_length=ai->ai_addrlen;
+	freeaddrinfo(ai);
+
+	int on=1;
+	setsockopt(send_socket,SOL_SOCKET,SO_BROADCAST,&on,sizeof(on));
+
+	//bytes per second
+	uint32_t rate=pacing_rate*1000/8;
+
+#ifdef SO_MAX_PACING_RATE
+	//kernel pacing (fq qdisc) on top, also covers messages that are sent unfragmented
+	if(pacing_rate>0 && setsockopt(send_socket,SOL_SOCKET,SO_MAX_PACING_RATE,&rate,sizeof(rate))!=0 && shutup==0)
+	{
+		fprintf(stderr,"SO_MAX_PACING_RATE not available: %s\n",strerror(errno));
+	}
+#endif
+
+#ifdef SO_TXTIME
+	if(use_txtime==1)
+	{
+		struct sock_txtime txtime_config={CLOCK_MONOTONIC,0};
+		if(setsockopt(send_socket,SOL_SOCKET,SO_TXTIME,&txtime_config,sizeof(txtime_config))!=0)
+		{
+			if(shutup==0)
+			{
+				fprintf(stderr,"SO_TXTIME not available: %s. sleeping in pacing thread.\n",strerror(errno));
+			}
+			use_txtime=0;
+		}
+	}
+#else
+	use_txtime=0;
+#endif
+
+	//queue up to 16 periods (all flows)
+	rb_send=rb_new(16*(MAX_(1,flow_count)*(2*sizeof(uint32_t)+FLOW_EXTRA_BYTES)+msg_size));
+	send_buffer=rb_alloc_scratch(msg_size+FLOW_EXTRA_BYTES);
+	if(rb_send==NULL || send_buffer==NULL)
+	{
+		fprintf(stderr,"could not allocate send queue\n");
+		return 1;
+	}
+
+	sem_init(&send_semaphore,0,0);
+
+	if(pthread_create(&pacing_thread,NULL,pacing_thread_func,NULL)!=0)
+	{
+		fprintf(stderr,"could not start pacing thread\n");
+		return 1;
+	}
+
+	if(shutup==0)
+	{
+		if(pacing_rate>0)
+		{
+			fprintf(stderr,"pacing: max. %.1f kbit/s%s\n",pacing_rate,
+				use_txtime==1 ? " (SO_TXTIME)" : ""
+			);
+		}
+		else
+		{
+			fprintf(stderr,"sending from sender thread, no rate limit\n");
+		}
+	}
+	return 0;
+}//end start_pacing
+
+//================================================================
+int start_flows()
+{
+	flow_sockets=malloc(flow_count*sizeof(int));
+	send_buffer=(send_buffer!=NULL) ? send_buffer : rb_alloc_scratch(msg_size+FLOW_EXTRA_BYTES);
+
+	int i;
+	for(i=0;i<flow_count;i++)
+	{
+		char port[16];
+		snprintf(port,sizeof(port),"%d",atoi(sendToPort)+1+i);
+
+		struct addrinfo hints;
+		struct addrinfo *ai;
+		memset(&hints,0,sizeof(hints));
+		hints.ai_family=AF_UNSPEC;
+		hints.ai_socktype=SOCK_DGRAM;
+
+		if(getaddrinfo(sendToHost,port,&hints,&ai)!=0)
+		{
+			fprintf(stderr,"flow %d: can't resolve %s:%s\n",i,sendToHost,port);
+			return 1;
+		}
+
+		//unbound: every flow gets its own source port
+		flow_sockets[i]=socket(ai->ai_family,ai->ai_socktype,ai->ai_protocol);
+
+		int on=1;
+		setsockopt(flow_sockets[i],SOL_SOCKET,SO_BROADCAST,&on,sizeof(on));
+
+		if(flow_sockets[i]<0 || connect(flow_sockets[i],ai->ai_addr,ai->ai_addrlen)!=0)
+		{
+			fprintf(stderr,"flow %d: can't connect to %s:%s: %s\n",i,sendToHost,port,strerror(errno));
+			freeaddrinfo(ai);
+			return 1;
+		}
+		freeaddrinfo(ai);
+
+		apply_net_socket_options(flow_sockets[i],"flow");
+
+#ifdef SO_TXTIME
+		if(use_txtime==1)
+		{
+			struct sock_txtime txtime_config={CLOCK_MONOTONIC,0};
+			setsockopt(flow_sockets[i],SOL_SOCKET,SO_TXTIME,&txtime_config,sizeof(txtime_config));
+		}
+#endif
+#ifdef SO_MAX_PACING_RATE
+		if(pacing_enabled==1 && pacing_rate>0)
+		{
+			//share of the total rate
+			uint32_t rate=pacing_rate*1000/8/flow_count;
+			setsockopt(flow_sockets[i],SOL_SOCKET,SO_MAX_PACING_RATE,&rate,sizeof(rate));
+		}
+#endif
+	}
+
+	if(shutup==0)
+	{
+		fprintf(stderr,"sending %d flows to %s:%d-%d\n",flow_count,sendToHost,
+			atoi(sendToPort)+1,atoi(sendToPort)+flow_count);
+	}
+	return 0;
+}//end start_flows
+
+//================================================================
+void flow_channels(int flow, int *first, int *count)
+{
+	//contiguous groups, sizes differ by at most one
+	*first=flow*input_port_count/flow_count;
+	*count=(flow+1)*input_port_count/flow_count-*first;
+}
+
+//================================================================
+void send_flows(lo_blob *blob, lo_timetag tt)
+{
+/*
+	/audio_flow hhtiiib*
+
+	1) h: message number
+	2) h: xrun counter
+	3) t: timetag
+	4) i: sampling rate
+	5) i: first channel in this message (zero-based)
+	6) i: total channel count
+	7) b: blob of channel <first>
+	...) b: up to channel <first+count-1>
+*/
+	int f;
+	for(f=0;f<flow_count;f++)
+	{
+		int first;
+		int count;
+		flow_channels(f,&first,&count);
+
+		lo_message msg=lo_message_new();
+		lo_message_add_int64(msg,msg_sequence_number);
+		lo_message_add_int64(msg,local_xrun_counter);
+		lo_message_add_timetag(msg,tt);
+		lo_message_add_int32(msg,sample_rate);
+		lo_message_add_int32(msg,first);
+		lo_message_add_int32(msg,input_port_count);
+
+		int i;
+		for(i=first;i<first+count;i++)
+		{
+			lo_message_add_blob(msg,blob[i]);
+		}
+
+		if(pacing_enabled==1)
+		{
+			queue_message(msg,"/audio_flow",f);
+		}
+		else
+		{
+			size_t len=msg_size+FLOW_EXTRA_BYTES;
+			if(lo_message_serialise(msg,"/audio_flow",send_buffer,&len)!=NULL)
+			{
+				send(flow_sockets[f],send_buffer,len,0);
+			}
+		}
+		lo_message_free(msg);
+	}
+}//end send_flows
+
+//================================================================
+static uint64_t monotonic_ns()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return (uint64_t)ts.tv_sec*1000000000+ts.tv_nsec;
+}
+
+//================================================================
+//big endian (OSC)
+static void put_uint32(char *out, uint32_t value)
+{
+	uint32_t v=htonl(value);
+	memcpy(out,&v,sizeof(uint32_t));
+}
+
+//================================================================
+static size_t frag_datagram(char *out, uint64_t id, uint32_t offset, uint32_t length,
+	const char *chunk, uint32_t chunk_size)
+{
+/*
+	/audio_frag hiib
+
+	1) h: id of the fragmented message, increasing
+	2) i: byte offset of this chunk in the message
+	3) i: message length
+	4) b: chunk of the serialized /audio or /audio_flow message
+*/
+	memcpy(out,"/audio_frag\0,hiib\0\0\0",20);
+	put_uint32(out+20,id>>32);
+	put_uint32(out+24,id);
+	put_uint32(out+28,offset);
+	put_uint32(out+32,length);
+	put_uint32(out+36,chunk_size);
+	memcpy(out+FRAG_HEADER_SIZE,chunk,chunk_size);
+
+	//blob data is padded to 4 bytes
+	size_t padded=(chunk_size+3) & ~3;
+	memset(out+FRAG_HEADER_SIZE+chunk_size,0,padded-chunk_size);
+	return FRAG_HEADER_SIZE+padded;
+}
+
+//================================================================
+//send one datagram not before the tokens for it are available
+static void send_paced(int socket_, struct sockaddr *address, socklen_t address_length,
+	char *data, size_t len, double rate, uint64_t *next_departure)
+{
+	uint64_t now=monotonic_ns();
+	uint64_t departure=MAX_(now,*next_departure);
+	//tokens for this datagram are spent at departure
+	*next_departure=departure+(rate>0 ? (uint64_t)(len/rate) : 0);
+
+	if(departure>now)
+	{
+		pacing_delayed_counter++;
+	}
+	pacing_datagram_counter++;
+
+	if(use_txtime==1)
+	{
+#ifdef SO_TXTIME
+		//the fq qdisc holds the packet until departure
+		char control[CMSG_SPACE(sizeof(uint64_t))];
+		memset(control,0,sizeof(control));
+
+		struct iovec iov={data,len};
+		struct msghdr mh;
+		memset(&mh,0,sizeof(mh));
+		mh.msg_name=address;
+		mh.msg_namelen=address_length;
+		mh.msg_iov=&iov;
+		mh.msg_iovlen=1;
+		mh.msg_control=control;
+		mh.msg_controllen=sizeof(control);
+
+		struct cmsghdr *cm=CMSG_FIRSTHDR(&mh);
+		cm->cmsg_level=SOL_SOCKET;
+		cm->cmsg_type=SCM_TXTIME;
+		cm->cmsg_len=CMSG_LEN(sizeof(uint64_t));
+		memcpy(CMSG_DATA(cm),&departure,sizeof(uint64_t));
+
+		sendmsg(socket_,&mh,0);
+#endif
+	}
+	else
+	{
+		if(departure>now)
+		{
+			struct timespec ts;
+			ts.tv_sec=departure/1000000000;
+			ts.tv_nsec=departure%1000000000;
+			clock_nanosleep(CLOCK_MONOTONIC,TIMER_ABSTIME,&ts,NULL);
+		}
+		sendto(socket_,data,len,0,address,address_length);
+	}
+}//end send_paced
+
+//================================================================
+static void *pacing_thread_func(void *arg)
+{
+	apply_net_thread_options("sender");
+
+	//bytes per nanosecond. no limit: 0
+	double rate=(double)pacing_rate*1000/8/1000000000;
+
+	//token bucket, depth of one datagram. earliest time the next datagram may leave
+	uint64_t next_departure=0;
+
+	void *buffer=rb_alloc_scratch(msg_size+FLOW_EXTRA_BYTES);
+	char *datagram=rb_alloc_scratch(PACING_DATAGRAM_SIZE);
+	uint64_t frag_id=0;
+
+	while(shutdown_in_progress==0)
+	{
+		sem_wait(&send_semaphore);
+
+		uint32_t len;
+		int32_t flow;
+		if(rb_can_read(rb_send)<2*sizeof(uint32_t))
+		{
+			continue;
+		}
+		rb_read(rb_send,(char*)&len,sizeof(uint32_t));
+		rb_read(rb_send,(char*)&flow,sizeof(int32_t));
+		rb_read(rb_send,buffer,len);
+
+		//flow sockets are connected
+		int socket_=(flow>=0) ? flow_sockets[flow] : send_socket;
+		struct sockaddr *address=(flow>=0) ? NULL : (struct sockaddr*)&send_address;
+		socklen_t address_length=(flow>=0) ? 0 : send_address_length;
+
+		//without a rate limit (socket options only) the message goes out as is
+		if(rate==0 || len<=PACING_DATAGRAM_SIZE)
+		{
+			send_paced(socket_,address,address_length,buffer,len,rate,&next_departure);
+			continue;
+		}
+
+		frag_id++;
+		uint32_t offset;
+		for(offset=0;offset<len;)
+		{
+			uint32_t chunk_size=MIN_(PACING_DATAGRAM_SIZE-FRAG_HEADER_SIZE,len-offset);
+			size_t size=frag_datagram(datagram,frag_id,offset,len,(char*)buffer+offset,chunk_size);
+			send_paced(socket_,address,address_length,datagram,size,rate,&next_departure);
+			offset+=chunk_size;
+		}
+	}
+
+	rb_free_scratch(datagram,PACING_DATAGRAM_SIZE);
+	rb_free_scratch(buffer,msg_size+FLOW_EXTRA_BYTES);
+	return NULL;
+}//end pacing_thread_func
+
+//================================================================
+// /report
+int osc_report_handler(const char *path, const char *types, lo_arg **argv, int argc,
+	void *data, void *user_data)
+{
+	if(shutdown_in_progress==1 || adaptive_format==0)
+	{
+		return 0;
+	}
+
+	int lost=argv[0]->i;
+	float jitter=argv[1]->f;
+	int fill=argv[2]->i;
+	int underflows=argv[3]->i;
+
+	float period_ms=1000*(float)period_size/(float)sample_rate;
+
+	//messages sent in the report interval (numbering restarts at 1 after /pause)
+	uint64_t sent=(msg_sequence_number>=report_sequence_prev) ?
+		msg_sequence_number-report_sequence_prev : msg_sequence_number;
+	report_sequence_prev=msg_sequence_number;
+	float loss_rate=(sent>0) ? (float)lost/sent : 0;
+
+	int index=format_ladder_index;
+
+	//many lost messages, receiver ran out of data or messages arrive too irregularly
+	if(loss_rate>adapt_loss_rate || underflows>0 || jitter>period_ms)
+	{
+		clean_report_counter=0;
+		bad_report_counter++;
+		if(bad_report_counter>=adapt_down_after && format_ladder_index<2)
+		{
+			bad_report_counter=0;
+			format_ladder_index++;
+		}
+	}
+	//a few lost messages: neither up nor down
+	else if(lost>0)
+	{
+		clean_report_counter=0;
+		bad_report_counter=0;
+	}
+	else
+	{
+		bad_report_counter=0;
+		clean_report_counter++;
+		//a larger format needs more bandwidth, only with data buffered at the receiver
+		if(clean_report_counter>=adapt_up_after && fill>0 && format_ladder_index>format_ladder_top)
+		{
+			clean_report_counter=0;
+			format_ladder_index--;
+		}
+	}
+
+	if(index!=format_ladder_index)
+	{
+		requested_bytes_per_sample=format_ladder[format_ladder_index];
+
+		if(shutup==0)
+		{
+			fprintf(stderr,"\nswitching to %d bytes per sample (lost: %d jitter: %.2f ms fill: %d underflows: %d)\n",
+				requested_bytes_per_sample,lost,jitter,fill,underflows);
+			fflush(stderr);
+		}
+		io_simple_int("/format_switched",requested_bytes_per_sample);
+	}
+	return 0;
+}//end osc_report_handler
+
 //================================================================
 // /pause
 int osc_pause_handler(const char *path, const char *types, lo_arg **argv, int argc,
@@ -1073,6 +1849,8 @@ void io_dump_config()
 		//lo_message_add_float(msgio,(float)input_port_count*period_size*bytes_per_sample/(float)transfer_size);
 
 		lo_message_add_float(msgio,expected_network_data_rate);	//26
+		lo_message_add_int32(msgio,suppress_silence);		//27
+		lo_message_add_float(msgio,silence_threshold);		//28
 		//lo_message_add_float(msgio,);
 
 //should be global
@@ -1085,7 +1863,7 @@ void io_dump_config()
 }//end io_dump_config
 
 //================================================================
-int message_size()
+int message_size(int sample_bytes)
 {
 	lo_message msg=lo_message_new();
 	lo_message_add_int64(msg,msg_sequence_number);
@@ -1095,14 +1873,16 @@ int message_size()
 	lo_timetag_now(&tt);
 	lo_message_add_timetag(msg,tt);
 	lo_message_add_int32(msg,1111);
+	lo_message_add_int64(msg,1111);
+	lo_message_add_int32(msg,1111);
 
 	lo_blob blob[input_port_count];
-	void* membuf=malloc(period_size*bytes_per_sample);
+	void* membuf=malloc(period_size*sample_bytes);
 
 	int i;
 	for(i=0; i<input_port_count; i++)
 	{
-		blob[i]=lo_blob_new(period_size*bytes_per_sample,membuf);
+		blob[i]=lo_blob_new(period_size*sample_bytes,membuf);
 		lo_message_add_blob(msg,blob[i]);		
 	}
 
@@ -1119,3 +1899,48 @@ int message_size()
 
 	return msg_size;
 }//end message_size
+
+//================================================================
+int flow_message_size(int sample_bytes)
+{
+	int first;
+	int count;
+	//first flow is the largest
+	flow_channels(0,&first,&count);
+
+	lo_message msg=lo_message_new();
+	lo_message_add_int64(msg,msg_sequence_number);
+	lo_message_add_int64(msg,local_xrun_counter);
+
+	lo_timetag tt;
+	lo_timetag_now(&tt);
+	lo_message_add_timetag(msg,tt);
+	lo_message_add_int32(msg,1111);
+	lo_message_add_int32(msg,first);
+	lo_message_add_int32(msg,input_port_count);
+
+	void* membuf=malloc(period_size*sample_bytes);
+
+	int i;
+	for(i=0; i<count; i++)
+	{
+		lo_blob blob=lo_blob_new(period_size*sample_bytes,membuf);
+		lo_message_add_blob(msg,blob);
+		lo_blob_free(blob);
+	}
+
+	int size=lo_message_length(msg,"/audio_flow");
+
+	lo_message_free(msg);
+	free(membuf);
+
+	return size;
+}//end flow_message_size
+
+//================================================================
+int transfer_length(int msg_size)
+{
+	return floor(msg_size / 1480) * 1514
+		+fmod(msg_size,1480)
+		+14+20+8;
+}//end transfer_length
@@ -36,6 +36,30 @@ structure:
 
 int nopause=0; //param
 
+//send silent channels as empty blobs
+int suppress_silence=0; //param
+
+//step down/up in sample format depending on /report from receiver
+int adaptive_format=0; //param
+
+//send from a separate thread with a rate ceiling (token bucket)
+int pacing_enabled=0; //param
+//hand departure time to the kernel (SO_TXTIME) instead of sleeping
+int use_txtime=0; //param
+//--pace splits larger messages into /audio_frag datagrams of at most this size,
+//so that IP doesn't fragment them into a burst (1500 bytes MTU - IPv6 and UDP header)
+#define PACING_DATAGRAM_SIZE 1452
+//path, typetag, h, i, i, blob size
+#define FRAG_HEADER_SIZE 40
+
+//stripe channel groups across n UDP flows (/audio_flow) to target_port+1..n
+int flow_count=0; //param
+//a flow message has a longer path and two more int32 than /audio
+#define FLOW_EXTRA_BYTES 64
+
+//send the test signal instead of the capture ports (jack_audio_receive --check)
+int test_signal=0; //param
+
 //================================================================
 static void print_help (void)
 {
@@ -48,6 +72,11 @@ static void print_help (void)
 	fprintf (stderr, "  Number of capture channels      (2) --in     <integer>\n");
 	fprintf (stderr, "  Autoconnect ports                   --connect\n");
 	fprintf (stderr, "  Send 16 bit samples  (32 bit float) --16\n");
+	fprintf (stderr, "  Send 24 bit samples  (32 bit float) --24\n");
+	fprintf (stderr, "  Lower format on congestion          --adapt\n");
+	fprintf (stderr, "  Pace sending, max. kbit/s  (1.5 x expected) --pace <float>\n");
+	fprintf (stderr, "     Use SO_TXTIME (needs fq qdisc)   --txtime\n");
+	fprintf (stderr, "  Send channel groups in n flows  (0) --flows  <integer>\n");
 	fprintf (stderr, "  JACK client name             (send) --name   <string>\n");
 	fprintf (stderr, "  JACK server name          (default) --sname  <string>\n");
 	fprintf (stderr, "  Update info every nth cycle    (99) --update <integer>\n");
@@ -61,6 +90,12 @@ static void print_help (void)
 	fprintf (stderr, "  Immediate send, ignore /pause       --nopause\n");
 	fprintf (stderr, "  (Use with multiple receivers. Ignore /pause, /deny)\n");
 	fprintf (stderr, "  Drop every nth message (test)   (0) --drop   <integer>\n");
+	fprintf (stderr, "  Send silent channels as empty blobs --silence\n");
+	fprintf (stderr, "     Threshold dBFS       (digital 0) --sthresh <float>\n");
+	fprintf (stderr, "  Send test signal (receiver --check) --testsig\n");
+	print_net_help();
+	print_alloc_help();
+	fprintf (stderr, "  (Socket options imply a sender thread, see --pace)\n");
 	fprintf (stderr, "target_host:   <string>\n");
 	fprintf (stderr, "target_port:   <integer>\n\n");
 	fprintf (stderr, "If target_port==0 and/or --lport 0: use random port(s)\n");
@@ -82,6 +117,11 @@ static struct option long_options[] =
 	{"in",          required_argument,      0, 'e'},
 	{"connect",     no_argument,    &autoconnect, 1},//done
 	{"16",          no_argument,            0, 'f'},
+	{"24",          no_argument,            0, 'o'},
+	{"adapt",       no_argument,    &adaptive_format, 1},
+	{"pace",        required_argument,      0, 'p'},
+	{"txtime",      no_argument,    &use_txtime, 1},
+	{"flows",       required_argument,      0, 'q'},
 	{"name",        required_argument,      0, 'g'},
 	{"sname",       required_argument,      0, 'h'},
 	{"update",      required_argument,      0, 'i'},
@@ -94,6 +134,11 @@ static struct option long_options[] =
 	{"ioport",      required_argument,      0, 'l'},
 	{"nopause",     no_argument,    &nopause, 1},//done
 	{"drop",        required_argument,      0, 'm'},
+	{"silence",     no_argument,    &suppress_silence, 1},
+	{"sthresh",     required_argument,      0, 'n'},
+	{"testsig",     no_argument,    &test_signal, 1},
+	NET_LONG_OPTIONS,
+	ALLOC_LONG_OPTIONS,
 	{0, 0, 0, 0}
 };
 
@@ -117,6 +162,30 @@ int osc_accept_handler(const char *path, const char *types, lo_arg **argv, int a
 int osc_deny_handler(const char *path, const char *types, lo_arg **argv, int argc,
 	void *data, void *user_data);
 
+//queue serialized message for pacing thread or send directly
+void send_audio_message(lo_message msg);
+
+//serialize message to rb_send for the pacing thread. flow -1: osc server socket
+void queue_message(lo_message msg, const char *path, int flow);
+
+//--flows: one UDP socket per flow (own source port), connected to target_port+1+flow
+int start_flows();
+
+//channels first..first+count-1 are sent in flow
+void flow_channels(int flow, int *first, int *count);
+
+//send one /audio_flow per flow with its channel group
+void send_flows(lo_blob *blob, lo_timetag tt);
+
+//setup socket options and start pacing thread
+int start_pacing();
+
+//pacing thread: send queued messages, respect rate ceiling
+static void *pacing_thread_func(void *arg);
+
+int osc_report_handler(const char *path, const char *types, lo_arg **argv, int argc,
+	void *data, void *user_data);
+
 int osc_pause_handler(const char *path, const char *types, lo_arg **argv, int argc,
 	void *data, void *user_data);
 
@@ -133,7 +202,14 @@ static void signal_handler(int sig);
 void io_dump_config();
 
 //create a dummy message, return size in bytes (message length)
+//all channels non-silent (upper bound with --silence)
 //don't forget to update when changing the real message (format) in process()
-int message_size();
+int message_size(int sample_bytes);
+
+//size of the largest /audio_flow message (--flows)
+int flow_message_size(int sample_bytes);
+
+//bytes on the wire (ethernet, IP fragments) for a message of msg_size bytes
+int transfer_length(int msg_size);
 
 #endif //JACK_AUDIO_SEND_H_INCLUDED
@@ -0,0 +1,126 @@
+/* part of audio_rxtx
+ *
+ * This program is free software; feel free to redistribute it and/or
+ * modify it.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. bla.
+*/
+
+#include <math.h>
+#include <stdint.h>
+
+#include "pcm24.h"
+
+#define MIN_(a,b) ( ((a) < (b)) ? (a) : (b) )
+#define MAX_(a,b) ( ((a) > (b)) ? (a) : (b) )
+
+//the build doesn't pass -m flags, the baseline (i.e. x86_64: SSE2) must run everywhere.
+//the SSSE3 loops are compiled for that target only and selected at runtime.
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+	#define PCM24_SSSE3
+	#include <tmmintrin.h>
+	#define PCM24_TARGET_SSSE3 __attribute__((target("ssse3")))
+#endif
+
+int pcm24_use_ssse3=0;
+
+//=========================================================
+int pcm24_have_ssse3()
+{
+#ifdef PCM24_SSSE3
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("ssse3") ? 1 : 0;
+#else
+	return 0;
+#endif
+}
+
+//=========================================================
+//runs before main(), no thread can call the conversions yet
+__attribute__((constructor)) static void pcm24_init()
+{
+	pcm24_use_ssse3=pcm24_have_ssse3();
+}
+
+#ifdef PCM24_SSSE3
+//=========================================================
+//converts a multiple of 4 samples, leaving at least 2 for the scalar loop. returns the count
+PCM24_TARGET_SSSE3 static int float_to_pcm24_ssse3(const float *in, unsigned char *out, int nframes)
+{
+	int i=0;
+	const __m128 min=_mm_set1_ps(-1.0f);
+	const __m128 max=_mm_set1_ps(1.0f);
+	const __m128 scale=_mm_set1_ps(8388607.0f);
+	//drop the most significant byte of every int32
+	const __m128i pack=_mm_setr_epi8(0,1,2,4,5,6,8,9,10,12,13,14,-1,-1,-1,-1);
+
+	//4 samples per round. storing 16 bytes of which the last 4 are overwritten
+	//in the next round, so leave enough room at the end for the scalar loop
+	for(;i+6<=nframes;i+=4)
+	{
+		__m128 x=_mm_min_ps(_mm_max_ps(_mm_loadu_ps(in+i),min),max);
+		__m128i v=_mm_cvtps_epi32(_mm_mul_ps(x,scale));
+		_mm_storeu_si128((__m128i*)(out+3*i),_mm_shuffle_epi8(v,pack));
+	}
+	return i;
+}
+
+//=========================================================
+PCM24_TARGET_SSSE3 static int pcm24_to_float_ssse3(const unsigned char *in, float *out, int nframes)
+{
+	int i=0;
+	const __m128 min=_mm_set1_ps(-1.0f);
+	const __m128 scale=_mm_set1_ps(1.0f/8388607.0f);
+	//move 3 bytes to the upper part of every int32, sign extend with shift
+	const __m128i unpack=_mm_setr_epi8(-1,0,1,2,-1,3,4,5,-1,6,7,8,-1,9,10,11);
+
+	//reading 16 bytes per 4 samples
+	for(;i+6<=nframes;i+=4)
+	{
+		__m128i v=_mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(in+3*i)),unpack);
+		v=_mm_srai_epi32(v,8);
+		_mm_storeu_ps(out+i,_mm_max_ps(_mm_mul_ps(_mm_cvtepi32_ps(v),scale),min));
+	}
+	return i;
+}
+#endif
+
+//=========================================================
+//24 bit signed little endian, 3 bytes per sample
+void float_to_pcm24(const float *in, unsigned char *out, int nframes)
+{
+	int i=0;
+#ifdef PCM24_SSSE3
+	if(pcm24_use_ssse3)
+	{
+		i=float_to_pcm24_ssse3(in,out,nframes);
+	}
+#endif
+	for(;i<nframes;i++)
+	{
+		//MAX_ first: NaN ends up as -1 like with _mm_max_ps
+		int32_t v=lrintf(MIN_(MAX_(in[i],-1.0f),1.0f)*8388607.0f);
+		out[3*i]=v;
+		out[3*i+1]=v>>8;
+		out[3*i+2]=v>>16;
+	}
+}
+
+//=========================================================
+void pcm24_to_float(const unsigned char *in, float *out, int nframes)
+{
+	int i=0;
+#ifdef PCM24_SSSE3
+	if(pcm24_use_ssse3)
+	{
+		i=pcm24_to_float_ssse3(in,out,nframes);
+	}
+#endif
+	for(;i<nframes;i++)
+	{
+		int32_t v=(int32_t)((uint32_t)in[3*i]<<8 | (uint32_t)in[3*i+1]<<16 | (uint32_t)in[3*i+2]<<24)>>8;
+		out[i]=MAX_((float)v*(1.0f/8388607.0f),-1.0f);
+	}
+}
@@ -0,0 +1,29 @@
+/* part of audio_rxtx
+ *
+ * This program is free software; feel free to redistribute it and/or
+ * modify it.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. bla.
+*/
+
+#ifndef PCM24_H_INCLUDED
+#define PCM24_H_INCLUDED
+
+//pcm24.h
+
+//conversion between float samples and 24 bit signed little endian (3 bytes per sample)
+//float input is clipped to -1..1, 24 bit input is scaled by 1/8388607 and clipped to -1
+//on x86 the SSSE3 variants are used if the CPU supports them (checked at startup).
+//both variants produce identical output (tests/test_pcm24.c).
+
+void float_to_pcm24(const float *in, unsigned char *out, int nframes);
+void pcm24_to_float(const unsigned char *in, float *out, int nframes);
+
+//1: SSSE3 variants are in use, 0: scalar only
+//set to 0 to force the scalar loops (tests). only set to 1 if pcm24_have_ssse3() returns 1.
+extern int pcm24_use_ssse3;
+int pcm24_have_ssse3();
+
+#endif //PCM24_H_INCLUDED
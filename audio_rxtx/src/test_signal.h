@@ -0,0 +1,293 @@
+/* part of audio_rxtx
+ *
+ * This program is free software; feel free to redistribute it and/or
+ * modify it.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. bla.
+*/
+
+#ifndef TEST_SIGNAL_H_INCLUDED
+#define TEST_SIGNAL_H_INCLUDED
+
+//test_signal.h
+
+//test signal of jack_audio_send --testsig, checked by jack_audio_receive --check.
+//tests/fake_jack.c feeds it to the capture ports and checks the playback ports with it.
+//header-only, no dependencies.
+//
+//frame f of channel c, with m=f/2 and step s=c+1:
+//even f: level (m*s) mod TEST_SIGNAL_PRIME_EVEN, positive value
+//odd f:  level (m*s) mod TEST_SIGNAL_PRIME_ODD, negative value
+//
+//the sign tells the parity of a frame. two even frames tell the channel (level difference s),
+//independent of the position. an even and an odd frame tell m modulo both primes,
+//which gives the position modulo TEST_SIGNAL_LENGTH (chinese remainder theorem).
+//the pattern repeats after TEST_SIGNAL_LENGTH frames (about 46 minutes at 48 kHz),
+//lost or repeated periods are only invisible if they add up to a multiple of that.
+//levels are 1/8191 apart and never 0 (silence), coarse enough to survive 16 bit.
+//values are (level+0.5) times the reciprocal of the prime, the SSE2 checker computes the same floats.
+
+#include <stdint.h>
+#include <math.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define TEST_SIGNAL_PRIME_EVEN 8191
+#define TEST_SIGNAL_PRIME_ODD 8179
+#define TEST_SIGNAL_LENGTH ((uint64_t)2*TEST_SIGNAL_PRIME_EVEN*TEST_SIGNAL_PRIME_ODD)
+//every channel needs its own step below both primes
+#define TEST_SIGNAL_MAX_CHANNELS (TEST_SIGNAL_PRIME_ODD-1)
+#define TEST_SIGNAL_SCALE_EVEN (1.0f/TEST_SIGNAL_PRIME_EVEN)
+#define TEST_SIGNAL_SCALE_ODD (-1.0f/TEST_SIGNAL_PRIME_ODD)
+
+//generator state for consecutive frames of one channel
+typedef struct
+{
+	uint32_t level_even;
+	uint32_t level_odd;
+	uint32_t step;
+	int odd;
+} test_signal_t;
+
+//=========================================================
+static inline void test_signal_init(test_signal_t *ts, int channel, uint64_t frame)
+{
+	uint64_t m=frame/2;
+	ts->step=channel+1;
+	ts->level_even=(m%TEST_SIGNAL_PRIME_EVEN)*ts->step%TEST_SIGNAL_PRIME_EVEN;
+	ts->level_odd=(m%TEST_SIGNAL_PRIME_ODD)*ts->step%TEST_SIGNAL_PRIME_ODD;
+	ts->odd=frame%2;
+}
+
+//=========================================================
+static inline float test_signal_value(uint32_t level, int odd)
+{
+	if(odd)
+	{
+		return ((float)level+0.5f)*TEST_SIGNAL_SCALE_ODD;
+	}
+	return ((float)level+0.5f)*TEST_SIGNAL_SCALE_EVEN;
+}
+
+//=========================================================
+static inline float test_signal_next(test_signal_t *ts)
+{
+	if(ts->odd==0)
+	{
+		ts->odd=1;
+		return test_signal_value(ts->level_even,0);
+	}
+
+	float value=test_signal_value(ts->level_odd,1);
+	//next m
+	ts->level_even+=ts->step;
+	if(ts->level_even>=TEST_SIGNAL_PRIME_EVEN)
+	{
+		ts->level_even-=TEST_SIGNAL_PRIME_EVEN;
+	}
+	ts->level_odd+=ts->step;
+	if(ts->level_odd>=TEST_SIGNAL_PRIME_ODD)
+	{
+		ts->level_odd-=TEST_SIGNAL_PRIME_ODD;
+	}
+	ts->odd=0;
+	return value;
+}
+
+//=========================================================
+static inline void test_signal_fill(float *out, int channel, uint64_t frame, int nframes)
+{
+	test_signal_t ts;
+	test_signal_init(&ts,channel,frame);
+	int i;
+	for(i=0;i<nframes;i++)
+	{
+		out[i]=test_signal_next(&ts);
+	}
+}
+
+//=========================================================
+//number of samples differing from the test signal by more than tolerance.
+//index of the first mismatch in *first (if any and first!=NULL)
+static inline int test_signal_mismatches_scalar(const float *in, int channel, uint64_t frame, int nframes,
+	float tolerance, int *first)
+{
+	test_signal_t ts;
+	test_signal_init(&ts,channel,frame);
+	int mismatches=0;
+	int i;
+	for(i=0;i<nframes;i++)
+	{
+		if(fabsf(in[i]-test_signal_next(&ts))>tolerance)
+		{
+			if(mismatches==0 && first!=NULL)
+			{
+				*first=i;
+			}
+			mismatches++;
+		}
+	}
+	return mismatches;
+}
+
+//=========================================================
+//same as test_signal_mismatches_scalar(), 4 frames (2 even/odd pairs) per step:
+//levels in integer lanes, wrapped with a compare instead of a branch, one multiply per value.
+//--check compares 512 channels and more in real time with this
+static inline int test_signal_mismatches(const float *in, int channel, uint64_t frame, int nframes,
+	float tolerance, int *first)
+{
+#ifdef __SSE2__
+	int i=0;
+	int mismatches=0;
+
+	//start at an even frame
+	if(frame%2==1 && nframes>0)
+	{
+		mismatches=test_signal_mismatches_scalar(in,channel,frame,1,tolerance,NULL);
+		i=1;
+	}
+
+	if(nframes-i>=4)
+	{
+		test_signal_t ts;
+		test_signal_init(&ts,channel,frame+i);
+		uint32_t step_even=ts.step%TEST_SIGNAL_PRIME_EVEN;
+		uint32_t step_odd=ts.step%TEST_SIGNAL_PRIME_ODD;
+		uint32_t next_even=(ts.level_even+step_even)%TEST_SIGNAL_PRIME_EVEN;
+		uint32_t next_odd=(ts.level_odd+step_odd)%TEST_SIGNAL_PRIME_ODD;
+
+		//lanes: even m, odd m, even m+1, odd m+1. advance by 2 m per step
+		__m128i level=_mm_setr_epi32(ts.level_even,ts.level_odd,next_even,next_odd);
+		const __m128i prime=_mm_setr_epi32(TEST_SIGNAL_PRIME_EVEN,TEST_SIGNAL_PRIME_ODD,
+			TEST_SIGNAL_PRIME_EVEN,TEST_SIGNAL_PRIME_ODD);
+		const __m128i prime_1=_mm_sub_epi32(prime,_mm_set1_epi32(1));
+		const __m128i increment=_mm_setr_epi32(2*step_even%TEST_SIGNAL_PRIME_EVEN,2*step_odd%TEST_SIGNAL_PRIME_ODD,
+			2*step_even%TEST_SIGNAL_PRIME_EVEN,2*step_odd%TEST_SIGNAL_PRIME_ODD);
+		const __m128 scale=_mm_setr_ps(TEST_SIGNAL_SCALE_EVEN,TEST_SIGNAL_SCALE_ODD,
+			TEST_SIGNAL_SCALE_EVEN,TEST_SIGNAL_SCALE_ODD);
+		const __m128 half=_mm_set1_ps(0.5f);
+		const __m128 abs_mask=_mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+		const __m128 tol=_mm_set1_ps(tolerance);
+		//compare results are -1 per lane, subtracting them counts
+		__m128i counter=_mm_setzero_si128();
+
+		for(;i+4<=nframes;i+=4)
+		{
+			__m128 expected=_mm_mul_ps(_mm_add_ps(_mm_cvtepi32_ps(level),half),scale);
+			__m128 diff=_mm_and_ps(_mm_sub_ps(_mm_loadu_ps(in+i),expected),abs_mask);
+			counter=_mm_sub_epi32(counter,_mm_castps_si128(_mm_cmpgt_ps(diff,tol)));
+
+			level=_mm_add_epi32(level,increment);
+			level=_mm_sub_epi32(level,_mm_and_si128(_mm_cmpgt_epi32(level,prime_1),prime));
+		}
+
+		int32_t lanes[4];
+		_mm_storeu_si128((__m128i*)lanes,counter);
+		mismatches+=lanes[0]+lanes[1]+lanes[2]+lanes[3];
+	}
+
+	if(i<nframes)
+	{
+		mismatches+=test_signal_mismatches_scalar(in+i,channel,frame+i,nframes-i,tolerance,NULL);
+	}
+
+	//locate only if needed
+	if(mismatches>0 && first!=NULL)
+	{
+		test_signal_mismatches_scalar(in,channel,frame,nframes,tolerance,first);
+	}
+	return mismatches;
+#else
+	return test_signal_mismatches_scalar(in,channel,frame,nframes,tolerance,first);
+#endif
+}
+
+//=========================================================
+//max. difference to the test signal after the sample format's round trip
+static inline float test_signal_tolerance(int bytes_per_sample)
+{
+	if(bytes_per_sample==2)
+	{
+		return 2.0f/32760;
+	}
+	else if(bytes_per_sample==3)
+	{
+		return 2.0f/8388607;
+	}
+	//float is passed unchanged
+	return 0;
+}
+
+//=========================================================
+//a^-1 mod p, p prime
+static inline uint64_t test_signal_inverse(uint64_t a, uint64_t p)
+{
+	uint64_t result=1;
+	uint64_t base=a%p;
+	uint64_t e=p-2;
+	while(e>0)
+	{
+		if(e & 1)
+		{
+			result=result*base%p;
+		}
+		base=base*base%p;
+		e>>=1;
+	}
+	return result;
+}
+
+//=========================================================
+//level of a sample, parity in *odd. -1 if out of range
+static inline int test_signal_level(float value, int *odd)
+{
+	*odd=(value<0);
+	long prime=*odd ? TEST_SIGNAL_PRIME_ODD : TEST_SIGNAL_PRIME_EVEN;
+	long level=lrintf(fabsf(value)*prime-0.5f);
+	return (level<0 || level>=prime) ? -1 : level;
+}
+
+//=========================================================
+//channel and frame (mod TEST_SIGNAL_LENGTH) of in[0], decoded from the first 4 samples.
+//returns 0 if these are not test signal samples
+static inline int test_signal_locate(const float *in, int nframes, int *channel, uint64_t *frame)
+{
+	if(nframes<4)
+	{
+		return 0;
+	}
+
+	//in[first_even] and in[first_even+1] share m
+	int first_even=(in[0]<0) ? 1 : 0;
+	int odd[3];
+	int even_1=test_signal_level(in[first_even],&odd[0]);
+	int odd_1=test_signal_level(in[first_even+1],&odd[1]);
+	int even_2=test_signal_level(in[first_even+2],&odd[2]);
+	if(even_1<0 || odd_1<0 || even_2<0 || odd[0]!=0 || odd[1]!=1 || odd[2]!=0)
+	{
+		return 0;
+	}
+
+	uint64_t step=(even_2-even_1+TEST_SIGNAL_PRIME_EVEN)%TEST_SIGNAL_PRIME_EVEN;
+	if(step<1 || step>TEST_SIGNAL_MAX_CHANNELS)
+	{
+		return 0;
+	}
+
+	//m*step = even_1 (mod PRIME_EVEN), m*step = odd_1 (mod PRIME_ODD)
+	uint64_t m_even=even_1*test_signal_inverse(step,TEST_SIGNAL_PRIME_EVEN)%TEST_SIGNAL_PRIME_EVEN;
+	uint64_t m_odd=odd_1*test_signal_inverse(step,TEST_SIGNAL_PRIME_ODD)%TEST_SIGNAL_PRIME_ODD;
+	uint64_t k=(m_odd+TEST_SIGNAL_PRIME_ODD-m_even%TEST_SIGNAL_PRIME_ODD)%TEST_SIGNAL_PRIME_ODD
+		*test_signal_inverse(TEST_SIGNAL_PRIME_EVEN,TEST_SIGNAL_PRIME_ODD)%TEST_SIGNAL_PRIME_ODD;
+	uint64_t m=m_even+TEST_SIGNAL_PRIME_EVEN*k;
+
+	*channel=step-1;
+	*frame=(2*m+TEST_SIGNAL_LENGTH-first_even)%TEST_SIGNAL_LENGTH;
+	return 1;
+}
+
+#endif //TEST_SIGNAL_H_INCLUDED
@@ -0,0 +1,158 @@
+#!/bin/bash
+
+#//benchmark jack_audio_send -> jack_audio_receive without jackd
+#//both programs load the in-process JACK stand-in (fake_jack.c) as libjack.so.0
+#//the sender's capture ports carry a test pattern that is verified at the receiver's playback ports
+#//udp_shaper sits in between and can add loss, jitter and reordering
+#//one line per combination of channels, period size and sample format:
+#//tx MB/s: audio payload per wall second
+#//us/cyc: CPU time in process() per cycle (avg/max)
+#//late: cycles that missed the simulated deadline
+#//silent: receiver periods without data between data (underflows), not the tail after the sender stopped
+#//disc: discontinuities in the received pattern (lost or reordered periods)
+#//err: samples differing from the pattern by more than the format's resolution
+
+OSC_PORT1=9998
+OSC_PORT2=9999
+SHAPER_PORT=9997
+
+SAMPLE_RATE=48000
+#cycle rate factor. 1: real time, 2: twice as fast. 0 (free running) won't keep both sides in step
+SPEED=${SPEED:-2}
+#seconds of audio per run
+AUDIO_SECONDS=${AUDIO_SECONDS:-10}
+
+CHANNELS=${CHANNELS:-"2 64 256"}
+PERIODS=${PERIODS:-"64 128 512"}
+FORMATS=${FORMATS:-"float 24 16"}
+
+#udp_shaper: link kbit/s (0: unlimited), queue bytes, loss %, jitter ms, reorder %
+LINK_KBITS=${LINK_KBITS:-0}
+QUEUE_BYTES=${QUEUE_BYTES:-4000000}
+LOSS=${LOSS:-0}
+JITTER=${JITTER:-0}
+REORDER=${REORDER:-0}
+
+OUTPUT_DIR=/tmp/audio_rxtx_test_logs
+
+function checkAvail()
+{
+	which "$1" >/dev/null 2>&1
+	ret=$?
+	if [ $ret -ne 0 ]
+	then
+		echo "tool \"$1\" not found. please install"
+		exit 1
+	fi
+}
+
+for tool in {jack_audio_send,jack_audio_receive,gcc,pkg-config}; \
+	do checkAvail "$tool"; done
+
+echo "creating output dir $OUTPUT_DIR (if not existing)"
+mkdir -p "$OUTPUT_DIR/fakejack"
+
+DIR=`dirname "$0"`
+SHAPER="$OUTPUT_DIR/udp_shaper"
+echo "compiling udp_shaper"
+gcc -O2 -o "$SHAPER" "$DIR/udp_shaper.c" || exit 1
+
+echo "compiling fake libjack"
+gcc -O2 -shared -fPIC -o "$OUTPUT_DIR/fakejack/libjack.so.0" \
+	"$DIR/fake_jack.c" "$DIR/fake_jack_stubs.c" -I"$DIR/../src" \
+	`pkg-config --cflags jack` -lpthread -lm || exit 1
+
+function field()
+{
+	#field <name> <report line>
+	echo "$2" | tr ' ' '\n' | grep "^$1=" | cut -d= -f2
+}
+
+function run()
+{
+	CHANNEL_COUNT=$1
+	PERIOD=$2
+	FORMAT=$3
+
+	case $FORMAT in
+		float) OPTS=""; BYTES=4; TOLERANCE=0 ;;
+		24) OPTS="--24"; BYTES=3; TOLERANCE=0.000001 ;;
+		16) OPTS="--16"; BYTES=2; TOLERANCE=0.0001 ;;
+	esac
+
+	NAME="${CHANNEL_COUNT}_${PERIOD}_${FORMAT}"
+	REPORT="$OUTPUT_DIR/bench_$NAME.report"
+	rm -f "$REPORT"
+
+	MESSAGES=$(( AUDIO_SECONDS * SAMPLE_RATE / PERIOD ))
+
+	export LD_LIBRARY_PATH="$OUTPUT_DIR/fakejack"
+	export FAKE_JACK_RATE=$SAMPLE_RATE
+	export FAKE_JACK_PERIOD=$PERIOD
+	export FAKE_JACK_SPEED=$SPEED
+	export FAKE_JACK_TOLERANCE=$TOLERANCE
+	export FAKE_JACK_REPORT="$REPORT"
+
+	"$SHAPER" $SHAPER_PORT $OSC_PORT2 $LINK_KBITS $QUEUE_BYTES $LOSS $JITTER $REORDER \
+		>"$OUTPUT_DIR/bench_shaper_$NAME.log" 2>&1 &
+	SHAPER_PID=$!
+
+	jack_audio_receive $OPTS --name receive --quiet --out $CHANNEL_COUNT $OSC_PORT2 \
+		>"$OUTPUT_DIR/bench_receive_$NAME.log" 2>&1 &
+	JACK_AUDIO_RECEIVE_PID=$!
+
+	sleep 0.5
+
+	jack_audio_send $OPTS --name send --quiet --limit $MESSAGES --lport $OSC_PORT1 --in $CHANNEL_COUNT localhost $SHAPER_PORT \
+		>"$OUTPUT_DIR/bench_send_$NAME.log" 2>&1
+	SEND_RET=$?
+
+	#let the receiver play out its buffer
+	if [ $SEND_RET -eq 0 ]
+	then
+		sleep 1
+	fi
+	kill $JACK_AUDIO_RECEIVE_PID
+	wait $JACK_AUDIO_RECEIVE_PID 2>/dev/null
+	kill $SHAPER_PID
+	wait $SHAPER_PID 2>/dev/null
+
+	unset LD_LIBRARY_PATH
+
+	if [ $SEND_RET -ne 0 ]
+	then
+		printf "%5s %6s %6s   sender failed, see $OUTPUT_DIR/bench_send_$NAME.log\n" $CHANNEL_COUNT $PERIOD $FORMAT
+		return
+	fi
+
+	SEND=`grep "^client=send" "$REPORT"`
+	RECEIVE=`grep "^client=receive" "$REPORT"`
+
+	CHECKED=`field checked "$RECEIVE"`
+	WALL=`field wall_s "$RECEIVE"`
+	MBS=`echo "$CHECKED $BYTES $WALL" | awk '{ if($3>0) printf "%.2f", $1*$2/$3/1000000; else print "-" }'`
+
+	printf "%5s %6s %6s %8s %9s/%-9s %9s/%-9s %7s %7s %7s %5s %9s\n" \
+		$CHANNEL_COUNT $PERIOD $FORMAT "$MBS" \
+		"`field cpu_avg_us "$SEND"`" "`field cpu_max_us "$SEND"`" \
+		"`field cpu_avg_us "$RECEIVE"`" "`field cpu_max_us "$RECEIVE"`" \
+		"`field late "$SEND"`" "`field late "$RECEIVE"`" \
+		"`field silent "$RECEIVE"`" "`field discontinuities "$RECEIVE"`" "`field errors "$RECEIVE"`"
+}
+
+echo "speed $SPEED, $AUDIO_SECONDS s audio per run, link $LINK_KBITS kbit/s, loss $LOSS %, jitter $JITTER ms, reorder $REORDER %"
+printf "%5s %6s %6s %8s %19s %19s %7s %7s %7s %5s %9s\n" \
+	chan period format "tx MB/s" "send us/cyc" "receive us/cyc" "late tx" "late rx" "silent" "disc" "err"
+
+for c in $CHANNELS
+do
+	for p in $PERIODS
+	do
+		for f in $FORMATS
+		do
+			run $c $p $f
+		done
+	done
+done
+
+echo "reports in $OUTPUT_DIR/bench_*.report"
@@ -0,0 +1,569 @@
+/* part of audio_rxtx
+ *
+ * This program is free software; feel free to redistribute it and/or
+ * modify it.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. bla.
+*/
+
+//in-process JACK stand-in for bench.sh
+//built as libjack.so.0, picked up by weak_libjack via LD_LIBRARY_PATH. no jackd needed.
+//a thread calls process() at the simulated cycle rate (or faster).
+//capture ports (JackPortIsInput of the client) get the test signal (../src/test_signal.h),
+//playback ports (JackPortIsOutput) are checked against it after every cycle.
+//
+//environment:
+//FAKE_JACK_RATE       sample rate (48000)
+//FAKE_JACK_PERIOD     period size (128)
+//FAKE_JACK_SPEED      cycle rate factor, 1: real time, 0: as fast as possible (1)
+//FAKE_JACK_TOLERANCE  max. difference per sample (0, exact)
+//FAKE_JACK_REPORT     append report line to this file (stderr)
+//
+//gcc -shared -fPIC -o libjack.so.0 fake_jack.c fake_jack_stubs.c -I../src `pkg-config --cflags jack` -lpthread -lm
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+
+#define USE_WEAK_JACK 1
+#include "weak_libjack.h"
+#include "test_signal.h"
+
+//exported as jack_<name>, the C names are renamed by weak_libjack.h
+#define FAKE(NAME) __asm__("jack_" #NAME)
+
+#define MAX_PORTS 1024
+
+struct _jack_port
+{
+	char name[128];
+	unsigned long flags;
+	float *buffer;
+};
+
+struct _jack_client
+{
+	char name[64];
+
+	jack_nframes_t sample_rate;
+	jack_nframes_t period_size;
+	double speed;
+	float tolerance;
+
+	JackProcessCallback process;
+	void *process_arg;
+	JackXRunCallback xrun;
+	void *xrun_arg;
+	JackShutdownCallback shutdown;
+	void *shutdown_arg;
+
+	struct _jack_port *ports[MAX_PORTS];
+	int port_count;
+
+	pthread_t thread;
+	volatile int running;
+
+	//frames since activation
+	uint64_t frame;
+	uint64_t cycle_start_ns;
+	uint64_t cycle_ns;
+
+	uint64_t cycles;
+	uint64_t late_cycles;
+	double cpu_sum_us;
+	double cpu_max_us;
+	uint64_t start_ns;
+	uint64_t end_ns;
+
+	//playback check
+	int locked;
+	uint64_t expected;
+	uint64_t checked_samples;
+	uint64_t error_samples;
+	uint64_t discontinuities;
+	uint64_t silent_cycles;
+	//silent cycles since the last data. only counted once data follows:
+	//the silence after the sender stopped is not an underflow
+	uint64_t silent_run;
+
+	int reported;
+};
+
+static struct _jack_client *clients[4];
+static int client_count=0;
+
+//================================================================
+static uint64_t clock_ns(clockid_t clock)
+{
+	struct timespec ts;
+	clock_gettime(clock,&ts);
+	return (uint64_t)ts.tv_sec*1000000000+ts.tv_nsec;
+}
+
+//================================================================
+static void fill_capture(struct _jack_client *c)
+{
+	int channel=0;
+	int p;
+	for(p=0;p<c->port_count;p++)
+	{
+		struct _jack_port *port=c->ports[p];
+		if(port==NULL || !(port->flags & JackPortIsInput))
+		{
+			continue;
+		}
+
+		test_signal_fill(port->buffer,channel,c->frame,c->period_size);
+		channel++;
+	}
+}
+
+//================================================================
+static void check_playback(struct _jack_client *c)
+{
+	struct _jack_port *first=NULL;
+	int p;
+	for(p=0;p<c->port_count;p++)
+	{
+		if(c->ports[p]!=NULL && (c->ports[p]->flags & JackPortIsOutput))
+		{
+			first=c->ports[p];
+			break;
+		}
+	}
+	if(first==NULL)
+	{
+		return;
+	}
+
+	jack_nframes_t i;
+	int silent=1;
+	for(i=0;i<c->period_size;i++)
+	{
+		if(first->buffer[i]!=0)
+		{
+			silent=0;
+			break;
+		}
+	}
+
+	//buffering or underflow. data continues where it stopped
+	if(silent==1)
+	{
+		if(c->locked==1)
+		{
+			c->silent_run++;
+		}
+		return;
+	}
+	c->silent_cycles+=c->silent_run;
+	c->silent_run=0;
+
+	//(re)lock to the frame position of the first channel
+	int channel_first;
+	uint64_t position;
+	if(test_signal_locate(first->buffer,c->period_size,&channel_first,&position)==1
+		&& (c->locked==0 || position!=c->expected))
+	{
+		if(c->locked==1)
+		{
+			c->discontinuities++;
+		}
+		c->expected=position;
+		c->locked=1;
+	}
+	if(c->locked==0)
+	{
+		return;
+	}
+
+	int channel=0;
+	for(p=0;p<c->port_count;p++)
+	{
+		struct _jack_port *port=c->ports[p];
+		if(port==NULL || !(port->flags & JackPortIsOutput))
+		{
+			continue;
+		}
+
+		c->error_samples+=test_signal_mismatches(port->buffer,channel,c->expected,c->period_size,c->tolerance,NULL);
+		c->checked_samples+=c->period_size;
+		channel++;
+	}
+	c->expected=(c->expected+c->period_size)%TEST_SIGNAL_LENGTH;
+}
+
+//================================================================
+static void report(struct _jack_client *c)
+{
+	if(c->reported==1)
+	{
+		return;
+	}
+	c->reported=1;
+
+	if(c->end_ns==0)
+	{
+		c->end_ns=clock_ns(CLOCK_MONOTONIC);
+	}
+
+	FILE *out=stderr;
+	const char *path=getenv("FAKE_JACK_REPORT");
+	if(path!=NULL)
+	{
+		out=fopen(path,"a");
+		if(out==NULL)
+		{
+			out=stderr;
+		}
+	}
+
+	double wall_s=c->start_ns>0 ? (c->end_ns-c->start_ns)/1e9 : 0;
+	fprintf(out,"client=%s cycles=%llu late=%llu wall_s=%.3f cpu_avg_us=%.2f cpu_max_us=%.2f"
+		" checked=%llu errors=%llu discontinuities=%llu silent=%llu\n",
+		c->name,
+		(unsigned long long)c->cycles,
+		(unsigned long long)c->late_cycles,
+		wall_s,
+		c->cycles>0 ? c->cpu_sum_us/c->cycles : 0,
+		c->cpu_max_us,
+		(unsigned long long)c->checked_samples,
+		(unsigned long long)c->error_samples,
+		(unsigned long long)c->discontinuities,
+		(unsigned long long)c->silent_cycles
+	);
+
+	if(out!=stderr)
+	{
+		fclose(out);
+	}
+}
+
+//================================================================
+static void report_all()
+{
+	int i;
+	for(i=0;i<client_count;i++)
+	{
+		report(clients[i]);
+	}
+}
+
+//================================================================
+static void *cycle_thread(void *arg)
+{
+	struct _jack_client *c=(struct _jack_client*)arg;
+
+	c->start_ns=clock_ns(CLOCK_MONOTONIC);
+	uint64_t next=c->start_ns;
+
+	while(c->running==1)
+	{
+		c->cycle_start_ns=clock_ns(CLOCK_MONOTONIC);
+
+		fill_capture(c);
+
+		uint64_t cpu=clock_ns(CLOCK_THREAD_CPUTIME_ID);
+		if(c->process!=NULL)
+		{
+			c->process(c->period_size,c->process_arg);
+		}
+		double cpu_us=(clock_ns(CLOCK_THREAD_CPUTIME_ID)-cpu)/1000.0;
+
+		check_playback(c);
+
+		c->cycles++;
+		c->cpu_sum_us+=cpu_us;
+		if(cpu_us>c->cpu_max_us)
+		{
+			c->cpu_max_us=cpu_us;
+		}
+		c->frame+=c->period_size;
+
+		if(c->cycle_ns==0)
+		{
+			continue;
+		}
+
+		next+=c->cycle_ns;
+		uint64_t now=clock_ns(CLOCK_MONOTONIC);
+		if(now>next)
+		{
+			//missed the deadline, like an xrun. start over from now
+			c->late_cycles++;
+			if(c->xrun!=NULL)
+			{
+				c->xrun(c->xrun_arg);
+			}
+			next=now;
+			continue;
+		}
+
+		struct timespec ts;
+		ts.tv_sec=next/1000000000;
+		ts.tv_nsec=next%1000000000;
+		clock_nanosleep(CLOCK_MONOTONIC,TIMER_ABSTIME,&ts,NULL);
+	}
+
+	c->end_ns=clock_ns(CLOCK_MONOTONIC);
+	return NULL;
+}
+
+//================================================================
+static int env_int(const char *name, int fallback)
+{
+	const char *value=getenv(name);
+	return value!=NULL ? atoi(value) : fallback;
+}
+
+//================================================================
+static double env_double(const char *name, double fallback)
+{
+	const char *value=getenv(name);
+	return value!=NULL ? atof(value) : fallback;
+}
+
+//================================================================
+jack_client_t *fake_client_open(const char *client_name, jack_options_t options, jack_status_t *status, ...) FAKE(client_open);
+jack_client_t *fake_client_open(const char *client_name, jack_options_t options, jack_status_t *status, ...)
+{
+	if(client_count>=4)
+	{
+		if(status!=NULL)
+		{
+			*status=JackFailure;
+		}
+		return NULL;
+	}
+
+	struct _jack_client *c=calloc(1,sizeof(struct _jack_client));
+	snprintf(c->name,sizeof(c->name),"%s",client_name);
+
+	c->sample_rate=env_int("FAKE_JACK_RATE",48000);
+	c->period_size=env_int("FAKE_JACK_PERIOD",128);
+	c->speed=env_double("FAKE_JACK_SPEED",1);
+	c->tolerance=env_double("FAKE_JACK_TOLERANCE",0);
+
+	if(c->speed>0)
+	{
+		c->cycle_ns=1e9*c->period_size/c->sample_rate/c->speed;
+	}
+
+	clients[client_count++]=c;
+	if(client_count==1)
+	{
+		//programs often exit() without closing the client
+		atexit(report_all);
+	}
+
+	if(status!=NULL)
+	{
+		*status=0;
+	}
+	return c;
+}
+
+//================================================================
+int fake_activate(jack_client_t *client) FAKE(activate);
+int fake_activate(jack_client_t *client)
+{
+	client->running=1;
+	return pthread_create(&client->thread,NULL,cycle_thread,client);
+}
+
+//================================================================
+int fake_deactivate(jack_client_t *client) FAKE(deactivate);
+int fake_deactivate(jack_client_t *client)
+{
+	if(client->running==1)
+	{
+		client->running=0;
+		//don't wait for ourselves (deactivate called from process())
+		if(!pthread_equal(pthread_self(),client->thread))
+		{
+			pthread_join(client->thread,NULL);
+		}
+	}
+	return 0;
+}
+
+//================================================================
+int fake_client_close(jack_client_t *client) FAKE(client_close);
+int fake_client_close(jack_client_t *client)
+{
+	fake_deactivate(client);
+	report(client);
+	return 0;
+}
+
+//================================================================
+char *fake_get_client_name(jack_client_t *client) FAKE(get_client_name);
+char *fake_get_client_name(jack_client_t *client)
+{
+	return client->name;
+}
+
+//================================================================
+jack_nframes_t fake_get_sample_rate(jack_client_t *client) FAKE(get_sample_rate);
+jack_nframes_t fake_get_sample_rate(jack_client_t *client)
+{
+	return client->sample_rate;
+}
+
+//================================================================
+jack_nframes_t fake_get_buffer_size(jack_client_t *client) FAKE(get_buffer_size);
+jack_nframes_t fake_get_buffer_size(jack_client_t *client)
+{
+	return client->period_size;
+}
+
+//================================================================
+jack_nframes_t fake_frames_since_cycle_start(const jack_client_t *client) FAKE(frames_since_cycle_start);
+jack_nframes_t fake_frames_since_cycle_start(const jack_client_t *client)
+{
+	if(client->cycle_ns==0)
+	{
+		return 0;
+	}
+	uint64_t elapsed=clock_ns(CLOCK_MONOTONIC)-client->cycle_start_ns;
+	return (jack_nframes_t)((double)elapsed/client->cycle_ns*client->period_size);
+}
+
+//================================================================
+jack_nframes_t fake_frame_time(const jack_client_t *client) FAKE(frame_time);
+jack_nframes_t fake_frame_time(const jack_client_t *client)
+{
+	return client->frame+fake_frames_since_cycle_start(client);
+}
+
+//================================================================
+jack_nframes_t fake_last_frame_time(const jack_client_t *client) FAKE(last_frame_time);
+jack_nframes_t fake_last_frame_time(const jack_client_t *client)
+{
+	return client->frame;
+}
+
+//================================================================
+jack_time_t fake_get_time() FAKE(get_time);
+jack_time_t fake_get_time()
+{
+	return clock_ns(CLOCK_MONOTONIC)/1000;
+}
+
+//================================================================
+int fake_set_process_callback(jack_client_t *client, JackProcessCallback callback, void *arg) FAKE(set_process_callback);
+int fake_set_process_callback(jack_client_t *client, JackProcessCallback callback, void *arg)
+{
+	client->process=callback;
+	client->process_arg=arg;
+	return 0;
+}
+
+//================================================================
+int fake_set_xrun_callback(jack_client_t *client, JackXRunCallback callback, void *arg) FAKE(set_xrun_callback);
+int fake_set_xrun_callback(jack_client_t *client, JackXRunCallback callback, void *arg)
+{
+	client->xrun=callback;
+	client->xrun_arg=arg;
+	return 0;
+}
+
+//================================================================
+void fake_on_shutdown(jack_client_t *client, JackShutdownCallback callback, void *arg) FAKE(on_shutdown);
+void fake_on_shutdown(jack_client_t *client, JackShutdownCallback callback, void *arg)
+{
+	client->shutdown=callback;
+	client->shutdown_arg=arg;
+}
+
+//================================================================
+jack_port_t *fake_port_register(jack_client_t *client, const char *port_name, const char *port_type,
+	unsigned long flags, unsigned long buffer_size) FAKE(port_register);
+jack_port_t *fake_port_register(jack_client_t *client, const char *port_name, const char *port_type,
+	unsigned long flags, unsigned long buffer_size)
+{
+	if(client->port_count>=MAX_PORTS)
+	{
+		return NULL;
+	}
+
+	struct _jack_port *port=calloc(1,sizeof(struct _jack_port));
+	snprintf(port->name,sizeof(port->name),"%s:%s",client->name,port_name);
+	port->flags=flags;
+	//largest period size JACK supports
+	port->buffer=calloc(8192,sizeof(float));
+
+	client->ports[client->port_count++]=port;
+	return port;
+}
+
+//================================================================
+int fake_port_unregister(jack_client_t *client, jack_port_t *port) FAKE(port_unregister);
+int fake_port_unregister(jack_client_t *client, jack_port_t *port)
+{
+	int p;
+	for(p=0;p<client->port_count;p++)
+	{
+		if(client->ports[p]==port)
+		{
+			//buffer stays valid, process() might still hold it
+			client->ports[p]=NULL;
+		}
+	}
+	return 0;
+}
+
+//================================================================
+void *fake_port_get_buffer(jack_port_t *port, jack_nframes_t nframes) FAKE(port_get_buffer);
+void *fake_port_get_buffer(jack_port_t *port, jack_nframes_t nframes)
+{
+	return port->buffer;
+}
+
+//================================================================
+const char *fake_port_name(const jack_port_t *port) FAKE(port_name);
+const char *fake_port_name(const jack_port_t *port)
+{
+	return port->name;
+}
+
+//================================================================
+//no other clients, nothing to autoconnect
+const char **fake_get_ports(jack_client_t *client, const char *port_name_pattern,
+	const char *type_name_pattern, unsigned long flags) FAKE(get_ports);
+const char **fake_get_ports(jack_client_t *client, const char *port_name_pattern,
+	const char *type_name_pattern, unsigned long flags)
+{
+	return NULL;
+}
+
+//================================================================
+int fake_connect(jack_client_t *client, const char *source_port, const char *destination_port) FAKE(connect);
+int fake_connect(jack_client_t *client, const char *source_port, const char *destination_port)
+{
+	return 0;
+}
+
+//================================================================
+void fake_free(void *ptr) FAKE(free);
+void fake_free(void *ptr)
+{
+	free(ptr);
+}
+
+//================================================================
+float fake_cpu_load(jack_client_t *client) FAKE(cpu_load);
+float fake_cpu_load(jack_client_t *client)
+{
+	if(client->cycles==0 || client->cycle_ns==0)
+	{
+		return 0;
+	}
+	return 100*(client->cpu_sum_us*1000/client->cycles)/client->cycle_ns;
+}
@@ -0,0 +1,42 @@
+/* part of audio_rxtx
+ *
+ * This program is free software; feel free to redistribute it and/or
+ * modify it.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. bla.
+*/
+
+//weak no-op versions of every function weak_libjack looks up,
+//so that it finds all required symbols in fake_jack (libjack.so.0).
+//fake_jack.c overrides the ones that are actually used.
+
+#include <string.h>
+
+#define USE_WEAK_JACK 1
+#include "weak_libjack.h"
+
+#define JCFUN(ERR, RTYPE, NAME, RVAL) \
+	RTYPE stub_ ## NAME (jack_client_t *client) __asm__("jack_" #NAME) __attribute__((weak)); \
+	RTYPE stub_ ## NAME (jack_client_t *client) { return RVAL; }
+
+#define JPFUN(ERR, RTYPE, NAME, DEF, ARGS, RVAL) \
+	RTYPE stub_ ## NAME DEF __asm__("jack_" #NAME) __attribute__((weak)); \
+	RTYPE stub_ ## NAME DEF { return RVAL; }
+
+//CODE may call other (renamed) jack functions, return zeroed value instead
+#define JXFUN(ERR, RTYPE, NAME, DEF, ARGS, CODE) \
+	RTYPE stub_ ## NAME DEF __asm__("jack_" #NAME) __attribute__((weak)); \
+	RTYPE stub_ ## NAME DEF { RTYPE r; memset(&r,0,sizeof(r)); return r; }
+
+#define JVFUN(ERR, NAME, DEF, ARGS, CODE) \
+	void stub_ ## NAME DEF __asm__("jack_" #NAME) __attribute__((weak)); \
+	void stub_ ## NAME DEF { }
+
+#include "weak_libjack.def"
+
+#undef JCFUN
+#undef JPFUN
+#undef JXFUN
+#undef JVFUN
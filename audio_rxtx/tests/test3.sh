@@ -0,0 +1,141 @@
+#!/bin/bash
+
+#//stress test live resizing of the receiver ringbuffer
+#//send /buffer ii with random sizes while streaming the test signal (--testsig / --check).
+#//the receiver must survive without underflows, overflows or corrupted periods, and its memory must not grow.
+#///buffer also moves the fill to the pre-buffer size (FILL / DROP), so missing and silent periods are expected.
+
+OSC_PORT1=9998
+OSC_PORT2=9999
+
+CHANNEL_COUNT=8
+RESIZE_COUNT=500
+#constant pre-buffer, far from an underflow
+PRE=20
+#max. growth of the receiver's RSS in kB over all resizes
+MAX_RSS_GROWTH_KB=4096
+OUTPUT_DIR=/tmp/audio_rxtx_test_logs
+
+#AUDIO_RXTX_OPTS="--16"
+
+function checkAvail()
+{
+	which "$1" >/dev/null 2>&1
+	ret=$?
+	if [ $ret -ne 0 ]
+	then
+		echo "tool \"$1\" not found. please install"
+		exit 1
+	fi
+}
+
+for tool in {jackd,jack_audio_send,jack_audio_receive,oscsend}; \
+	do checkAvail "$tool"; done
+
+echo "creating output dir $OUTPUT_DIR (if not existing)"
+mkdir -p "$OUTPUT_DIR"
+LOG="$OUTPUT_DIR/test3_receive.log"
+
+echo "starting dummy jack 'audio_rxtx'"
+jackd -n audio_rxtx -d dummy -r44100 -p128 >/dev/null 2>&1 &
+JACKD_PID=$!
+
+sleep 1
+
+echo "starting jack_audio_send ($CHANNEL_COUNT channels)"
+JACK_DEFAULT_SERVER=audio_rxtx jack_audio_send $AUDIO_RXTX_OPTS --testsig --quiet --lport $OSC_PORT1 "--in" $CHANNEL_COUNT localhost $OSC_PORT2 >/dev/null 2>&1 &
+JACK_AUDIO_SEND_PID=$!
+
+echo "starting jack_audio_receive ($CHANNEL_COUNT channels), log: $LOG"
+JACK_DEFAULT_SERVER=audio_rxtx jack_audio_receive $AUDIO_RXTX_OPTS --check --quiet --out $CHANNEL_COUNT $OSC_PORT2 >"$LOG" 2>&1 &
+JACK_AUDIO_RECEIVE_PID=$!
+
+function rss_kb()
+{
+	grep "^VmRSS" /proc/$JACK_AUDIO_RECEIVE_PID/status | awk '{print $2}'
+}
+
+sleep 2
+
+echo "sending $RESIZE_COUNT /buffer messages"
+for i in `seq 1 $RESIZE_COUNT`
+do
+	#room for the pre-buffer plus jitter, so the buffer never overflows
+	MAX=$(( PRE + 20 + (RANDOM % 200) ))
+	oscsend localhost $OSC_PORT2 /buffer ii $PRE $MAX
+
+	#memory after the first round of resizes (all sizes seen once)
+	if [ $i -eq 100 ]
+	then
+		RSS_START=`rss_kb`
+	fi
+
+	#let some cycles pass now and then, mostly hammer
+	if [ $(( i % 50 )) -eq 0 ]
+	then
+		sleep 0.2
+	fi
+
+	kill -0 $JACK_AUDIO_RECEIVE_PID 2>/dev/null
+	if [ $? -ne 0 ]
+	then
+		break
+	fi
+done
+
+sleep 1
+
+kill -0 $JACK_AUDIO_RECEIVE_PID 2>/dev/null
+RECEIVE_ALIVE=$?
+RSS_END=`rss_kb`
+
+echo "shutting down / killing programs"
+kill -9 $JACK_AUDIO_SEND_PID
+#receiver prints counters and the check summary on exit
+kill $JACK_AUDIO_RECEIVE_PID
+wait $JACK_AUDIO_RECEIVE_PID 2>/dev/null
+kill -9 $JACKD_PID
+
+if [ $RECEIVE_ALIVE -ne 0 ]
+then
+	echo "FAILED: jack_audio_receive died during resize (see $LOG)"
+	exit 1
+fi
+
+echo "resizes done: `grep -c "new ringbuffer size" "$LOG"`"
+grep "^buffer underflows\|^check: [0-9]" "$LOG"
+echo "RSS after 100 resizes: $RSS_START kB, at end: $RSS_END kB"
+
+FAILED=0
+function expect_zero()
+{
+	#expect_zero <description> <value>
+	if [ "$2" != "0" ]
+	then
+		echo "FAILED: $1: ${2:-not reported}"
+		FAILED=1
+	fi
+}
+
+COUNTERS=`grep "^buffer underflows" "$LOG"`
+expect_zero "buffer underflows" `echo "$COUNTERS" | awk '{print $3}' | tr -d ,`
+expect_zero "buffer overflows" `echo "$COUNTERS" | awk '{print $6}'`
+SUMMARY=`grep "^check: [0-9]" "$LOG"`
+expect_zero "repeated periods" `echo "$SUMMARY" | grep "periods checked" | awk '{print $7}'`
+expect_zero "swapped channels" `echo "$SUMMARY" | grep "discontinuities" | awk '{print $4}'`
+expect_zero "wrong samples" `echo "$SUMMARY" | grep "discontinuities" | awk '{print $7}'`
+
+if [ -z "$RSS_START" ] || [ -z "$RSS_END" ] || [ $(( RSS_END - RSS_START )) -gt $MAX_RSS_GROWTH_KB ]
+then
+	echo "FAILED: receiver memory grew from $RSS_START kB to $RSS_END kB"
+	FAILED=1
+fi
+
+if [ $FAILED -ne 0 ]
+then
+	echo "see $LOG"
+	exit 1
+fi
+
+echo "done!"
+exit 0
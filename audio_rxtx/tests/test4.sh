@@ -0,0 +1,84 @@
+#!/bin/bash
+
+#//compare drops on a slow link with a small queue, with and without --pace
+#//udp_shaper forwards sender -> receiver at LINK_KBITS, tail drop if queue is full
+#//udp_shaper only sees whole datagrams. unpaced, a message is one large datagram (IP fragments on a real link).
+#//paced, it is split into /audio_frag datagrams <= 1452 bytes, each one paced. compare drops and peak queue.
+
+OSC_PORT1=9998
+OSC_PORT2=9999
+SHAPER_PORT=9997
+
+CHANNEL_COUNT=16
+#~1.5 x 16 channels 32 bit float at 44100
+LINK_KBITS=35000
+#bytes, room for about one message, back-to-back messages get dropped
+QUEUE_BYTES=12000
+RUN_SECONDS=10
+OUTPUT_DIR=/tmp/audio_rxtx_test_logs
+
+#AUDIO_RXTX_OPTS="--16"
+
+function checkAvail()
+{
+	which "$1" >/dev/null 2>&1
+	ret=$?
+	if [ $ret -ne 0 ]
+	then
+		echo "tool \"$1\" not found. please install"
+		exit 1
+	fi
+}
+
+for tool in {jackd,jack_audio_send,jack_audio_receive,gcc}; \
+	do checkAvail "$tool"; done
+
+echo "creating output dir $OUTPUT_DIR (if not existing)"
+mkdir -p "$OUTPUT_DIR"
+
+DIR=`dirname "$0"`
+SHAPER="$OUTPUT_DIR/udp_shaper"
+echo "compiling udp_shaper"
+gcc -O2 -o "$SHAPER" "$DIR/udp_shaper.c" || exit 1
+
+echo "starting dummy jack 'audio_rxtx'"
+jackd -n audio_rxtx -d dummy -r44100 -p128 >/dev/null 2>&1 &
+JACKD_PID=$!
+
+sleep 1
+
+function run()
+{
+	NAME="$1"
+	shift
+
+	"$SHAPER" $SHAPER_PORT $OSC_PORT2 $LINK_KBITS $QUEUE_BYTES >"$OUTPUT_DIR/test4_shaper_$NAME.log" 2>&1 &
+	SHAPER_PID=$!
+
+	JACK_DEFAULT_SERVER=audio_rxtx jack_audio_receive $AUDIO_RXTX_OPTS --quiet --out $CHANNEL_COUNT $OSC_PORT2 >/dev/null 2>&1 &
+	JACK_AUDIO_RECEIVE_PID=$!
+
+	JACK_DEFAULT_SERVER=audio_rxtx jack_audio_send $AUDIO_RXTX_OPTS "$@" --quiet --lport $OSC_PORT1 "--in" $CHANNEL_COUNT localhost $SHAPER_PORT >/dev/null 2>&1 &
+	JACK_AUDIO_SEND_PID=$!
+
+	sleep $RUN_SECONDS
+
+	kill -9 $JACK_AUDIO_SEND_PID
+	kill -9 $JACK_AUDIO_RECEIVE_PID
+	kill $SHAPER_PID
+	wait $SHAPER_PID 2>/dev/null
+
+	echo "$NAME: `cat "$OUTPUT_DIR/test4_shaper_$NAME.log"`"
+}
+
+echo "running $RUN_SECONDS seconds unpaced"
+run unpaced
+
+echo "running $RUN_SECONDS seconds paced"
+run paced --pace 0
+
+echo "shutting down / killing programs"
+kill -9 $JACKD_PID
+
+echo "done!"
+exit 0
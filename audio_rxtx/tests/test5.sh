@@ -0,0 +1,67 @@
+#!/bin/bash
+
+#//sample-exact check of the transmission with jack_audio_send --testsig / jack_audio_receive --check
+#//first run clean, then drop every 50th message at the sender. the checker must report the missing periods
+
+OSC_PORT1=9998
+OSC_PORT2=9999
+
+CHANNEL_COUNT=64
+RUN_SECONDS=10
+OUTPUT_DIR=/tmp/audio_rxtx_test_logs
+
+#AUDIO_RXTX_OPTS="--16"
+
+function checkAvail()
+{
+	which "$1" >/dev/null 2>&1
+	ret=$?
+	if [ $ret -ne 0 ]
+	then
+		echo "tool \"$1\" not found. please install"
+		exit 1
+	fi
+}
+
+for tool in {jackd,jack_audio_send,jack_audio_receive}; \
+	do checkAvail "$tool"; done
+
+echo "creating output dir $OUTPUT_DIR (if not existing)"
+mkdir -p "$OUTPUT_DIR"
+
+echo "starting dummy jack 'audio_rxtx'"
+jackd -n audio_rxtx -d dummy -r44100 -p128 >/dev/null 2>&1 &
+JACKD_PID=$!
+
+sleep 1
+
+function run()
+{
+	NAME="$1"
+	shift
+
+	JACK_DEFAULT_SERVER=audio_rxtx jack_audio_receive $AUDIO_RXTX_OPTS --check --quiet --out $CHANNEL_COUNT $OSC_PORT2 >"$OUTPUT_DIR/test5_receive_$NAME.log" 2>&1 &
+	JACK_AUDIO_RECEIVE_PID=$!
+
+	JACK_DEFAULT_SERVER=audio_rxtx jack_audio_send $AUDIO_RXTX_OPTS "$@" --testsig --quiet --lport $OSC_PORT1 "--in" $CHANNEL_COUNT localhost $OSC_PORT2 >/dev/null 2>&1 &
+	JACK_AUDIO_SEND_PID=$!
+
+	sleep $RUN_SECONDS
+
+	kill -9 $JACK_AUDIO_SEND_PID
+	#receiver prints the check summary on exit
+	kill $JACK_AUDIO_RECEIVE_PID
+	wait $JACK_AUDIO_RECEIVE_PID 2>/dev/null
+
+	echo "$NAME:"
+	grep "^check: [0-9]" "$OUTPUT_DIR/test5_receive_$NAME.log"
+}
+
+echo "running $RUN_SECONDS seconds clean (expecting no errors)"
+run clean
+
+echo "running $RUN_SECONDS seconds dropping every 50th message (expecting missing periods)"
+run drop --drop 50
+
+echo "shutting down / killing programs"
+kill -9 $JACKD_PID
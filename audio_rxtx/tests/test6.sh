@@ -0,0 +1,78 @@
+#!/bin/bash
+
+#//restart a paced sender (/audio_frag) against a running receiver
+#//the fragment ids of the new sender start at 1 again, the receiver must follow right away.
+#//jack_audio_receive --check counts the periods that arrived in both runs
+
+OSC_PORT1=9998
+OSC_PORT2=9999
+
+CHANNEL_COUNT=16
+RUN_SECONDS=5
+SAMPLE_RATE=44100
+PERIOD=128
+OUTPUT_DIR=/tmp/audio_rxtx_test_logs
+
+#AUDIO_RXTX_OPTS="--16"
+
+function checkAvail()
+{
+	which "$1" >/dev/null 2>&1
+	ret=$?
+	if [ $ret -ne 0 ]
+	then
+		echo "tool \"$1\" not found. please install"
+		exit 1
+	fi
+}
+
+for tool in {jackd,jack_audio_send,jack_audio_receive}; \
+	do checkAvail "$tool"; done
+
+echo "creating output dir $OUTPUT_DIR (if not existing)"
+mkdir -p "$OUTPUT_DIR"
+
+echo "starting dummy jack 'audio_rxtx'"
+jackd -n audio_rxtx -d dummy -r$SAMPLE_RATE -p$PERIOD >/dev/null 2>&1 &
+JACKD_PID=$!
+
+sleep 1
+
+JACK_DEFAULT_SERVER=audio_rxtx jack_audio_receive $AUDIO_RXTX_OPTS --check --quiet --out $CHANNEL_COUNT $OSC_PORT2 >"$OUTPUT_DIR/test6_receive.log" 2>&1 &
+JACK_AUDIO_RECEIVE_PID=$!
+
+for run in 1 2
+do
+	echo "paced sender run $run, $RUN_SECONDS seconds"
+	#--pace 0: 1.5 x data rate, messages are larger than one datagram and go as /audio_frag
+	JACK_DEFAULT_SERVER=audio_rxtx jack_audio_send $AUDIO_RXTX_OPTS --pace 0 --testsig --quiet --lport $OSC_PORT1 "--in" $CHANNEL_COUNT localhost $OSC_PORT2 >/dev/null 2>&1 &
+	JACK_AUDIO_SEND_PID=$!
+
+	sleep $RUN_SECONDS
+
+	kill -9 $JACK_AUDIO_SEND_PID
+	wait $JACK_AUDIO_SEND_PID 2>/dev/null
+	sleep 1
+done
+
+#receiver prints the check summary on exit
+kill $JACK_AUDIO_RECEIVE_PID
+wait $JACK_AUDIO_RECEIVE_PID 2>/dev/null
+
+echo "shutting down / killing programs"
+kill -9 $JACKD_PID
+
+grep "^check: [0-9]" "$OUTPUT_DIR/test6_receive.log"
+
+CHECKED=`grep "periods checked" "$OUTPUT_DIR/test6_receive.log" | awk '{print $2}'`
+#both runs minus one second of startup each
+EXPECTED=$(( 2 * (RUN_SECONDS - 1) * SAMPLE_RATE / PERIOD ))
+if [ -z "$CHECKED" ] || [ "$CHECKED" -lt $EXPECTED ]
+then
+	echo "FAIL: ${CHECKED:-0} periods checked, expected at least $EXPECTED (audio after restart missing?)"
+	exit 1
+fi
+
+echo "OK: $CHECKED periods checked (at least $EXPECTED expected)"
+echo "done!"
+exit 0
@@ -0,0 +1,153 @@
+/* part of audio_rxtx
+ *
+ * This program is free software; feel free to redistribute it and/or
+ * modify it.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. bla.
+*/
+
+//unit test for pcm24.c: scalar and SSSE3 variants must give identical results,
+//round trip must be exact to 1/8388607, nothing may be written past nframes.
+//make test
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "../src/pcm24.h"
+
+#define MAX_FRAMES 1030
+#define GUARD 32
+
+static int checks=0;
+static int failed=0;
+
+#define CHECK(cond, ...) \
+	do { checks++; if(!(cond)) { failed++; fprintf(stderr, "FAIL %s:%d: ", __FILE__, __LINE__); \
+	fprintf(stderr, __VA_ARGS__); fprintf(stderr, "\n"); } } while(0)
+
+static float in[MAX_FRAMES];
+static unsigned char pcm[2][3*MAX_FRAMES+GUARD];
+static float out[2][MAX_FRAMES+GUARD];
+
+//=========================================================
+static void fill_input()
+{
+	int i;
+	for(i=0;i<MAX_FRAMES;i++)
+	{
+		in[i]=2.2f*((float)rand()/RAND_MAX)-1.1f;
+	}
+	//edges and out of range values at positions covered by the SIMD loop and by the tail
+	int k;
+	for(k=0;k<2;k++)
+	{
+		int o=(k==0) ? 0 : MAX_FRAMES-9;
+		in[o]=1.0f;
+		in[o+1]=-1.0f;
+		in[o+2]=0.0f;
+		in[o+3]=-0.0f;
+		in[o+4]=1e9f;
+		in[o+5]=-1e9f;
+		in[o+6]=NAN;
+		in[o+7]=0.5f/8388607.0f;
+		in[o+8]=1.5f/8388607.0f;
+	}
+}
+
+//=========================================================
+//variant 0: scalar, 1: SSSE3
+static void convert(int variant, int nframes)
+{
+	memset(pcm[variant],0xA5,sizeof(pcm[variant]));
+	memset(out[variant],0xA5,sizeof(out[variant]));
+	pcm24_use_ssse3=variant;
+	float_to_pcm24(in,pcm[variant],nframes);
+	pcm24_to_float(pcm[variant],out[variant],nframes);
+}
+
+//=========================================================
+static void test_variant(int variant, int nframes)
+{
+	int i;
+	convert(variant,nframes);
+	for(i=3*nframes;i<(int)sizeof(pcm[variant]);i++)
+	{
+		CHECK(pcm[variant][i]==0xA5,"variant %d nframes %d: pcm written past end at byte %d",variant,nframes,i);
+	}
+	for(i=nframes;i<MAX_FRAMES+GUARD;i++)
+	{
+		unsigned char *b=(unsigned char*)&out[variant][i];
+		CHECK(b[0]==0xA5 && b[3]==0xA5,"variant %d nframes %d: float written past end at %d",variant,nframes,i);
+	}
+	for(i=0;i<nframes;i++)
+	{
+		float expect=isnan(in[i]) ? -1.0f : fminf(fmaxf(in[i],-1.0f),1.0f);
+		CHECK(fabsf(out[variant][i]-expect)<=0.5f/8388607.0f+1e-7f
+			,"variant %d nframes %d: round trip at %d: %.9f -> %.9f",variant,nframes,i,in[i],out[variant][i]);
+		CHECK(out[variant][i]>=-1.0f && out[variant][i]<=1.0f
+			,"variant %d nframes %d: out of range at %d: %.9f",variant,nframes,i,out[variant][i]);
+	}
+}
+
+//=========================================================
+static void test_decode_all_extremes()
+{
+	//every variant must map -8388608 (not produced by float_to_pcm24) to -1
+	unsigned char p[3*16];
+	float f[2][16];
+	int variant;
+	int i;
+	for(i=0;i<16;i++)
+	{
+		int32_t v=(i%2) ? -8388608 : 8388607-i;
+		p[3*i]=v;
+		p[3*i+1]=v>>8;
+		p[3*i+2]=v>>16;
+	}
+	for(variant=0;variant<=pcm24_have_ssse3();variant++)
+	{
+		pcm24_use_ssse3=variant;
+		pcm24_to_float(p,f[variant],16);
+		for(i=0;i<16;i++)
+		{
+			float expect=(i%2) ? -1.0f : (float)(8388607-i)*(1.0f/8388607.0f);
+			CHECK(f[variant][i]==expect,"variant %d: decode at %d: %.9f != %.9f",variant,i,f[variant][i],expect);
+		}
+	}
+}
+
+//=========================================================
+int main()
+{
+	int have=pcm24_have_ssse3();
+	int nframes;
+	int round;
+
+	fprintf(stderr,"SSSE3: %s, selected at startup: %d\n",have ? "yes" : "no (scalar only)",pcm24_use_ssse3);
+	CHECK(pcm24_use_ssse3==have,"startup selection %d != cpu support %d",pcm24_use_ssse3,have);
+
+	srand(161020);
+	for(round=0;round<4;round++)
+	{
+		fill_input();
+		for(nframes=0;nframes<=MAX_FRAMES;nframes+=(nframes<40) ? 1 : 33)
+		{
+			test_variant(0,nframes);
+			if(!have)
+			{
+				continue;
+			}
+			test_variant(1,nframes);
+			CHECK(memcmp(pcm[0],pcm[1],sizeof(pcm[0]))==0,"nframes %d: scalar and SSSE3 pcm differ",nframes);
+			CHECK(memcmp(out[0],out[1],sizeof(out[0]))==0,"nframes %d: scalar and SSSE3 float differ",nframes);
+		}
+	}
+	test_decode_all_extremes();
+
+	fprintf(stderr,"%d checks, %d failed\n",checks,failed);
+	return failed ? 1 : 0;
+}
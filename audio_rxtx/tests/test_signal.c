@@ -0,0 +1,181 @@
+/* part of audio_rxtx
+ *
+ * This program is free software; feel free to redistribute it and/or
+ * modify it.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. bla.
+*/
+
+//unit test for test_signal.h: every 4 samples must give back channel and position,
+//also after a 16 bit round trip. no sample is 0 (silence).
+//the SSE2 comparison must count like the scalar one and keep up with 512 channels at 48 kHz.
+//make test
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "../src/test_signal.h"
+
+#define NFRAMES 64
+
+static int checks=0;
+static int failed=0;
+
+#define CHECK(cond, ...) \
+	do { checks++; if(!(cond)) { failed++; fprintf(stderr, "FAIL %s:%d: ", __FILE__, __LINE__); \
+	fprintf(stderr, __VA_ARGS__); fprintf(stderr, "\n"); } } while(0)
+
+//=========================================================
+static void round_trip_16(float *buffer, int nframes)
+{
+	int i;
+	for(i=0;i<nframes;i++)
+	{
+		buffer[i]=lrintf(buffer[i]*32767)/32767.0f;
+	}
+}
+
+//=========================================================
+static void test_locate(int channel, uint64_t frame, int bytes_per_sample)
+{
+	float buffer[NFRAMES];
+	test_signal_fill(buffer,channel,frame,NFRAMES);
+	if(bytes_per_sample==2)
+	{
+		round_trip_16(buffer,NFRAMES);
+	}
+
+	int i;
+	int zero=0;
+	for(i=0;i<NFRAMES;i++)
+	{
+		zero+=(buffer[i]==0);
+	}
+	CHECK(zero==0,"channel %d frame %llu: %d silent sample(s)",channel,(unsigned long long)frame,zero);
+
+	int located_channel=-1;
+	uint64_t located_frame=0;
+	int located=test_signal_locate(buffer,NFRAMES,&located_channel,&located_frame);
+	CHECK(located==1 && located_channel==channel && located_frame==frame%TEST_SIGNAL_LENGTH
+		,"channel %d frame %llu (%d bytes): located %d channel %d frame %llu"
+		,channel,(unsigned long long)frame,bytes_per_sample,located,located_channel,(unsigned long long)located_frame);
+
+	CHECK(test_signal_mismatches(buffer,channel,frame,NFRAMES,test_signal_tolerance(bytes_per_sample),NULL)==0
+		,"channel %d frame %llu (%d bytes): mismatches",channel,(unsigned long long)frame,bytes_per_sample);
+
+	//neighbour channel and a shifted position must not match
+	CHECK(test_signal_mismatches(buffer,channel+1,frame,NFRAMES,test_signal_tolerance(bytes_per_sample),NULL)>=NFRAMES/2
+		,"channel %d frame %llu: matches channel %d",channel,(unsigned long long)frame,channel+1);
+	CHECK(test_signal_mismatches(buffer,channel,frame+NFRAMES,NFRAMES,test_signal_tolerance(bytes_per_sample),NULL)>=NFRAMES/2
+		,"channel %d frame %llu: matches one period later",channel,(unsigned long long)frame);
+}
+
+//=========================================================
+//damaged period at any alignment: both comparisons must agree, also on the first mismatch
+static void test_kernel(int channel, uint64_t frame, int nframes, int errors)
+{
+	float buffer[NFRAMES];
+	test_signal_fill(buffer,channel,frame,nframes);
+	int i;
+	for(i=0;i<errors;i++)
+	{
+		buffer[rand()%nframes]+=0.01f;
+	}
+
+	int first_scalar=-1;
+	int first=-1;
+	int scalar=test_signal_mismatches_scalar(buffer,channel,frame,nframes,0,&first_scalar);
+	int vector=test_signal_mismatches(buffer,channel,frame,nframes,0,&first);
+	CHECK(scalar==vector && first_scalar==first
+		,"channel %d frame %llu nframes %d: scalar %d (first %d), vector %d (first %d)"
+		,channel,(unsigned long long)frame,nframes,scalar,first_scalar,vector,first);
+}
+
+//=========================================================
+static volatile int sink;
+
+static double seconds_per_check(int (*check)(const float*, int, uint64_t, int, float, int*),
+	const float *buffers, int channels, int nframes, int periods)
+{
+	struct timespec start, end;
+	clock_gettime(CLOCK_MONOTONIC,&start);
+	int mismatches=0;
+	int p, c;
+	for(p=0;p<periods;p++)
+	{
+		for(c=0;c<channels;c++)
+		{
+			mismatches+=check(buffers+c*nframes,c,(uint64_t)p*nframes,nframes,0,NULL);
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC,&end);
+	//keep the result alive. the buffers hold the first period only, later ones mismatch
+	sink+=mismatches;
+	return (end.tv_sec-start.tv_sec)+(end.tv_nsec-start.tv_nsec)/1e9;
+}
+
+//=========================================================
+//one second of 512 channels at 48 kHz, 128 frames per period, must take well below one second
+static void test_throughput()
+{
+	const int channels=512;
+	const int nframes=128;
+	const int periods=48000/nframes;
+
+	float *buffers=malloc(channels*nframes*sizeof(float));
+	int c;
+	for(c=0;c<channels;c++)
+	{
+		test_signal_fill(buffers+c*nframes,c,0,nframes);
+	}
+
+	double scalar=seconds_per_check(test_signal_mismatches_scalar,buffers,channels,nframes,periods);
+	double vector=seconds_per_check(test_signal_mismatches,buffers,channels,nframes,periods);
+	fprintf(stderr,"512 ch x 48 kHz: scalar %.1f ms, vector %.1f ms per second of audio\n",scalar*1000,vector*1000);
+	//checker thread shares the machine with JACK
+	CHECK(vector<0.25,"comparison too slow for 512 channels: %.3f s per second",vector);
+
+	free(buffers);
+}
+
+//=========================================================
+int main()
+{
+	int round;
+
+	srand(161020);
+	for(round=0;round<100000;round++)
+	{
+		int channel=rand()%1024;
+		uint64_t frame=((uint64_t)rand()*rand())%(3*TEST_SIGNAL_LENGTH);
+		test_locate(channel,frame,(round%2) ? 2 : 4);
+	}
+
+	//edges
+	test_locate(0,0,4);
+	test_locate(0,TEST_SIGNAL_LENGTH-1,4);
+	test_locate(TEST_SIGNAL_MAX_CHANNELS-1,TEST_SIGNAL_LENGTH-2,2);
+
+	for(round=0;round<100000;round++)
+	{
+		test_kernel(rand()%1024,((uint64_t)rand()*rand())%(3*TEST_SIGNAL_LENGTH),1+rand()%NFRAMES,rand()%3);
+	}
+	test_kernel(TEST_SIGNAL_MAX_CHANNELS-1,TEST_SIGNAL_LENGTH-3,NFRAMES,0);
+
+	test_throughput();
+
+	//a filled period continues exactly where the previous one ended
+	float a[2*NFRAMES];
+	float b[NFRAMES];
+	test_signal_fill(a,5,1001,2*NFRAMES);
+	test_signal_fill(b,5,1001+NFRAMES,NFRAMES);
+	CHECK(memcmp(a+NFRAMES,b,sizeof(b))==0,"fill not continuous");
+
+	fprintf(stderr,"%d checks, %d failed\n",checks,failed);
+	return failed ? 1 : 0;
+}
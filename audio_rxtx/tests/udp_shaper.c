@@ -0,0 +1,276 @@
+/* part of audio_rxtx
+ *
+ * This program is free software; feel free to redistribute it and/or 
+ * modify it.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. bla.
+*/
+
+//netem-like udp forwarder for test4.sh
+//models a link with a fixed rate and a small queue (bytes).
+//datagrams that don't fit the queue are dropped (tail drop).
+//optional impairments (bench.sh): random loss, jitter and reordering
+//before the link. fixed seed, runs are repeatable.
+//gcc -o udp_shaper udp_shaper.c
+//udp_shaper <listen port> <forward port> <link kbit/s> <queue bytes> [loss % [jitter ms [reorder %]]]
+//link kbit/s 0: unlimited
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#define MAX_DGRAM 65536
+#define MAX_QUEUE 4096
+
+typedef struct
+{
+	int len;
+	char *data;
+} dgram_t;
+
+dgram_t queue[MAX_QUEUE];
+int queue_head=0;
+int queue_count=0;
+int queue_bytes=0;
+
+//datagrams held back by jitter / reordering, unordered
+dgram_t delayed[MAX_QUEUE];
+double delayed_until[MAX_QUEUE];
+int delayed_count=0;
+
+unsigned long received=0;
+unsigned long forwarded=0;
+unsigned long dropped=0;
+unsigned long lost=0;
+unsigned long reordered=0;
+//highest queue fill seen. bursts above the link rate show up here
+//(only datagrams are visible, not the IP fragments of a large one)
+int queue_bytes_peak=0;
+
+volatile int done=0;
+
+//================================================================
+static void signal_handler(int sig)
+{
+	done=1;
+}
+
+//================================================================
+static double now_s()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec+ts.tv_nsec/1e9;
+}
+
+//================================================================
+//0..1
+static double random_unit()
+{
+	return (double)rand()/RAND_MAX;
+}
+
+//================================================================
+//add to link queue, tail drop if full
+static void enqueue(char *data, int len, int queue_limit)
+{
+	if(queue_bytes+len>queue_limit || queue_count>=MAX_QUEUE)
+	{
+		free(data);
+		dropped++;
+		return;
+	}
+
+	dgram_t *d=&queue[(queue_head+queue_count)%MAX_QUEUE];
+	d->data=data;
+	d->len=len;
+	queue_bytes+=len;
+	if(queue_bytes>queue_bytes_peak)
+	{
+		queue_bytes_peak=queue_bytes;
+	}
+	queue_count++;
+}
+
+//================================================================
+//move due datagrams to the link queue, earliest first
+static void release_delayed(double now, int queue_limit)
+{
+	while(delayed_count>0)
+	{
+		int first=0;
+		int i;
+		for(i=1;i<delayed_count;i++)
+		{
+			if(delayed_until[i]<delayed_until[first])
+			{
+				first=i;
+			}
+		}
+		if(delayed_until[first]>now)
+		{
+			return;
+		}
+
+		enqueue(delayed[first].data,delayed[first].len,queue_limit);
+
+		delayed_count--;
+		delayed[first]=delayed[delayed_count];
+		delayed_until[first]=delayed_until[delayed_count];
+	}
+}
+
+//================================================================
+int main(int argc, char *argv[])
+{
+	if(argc<5)
+	{
+		fprintf(stderr,"usage: udp_shaper <listen port> <forward port> <link kbit/s> <queue bytes> [loss %% [jitter ms [reorder %%]]]\n");
+		return 1;
+	}
+
+	int listen_port=atoi(argv[1]);
+	int forward_port=atoi(argv[2]);
+	//bytes per second
+	double link_rate=atof(argv[3])*1000/8;
+	int queue_limit=atoi(argv[4]);
+
+	double loss=argc>5 ? atof(argv[5])/100 : 0;
+	double jitter=argc>6 ? atof(argv[6])/1000 : 0;
+	double reorder=argc>7 ? atof(argv[7])/100 : 0;
+	//reordered datagrams are overtaken by the following ones
+	double reorder_delay=jitter>0 ? 2*jitter : 0.001;
+
+	srand(1);
+
+	int fd=socket(AF_INET,SOCK_DGRAM,0);
+	struct sockaddr_in addr;
+	memset(&addr,0,sizeof(addr));
+	addr.sin_family=AF_INET;
+	addr.sin_addr.s_addr=htonl(INADDR_LOOPBACK);
+	addr.sin_port=htons(listen_port);
+	if(bind(fd,(struct sockaddr*)&addr,sizeof(addr))!=0)
+	{
+		perror("bind");
+		return 1;
+	}
+
+	struct sockaddr_in fwd=addr;
+	fwd.sin_port=htons(forward_port);
+
+	//replies from the receiver go back to the last sender
+	struct sockaddr_in from;
+	socklen_t from_len=sizeof(from);
+	int have_from=0;
+
+	int fd_back=socket(AF_INET,SOCK_DGRAM,0);
+
+	signal(SIGINT,signal_handler);
+	signal(SIGTERM,signal_handler);
+
+	char buf[MAX_DGRAM];
+	//time when the head of the queue has left the link
+	double link_free_at=now_s();
+
+	struct pollfd pfd[2]={{fd,POLLIN,0},{fd_back,POLLIN,0}};
+
+	while(!done)
+	{
+		double now=now_s();
+
+		release_delayed(now,queue_limit);
+
+		//serialize queued datagrams onto the link
+		while(queue_count>0 && link_free_at<=now)
+		{
+			dgram_t *d=&queue[queue_head];
+			sendto(fd_back,d->data,d->len,0,(struct sockaddr*)&fwd,sizeof(fwd));
+			//back-to-back if the link was busy until recently (poll granularity), else start now
+			if(now-link_free_at>0.002)
+			{
+				link_free_at=now;
+			}
+			if(link_rate>0)
+			{
+				link_free_at+=d->len/link_rate;
+			}
+			queue_bytes-=d->len;
+			free(d->data);
+			queue_head=(queue_head+1)%MAX_QUEUE;
+			queue_count--;
+			forwarded++;
+		}
+
+		int timeout_ms=1;
+		if(queue_count==0 && delayed_count==0)
+		{
+			timeout_ms=100;
+		}
+
+		if(poll(pfd,2,timeout_ms)<=0)
+		{
+			continue;
+		}
+
+		if(pfd[0].revents & POLLIN)
+		{
+			from_len=sizeof(from);
+			int len=recvfrom(fd,buf,MAX_DGRAM,0,(struct sockaddr*)&from,&from_len);
+			if(len<=0)
+			{
+				continue;
+			}
+			have_from=1;
+			received++;
+
+			if(loss>0 && random_unit()<loss)
+			{
+				lost++;
+				continue;
+			}
+
+			char *data=malloc(len);
+			memcpy(data,buf,len);
+
+			double delay=jitter*random_unit();
+			if(reorder>0 && random_unit()<reorder)
+			{
+				delay+=reorder_delay;
+				reordered++;
+			}
+
+			if(delay>0 && delayed_count<MAX_QUEUE)
+			{
+				delayed[delayed_count].data=data;
+				delayed[delayed_count].len=len;
+				delayed_until[delayed_count]=now_s()+delay;
+				delayed_count++;
+			}
+			else
+			{
+				enqueue(data,len,queue_limit);
+			}
+		}
+
+		if(pfd[1].revents & POLLIN)
+		{
+			int len=recv(fd_back,buf,MAX_DGRAM,0);
+			if(len>0 && have_from)
+			{
+				sendto(fd,buf,len,0,(struct sockaddr*)&from,from_len);
+			}
+		}
+	}
+
+	printf("received: %lu forwarded: %lu dropped: %lu lost: %lu reordered: %lu peak queue: %d\n"
+		,received,forwarded,dropped,lost,reordered,queue_bytes_peak);
+	return 0;
+}//end main
@@ -2,11 +2,12 @@
 #include <string.h>
 #include <signal.h>
 #include <unistd.h>
+#include <inttypes.h>
 #include <jack/jack.h>
 //#include <jack/ringbuffer.h>
 #include <lo/lo.h>
 
-#include "rb.h"
+#include "../rb/rb.h"
 
 //both jack1 and jack2 have metadata api now
 //#define HAS_JACK_METADATA_API
@@ -45,6 +46,10 @@ char *default_port="3344";
 
 int quit_program;
 
+//process() cycles and page faults of the process since the ringbuffer was set up (--alloc)
+volatile uint64_t process_cycle_count=0;
+uint64_t page_faults_at_start=0;
+
 #ifdef HAS_JACK_METADATA_API
 jack_uuid_t osc_port_uuid;
 #endif
@@ -66,38 +71,87 @@ int default_msg_handler(const char *path, const char *types, lo_arg **argv, int
 	, void *data, void *user_data)
 {
 	//get size of message incl. path
-	size_t size;
-	void *msg_ptr=lo_message_serialise(data, path, NULL, &size);
-
-	size_t can_write=rb_can_write(rb);
-	//printf("size %lu (+%lu bytes delim) can write %lu\n", size, sizeof(size_t), can_write);
+	size_t size=lo_message_length(data, path);
+	//record: position in cycle, size of message, message
+	size_t record_size=sizeof(jack_nframes_t)+sizeof(size_t)+size;
 
 	jack_nframes_t frames_since_cycle_start=jack_frames_since_cycle_start(client);
 
 	//printf("arrival at sample (since cycle start): %d\n", frames_since_cycle_start);
 
-	if(size+sizeof(jack_nframes_t)+sizeof(size_t)<=can_write)
-	{
-		//write position in cycle as samples since start of cycle
-		int cnt=rb_write(rb, (char*)&frames_since_cycle_start, sizeof(jack_nframes_t));
-		//write size of message
-		cnt=rb_write(rb, (char*)&size, sizeof(size_t));
-		//write message
-		cnt+=rb_write(rb, (void *)msg_ptr, size );
-		//printf("%i\n",cnt);
-		printf("+");
-	}
-	else
+	rb_region_t regions[2];
+	if(rb_write_reserve(rb, record_size, regions)<record_size)
 	{
 		printf("ringbuffer full, can't write! message is lost\n");
 		return 1;
 	}
 
-	free(msg_ptr);
+	//build the record straight in the ringbuffer, or in a temporary buffer if it wraps
+	char *record=regions[1].size==0 ? regions[0].buffer : malloc(record_size);
+
+	//write position in cycle as samples since start of cycle
+	memcpy(record, &frames_since_cycle_start, sizeof(jack_nframes_t));
+	//write size of message
+	memcpy(record+sizeof(jack_nframes_t), &size, sizeof(size_t));
+	//write message
+	lo_message_serialise(data, path, record+sizeof(jack_nframes_t)+sizeof(size_t), &size);
+
+	if(record!=regions[0].buffer)
+	{
+		memcpy(regions[0].buffer, record, regions[0].size);
+		memcpy(regions[1].buffer, record+regions[0].size, regions[1].size);
+		free(record);
+	}
+
+	//the reader sees the whole record at once
+	rb_write_commit(rb, record_size);
+	printf("+");
 
 	return 0;
 }
 
+//remove --alloc <list> from the arguments and apply it to the ringbuffer (rb.h)
+static void parse_alloc_option(int *argc, char *argv[])
+{
+	int i;
+	for(i=1; i<*argc; i++)
+	{
+		if(strcmp(argv[i], "--alloc"))
+		{
+			continue;
+		}
+		int policy=(i+1<*argc) ? rb_parse_alloc_policy(argv[i+1]) : -1;
+		if(policy<0)
+		{
+			fprintf(stderr, "--alloc: use a comma separated list of prefault, hugepages, mlock or none\n");
+			exit(1);
+		}
+		rb_set_alloc_policy(policy);
+		//shift the rest incl. the terminating NULL
+		memmove(&argv[i], &argv[i+2], (*argc-i-1)*sizeof(char*));
+		*argc-=2;
+		i--;
+	}
+}
+
+//page faults of the whole process (incl. the osc server thread) per JACK cycle
+static void print_page_faults()
+{
+	uint64_t minor=0, major=0;
+	if(!rb_page_faults(&minor, &major) || process_cycle_count<1)
+	{
+		return;
+	}
+	char policy[64];
+	rb_alloc_policy_string(rb_get_alloc_policy(), policy, sizeof(policy));
+	fprintf(stderr, "page faults: %"PRIu64" in %"PRIu64" cycles (%.3f per cycle, alloc: %s)\n"
+		,minor+major-page_faults_at_start
+		,process_cycle_count
+		,(double)(minor+major-page_faults_at_start)/process_cycle_count
+		,policy
+	);
+}
+
 static void signal_handler(int sig)
 {
 	quit_program=1;
@@ -110,6 +164,8 @@ static int process(jack_nframes_t frames, void *arg)
 
 	jack_osc_clear_buffer(buffer_out);
 
+	process_cycle_count++;
+
 	while(rb_can_read(rb)>sizeof(jack_nframes_t)+sizeof(size_t))
 	{	
 		//size_t can_read=rb_can_read(rb);
@@ -122,10 +178,16 @@ static int process(jack_nframes_t frames, void *arg)
 		rb_read (rb, (char*)&msg_size, sizeof(size_t));
 		//printf("msg_size %lu\n", msg_size);
 
-		void *buffer=malloc(msg_size);
-
-		//read message from ringbuffer to msg_buffer
-		rb_read(rb, (void*)buffer, msg_size);
+		//use the message in place if it's in one piece (rb is mirrored)
+		rb_region_t regions[2];
+		rb_read_reserve(rb, msg_size, regions);
+		void *buffer=regions[0].buffer;
+		if(regions[1].size>0)
+		{
+			buffer=malloc(msg_size);
+			memcpy(buffer, regions[0].buffer, regions[0].size);
+			memcpy((char*)buffer+regions[0].size, regions[1].buffer, regions[1].size);
+		}
 /*
 		char* path=lo_get_path(buffer, msg_size);
 		printf("path %s\n", path);
@@ -149,7 +211,11 @@ static int process(jack_nframes_t frames, void *arg)
 		{
 			fprintf(stderr, "available jack osc buffer size was too small! message lost\n");
 		}
-		free(buffer);
+		if(buffer!=regions[0].buffer)
+		{
+			free(buffer);
+		}
+		rb_read_commit(rb, msg_size);
 	}
 
 	return 0;
@@ -158,6 +224,10 @@ static int process(jack_nframes_t frames, void *arg)
 int main(int argc, char *argv[])
 {
 	quit_program=0;
+
+	//takes out --alloc <list>, the port stays positional
+	parse_alloc_option(&argc, argv);
+
 	char cn[64];
 	memset(cn, 0, sizeof(cn));
 	strncpy(cn, default_name, sizeof(cn)-1);
@@ -207,7 +277,23 @@ int main(int argc, char *argv[])
 	signal(SIGHUP, signal_handler);
 	signal(SIGINT, signal_handler);
 
-	rb=rb_new(100000);
+	//mirrored: records never wrap, handler and process() work in place
+	rb=rb_new_mirrored(100000);
+	if(rb==NULL)
+	{
+		fprintf(stderr, "could not create ringbuffer\n");
+#ifdef HAS_JACK_METADATA_API
+		jack_remove_property(client, osc_port_uuid, JACKEY_EVENT_TYPES);
+#endif
+		jack_client_close(client);
+		return 1;
+	}
+
+	{
+	uint64_t minor=0, major=0;
+	rb_page_faults(&minor, &major);
+	page_faults_at_start=minor+major;
+	}
 
 	if(argc>1)
 	{
@@ -237,6 +323,8 @@ int main(int argc, char *argv[])
 		sleep(1);
 	};
 
+	print_page_faults();
+
 #ifdef HAS_JACK_METADATA_API
 	jack_remove_property(client, osc_port_uuid, JACKEY_EVENT_TYPES);
 #endif
@@ -133,8 +133,9 @@ Command Meaning 				# param
 #include <sys/types.h>
 #include <sys/ioctl.h>
 #include <fcntl.h>
+#include <inttypes.h>
 
-#include "rb_midi.h"
+#include "../rb/rb_midi.h"
 
 int main(int argc, char *argv[]);
 static void setup_serial_thread();
@@ -144,8 +145,11 @@ static void signal_handler(int sig);
 static void shutdown_callback(void *arg);
 static void jack_error(const char* err);
 static int process(jack_nframes_t nframes, void *arg);
+static int queue_to_serial(const jack_midi_data_t *data, size_t size);
 static int transfer_byte(int from, int to, int is_control);
 static void print_status(int fd);
+static void parse_alloc_option(int *argc, char *argv[]);
+static void print_page_faults();
 
 static int comfd;
 struct termios oldtio, newtio; //place for old and new port settings for serial por
@@ -157,6 +161,8 @@ static char *devicename = "/dev/ttyUSB0";
 //char *devicename = "/dev/ttyACM0";
 
 static rb_t *rb=NULL;
+//MIDI bytes from JACK, written to the serial device in serial_thread
+static rb_t *rb_to_serial=NULL;
 
 speed_spec speeds[] =
 {
@@ -188,10 +194,14 @@ static int connection_to_jack_down=1;
 
 //serial thread
 static pthread_t serial_thread={0};
-static pthread_mutex_t serial_thread_lock=PTHREAD_MUTEX_INITIALIZER;
-static pthread_cond_t ok_to_read=PTHREAD_COND_INITIALIZER;
+//wakes serial_thread on start and when process() put bytes to rb_to_serial
+static rb_notifier_t *serial_notifier=NULL;
 static int serial_thread_initialized=0;
 
+//process() cycles and page faults of the process since the ringbuffers were set up (--alloc)
+static volatile uint64_t process_cycle_count=0;
+static uint64_t page_faults_at_start=0;
+
 //===================================================================
 int main(int argc, char *argv[])
 {
@@ -199,13 +209,18 @@ int main(int argc, char *argv[])
 	setbuf(stdout, NULL);
 	setbuf(stderr, NULL);
 
+	//takes out --alloc <list>, device and speed stay positional
+	parse_alloc_option(&argc, argv);
+
 	if(argc >= 2 &&
 		(strcmp(argv[1], "-h")==0 || strcmp(argv[1], "--help")==0))
 	{
 		printf("connect JACK client to serial device\n\n");
-		printf("syntax: jack_tty <serial device> <speed>\n\n");
+		printf("syntax: jack_tty [--alloc <list>] <serial device> <speed>\n\n");
 		printf("default values: /dev/ttyUSB0 115200\n");
 		printf("example: jack_tty /dev/ttyACM0 9600\n");
+		printf("--alloc: ringbuffer allocation, comma separated: prefault,hugepages,mlock (none)\n");
+		printf("page faults per cycle are shown at exit.\n\n");
 
 		printf("jack_tty source at https://github.com/7890/jack_tools\n\n");
 		return(0);
@@ -290,6 +305,18 @@ int main(int argc, char *argv[])
 	//just 100 bytes. this is handy for dumping the ringbuffer.
 	rb=rb_new( 100 );
 	//rb=rb_new( 3 * jack_get_buffer_size(client) );
+	if(rb==NULL)
+	{
+		fprintf(stderr, "could not create ringbuffer\n");
+		exit(1);
+	}
+
+	{
+	uint64_t minor=0, major=0;
+	rb_page_faults(&minor, &major);
+	page_faults_at_start=minor+major;
+	process_cycle_count=0;
+	}
 
 	jack_on_shutdown(client, shutdown_callback, NULL);
 
@@ -334,9 +361,15 @@ _continue:
 //=============================================================================
 static void setup_serial_thread()
 {
+	rb_to_serial=rb_new(1024);
+	serial_notifier=rb_notifier_new();
+	if(rb_to_serial==NULL || serial_notifier==NULL)
+	{
+		fprintf(stderr, "could not create ringbuffer for serial thread\n");
+		exit(1);
+	}
+
 	pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, NULL);
-	//initially lock
-	pthread_mutex_lock(&serial_thread_lock);
 	//create the serial_thread (pthread_t) with start routine serial_thread_func
 	//serial_thread_func will be called after thread creation
 	//(no attributes, no args)
@@ -346,17 +379,8 @@ static void setup_serial_thread()
 //=============================================================================
 static void start_serial_thread()
 {
-	if(pthread_mutex_trylock (&serial_thread_lock)==0)
-	{
-		//signal to serial_thread it can start or continue to read
-		pthread_cond_signal (&ok_to_read);
-		//unlock again
-		pthread_mutex_unlock (&serial_thread_lock);
-	}
-	else
-	{
-//		fprintf(stderr,"/!\\ could not lock mutex.\n");
-	}
+	//signal to serial_thread it can start or continue to read
+	rb_notifier_wake(serial_notifier);
 }//end start_serial_thread()
 
 //this method is called from serial_thread (pthread_t)
@@ -421,25 +445,60 @@ _init:
 		serial_thread_initialized=1;
 
 		//===wait here until started
-		pthread_cond_wait (&ok_to_read, &serial_thread_lock);
+		rb_notifier_wait(serial_notifier, -1);
 	}
 
+	int notifier_fd=rb_notifier_fd(serial_notifier);
+
 	while(!need_exit)
 	{
 		fd_set fds;
+		fd_set wfds;
 		int ret;
 		
 		FD_ZERO(&fds);
+		FD_ZERO(&wfds);
 		FD_SET(STDIN_FILENO, &fds);
 		FD_SET(comfd, &fds);
 
-		ret = select(comfd+1, &fds, NULL, NULL, NULL);
+		//bytes from JACK pending: wait until the device takes more. otherwise
+		//let process() wake us when it puts bytes
+		if(rb_notifier_arm(serial_notifier, rb_to_serial, RB_WAIT_READABLE, 1))
+		{
+			FD_SET(comfd, &wfds);
+		}
+		else
+		{
+			FD_SET(notifier_fd, &fds);
+		}
+
+		ret = select((comfd>notifier_fd ? comfd : notifier_fd)+1, &fds, &wfds, NULL, NULL);
 		if(ret == -1)
 		{
 			perror("select");
 		}
 		else if (ret > 0)
 		{
+			if(FD_ISSET(notifier_fd, &fds))
+			{
+				rb_notifier_clear(serial_notifier);
+			}
+
+			//put MIDI bytes from JACK to serial
+			rb_region_t region;
+			rb_get_next_read_region(rb_to_serial, &region);
+			while(region.size>0)
+			{
+				ssize_t written=write(comfd, region.buffer, region.size);
+				if(written<=0)
+				{
+					//device busy, continue when writable
+					break;
+				}
+				rb_advance_read_index(rb_to_serial, written);
+				rb_get_next_read_region(rb_to_serial, &region);
+			}
+
 			if(FD_ISSET(STDIN_FILENO, &fds))
 			{
 //				fprintf(stderr,"SERIAL< ");//going to serial
@@ -479,8 +538,6 @@ _init:
 	tcsetattr(comfd, TCSANOW, &oldtio);
 	tcsetattr(STDIN_FILENO, TCSANOW, &oldkey);
 
-	pthread_mutex_unlock (&serial_thread_lock);
-
 	return 0;
 }//end serial_thread_func()
 
@@ -488,17 +545,40 @@ _init:
 static void signal_handler(int sig)
 {
 	fprintf(stderr, "signal received, exiting ...\n");
+	print_page_faults();
 
 	if(!connection_to_jack_down)
 	{
 		jack_client_close(client);
 	}
 
+	//stop serial_thread before its ringbuffer goes away (unless the signal arrived there)
+	if(serial_notifier!=NULL && !pthread_equal(pthread_self(), serial_thread))
+	{
+		pthread_cancel(serial_thread);
+		pthread_join(serial_thread, NULL);
+	}
+
 	rb_free(rb);
+	//rb_to_serial is a file in /dev/shm (RB_DEFAULT_USE_SHM)
+	rb_free(rb_to_serial);
+	rb_notifier_free(serial_notifier);
 
 	exit(0);
 }
 
+//================================================================
+//called in process(): queue a whole MIDI message for serial_thread or drop it.
+//a partly written message would corrupt the byte stream on the device
+static int queue_to_serial(const jack_midi_data_t *data, size_t size)
+{
+	if(rb_can_write(rb_to_serial)<size)
+	{
+		return 0;
+	}
+	return rb_write(rb_to_serial, (const char*)data, size);
+}
+
 //================================================================
 static void shutdown_callback(void *arg)
 {
@@ -519,6 +599,7 @@ static int process(jack_nframes_t nframes, void *arg)
 	{
 		return 0;
 	}
+	process_cycle_count++;
 
 	//prepare receive buffer
 	buffer_in_midi = jack_port_get_buffer (port_in_midi, nframes);
@@ -528,7 +609,7 @@ static int process(jack_nframes_t nframes, void *arg)
 	//process incoming messages from JACK
 	int msgCount = jack_midi_get_event_count (buffer_in_midi);
 
-	int x=0; //return value of write
+	int x=0; //return value of rb_write
 
 	int i;
 	//iterate over encapsulated osc messages
@@ -565,30 +646,27 @@ static int process(jack_nframes_t nframes, void *arg)
 						return 0;
 					}
 
-					jack_midi_data_t *buffer;
+					jack_midi_data_t buffer[3];
 
 					//176: b0 (cc on channel 0)
 					//oscsend localhost 3344 /midi iii 176 40 1
 					if(argc==1 && !strcmp(types, "i"))
 					{
-						buffer=malloc(1);
 						buffer[0]=argv[0]->i;
-						x=write(comfd, (void*)buffer, argc);
+						x=queue_to_serial(buffer, argc);
 					}
 					else if(argc==2 && !strcmp(types, "ii"))
 					{
-						buffer=malloc(2);
 						buffer[0]=argv[0]->i;
 						buffer[1]=argv[1]->i;
-						x=write(comfd, (void*)buffer, argc);
+						x=queue_to_serial(buffer, argc);
 					}
 					else if(argc==3 && !strcmp(types, "iii"))
 					{
-						buffer=malloc(3);
 						buffer[0]=argv[0]->i;
 						buffer[1]=argv[1]->i;
 						buffer[2]=argv[2]->i;
-						x=write(comfd, (void*)buffer, argc);
+						x=queue_to_serial(buffer, argc);
 					}
 
 					if(argc==1 && !strcmp(types, "b"))
@@ -601,19 +679,21 @@ static int process(jack_nframes_t nframes, void *arg)
 			else //assume "normal" midi
 			{
 //				fprintf(stderr, "MIDI> #%d len %lu\n\r", msgCount, event.size);//, event.buffer);
-				//write to serial
-				x=write(comfd, (void*)event.buffer, event.size);
+				//write to serial (in serial_thread)
+				x=queue_to_serial(event.buffer, event.size);
 			}
 		}
 		if(x==0){}//satisfy unused var
 	}
+	//wake serial_thread if it waits for bytes
+	rb_notify(serial_notifier);
 
 	//put MIDI bytes from serial to JACK
 
 	int pos=0; //!!!! timing wrong
 
 	//holding midi message
-	void *buf=malloc(3);
+	char buf[3];
 
 	size_t m_count=0;
 	while( (m_count=rb_read_next_midi_message(rb, buf)) > 0 )
@@ -623,10 +703,53 @@ static int process(jack_nframes_t nframes, void *arg)
 		pos++; //pseudo timing
 	}
 
-	free(buf);
 	return 0;
 }
 
+//=============================================================================
+//remove --alloc <list> from the arguments and apply it to all ringbuffers (rb.h)
+static void parse_alloc_option(int *argc, char *argv[])
+{
+	int i;
+	for(i=1; i<*argc; i++)
+	{
+		if(strcmp(argv[i], "--alloc"))
+		{
+			continue;
+		}
+		int policy=(i+1<*argc) ? rb_parse_alloc_policy(argv[i+1]) : -1;
+		if(policy<0)
+		{
+			fprintf(stderr, "--alloc: use a comma separated list of prefault, hugepages, mlock or none\n");
+			exit(1);
+		}
+		rb_set_alloc_policy(policy);
+		//shift the rest incl. the terminating NULL
+		memmove(&argv[i], &argv[i+2], (*argc-i-1)*sizeof(char*));
+		*argc-=2;
+		i--;
+	}
+}
+
+//=============================================================================
+//page faults of the whole process (incl. serial_thread) per JACK cycle
+static void print_page_faults()
+{
+	uint64_t minor=0, major=0;
+	if(!rb_page_faults(&minor, &major) || process_cycle_count<1)
+	{
+		return;
+	}
+	char policy[64];
+	rb_alloc_policy_string(rb_get_alloc_policy(), policy, sizeof(policy));
+	fprintf(stderr, "page faults: %"PRIu64" in %"PRIu64" cycles (%.3f per cycle, alloc: %s)\n"
+		,minor+major-page_faults_at_start
+		,process_cycle_count
+		,(double)(minor+major-page_faults_at_start)/process_cycle_count
+		,policy
+	);
+}
+
 //=============================================================================
 static void print_status(int fd)
 {
@@ -24,7 +24,7 @@
 #ifndef BUFFERS_H_INC
 #define BUFFERS_H_INC
 
-#include "rb.h"
+#include "../../rb/rb.h"
 
 //ringbuffers
 //read from file, write to rb_interleaved (in case of resampling)
@@ -59,10 +59,11 @@ static void setup_ringbuffers(int channel_count, int file_sample_rate, int jack_
 	rb_free(rb_deinterleaved);
 	rb_free(rb_resampler_swingout);
 
-	rb_interleaved                  =rb_new_audio_seconds(1.9,"interleaved",file_sample_rate,channel_count,sizeof(float));
-	rb_resampled_interleaved        =rb_new_audio_seconds(1.9,"resampled interleaved",jack_sample_rate,channel_count,sizeof(float));
-	rb_deinterleaved                =rb_new_audio_seconds(1.9,"deinterleaved",jack_sample_rate,channel_count,sizeof(float));
-	rb_resampler_swingout		=rb_new_audio_seconds(0.5,"resampler swingout",jack_sample_rate,channel_count,sizeof(float));
+	//mirrored: the disk reader, the resampler and deinterleave() access these in place, also across the buffer end
+	rb_interleaved                  =rb_new_mirrored_audio_seconds(1.9,"interleaved",file_sample_rate,channel_count,sizeof(float));
+	rb_resampled_interleaved        =rb_new_mirrored_audio_seconds(1.9,"resampled interleaved",jack_sample_rate,channel_count,sizeof(float));
+	rb_deinterleaved                =rb_new_mirrored_audio_seconds(1.9,"deinterleaved",jack_sample_rate,channel_count,sizeof(float));
+	rb_resampler_swingout		=rb_new_mirrored_audio_seconds(0.5,"resampler swingout",jack_sample_rate,channel_count,sizeof(float));
 }
 
 //=============================================================================
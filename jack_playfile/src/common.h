@@ -128,6 +128,7 @@ static void free_structs()
 	delete running;
 	delete transport;
 	free(jack->ioPortArray);
+	free(jack->deinterleave_destinations);
 	delete jack;
 	delete debug_marker;
 	rs_free(r1);
@@ -169,6 +170,7 @@ static struct option long_options[] =
 	{"transport",	no_argument,  0,	'j'},    //JackServer
 	{"verbose",	no_argument,  0,	'v'},    //Settings
 	{"libs",	no_argument,  0,	'L'},
+	{"alloc",	required_argument,	0, 'M'}, //rb.h allocation policy
 	{0, 0, 0, 0}
 };
 
@@ -181,7 +183,7 @@ static void parse_cmdline_args(int argc, char *argv[])
 	{
 		//getopt_long stores the option index here
 		int option_index=0;
-		opt=getopt_long(argc, argv, "hHVn:s:w:o:c:O:C:DQ:S:A:F:RdNEpmlfarkejvL", long_options, &option_index);
+		opt=getopt_long(argc, argv, "hHVn:s:w:o:c:O:C:DQ:S:A:F:RdNEpmlfarkejvLM:", long_options, &option_index);
 
 		//Detect the end of the options
 		if(opt==-1)
@@ -325,6 +327,18 @@ static void parse_cmdline_args(int argc, char *argv[])
 				print_libs();
 				exit(0);
 
+			case 'M':
+			{
+				int policy=rb_parse_alloc_policy(optarg);
+				if(policy<0)
+				{
+					fprintf(stderr,"--alloc '%s': use a comma separated list of prefault, hugepages, mlock or none\n",optarg);
+					exit(1);
+				}
+				rb_set_alloc_policy(policy);
+				break;
+			}
+
 			case '?': //invalid commands
 				//getopt_long already printed an error message
 				fprintf(stderr, "Wrong arguments, see --help.\n");
@@ -373,6 +387,7 @@ static void print_main_help()
 	fprintf (stdout, "  -O, --choffset <integer>  Channel offset (in file):  (0)\n");
 	fprintf (stdout, "  -C, --chcount <integer>   Channel count  (in file):  (all)\n");
 	fprintf (stdout, "  -d, --dump                Print usable files to stdout and quit\n");
+	fprintf (stdout, "  -M, --alloc <list>        Buffer allocation: prefault,hugepages,mlock  (none)\n");
 	fprintf (stdout, "  -v, --verbose             Show more info about files, JACK settings\n");
 	fprintf (stdout, "  -L, --libs                Show license and library info\n\n");
 
@@ -63,10 +63,17 @@ typedef struct
 	uint64_t process_cycle_underruns;
 	uint64_t total_frames_pushed_to_jack;
 
+	//page faults of the JACK process thread, sampled about once per second in process()
+	uint64_t page_faults_first;
+	uint64_t page_faults_first_cycle; //0: no sample yet
+	uint64_t page_faults_last;
+	uint64_t page_faults_last_cycle;
+
 	jack_options_t options;
 	jack_status_t status;
 	jack_transport_state_t transport_state;
 	jack_port_t **ioPortArray;
+	char **deinterleave_destinations; //one per output port, used in jack_deinterleave() (no VLA in process())
 	jack_client_t *client;
 
 	int try_reconnect; //wait for JACK if not available, try reconnect if was shutdown
@@ -31,8 +31,8 @@
 
 //disk thread
 static pthread_t disk_thread={0};
-static pthread_mutex_t disk_thread_lock=PTHREAD_MUTEX_INITIALIZER;
-static pthread_cond_t ok_to_read=PTHREAD_COND_INITIALIZER;
+//wakes disk_thread when process() made enough space in the buffer it fills, or on request
+static rb_notifier_t *disk_thread_notifier=NULL;
 static int disk_thread_initialized=0;
 
 //disk reads
@@ -52,7 +52,8 @@ static int prepare_for_next_file=0;
 static int bytes_per_sample_in_file=0;
 
 //disk reads read into this buffer
-static float *frames_from_file_buffer;
+static float *frames_from_file_buffer=NULL;
+static uint64_t frames_from_file_buffer_size=0;
 
 //how many frames to read per request
 static int sndfile_request_frames=0;
@@ -228,8 +229,15 @@ while(true)
 		fprintf(stderr,"sndfile_request_frames: %d\n",sndfile_request_frames);
 	}
 
-	delete[] frames_from_file_buffer;
-	frames_from_file_buffer=new float[sndfile_request_frames*running->channel_count];
+	//allocated according to --alloc, like the ringbuffers
+	rb_free_scratch(frames_from_file_buffer,frames_from_file_buffer_size);
+	frames_from_file_buffer_size=sndfile_request_frames*running->channel_count*sizeof(float);
+	frames_from_file_buffer=(float*)rb_alloc_scratch(frames_from_file_buffer_size);
+	if(frames_from_file_buffer==NULL)
+	{
+		fprintf(stderr,"could not allocate file read buffer.\n");
+		signal_handler(44);
+	}
 
 	if(settings->is_verbose)
 	{
@@ -465,8 +473,7 @@ static int open_init_file(const char *f)
 	}
 /*
 	//"kill" thread
-	pthread_mutex_unlock(&disk_thread_lock);
-	pthread_cond_signal(&ok_to_read);
+	rb_notifier_wake(disk_thread_notifier);
 	pthread_join(disk_thread, NULL);
 	pthread_cancel(disk_thread);
 	disk_thread_initialized=0;
@@ -746,13 +753,28 @@ static int disk_read_frames()
 
 		//frames_read: number of (multi-channel) samples to read, i.e. 1 frame in a stereo file = two values
 
-		//get float frames from any of the readers, requested size ensured to be returned except eof
-		frames_read_from_file=sin_read_frames_from_file_to_buffer(frames_from_file_buffer
-			,frames_read,running->channel_offset,running->channel_count);
+		//decode straight into the selected ringbuffer if the reserved space is in one piece
+		//(always the case with the mirrored buffers, see setup_ringbuffers())
+		rb_region_t regions[2];
+		rb_write_reserve(rb_to_use,rb_frame_to_byte_count(rb_to_use,frames_read),regions);
+
+		if(regions[1].size==0)
+		{
+			//get float frames from any of the readers, requested size ensured to be returned except eof
+			frames_read_from_file=sin_read_frames_from_file_to_buffer((float*)regions[0].buffer
+				,frames_read,running->channel_offset,running->channel_count);
+
+			rb_write_commit(rb_to_use,rb_frame_to_byte_count(rb_to_use,frames_read_from_file));
+		}
+		else
+		{
+			frames_read_from_file=sin_read_frames_from_file_to_buffer(frames_from_file_buffer
+				,frames_read,running->channel_offset,running->channel_count);
 
-		//put to the selected ringbuffer
-		rb_write(rb_to_use,(const char*)frames_from_file_buffer
-			,rb_frame_to_byte_count(rb_to_use,frames_read_from_file));
+			//put to the selected ringbuffer
+			rb_write(rb_to_use,(const char*)frames_from_file_buffer
+				,rb_frame_to_byte_count(rb_to_use,frames_read_from_file));
+		}
 	}//end if(!transport->is_idling_at_end)
 
 	if(frames_read_from_file>0)
@@ -882,8 +904,9 @@ static void *disk_thread_func(void *arg)
 		{
 			if(rb_can_write_frames(rb_resampled_interleaved)<sndfile_request_frames)
 			{
-				//===wait here until process() requests to continue
-				pthread_cond_wait (&ok_to_read, &disk_thread_lock);
+				//===wait here until process() made space for one request (or requests a seek)
+				rb_wait_writable(rb_resampled_interleaved,disk_thread_notifier
+					,rb_frame_to_byte_count(rb_resampled_interleaved,sndfile_request_frames),-1);
 				//once waked up, restart loop
 				continue;
 			}
@@ -892,8 +915,9 @@ static void *disk_thread_func(void *arg)
 		{
 			if(rb_can_write_frames(rb_interleaved)<sndfile_request_frames)
 			{
-				//===wait here until process() requests to continue
-				pthread_cond_wait (&ok_to_read, &disk_thread_lock);
+				//===wait here until process() made space for one request (or requests a seek)
+				rb_wait_writable(rb_interleaved,disk_thread_notifier
+					,rb_frame_to_byte_count(rb_interleaved,sndfile_request_frames),-1);
 				//once waked up, restart loop
 				continue;
 			}
@@ -902,11 +926,11 @@ static void *disk_thread_func(void *arg)
 		//for both resampling, non-resampling
 		//disk_read() returns 0 on EOF
 		if(!disk_read_frames())
-		{///
+		{
+			//===nothing to read (EOF, idling at end): wait here until process() requests to continue
+			rb_notifier_wait(disk_thread_notifier,-1);
 		}
-
-		//===wait here until process() requests to continue
-		pthread_cond_wait (&ok_to_read, &disk_thread_lock);
+		//otherwise read on while there is space
 	}//end main loop
 
 	///never reached
@@ -923,9 +947,14 @@ static void setup_disk_thread()
 		return;
 	}
 
+	disk_thread_notifier=rb_notifier_new();
+	if(disk_thread_notifier==NULL)
+	{
+		fprintf(stderr,"/!\\ could not create notifier for disk thread\n");
+		signal_handler(44); //quit with error
+	}
+
 	pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, NULL);
-	//initially lock
-	pthread_mutex_lock(&disk_thread_lock);
 	//create the disk_thread (pthread_t) with start routine disk_thread_func
 	//disk_thread_func will be called after thread creation
 	//(not attributes, no args)
@@ -937,15 +966,15 @@ static void setup_disk_thread()
 //=============================================================================
 static void req_buffer_from_disk_thread()
 {
-	//if possible to lock the disk_thread_lock mutex
-	if(!pthread_mutex_trylock(&disk_thread_lock))
+	//seeks are done in disk_thread: wake it regardless of the space in the buffers
+	if(running->seek_frames_in_progress)
 	{
-//		fprintf(stderr,"new data from disk thread requested\n");
-		//signal to disk_thread it can start or continue to read
-		pthread_cond_signal (&ok_to_read);
-		//unlock again
-		pthread_mutex_unlock (&disk_thread_lock);
+		rb_notifier_wake(disk_thread_notifier);
+		return;
 	}
+	//wake disk_thread if it waits and there is space for one request (or if it waits at the end).
+	//realtime safe, nothing is lost if disk_thread is busy (see rb_notifier_new())
+	rb_notify(disk_thread_notifier);
 }//end req_buffer_from_disk_thread()
 
 //>=0
@@ -1079,6 +1108,25 @@ static void print_stats()
 	);
 }//end print_stats()
 
+//=============================================================================
+//page faults of the JACK process thread, as sampled in process() (see jack_sample_page_faults())
+static void print_page_faults()
+{
+	uint64_t cycles=jack->page_faults_last_cycle-jack->page_faults_first_cycle;
+	if(cycles<1)
+	{
+		return;
+	}
+	char policy[64];
+	rb_alloc_policy_string(rb_get_alloc_policy(),policy,sizeof(policy));
+	fprintf(stderr,"page faults in process(): %"PRId64" in %"PRId64" cycles (%.3f per cycle, alloc: %s)\n"
+		,jack->page_faults_last-jack->page_faults_first
+		,cycles
+		,(double)(jack->page_faults_last-jack->page_faults_first)/cycles
+		,policy
+	);
+}//end print_page_faults()
+
 //=============================================================================
 static void signal_handler(int sig)
 {
@@ -1086,6 +1134,11 @@ static void signal_handler(int sig)
 //	fprintf(stderr,"signal_handler() called\n");
 	print_stats();
 
+	if(settings->is_verbose)
+	{
+		print_page_faults();
+	}
+
 	if(jack->process_cycle_underruns>0)
 	{
 		fprintf(stderr,"/!\\ underruns: %"PRId64"\n",jack->process_cycle_underruns);
@@ -1105,7 +1158,7 @@ static void signal_handler(int sig)
 	kb_reset_terminal();
 
 //////
-	delete[] frames_from_file_buffer;
+	rb_free_scratch(frames_from_file_buffer,frames_from_file_buffer_size);
 	///in sndfile.h
 	delete[] tmp_buffer;
 
@@ -41,6 +41,7 @@ static int all_frames_read();
 static uint64_t get_current_play_position_in_file();
 
 static void print_stats();
+static void print_page_faults();
 
 static void signal_handler(int sig);
 
@@ -38,6 +38,7 @@ static void jack_error(const char* err);
 static int jack_wait_connect();
 static void jack_post_init();
 static void jack_deinterleave();
+static void jack_sample_page_faults();
 static int jack_process(jack_nframes_t nframes, void *arg);
 static int jack_open_client();
 static int jack_register_output_ports();
@@ -76,10 +77,16 @@ static void init_jack_struct()
 	jack->process_cycle_underruns=0;
 	jack->total_frames_pushed_to_jack=0;
 
+	jack->page_faults_first=0;
+	jack->page_faults_first_cycle=0;
+	jack->page_faults_last=0;
+	jack->page_faults_last_cycle=0;
+
 	jack->options = jack_options_t(JackNoStartServer | JackServerName);
 	//jack->status=;
 	//jack->transport_state=;
 	//jack->ioPortArray=; //set in jack_register_output_ports()
+	jack->deinterleave_destinations=NULL; //allocated in jack_init()
 	jack->client=NULL;
 
 	jack->try_reconnect=1;
@@ -132,6 +139,9 @@ static int jack_init()
 	jack->ioPortArray = (jack_port_t**) calloc(
 		jack->output_port_count * sizeof(jack_port_t*), sizeof(jack_port_t*));
 
+	//channel_count is limited to output_port_count
+	jack->deinterleave_destinations = (char**) calloc(jack->output_port_count, sizeof(char*));
+
 	jack_set_error_function(jack_error);
 
 	return 1;
@@ -203,6 +213,30 @@ static void jack_post_init()
 	}
 }//end jack_post_init()
 
+//=============================================================================
+//called in process(): sample page faults of this thread about once per second
+//(getrusage is a system call). see print_page_faults()
+static void jack_sample_page_faults()
+{
+	uint64_t interval=MAX(1,(uint64_t)jack->cycles_per_second);
+	if(jack->process_cycle_count%interval!=1 && interval>1)
+	{
+		return;
+	}
+	uint64_t minor=0, major=0;
+	if(!rb_page_faults(&minor,&major))
+	{
+		return;
+	}
+	if(jack->page_faults_first_cycle==0)
+	{
+		jack->page_faults_first=minor+major;
+		jack->page_faults_first_cycle=jack->process_cycle_count;
+	}
+	jack->page_faults_last=minor+major;
+	jack->page_faults_last_cycle=jack->process_cycle_count;
+}//end jack_sample_page_faults()
+
 //=============================================================================
 static void jack_deinterleave()
 {
@@ -224,18 +258,40 @@ static void jack_deinterleave()
 		&& (rb_can_write_frames(rb_deinterleaved) >= resampled_frames_use) //>=jack->period_frames)
 	)
 	{
-		for(int channel_loop=0; channel_loop < running->channel_count; channel_loop++)
+		//one block of resampled_frames_use samples per channel
+		uint64_t block_bytes=resampled_frames_use * bytes_per_sample;
+		rb_region_t regions[2];
+		rb_write_reserve(rb_deinterleaved,block_bytes * running->channel_count,regions);
+
+		if(regions[1].size==0)
 		{
-			//this does not advance the read index of rb_resampled_interleaved
-			size_t count=rb_deinterleave_audio(rb_resampled_interleaved
-				,(char *)data_resampled_deinterleaved_one_channel_one_period
-				,resampled_frames_use, channel_loop);
+			//all channels in one pass straight into rb_deinterleaved
+			//(always the case with the mirrored buffer, see setup_ringbuffers())
+			char **destinations=jack->deinterleave_destinations;
+			for(int channel_loop=0; channel_loop < running->channel_count; channel_loop++)
+			{
+				destinations[channel_loop]=regions[0].buffer + channel_loop * block_bytes;
+			}
 
-			//write 
-			rb_write(rb_deinterleaved
-				,(const char *)data_resampled_deinterleaved_one_channel_one_period
-				,resampled_frames_use * bytes_per_sample);
-		}//end for every channel
+			//this does not advance the read index of rb_resampled_interleaved
+			rb_deinterleave_audio_channels(rb_resampled_interleaved,destinations,resampled_frames_use);
+			rb_write_commit(rb_deinterleaved,block_bytes * running->channel_count);
+		}
+		else
+		{
+			for(int channel_loop=0; channel_loop < running->channel_count; channel_loop++)
+			{
+				//this does not advance the read index of rb_resampled_interleaved
+				size_t count=rb_deinterleave_audio(rb_resampled_interleaved
+					,(char *)data_resampled_deinterleaved_one_channel_one_period
+					,resampled_frames_use, channel_loop);
+
+				//write 
+				rb_write(rb_deinterleaved
+					,(const char *)data_resampled_deinterleaved_one_channel_one_period
+					,block_bytes);
+			}//end for every channel
+		}
 
 		//finaly advance read index
 		rb_advance_read_index(rb_resampled_interleaved
@@ -319,6 +375,8 @@ static int jack_process(jack_nframes_t nframes, void *arg)
 	//count at start of enabled, non-zero (seek) cycles (1st cycle = #1)
 	jack->process_cycle_count++;
 
+	jack_sample_page_faults();
+
 	//normal operation
 	if(rb_can_read_frames(rb_deinterleaved)>=jack->period_frames)
 	{
@@ -245,9 +245,17 @@ static int rs_process(rs_t *r)
 		while(R.out_count>0)
 		{
 			//read from r->in_buffer, just peek / don't move read pointer yet
-			size_t peeked=rb_peek(buffer_to_use
-				,(char*)interleaved_frame_buffer
-				,byte_count_in);
+			//use the input in place if it's in one piece (always for mirrored buffers)
+			uint64_t contiguous;
+			float *input=(float*)rb_read_ptr(buffer_to_use,&contiguous);
+			size_t peeked=rb_MIN(contiguous,byte_count_in);
+			if(peeked<byte_count_in && contiguous<rb_can_read(buffer_to_use))
+			{
+				peeked=rb_peek(buffer_to_use
+					,(char*)interleaved_frame_buffer
+					,byte_count_in);
+				input=interleaved_frame_buffer;
+			}
 			
 			int R_in_count;
 			int R_out_count;
@@ -275,7 +283,7 @@ static int rs_process(rs_t *r)
 			R_out_count=MAX(1,R_out_count);
 
 			//configure for next resampler process cycle
-			R.inp_data=interleaved_frame_buffer;
+			R.inp_data=input;
 			R.inp_count=R_in_count;
 			R.out_data=buffer_resampling_out;
 			R.out_count=R_out_count;
@@ -0,0 +1,3927 @@
+/** @file rb.h \mainpage Introduction
+ * rb.h -- A set of functions to work with lock-free ringbuffers.
+ * A ringbuffer can hold n (count) bytes of data.
+ *
+ * \image html drawing_ringbuffer_1_path.svg "Ringbuffer (size=12)"
+ * \image latex drawing_ringbuffer_1_path.eps "Ringbuffer (size=12)"
+ *
+ * The key attribute of this ringbuffer is that it can be safely accessed
+ * by two threads simultaneously -- one reading from the buffer and
+ * the other writing to it -- without using any synchronization or
+ * mutual exclusion primitives. For this to work correctly, there can
+ * only be a single reader and a single writer thread. Their
+ * identities cannot be interchanged, i.e. a reader can not become a
+ * writer and vice versa.
+ *
+ * A ringbuffer can be created in shared memory allowing two processes to 
+ * read and write to it. This enables a simple form of IPC.
+ *
+ * rb.h offers several audio-centric functions that facilitate to use the 
+ * buffer with audiosample data or similar data sharing aspects of audio.
+ * Audiosample data is characterized through the sample rate, the number of
+ * (interleaved) channels and the size (count of bytes) of one sample.
+ *
+ * For situations where multiple reader or writer threads or processes are
+ * involved rb.h offers locking mechanisms (mutex) to allow exclusive reads/writes.
+ * Messages of a fixed size can be passed without locks through rb_mpmc.h instead.
+ *
+ * Please find a documentation of all functions here: \ref rb.h.
+ *
+ * rb.h is part of a collection of C snippets which can be found here:
+ * [https://github.com/7890/csnip](https://github.com/7890/csnip)
+ *
+ * All tools in jack_tools include this single copy (rb/rb.h).
+ * Unit tests and a benchmark: 'make test', 'make bench' in rb/.
+ *
+ * Copyright (C) 2015 - 2016 Thomas Brand
+ *
+ * rb.h is derived from ringbuffer.c and ringbuffer.h in jack repository
+ * [https://github.com/jackaudio/jack1](https://github.com/jackaudio/jack1)
+ *
+ * Any errors or shortcomings in this derivative code shall not be related to 
+ * the authors this file (rb.h) was based on.
+ *
+ * Header from ringbuffer.c (jack_ringbuffer_t):
+\verbatim
+Copyright (C) 2000 Paul Davis
+Copyright (C) 2003 Rohan Drape
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation; either version 2.1 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program; if not, write to the Free Software 
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+ISO/POSIX C version of Paul Davis's lock free ringbuffer C++ code.
+This is safe for the case of one read thread and one write thread.
+\endverbatim
+ *
+ */
+
+//EXPERIMENTAL CODE
+//NOT ALL METHODS FULLY TESTED
+
+#ifndef _RB_H
+#define _RB_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+static const char RB_MAGIC[8]={'r','i','n','g','b','u','f','\0'};
+/**< The first few bytes in a rb_t data block.*/
+
+static const float RB_VERSION=0.28;
+/**< Version of rb.h. Changing the rb.h binary data layout can cause the loss of 
+interoperability with other programs using (including at compile time) a previous version of rb.h.*/
+
+//doxygen sets this to include normally unset preprocessor defines in the documentation
+#ifdef DOXYGEN
+#define RB_DISABLE_MLOCK
+/**< If defined (without value), do NOT provide POSIX memory locking (see rb_mlock(), rb_munlock()).*/
+
+#define RB_DISABLE_RW_MUTEX
+/**< If defined (without value), do NOT provide read and write mutex locks.
+Programs that include rb.h without setting #RB_DISABLE_RW_MUTEX defined need to link with '-lpthread'.
+Not disabling doesn't mean that read and write operations are locked by default.
+A caller can use these functions to wrap read and write operations:
+See also rb_try_exclusive_read(), rb_release_read(), rb_try_exclusive_write(), rb_release_write().
+Using any locking functions makes rb.h a non-lockfree buffer, allowing more than one read or write
+thread or process.
+*/
+
+#define RB_DISABLE_SHM
+/**< If defined (without value), do NOT provide shared memory support.
+Files created in shared memory can normally be found under '/dev/shm/' on a Linux system.
+Programs that include rb.h without setting #RB_DISABLE_SHM need to link with '-lrt -luuid'.
+See also rb_new_shared().*/
+
+#define RB_DEFAULT_USE_SHM
+/**< If defined (without value), rb_new_(!shared)*() functions will implicitely use shared memory backed storage.
+Otherwise rb_new_(!shared)*() functions will use malloc(), in private heap storage.
+See also rb_new_shared_*() methods.*/
+
+#define WIN_BUILD
+/**< If defined (without value), prepare for windows build */
+
+#define RB_DISABLE_SIMD
+/**< If defined (without value), do NOT use the SSE / AVX kernels in rb_deinterleave_audio_channels()
+and rb_interleave_audio_channels(). The SSE kernels are used on x86 (always available on x86_64),
+the AVX kernels if compiled with i.e. -mavx or -march=native.*/
+
+#endif
+
+#include <stdlib.h> //malloc, free
+#include <string.h> //memcpy
+#include <stdio.h> //fprintf
+#include <math.h> //ceil, floor
+
+#include <inttypes.h> //uint8_t
+#include <errno.h> //strerror
+
+#ifdef WIN_BUILD
+	//no win pthread support atm
+	#define RB_DISABLE_RW_MUTEX
+#endif
+
+#ifndef RB_DISABLE_MLOCK
+	#ifndef WIN_BUILD
+		#include <sys/mman.h> //mlock, munlock
+	#else
+		#include "win/mman.h"
+	#endif
+#endif
+
+#ifndef RB_DISABLE_RW_MUTEX
+	#include <pthread.h> //pthread_mutex_init, pthread_mutex_lock ..
+#endif
+
+#ifndef RB_DISABLE_SIMD
+	#if defined(__SSE__) || defined(_M_X64)
+		#include <xmmintrin.h> //_mm_shuffle_ps, _MM_TRANSPOSE4_PS
+		#define RB_SSE
+	#endif
+	#ifdef __AVX__
+		#include <immintrin.h> //_mm256_permute2f128_ps
+		#define RB_AVX
+	#endif
+#endif
+
+#ifndef WIN_BUILD
+	#include <sys/mman.h> //mmap (mirrored buffers)
+	#include <sys/syscall.h> //SYS_memfd_create
+	#include <unistd.h> //ftruncate, sysconf
+	#include <sys/eventfd.h> //eventfd (rb_notifier_t)
+	#include <poll.h> //poll
+	#include <sys/resource.h> //getrlimit, getrusage
+#endif
+
+#ifndef RB_DISABLE_SHM
+	#ifndef WIN_BUILD
+		#include <sys/mman.h> //mmap
+		#include <sys/shm.h> //shm_open, shm_unlink, mmap
+		#include <uuid/uuid.h> //uuid_generate_time_safe
+	#else
+		#include "win/mman.h"
+		#include "win/uuid.h" //uuid_generate_time_safe
+	#endif
+	#include <unistd.h> //ftruncate
+	#include <fcntl.h> //constants O_CREAT, ..
+	#include <sys/stat.h> //
+#endif
+
+#define RB_CACHE_LINE_SIZE 64
+/**< Alignment of rb_t and of the reader and writer parts of it.*/
+
+static inline uint64_t rb_MIN(uint64_t a, uint64_t b) {return a<b ? a : b;}
+static inline uint64_t rb_MAX(uint64_t a, uint64_t b) {return a>b ? a : b;}
+
+static const char *bar_string="============================================================";
+/**< Used in method rb_debug_linearbar() to indicate buffer fill level.*/
+
+/**
+ * Ringbuffers are of type rb_t.
+ * 
+ * The members of an rb_t struct must normally not be changed directly by a user of rb.h.
+ * However it can be done, this is an open system. Not using the rb_*() functions to operate
+ * on rb_t will produce arbitrary results.
+ *
+ * Example use:
+ * @code
+ * rb_t *ringbuffer;
+ * ringbuffer=rb_new(1024);
+ * if(ringbuffer!=NULL) { //do stuff }
+ * @endcode
+ */
+//the reader and the writer each own one cache line of rb_t. positions, cached copies of the
+//other side's position and statistics are only ever written by the owning side, so the two
+//threads don't invalidate each other's cache line on every operation.
+//all members are naturally aligned and the padding is explicit, sizeof(rb_t) is a multiple of
+//RB_CACHE_LINE_SIZE (checked below) so that the same layout is seen by every process.
+typedef struct
+{
+  //cache line 0: set at creation, rarely written
+  char magic[8];		/**< \brief The first 8 bytes of a ringbuffer data structure. Like in a file header, this "MAGIC" signature helps to quickly identify if these bytes could be the start of a rb.h ringbuffer data structure.*/
+  float version;		/**< \brief Version of rb.h. This can be used to verify that the binary format of other rb.h in use match this one.*/
+  int32_t frame_shift;		/**< \brief log2(frame_size) if frame_size is a power of two, -1 otherwise. Used to convert between bytes and frames without division.*/
+  uint64_t size;		/**< \brief Size in bytes of the buffer as requested by caller.*/
+  uint64_t size_mask;		/**< \brief size-1 if size is a power of two (positions are masked instead of taken modulo size), 0 otherwise.*/
+
+  int32_t memory_locked;	/**< \brief Whether or not the buffer is locked to memory (if locked, no virtual memory disk swaps).*/
+  int32_t in_shared_memory;	/**< \brief Whether or not the buffer is allocated as a file in shared memory (normally found under '/dev/shm') on a Linux system.*/
+
+  int32_t mirrored;		/**< \brief Whether or not the buffer is mapped twice back to back, so that any readable or writable span is contiguous (see rb_new_mirrored()).*/
+  int32_t buffer_offset;	/**< \brief Offset of the buffer from the start of rb_t. sizeof(rb_t), or rb_t padded to whole pages for a mirrored buffer.*/
+
+  int32_t no_more_input_data;	/**< \brief A writer can indicate that no more data will be put to the ringbuffer, i.e. the writer finished.*/
+
+  int32_t channel_count;	/**< \brief Count of channels stored in this buffer (interleaved).*/
+  int32_t bytes_per_sample;	/**< \brief Count of bytes per audio sample.*/
+  int32_t frame_size;		/**< \brief Count of bytes per multichannel frame (channel_count * bytes_per_sample).*/
+
+  //cache line 1: written by the writer only
+  uint64_t write_index;		/**< \brief Absolute position (count of bytes ever written) for write operations. Never wraps, the offset in the buffer is write_index % size. Stored with release semantics after the data.*/
+  uint64_t read_index_cache;	/**< \brief The writer's last seen value of read_index. The writer only loads read_index again if this value doesn't leave enough space.*/
+  uint64_t total_bytes_write;	/**< \brief Total bytes written to this ringbuffer. Advancing the write index is interpreted as a write operation. Internal calls are also counted. rb_reset() and rb_reset_stats() will reset this value.*/
+  uint64_t total_overflows;	/**< \brief Total overflow incidents (not bytes): could not write the requested amount of bytes. rb_reset() and rb_reset_stats() will reset this value.*/
+  char pad_writer[32];
+
+  //cache line 2: written by the reader only
+  uint64_t read_index;		/**< \brief Absolute position (count of bytes ever read) for read operations. Never wraps, the offset in the buffer is read_index % size. read_index <= write_index <= read_index + size.*/
+  uint64_t write_index_cache;	/**< \brief The reader's last seen value of write_index. The reader only loads write_index again if this value doesn't provide enough data.*/
+  uint64_t total_bytes_read;	/**< \brief Total bytes read from this ringbuffer. Aadvancing the read index is iterpreted as a read operation. Internal calls are also counted. rb_reset() and rb_reset_stats() will reset this value.*/
+  uint64_t total_bytes_peek;	/**< \brief Total bytes peeked from this ringbuffer. rb_reset() will reset this value.*/
+  uint64_t total_underflows;	/**< \brief Total underflow incidents (not bytes): could not read the requested amount of bytes. rb_reset() and rb_reset_stats() will reset this value.*/
+  char pad_reader[24];
+
+  char shm_handle[256];		/**< \brief Name of shared memory file, alphanumeric handle.*/
+  char human_name[256];		/**< \brief Name of buffer, alphanumeric.*/
+
+#ifndef RB_DISABLE_RW_MUTEX
+  pthread_mutex_t read_lock;	/**< \brief Mutex lock for mutually exclusive read operations.*/
+  pthread_mutex_t write_lock;	/**< \brief Mutex lock for mutually exclusive write operations.*/
+  pthread_mutexattr_t mutex_attributes;
+  #ifdef _32_BIT
+  //84 vs 52 bytes -> diff 32
+  char pad[32];
+  #endif
+#else
+  //pad datatype to get equal header size
+  //char pad[sizeof(pthread_mutexattr_t)+sizeof(pthread_mutex_t)+sizeof(pthread_mutex_t)];
+  char pad[84];
+#endif
+
+  int32_t memory_lockable;	/**< \brief Whether or not the buffer can possibly be locked to memory using mlock(). This flag is 0 if rb.h is compiled with RB_DISABLE_MLOCK, 1 otherwise. */
+  int32_t memory_shareable;	/**< \brief Whether or not the buffer can possibly be created or accessed in shared memory. This flag is 0 if rb.h is compiled with RB_DISABLE_SHM, 1 otherwise. */
+  int32_t mutex_lockable;	/**< \brief Whether or not the buffer can possibly be locked for exclusive read or write access using pthread_mutex. This flag is 0 if rb.h is compiled with RB_DISABLE_RW_MUTEX, 1 otherwise. */
+
+  int32_t unlink_requested;	/**< \brief If set to 1, readers and writers should consider the buffer deleted, not using it anymore (unlinking it with rb_free()).*/ 
+  int32_t sample_rate;		/**< \brief If ringbuffer is used as audio buffer, sample_rate is > 0.*/
+
+  //round up to whole cache lines, the buffer starts right after rb_t (unless mirrored)
+  char pad_end[24];
+}
+rb_t;
+
+//compile time check of the layout: fails to compile if sizeof(rb_t) isn't a multiple of the cache line size
+typedef char rb_t_size_check[(sizeof(rb_t)%RB_CACHE_LINE_SIZE==0) ? 1 : -1];
+
+//make struct memebers accessible via function
+
+/** Access rb_t member 'version' via method.*/
+static inline int rb_version(rb_t *rb) {return rb->version;}
+/** Access rb_t member 'memory_locked' via method.*/
+static inline int rb_is_mlocked(rb_t *rb) {return rb->memory_locked;}
+/** Access rb_t member 'in_shared_memory' via method.*/
+static inline int rb_is_shared(rb_t *rb) {return rb->in_shared_memory;}
+/** Access rb_t member 'memory_lockable' via method.*/
+static inline int rb_is_memory_lockable(rb_t *rb) {return rb->memory_lockable;}
+/** Access rb_t member 'memory_shareable' via method.*/
+static inline int rb_is_memory_shareable(rb_t *rb) {return rb->memory_shareable;}
+/** Access rb_t member 'mutex_lockable' via method.*/
+static inline int rb_is_mutex_lockable(rb_t *rb) {return rb->mutex_lockable;}
+/** Access rb_t member 'mirrored' via method.*/
+static inline int rb_is_mirrored(rb_t *rb) {return rb->mirrored;}
+/** Access rb_t member 'unlink_requested' via method.*/
+static inline int rb_is_unlink_requested(rb_t *rb) {return rb->unlink_requested;}
+/** Access rb_t member 'unlink_requested' via method.*/
+static inline void rb_request_unlink(rb_t *rb) {rb->unlink_requested=1;}
+/** Access rb_t member 'size' via method.*/
+static inline uint64_t rb_size(rb_t *rb){return rb->size;}
+/** Access rb_t member 'shm_handle' via method.*/
+static inline char *rb_shared_memory_handle(rb_t *rb) {return rb->shm_handle;}
+/** Access rb_t member 'human_name' via method.*/
+static inline char *rb_human_name(rb_t *rb) {return rb->human_name;}
+/** Access rb_t member 'sample_rate' via method.*/
+static inline int rb_sample_rate(rb_t *rb) {return rb->sample_rate;}
+/** Access rb_t member 'channel_count' via method.*/
+static inline int rb_channel_count(rb_t *rb) {return rb->channel_count;}
+/** Access rb_t member 'bytes_per_sample' via method.*/
+static inline int rb_bytes_per_sample(rb_t *rb) {return rb->bytes_per_sample;}
+
+/**
+ * Read and write regions are of type rb_region_t.
+ * 
+ * A region is a continuous part in the ringbuffer, defined through start (pointer) and length (size).
+ * 
+ * See rb_get_read_regions(), rb_get_write_regions(), rb_get_next_read_region(), rb_get_next_write_region().
+ *
+ * Example use:
+ * @code
+ * rb_region_t regions[2];
+ * rb_get_read_regions(rb,regions);
+ * if(regions[0].size>0) { //do stuff with regions[0].buffer, first part of possible split }
+ * if(regions[1].size>0) { //do stuff with regions[1].buffer, second part of possible split }
+ * @endcode
+ */
+typedef struct  
+{
+  char  *buffer;	/**< \brief Pointer to location in main byte buffer. It correponds to a partial (segment)
+			      or full area of the main byte buffer in rb_t.*/
+  uint64_t size;		/**< \brief Count of bytes that can be read from the buffer region.*/
+} 
+rb_region_t;
+
+/**
+ * Wakes a thread that waits for a ringbuffer to become readable or writable, see rb_notifier_new().
+ *
+ * A notifier is local to the process (it holds an eventfd), even if the ringbuffer is in shared memory.
+ */
+typedef struct
+{
+  int fd;			/**< \brief eventfd, readable while a wakeup is pending. Can be added to poll(), select() or epoll sets.*/
+  int32_t armed;		/**< \brief 1 while the waiting side is blocked (or about to block). rb_notify() only writes to fd if set.*/
+  int32_t condition;		/**< \brief What the waiting side waits for: #RB_WAIT_ANY, #RB_WAIT_READABLE or #RB_WAIT_WRITABLE.*/
+  const rb_t *rb;		/**< \brief Ringbuffer the condition refers to.*/
+  uint64_t watermark;		/**< \brief Count of readable (writable) bytes that satisfies the condition.*/
+  uint64_t total_notifications;	/**< \brief Count of wakeups sent (writes to fd).*/
+}
+rb_notifier_t;
+
+/** rb_notifier_t condition: any rb_notify() wakes the waiting side.*/
+#define RB_WAIT_ANY 0
+/** rb_notifier_t condition: rb_notify() wakes the waiting side if rb_can_read() reached the watermark.*/
+#define RB_WAIT_READABLE 1
+/** rb_notifier_t condition: rb_notify() wakes the waiting side if rb_can_write() reached the watermark.*/
+#define RB_WAIT_WRITABLE 2
+
+/** Allocation policy flag: touch every page of new buffers at creation, so that the first writes
+(i.e. in a realtime thread) don't page-fault. See rb_set_alloc_policy().*/
+#define RB_ALLOC_PREFAULT 1
+/** Allocation policy flag: ask for transparent hugepages for new buffers (madvise(MADV_HUGEPAGE)).
+Large buffers then need fewer TLB entries. See rb_set_alloc_policy().*/
+#define RB_ALLOC_HUGEPAGES 2
+/** Allocation policy flag: lock new buffers to memory with mlock() (implies #RB_ALLOC_PREFAULT).
+Creating a buffer fails if it can't be locked. See rb_set_alloc_policy().*/
+#define RB_ALLOC_MLOCK 4
+
+/** Transparent hugepage size on x86_64 and aarch64 (4k pages). Buffers of at least this size are
+aligned to it if #RB_ALLOC_HUGEPAGES is set.*/
+#define RB_HUGEPAGE_SIZE (2*1024*1024)
+
+/**
+ * A shadow read cursor follows the writer of a ringbuffer without consuming data, see rb_shadow_new().
+ *
+ * The ringbuffer is never written to: read_index, statistics and the reader are left alone.
+ * A shadow cursor can't hold back the writer, bytes that are overwritten before the shadow
+ * cursor got to them are skipped and counted as lost.
+ */
+typedef struct
+{
+  const rb_t *rb;		/**< \brief Ringbuffer to follow.*/
+  const char *buffer;		/**< \brief Start of the buffer of rb.*/
+  uint64_t size;		/**< \brief Copy of the ringbuffer size (the owner sets it to 0 in rb_free()).*/
+  uint64_t frame_size;		/**< \brief Copy of the ringbuffer frame size (1 if not an audio buffer). Positions are kept at frame boundaries.*/
+  int32_t mirrored;		/**< \brief Copy of the ringbuffer mirrored flag.*/
+  int32_t pad;
+  uint64_t mapped_size;		/**< \brief Bytes mapped by rb_shadow_open(), 0 if rb is a ringbuffer of this process (rb_shadow_new()).*/
+  uint64_t position;		/**< \brief Absolute position of the next byte to read, like read_index but independent of it.*/
+  uint64_t guard;		/**< \brief Bytes the writer is assumed to have in flight at most (copied to the buffer, write_index not yet advanced). Bytes closer than that to being overwritten are not read. Default: size/4.*/
+  uint64_t total_bytes_read;	/**< \brief Total bytes copied by rb_shadow_read().*/
+  uint64_t total_bytes_lost;	/**< \brief Total bytes skipped because the writer was faster than the shadow cursor.*/
+  uint64_t total_overruns;	/**< \brief Total overrun incidents (not bytes): the writer lapped the shadow cursor.*/
+}
+rb_shadow_t;
+
+static inline void rb_set_common_init_values(rb_t *rb);
+static inline rb_t *rb_new(uint64_t size);
+static inline rb_t *rb_new_named(uint64_t size, const char *name);
+static inline rb_t *rb_new_audio(uint64_t size, const char *name, int sample_rate, int channel_count, int bytes_per_sample);
+static inline rb_t *rb_new_audio_seconds(double seconds, const char *name, int sample_rate, int channel_count, int bytes_per_sample);
+static inline rb_t *rb_new_shared(uint64_t size);
+static inline rb_t *rb_open_shared(const char *shm_handle);
+static inline rb_t *rb_new_mirrored(uint64_t size);
+static inline rb_t *rb_new_mirrored_audio(uint64_t size, const char *name, int sample_rate, int channel_count, int bytes_per_sample);
+static inline rb_t *rb_new_mirrored_audio_seconds(double seconds, const char *name, int sample_rate, int channel_count, int bytes_per_sample);
+static inline rb_t *rb_new_shared_mirrored_audio(uint64_t size, const char *name, int sample_rate, int channel_count, int bytes_per_sample);
+static inline rb_t *rb_new_shared_named(uint64_t size, const char *name);
+static inline rb_t *rb_new_shared_audio(uint64_t size, const char *name, int sample_rate, int channel_count, int bytes_per_sample);
+static inline rb_t *rb_new_shared_audio_seconds(double seconds, const char *name, int sample_rate, int channel_count, int bytes_per_sample);
+
+static inline void rb_free(rb_t *rb);
+static inline int rb_mlock(rb_t *rb);
+static inline int rb_munlock(rb_t *rb);
+static inline void rb_set_alloc_policy(int policy);
+static inline int rb_get_alloc_policy();
+static inline int rb_parse_alloc_policy(const char *list);
+static inline void rb_alloc_policy_string(int policy, char *buf, size_t size);
+static inline void *rb_alloc_scratch(uint64_t size);
+static inline void rb_free_scratch(void *buffer, uint64_t size);
+static inline int rb_page_faults(uint64_t *minor, uint64_t *major);
+static inline int rb_is_mlocked(rb_t *rb);
+static inline int rb_is_shared(rb_t *rb);
+static inline uint64_t rb_size(rb_t *rb);
+static inline char *rb_shared_memory_handle(rb_t *rb);
+static inline void rb_reset(rb_t *rb);
+static inline uint64_t rb_can_read(const rb_t *rb);
+static inline uint64_t rb_can_read_frames(const rb_t *rb);
+static inline uint64_t rb_can_write(const rb_t *rb);
+static inline uint64_t rb_can_write_frames(const rb_t *rb);
+static inline uint64_t rb_generic_read(rb_t *rb, char *destination, uint64_t count, int over);
+static inline uint64_t rb_read(rb_t *rb, char *destination, uint64_t count);
+static inline uint64_t rb_overread(rb_t *rb, char *destination, uint64_t count);
+static inline uint64_t rb_write(rb_t *rb, const char *source, uint64_t count);
+static inline uint64_t rb_peek(rb_t *rb, char *destination, uint64_t count);
+static inline uint64_t rb_peek_at(rb_t *rb, char *destination, uint64_t count, uint64_t offset);
+static inline uint64_t rb_drop(rb_t *rb);
+static inline int rb_find_byte(rb_t *rb, char byte, uint64_t *offset);
+static inline int rb_find_byte_sequence(rb_t *rb, char *pattern, uint64_t pattern_offset, uint64_t count, uint64_t *offset);
+static inline uint64_t rb_read_byte(rb_t *rb, char *destination);
+static inline uint64_t rb_peek_byte(rb_t *rb, char *destination);
+static inline uint64_t rb_peek_byte_at(rb_t *rb, char *destination, uint64_t offset);
+static inline uint64_t rb_skip_byte(rb_t *rb);
+static inline uint64_t rb_write_byte(rb_t *rb, const char *source);
+static inline uint64_t rb_deinterleave_items(rb_t *rb, char *destination ,uint64_t item_count, uint64_t item_size, uint64_t initial_item_offset, uint64_t item_block_size);
+static inline uint64_t rb_deinterleave_audio(rb_t *rb, char *destination ,uint64_t frame_count, uint64_t frame_offset);
+static inline uint64_t rb_deinterleave_audio_channels(rb_t *rb, char **destinations, uint64_t frame_count);
+static inline uint64_t rb_interleave_audio_channels(rb_t *rb, const char **sources, uint64_t frame_count);
+static inline uint64_t rb_generic_advance_read_index(rb_t *rb, uint64_t count, int over);
+static inline uint64_t rb_advance_read_index(rb_t *rb, uint64_t count);
+static inline uint64_t rb_overadvance_read_index(rb_t *rb, uint64_t count);
+static inline uint64_t rb_advance_write_index(rb_t *rb, uint64_t count);
+static inline void rb_get_read_regions(const rb_t *rb, rb_region_t *regions);
+static inline void rb_get_write_regions(const rb_t *rb, rb_region_t *regions);
+static inline void rb_get_next_read_region(const rb_t *rb, rb_region_t *region);
+static inline void rb_get_next_write_region(const rb_t *rb, rb_region_t *region);
+static inline char *rb_read_ptr(rb_t *rb, uint64_t *count);
+static inline char *rb_write_ptr(rb_t *rb, uint64_t *count);
+static inline uint64_t rb_write_reserve(rb_t *rb, uint64_t count, rb_region_t *regions);
+static inline uint64_t rb_write_commit(rb_t *rb, uint64_t count);
+static inline uint64_t rb_read_reserve(rb_t *rb, uint64_t count, rb_region_t *regions);
+static inline uint64_t rb_read_commit(rb_t *rb, uint64_t count);
+static inline rb_notifier_t *rb_notifier_new();
+static inline void rb_notifier_free(rb_notifier_t *n);
+static inline int rb_notifier_fd(const rb_notifier_t *n);
+static inline int rb_notifier_arm(rb_notifier_t *n, const rb_t *rb, int condition, uint64_t watermark);
+static inline int rb_notifier_clear(rb_notifier_t *n);
+static inline int rb_notify(rb_notifier_t *n);
+static inline int rb_notifier_wake(rb_notifier_t *n);
+static inline int rb_notifier_wait(rb_notifier_t *n, int timeout_ms);
+static inline int rb_wait_readable(rb_t *rb, rb_notifier_t *n, uint64_t watermark, int timeout_ms);
+static inline int rb_wait_writable(rb_t *rb, rb_notifier_t *n, uint64_t watermark, int timeout_ms);
+static inline rb_shadow_t *rb_shadow_new(const rb_t *rb);
+static inline rb_shadow_t *rb_shadow_open(const char *shm_handle);
+static inline void rb_shadow_free(rb_shadow_t *s);
+static inline const rb_t *rb_shadow_rb(const rb_shadow_t *s);
+static inline void rb_shadow_sync(rb_shadow_t *s);
+static inline uint64_t rb_shadow_can_read(rb_shadow_t *s);
+static inline uint64_t rb_shadow_read(rb_shadow_t *s, char *destination, uint64_t count);
+static inline uint64_t rb_frame_to_byte_count(const rb_t *rb, uint64_t count);
+static inline uint64_t rb_byte_to_frame_count(const rb_t *rb, uint64_t count);
+static inline uint64_t rb_second_to_byte_count(double seconds, int sample_rate, int channel_count, int bytes_per_sample);
+static inline uint64_t rb_audio_size_pow2(uint64_t size, int channel_count, int bytes_per_sample);
+static inline int rb_try_exclusive_read(rb_t *rb);
+static inline void rb_release_read(rb_t *rb);
+static inline int rb_try_exclusive_write(rb_t *rb);
+static inline void rb_release_write(rb_t *rb);
+static inline void *buf_ptr(const rb_t *rb);
+static inline void rb_debug(const rb_t *rb);
+static inline void rb_debug_linearbar(const rb_t *rb);
+static inline void rb_print_regions(const rb_t *rb);
+
+//=============================================================================
+//positions are loaded with acquire and stored with release semantics: the data copied to (from)
+//the buffer is visible to the reader (writer) before the new position is.
+//gcc/clang __atomic builtins work in C and C++ (jack_playfile is compiled with g++) and on shared memory.
+static inline uint64_t _rb_load(const uint64_t *position)
+{
+	return __atomic_load_n(position,__ATOMIC_ACQUIRE);
+}
+
+//=============================================================================
+static inline void _rb_store(uint64_t *position, uint64_t value)
+{
+	__atomic_store_n(position,value,__ATOMIC_RELEASE);
+}
+
+//=============================================================================
+//writer side: space available for writing. read_index is only loaded (shared cache line) 
+//if the cached copy doesn't leave room for count bytes.
+static inline uint64_t _rb_writer_space(rb_t *rb, uint64_t count)
+{
+	uint64_t used=rb->write_index-rb->read_index_cache;
+	if(rb->size-used<count)
+	{
+		rb->read_index_cache=_rb_load(&rb->read_index);
+		used=rb->write_index-rb->read_index_cache;
+	}
+	return rb->size-used;
+}
+
+//=============================================================================
+//reader side: count of bytes available for reading. write_index is only loaded if the cached
+//copy doesn't provide count bytes.
+static inline uint64_t _rb_reader_available(rb_t *rb, uint64_t count)
+{
+	uint64_t available=rb->write_index_cache-rb->read_index;
+	if(available<count)
+	{
+		rb->write_index_cache=_rb_load(&rb->write_index);
+		available=rb->write_index_cache-rb->read_index;
+	}
+	return available;
+}
+
+//=============================================================================
+//bytes between read and write position as seen by any thread (read position loaded first,
+//a concurrent writer can only make the difference bigger)
+static inline uint64_t _rb_used(const rb_t *rb)
+{
+	uint64_t r=_rb_load(&rb->read_index);
+	uint64_t w=_rb_load(&rb->write_index);
+	return rb_MIN(w-r,rb->size);
+}
+
+//=============================================================================
+//offset in the buffer for an absolute position
+static inline uint64_t _rb_offset(const rb_t *rb, uint64_t position)
+{
+	//power of two size: mask, otherwise modulo
+	return rb->size_mask ? position & rb->size_mask : position % rb->size;
+}
+
+//=============================================================================
+//log2 of value if it's a power of two, -1 otherwise
+static inline int _rb_log2(uint64_t value)
+{
+	if(value==0 || (value & (value-1))) {return -1;}
+	int shift=0;
+	while(value>1) {value>>=1; shift++;}
+	return shift;
+}
+
+//=============================================================================
+//set the values derived from size, channel_count and bytes_per_sample
+static inline void _rb_set_derived_values(rb_t *rb)
+{
+	rb->size_mask=_rb_log2(rb->size)>0 ? rb->size-1 : 0;
+	rb->frame_size=rb->channel_count*rb->bytes_per_sample;
+	rb->frame_shift=_rb_log2(rb->frame_size);
+}
+
+//=============================================================================
+//describe count bytes (<= size) starting at buffer offset in two regions. the second
+//region is only used if the bytes wrap around the buffer end (never if mirrored)
+static inline void _rb_fill_regions(const rb_t *rb, uint64_t offset, uint64_t count, rb_region_t *regions)
+{
+	regions[0].buffer=&(  ((char*)buf_ptr(rb))  [offset]);
+	regions[0].size=rb->mirrored ? count : rb_MIN(count,rb->size-offset);
+	regions[1].buffer=  ((char*)buf_ptr(rb));
+	regions[1].size=count-regions[0].size;
+}
+
+//=============================================================================
+//copy count bytes (<= size) out of the buffer starting at absolute position
+static inline void _rb_copy_out(const rb_t *rb, char *destination, uint64_t position, uint64_t count)
+{
+	uint64_t offset=_rb_offset(rb,position);
+	//a mirrored buffer continues past its end
+	uint64_t copy_count_1=rb->mirrored ? count : rb_MIN(count,rb->size-offset);
+	memcpy(destination, &( ((char*)buf_ptr(rb)) [offset] ), copy_count_1);
+	if(copy_count_1<count)
+	{
+		memcpy(destination+copy_count_1, buf_ptr(rb), count-copy_count_1);
+	}
+}
+
+//=============================================================================
+//copy count bytes (<= size) into the buffer starting at absolute position
+static inline void _rb_copy_in(rb_t *rb, const char *source, uint64_t position, uint64_t count)
+{
+	uint64_t offset=_rb_offset(rb,position);
+	//a mirrored buffer continues past its end
+	uint64_t copy_count_1=rb->mirrored ? count : rb_MIN(count,rb->size-offset);
+	memcpy( &( ((char*)buf_ptr(rb)) [offset] ), source, copy_count_1);
+	if(copy_count_1<count)
+	{
+		memcpy(buf_ptr(rb), source+copy_count_1, count-copy_count_1);
+	}
+}
+
+//frames per block in the deinterleave / interleave loops (16 float samples: one cache line per channel)
+#define RB_DEINTERLEAVE_BLOCK 16
+
+//=============================================================================
+//deinterleave frame_count frames of channel_count samples (bytes_per_sample each) from source.
+//channel c goes to destinations[c], starting at sample destination_offset. plain loop, any format
+static inline void _rb_deinterleave_generic(const char *source, char **destinations, uint64_t destination_offset
+	,uint64_t frame_count, int channel_count, int bytes_per_sample)
+{
+	uint64_t block;
+	uint64_t i;
+	int c;
+	//blocks of RB_DEINTERLEAVE_BLOCK frames, channel by channel: every destination is written a
+	//cache line at a time, the source block stays in the cache
+	for(block=0;block<frame_count;block+=RB_DEINTERLEAVE_BLOCK)
+	{
+		uint64_t end=rb_MIN(block+RB_DEINTERLEAVE_BLOCK,frame_count);
+		for(c=0;c<channel_count;c++)
+		{
+			if(bytes_per_sample==sizeof(float))
+			{
+				const float *s=(const float*)source+c;
+				float *d=(float*)destinations[c]+destination_offset;
+				for(i=block;i<end;i++) {d[i]=s[i*channel_count];}
+				continue;
+			}
+			for(i=block;i<end;i++)
+			{
+				memcpy(destinations[c]+(destination_offset+i)*bytes_per_sample
+					,source+(i*channel_count+c)*bytes_per_sample,bytes_per_sample);
+			}
+		}
+	}
+}
+
+//=============================================================================
+//reverse of _rb_deinterleave_generic(): sources[c] starting at sample source_offset to interleaved destination
+static inline void _rb_interleave_generic(char *destination, const char **sources, uint64_t source_offset
+	,uint64_t frame_count, int channel_count, int bytes_per_sample)
+{
+	uint64_t block;
+	uint64_t i;
+	int c;
+	for(block=0;block<frame_count;block+=RB_DEINTERLEAVE_BLOCK)
+	{
+		uint64_t end=rb_MIN(block+RB_DEINTERLEAVE_BLOCK,frame_count);
+		for(c=0;c<channel_count;c++)
+		{
+			if(bytes_per_sample==sizeof(float))
+			{
+				const float *s=(const float*)sources[c]+source_offset;
+				float *d=(float*)destination+c;
+				for(i=block;i<end;i++) {d[i*channel_count]=s[i];}
+				continue;
+			}
+			for(i=block;i<end;i++)
+			{
+				memcpy(destination+(i*channel_count+c)*bytes_per_sample
+					,sources[c]+(source_offset+i)*bytes_per_sample,bytes_per_sample);
+			}
+		}
+	}
+}
+
+//=============================================================================
+//float kernels for 1, 2, 6 and any multiple of 4 channels. they handle whole vectors of frames and
+//return the count of frames done, the rest is left to the generic loop
+static inline uint64_t _rb_deinterleave_float(const float *s, char **destinations, uint64_t offset
+	,uint64_t frame_count, int channel_count)
+{
+	uint64_t i=0;
+	if(channel_count==1)
+	{
+		memcpy((float*)destinations[0]+offset,s,frame_count*sizeof(float));
+		return frame_count;
+	}
+#ifdef RB_SSE
+	float *d[8];
+	int c;
+	for(c=0;c<channel_count && c<8;c++) {d[c]=(float*)destinations[c]+offset;}
+
+	switch(channel_count)
+	{
+	case 2:
+	#ifdef RB_AVX
+		for(;i+8<=frame_count;i+=8)
+		{
+			__m256 x=_mm256_loadu_ps(s+2*i);
+			__m256 y=_mm256_loadu_ps(s+2*i+8);
+			//frames 0,1,4,5 and 2,3,6,7: even/odd elements per lane are then in order
+			__m256 lo=_mm256_permute2f128_ps(x,y,0x20);
+			__m256 hi=_mm256_permute2f128_ps(x,y,0x31);
+			_mm256_storeu_ps(d[0]+i,_mm256_shuffle_ps(lo,hi,_MM_SHUFFLE(2,0,2,0)));
+			_mm256_storeu_ps(d[1]+i,_mm256_shuffle_ps(lo,hi,_MM_SHUFFLE(3,1,3,1)));
+		}
+	#endif
+		for(;i+4<=frame_count;i+=4)
+		{
+			__m128 a=_mm_loadu_ps(s+2*i);
+			__m128 b=_mm_loadu_ps(s+2*i+4);
+			_mm_storeu_ps(d[0]+i,_mm_shuffle_ps(a,b,_MM_SHUFFLE(2,0,2,0)));
+			_mm_storeu_ps(d[1]+i,_mm_shuffle_ps(a,b,_MM_SHUFFLE(3,1,3,1)));
+		}
+		break;
+	case 6:
+		for(;i+4<=frame_count;i+=4)
+		{
+			//4 frames of 6 channels in 6 vectors. channels 0-3 of each frame, then 4-5
+			const float *f=s+6*i;
+			__m128 v1=_mm_loadu_ps(f+4);
+			__m128 v2=_mm_loadu_ps(f+8);
+			__m128 v4=_mm_loadu_ps(f+16);
+			__m128 v5=_mm_loadu_ps(f+20);
+			__m128 r0=_mm_loadu_ps(f);
+			__m128 r1=_mm_shuffle_ps(v1,v2,_MM_SHUFFLE(1,0,3,2));
+			__m128 r2=_mm_loadu_ps(f+12);
+			__m128 r3=_mm_shuffle_ps(v4,v5,_MM_SHUFFLE(1,0,3,2));
+			__m128 h0=_mm_shuffle_ps(v1,v2,_MM_SHUFFLE(3,2,1,0));
+			__m128 h1=_mm_shuffle_ps(v4,v5,_MM_SHUFFLE(3,2,1,0));
+			_MM_TRANSPOSE4_PS(r0,r1,r2,r3);
+			_mm_storeu_ps(d[0]+i,r0);
+			_mm_storeu_ps(d[1]+i,r1);
+			_mm_storeu_ps(d[2]+i,r2);
+			_mm_storeu_ps(d[3]+i,r3);
+			_mm_storeu_ps(d[4]+i,_mm_shuffle_ps(h0,h1,_MM_SHUFFLE(2,0,2,0)));
+			_mm_storeu_ps(d[5]+i,_mm_shuffle_ps(h0,h1,_MM_SHUFFLE(3,1,3,1)));
+		}
+		break;
+	case 8:
+	#ifdef RB_AVX
+		for(;i+8<=frame_count;i+=8)
+		{
+			//8x8 transpose
+			const float *f=s+8*i;
+			__m256 t0=_mm256_unpacklo_ps(_mm256_loadu_ps(f),_mm256_loadu_ps(f+8));
+			__m256 t1=_mm256_unpackhi_ps(_mm256_loadu_ps(f),_mm256_loadu_ps(f+8));
+			__m256 t2=_mm256_unpacklo_ps(_mm256_loadu_ps(f+16),_mm256_loadu_ps(f+24));
+			__m256 t3=_mm256_unpackhi_ps(_mm256_loadu_ps(f+16),_mm256_loadu_ps(f+24));
+			__m256 t4=_mm256_unpacklo_ps(_mm256_loadu_ps(f+32),_mm256_loadu_ps(f+40));
+			__m256 t5=_mm256_unpackhi_ps(_mm256_loadu_ps(f+32),_mm256_loadu_ps(f+40));
+			__m256 t6=_mm256_unpacklo_ps(_mm256_loadu_ps(f+48),_mm256_loadu_ps(f+56));
+			__m256 t7=_mm256_unpackhi_ps(_mm256_loadu_ps(f+48),_mm256_loadu_ps(f+56));
+			__m256 u0=_mm256_shuffle_ps(t0,t2,_MM_SHUFFLE(1,0,1,0));
+			__m256 u1=_mm256_shuffle_ps(t0,t2,_MM_SHUFFLE(3,2,3,2));
+			__m256 u2=_mm256_shuffle_ps(t1,t3,_MM_SHUFFLE(1,0,1,0));
+			__m256 u3=_mm256_shuffle_ps(t1,t3,_MM_SHUFFLE(3,2,3,2));
+			__m256 u4=_mm256_shuffle_ps(t4,t6,_MM_SHUFFLE(1,0,1,0));
+			__m256 u5=_mm256_shuffle_ps(t4,t6,_MM_SHUFFLE(3,2,3,2));
+			__m256 u6=_mm256_shuffle_ps(t5,t7,_MM_SHUFFLE(1,0,1,0));
+			__m256 u7=_mm256_shuffle_ps(t5,t7,_MM_SHUFFLE(3,2,3,2));
+			_mm256_storeu_ps(d[0]+i,_mm256_permute2f128_ps(u0,u4,0x20));
+			_mm256_storeu_ps(d[1]+i,_mm256_permute2f128_ps(u1,u5,0x20));
+			_mm256_storeu_ps(d[2]+i,_mm256_permute2f128_ps(u2,u6,0x20));
+			_mm256_storeu_ps(d[3]+i,_mm256_permute2f128_ps(u3,u7,0x20));
+			_mm256_storeu_ps(d[4]+i,_mm256_permute2f128_ps(u0,u4,0x31));
+			_mm256_storeu_ps(d[5]+i,_mm256_permute2f128_ps(u1,u5,0x31));
+			_mm256_storeu_ps(d[6]+i,_mm256_permute2f128_ps(u2,u6,0x31));
+			_mm256_storeu_ps(d[7]+i,_mm256_permute2f128_ps(u3,u7,0x31));
+		}
+	#endif
+		//FALLTHROUGH
+	default:
+		if(channel_count%4) {break;}
+		//4x4 transposes (4 frames of 4 channels), in blocks of frames so that every
+		//destination is written a cache line at a time
+		{
+			uint64_t end=frame_count & ~(uint64_t)3;
+			uint64_t block;
+			for(block=i;block<end;block+=RB_DEINTERLEAVE_BLOCK)
+			{
+				uint64_t block_end=rb_MIN(block+RB_DEINTERLEAVE_BLOCK,end);
+				for(c=0;c<channel_count;c+=4)
+				{
+					uint64_t k;
+					for(k=block;k<block_end;k+=4)
+					{
+						const float *f=s+k*channel_count+c;
+						__m128 r0=_mm_loadu_ps(f);
+						__m128 r1=_mm_loadu_ps(f+channel_count);
+						__m128 r2=_mm_loadu_ps(f+2*channel_count);
+						__m128 r3=_mm_loadu_ps(f+3*channel_count);
+						_MM_TRANSPOSE4_PS(r0,r1,r2,r3);
+						_mm_storeu_ps((float*)destinations[c]+offset+k,r0);
+						_mm_storeu_ps((float*)destinations[c+1]+offset+k,r1);
+						_mm_storeu_ps((float*)destinations[c+2]+offset+k,r2);
+						_mm_storeu_ps((float*)destinations[c+3]+offset+k,r3);
+					}
+				}
+			}
+			i=end;
+		}
+		break;
+	}
+#endif
+	return i;
+}
+
+//=============================================================================
+//reverse of _rb_deinterleave_float()
+static inline uint64_t _rb_interleave_float(float *d, const char **sources, uint64_t offset
+	,uint64_t frame_count, int channel_count)
+{
+	uint64_t i=0;
+	if(channel_count==1)
+	{
+		memcpy(d,(const float*)sources[0]+offset,frame_count*sizeof(float));
+		return frame_count;
+	}
+#ifdef RB_SSE
+	const float *s[8];
+	int c;
+	for(c=0;c<channel_count && c<8;c++) {s[c]=(const float*)sources[c]+offset;}
+
+	switch(channel_count)
+	{
+	case 2:
+		for(;i+4<=frame_count;i+=4)
+		{
+			__m128 l=_mm_loadu_ps(s[0]+i);
+			__m128 r=_mm_loadu_ps(s[1]+i);
+			_mm_storeu_ps(d+2*i,_mm_unpacklo_ps(l,r));
+			_mm_storeu_ps(d+2*i+4,_mm_unpackhi_ps(l,r));
+		}
+		break;
+	case 6:
+		for(;i+4<=frame_count;i+=4)
+		{
+			//channels 0-3 of 4 frames, channels 4-5 pairwise, then merge to 6 vectors
+			float *f=d+6*i;
+			__m128 r0=_mm_loadu_ps(s[0]+i);
+			__m128 r1=_mm_loadu_ps(s[1]+i);
+			__m128 r2=_mm_loadu_ps(s[2]+i);
+			__m128 r3=_mm_loadu_ps(s[3]+i);
+			__m128 c4=_mm_loadu_ps(s[4]+i);
+			__m128 c5=_mm_loadu_ps(s[5]+i);
+			_MM_TRANSPOSE4_PS(r0,r1,r2,r3);
+			__m128 h0=_mm_unpacklo_ps(c4,c5);
+			__m128 h1=_mm_unpackhi_ps(c4,c5);
+			_mm_storeu_ps(f,r0);
+			_mm_storeu_ps(f+4,_mm_shuffle_ps(h0,r1,_MM_SHUFFLE(1,0,1,0)));
+			_mm_storeu_ps(f+8,_mm_shuffle_ps(r1,h0,_MM_SHUFFLE(3,2,3,2)));
+			_mm_storeu_ps(f+12,r2);
+			_mm_storeu_ps(f+16,_mm_shuffle_ps(h1,r3,_MM_SHUFFLE(1,0,1,0)));
+			_mm_storeu_ps(f+20,_mm_shuffle_ps(r3,h1,_MM_SHUFFLE(3,2,3,2)));
+		}
+		break;
+	default:
+		if(channel_count%4) {break;}
+		//4x4 transposes, in blocks of frames (see _rb_deinterleave_float())
+		{
+			uint64_t end=frame_count & ~(uint64_t)3;
+			uint64_t block;
+			for(block=i;block<end;block+=RB_DEINTERLEAVE_BLOCK)
+			{
+				uint64_t block_end=rb_MIN(block+RB_DEINTERLEAVE_BLOCK,end);
+				for(c=0;c<channel_count;c+=4)
+				{
+					uint64_t k;
+					for(k=block;k<block_end;k+=4)
+					{
+						float *f=d+k*channel_count+c;
+						__m128 r0=_mm_loadu_ps((const float*)sources[c]+offset+k);
+						__m128 r1=_mm_loadu_ps((const float*)sources[c+1]+offset+k);
+						__m128 r2=_mm_loadu_ps((const float*)sources[c+2]+offset+k);
+						__m128 r3=_mm_loadu_ps((const float*)sources[c+3]+offset+k);
+						_MM_TRANSPOSE4_PS(r0,r1,r2,r3);
+						_mm_storeu_ps(f,r0);
+						_mm_storeu_ps(f+channel_count,r1);
+						_mm_storeu_ps(f+2*channel_count,r2);
+						_mm_storeu_ps(f+3*channel_count,r3);
+					}
+				}
+			}
+			i=end;
+		}
+		break;
+	}
+#endif
+	return i;
+}
+
+//=============================================================================
+//deinterleave a contiguous block: kernel for the common float layouts, generic loop for the rest
+static inline void _rb_deinterleave_block(const char *source, char **destinations, uint64_t destination_offset
+	,uint64_t frame_count, int channel_count, int bytes_per_sample)
+{
+	uint64_t done=0;
+	if(bytes_per_sample==sizeof(float))
+	{
+		done=_rb_deinterleave_float((const float*)source,destinations,destination_offset,frame_count,channel_count);
+	}
+	_rb_deinterleave_generic(source+done*channel_count*bytes_per_sample,destinations,destination_offset+done
+		,frame_count-done,channel_count,bytes_per_sample);
+}
+
+//=============================================================================
+//reverse of _rb_deinterleave_block()
+static inline void _rb_interleave_block(char *destination, const char **sources, uint64_t source_offset
+	,uint64_t frame_count, int channel_count, int bytes_per_sample)
+{
+	uint64_t done=0;
+	if(bytes_per_sample==sizeof(float))
+	{
+		done=_rb_interleave_float((float*)destination,sources,source_offset,frame_count,channel_count);
+	}
+	_rb_interleave_generic(destination+done*channel_count*bytes_per_sample,sources,source_offset+done
+		,frame_count-done,channel_count,bytes_per_sample);
+}
+
+/*
+*/
+//=============================================================================
+static inline int _shm_open(const char *shm_handle,int oflag, mode_t mode)
+{
+#ifndef RB_DISABLE_SHM
+	#ifndef WIN_BUILD
+		//int shm_open(const char *name, int oflag, mode_t mode);
+		return shm_open(shm_handle,oflag,mode);
+	#else
+		mode=S_IRUSR | S_IWUSR;
+		return open(shm_handle, oflag, mode);
+	#endif
+#else
+	return -1;
+#endif
+}
+
+/*
+*/
+//=============================================================================
+static inline int _shm_unlink(const char *shm_handle)
+{
+#ifndef RB_DISABLE_SHM
+	#ifndef WIN_BUILD
+		//int shm_unlink(const char *name);
+		return shm_unlink(shm_handle);
+	#else
+		///unmap
+	#endif
+#else
+	return -1;
+#endif
+}
+
+/**
+ * Used internally while creating new instances of rb_t.
+ * This function sets all rb_t members to an initial value.
+ */
+//=============================================================================
+static inline void rb_set_common_init_values(rb_t *rb)
+{
+	strncpy(rb->magic, RB_MAGIC, 8);
+	rb->version=RB_VERSION;
+
+	rb->write_index=0;
+	rb->read_index=0;
+	rb->read_index_cache=0;
+	rb->write_index_cache=0;
+	rb->memory_locked=0;
+	rb->no_more_input_data=0;
+	rb->mirrored=0;
+	rb->buffer_offset=sizeof(rb_t);
+
+	rb->total_bytes_read=0;
+	rb->total_bytes_write=0;
+	rb->total_bytes_peek=0;
+	rb->total_underflows=0;
+	rb->total_overflows=0;
+
+	rb->shm_handle[0]='\0';
+
+#ifndef RB_DISABLE_MLOCK
+	rb->memory_lockable=1;
+#else
+	rb->memory_lockable=0;
+#endif
+
+#ifndef RB_DISABLE_RW_MUTEX
+	rb->mutex_lockable=1;
+#else
+	rb->mutex_lockable=0;
+#endif
+
+#ifndef RB_DISABLE_SHM
+	rb->memory_shareable=1;
+#else
+	rb->memory_shareable=0;
+#endif
+
+#ifndef RB_DISABLE_RW_MUTEX
+	#ifndef RB_DISABLE_SHM
+		pthread_mutexattr_init(&rb->mutex_attributes);
+		pthread_mutexattr_setpshared(&rb->mutex_attributes, PTHREAD_PROCESS_SHARED);
+		pthread_mutex_init(&rb->read_lock, &rb->mutex_attributes);
+		pthread_mutex_init(&rb->write_lock, &rb->mutex_attributes);
+	#else
+		pthread_mutex_init(&rb->read_lock, NULL);
+		pthread_mutex_init(&rb->write_lock, NULL);
+	#endif
+#endif
+}//end rb_set_common_init_values()
+
+/**
+ * Used internally while creating new instances of rb_t.
+ * This function sets the name and audio properties after rb_set_common_init_values().
+ */
+//=============================================================================
+static inline void _rb_set_audio_properties(rb_t *rb, const char *name, int sample_rate, int channel_count, int bytes_per_sample)
+{
+	rb->unlink_requested=0;
+	rb->sample_rate=sample_rate;
+	rb->channel_count=channel_count;
+	rb->bytes_per_sample=bytes_per_sample;
+	_rb_set_derived_values(rb);
+	strncpy(rb->human_name, name, 255);
+}
+
+//=============================================================================
+//round up to whole pages (mirrored buffers map the buffer part separately)
+static inline uint64_t _rb_page_round(uint64_t size)
+{
+#ifndef WIN_BUILD
+	uint64_t page=sysconf(_SC_PAGESIZE);
+#else
+	uint64_t page=4096;
+#endif
+	return (size+page-1)/page*page;
+}
+
+//=============================================================================
+//bytes of address space used by rb (for munmap)
+static inline uint64_t _rb_mapped_size(const rb_t *rb)
+{
+	return rb->buffer_offset + (rb->mirrored ? 2 : 1) * rb->size;
+}
+
+//=============================================================================
+//map fd holding header_size bytes (rb_t padded to whole pages) followed by size bytes
+//of buffer. the buffer is mapped a second time right after the first mapping.
+//prot: PROT_READ | PROT_WRITE, or PROT_READ for a read-only view (see rb_shadow_open())
+static inline rb_t *_rb_map_mirrored(int fd, uint64_t header_size, uint64_t size, int prot)
+{
+#ifndef WIN_BUILD
+	//reserve address space for the header and both views of the buffer
+	char *base=(char*)mmap(0, header_size + 2*size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(base==MAP_FAILED) {return NULL;}
+
+	if(mmap(base, header_size + size, prot, MAP_SHARED | MAP_FIXED, fd, 0)==MAP_FAILED
+		|| mmap(base + header_size + size, size, prot, MAP_SHARED | MAP_FIXED, fd, header_size)==MAP_FAILED)
+	{
+		fprintf(stderr,"rb.h: MAP_FAILED %d %s\n",errno,strerror(errno));
+		munmap(base, header_size + 2*size);
+		return NULL;
+	}
+	return (rb_t*)base;
+#else
+	return NULL;
+#endif
+}
+
+//=============================================================================
+//size the file behind fd and map it mirrored. size must be a multiple of the page size.
+static inline rb_t *_rb_new_mirrored_fd(int fd, uint64_t size)
+{
+#ifndef WIN_BUILD
+	uint64_t header_size=_rb_page_round(sizeof(rb_t));
+	if(ftruncate(fd, header_size + size)) {return NULL;}
+
+	rb_t *rb=_rb_map_mirrored(fd, header_size, size, PROT_READ | PROT_WRITE);
+	if(rb==NULL) {return NULL;}
+
+	rb_set_common_init_values(rb);
+	rb->mirrored=1;
+	rb->buffer_offset=header_size;
+	rb->size=size;
+	return rb;
+#else
+	return NULL;
+#endif
+}
+
+//=============================================================================
+//allocation policy of this translation unit (rb.h is header-only), see rb_set_alloc_policy()
+static inline int *_rb_alloc_policy()
+{
+	static int policy=0;
+	return &policy;
+}
+
+/**
+ * Set the allocation policy for buffers created after the call: ringbuffers created with
+ * any rb_new*() function, queues created with rb_mpmc_new*() (rb_mpmc.h) and scratch
+ * buffers allocated with rb_alloc_scratch().
+ *
+ * The default policy (0) leaves it to the system when pages are faulted in and if they
+ * are swapped out. A program with realtime threads can ask for its buffers to be
+ * resident from the start, i.e. set from a command line option with rb_parse_alloc_policy().
+ *
+ * rb.h is header-only: the policy applies to buffers created in the calling source file.
+ *
+ * @param policy 0 or a combination of #RB_ALLOC_PREFAULT, #RB_ALLOC_HUGEPAGES and #RB_ALLOC_MLOCK.
+ */
+//=============================================================================
+static inline void rb_set_alloc_policy(int policy)
+{
+	*_rb_alloc_policy()=policy;
+}
+
+/**
+ * Return the allocation policy set with rb_set_alloc_policy().
+ *
+ * @return 0 or a combination of RB_ALLOC_* flags.
+ */
+//=============================================================================
+static inline int rb_get_alloc_policy()
+{
+	return *_rb_alloc_policy();
+}
+
+//=============================================================================
+static inline int _rb_is_token(const char *s, size_t len, const char *name)
+{
+	return strlen(name)==len && !strncmp(s,name,len);
+}
+
+/**
+ * Parse a comma separated list of allocation policy names, i.e. given on the command line.
+ *
+ * Names: 'prefault', 'hugepages', 'mlock' (implies prefault) and 'none'.
+ *
+ * @param list i.e. "hugepages,mlock"
+ *
+ * @return a combination of RB_ALLOC_* flags; -1 if the list holds an unknown name.
+ */
+//=============================================================================
+static inline int rb_parse_alloc_policy(const char *list)
+{
+	int policy=0;
+	const char *s=list;
+	while(*s!='\0')
+	{
+		const char *end=strchr(s,',');
+		size_t len=(end!=NULL) ? (size_t)(end-s) : strlen(s);
+		if(_rb_is_token(s,len,"prefault")) {policy|=RB_ALLOC_PREFAULT;}
+		else if(_rb_is_token(s,len,"hugepages")) {policy|=RB_ALLOC_HUGEPAGES;}
+		else if(_rb_is_token(s,len,"mlock")) {policy|=RB_ALLOC_MLOCK | RB_ALLOC_PREFAULT;}
+		else if(!_rb_is_token(s,len,"none")) {return -1;}
+		s+=len;
+		if(*s==',') {s++;}
+	}
+	return policy;
+}
+
+/**
+ * Describe an allocation policy the way rb_parse_alloc_policy() reads it.
+ *
+ * @param policy 0 or a combination of RB_ALLOC_* flags.
+ * @param buf buffer for the description, i.e. "prefault,mlock" or "none"
+ * @param size size of buf in bytes.
+ */
+//=============================================================================
+static inline void rb_alloc_policy_string(int policy, char *buf, size_t size)
+{
+	const char *names[3]={"prefault","hugepages","mlock"};
+	snprintf(buf,size,"%s",policy==0 ? "none" : "");
+	int i;
+	for(i=0;i<3;i++)
+	{
+		if(policy & (1<<i))
+		{
+			size_t len=strlen(buf);
+			snprintf(buf+len,size-len,"%s%s",len>0 ? "," : "",names[i]);
+		}
+	}
+}
+
+//=============================================================================
+//ask for transparent hugepages for the whole pages in [start, start+size)
+static inline void _rb_advise_hugepages(void *start, uint64_t size)
+{
+#if !defined(WIN_BUILD) && defined(MADV_HUGEPAGE)
+	uintptr_t page=sysconf(_SC_PAGESIZE);
+	uintptr_t from=((uintptr_t)start+page-1)/page*page;
+	uintptr_t to=((uintptr_t)start+size)/page*page;
+	if(to>from)
+	{
+		//best effort: fails i.e. if THP is disabled, or for shared memory unless shmem_enabled allows it
+		madvise((void*)from,to-from,MADV_HUGEPAGE);
+	}
+#endif
+}
+
+//=============================================================================
+//fault in every page of [start, start+size) by writing to it (a read would only map the
+//shared zero page). the contents are kept, works for heap, shared memory and memfd alike
+static inline void _rb_prefault(void *start, uint64_t size)
+{
+	if(size<1) {return;}
+	volatile char *p=(volatile char*)start;
+	uint64_t page=_rb_page_round(1);
+	uint64_t i;
+	for(i=0;i<size;i+=page)
+	{
+		p[i]=p[i];
+	}
+	p[size-1]=p[size-1];
+}
+
+//=============================================================================
+static inline void _rb_mlock_failed(uint64_t size, int err)
+{
+#if !defined(RB_DISABLE_MLOCK) && !defined(WIN_BUILD)
+	fprintf(stderr,"rb.h: could not lock %" PRIu64 " bytes to memory: %s\n",size,strerror(err));
+	struct rlimit limit;
+	if((err==ENOMEM || err==EPERM || err==EAGAIN) && getrlimit(RLIMIT_MEMLOCK,&limit)==0
+		&& limit.rlim_cur!=RLIM_INFINITY)
+	{
+		fprintf(stderr,"rb.h: RLIMIT_MEMLOCK is %" PRIu64 " kB (ulimit -l) for all locked memory of the process.\n"
+			"rb.h: raise it (i.e. '@audio - memlock unlimited' in /etc/security/limits.conf) or don't use mlock.\n"
+			,(uint64_t)limit.rlim_cur/1024);
+	}
+#else
+	fprintf(stderr,"rb.h: could not lock %" PRIu64 " bytes to memory: built with RB_DISABLE_MLOCK\n",size);
+#endif
+}
+
+//=============================================================================
+//hugepage advice and prefaulting part of the allocation policy (locking is up to the caller)
+static inline void _rb_prepare_alloc(void *start, uint64_t size, void *advise_start, uint64_t advise_size)
+{
+	int policy=rb_get_alloc_policy();
+	if(policy & RB_ALLOC_HUGEPAGES)
+	{
+		_rb_advise_hugepages(advise_start,advise_size);
+	}
+	if(policy & (RB_ALLOC_PREFAULT | RB_ALLOC_MLOCK))
+	{
+		_rb_prefault(start,size);
+	}
+}
+
+//=============================================================================
+//apply the allocation policy to a new ringbuffer. returns 0 if it had to be locked but couldn't
+static inline int _rb_apply_alloc_policy(rb_t *rb)
+{
+	int policy=rb_get_alloc_policy();
+	//both views of a mirrored buffer: each has its own page table entries
+	_rb_prepare_alloc(rb,_rb_mapped_size(rb),buf_ptr(rb),rb->size);
+	if((policy & RB_ALLOC_MLOCK) && !rb_mlock(rb))
+	{
+		_rb_mlock_failed(_rb_mapped_size(rb),errno);
+		return 0;
+	}
+	return 1;
+}
+
+/**
+ * Allocate a zero-initialized scratch buffer according to the allocation policy (see rb_set_alloc_policy()).
+ *
+ * Meant for buffers that a realtime thread uses next to its ringbuffers (i.e. conversion
+ * or staging buffers). The buffer is mapped separately (whole pages, not shared with other
+ * heap data) so that it can be locked and unlocked on its own.
+ *
+ * This is not a realtime operation. Release the buffer with rb_free_scratch().
+ *
+ * @param size size of the buffer in bytes.
+ *
+ * @return pointer to the buffer if successful; NULL otherwise.
+ */
+//=============================================================================
+static inline void *rb_alloc_scratch(uint64_t size)
+{
+	if(size<1) {return NULL;}
+	int policy=rb_get_alloc_policy();
+#ifndef WIN_BUILD
+	uint64_t mapped_size=_rb_page_round(size);
+	//anonymous memory is zero-filled
+	void *p=mmap(0, mapped_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(p==MAP_FAILED) {return NULL;}
+	_rb_prepare_alloc(p,mapped_size,p,mapped_size);
+	#ifndef RB_DISABLE_MLOCK
+	if((policy & RB_ALLOC_MLOCK) && mlock(p,mapped_size))
+	{
+		_rb_mlock_failed(mapped_size,errno);
+		munmap(p,mapped_size);
+		return NULL;
+	}
+	#else
+	if(policy & RB_ALLOC_MLOCK)
+	{
+		_rb_mlock_failed(mapped_size,0);
+		munmap(p,mapped_size);
+		return NULL;
+	}
+	#endif
+	return p;
+#else
+	if(policy & RB_ALLOC_MLOCK)
+	{
+		_rb_mlock_failed(size,0);
+		return NULL;
+	}
+	return calloc(1,size);
+#endif
+}
+
+/**
+ * Release a buffer allocated with rb_alloc_scratch(). A locked buffer is unlocked with it.
+ *
+ * This is not a realtime operation.
+ *
+ * @param buffer pointer returned by rb_alloc_scratch(), or NULL.
+ * @param size size given to rb_alloc_scratch().
+ */
+//=============================================================================
+static inline void rb_free_scratch(void *buffer, uint64_t size)
+{
+	if(buffer==NULL) {return;}
+#ifndef WIN_BUILD
+	//unmapping also unlocks
+	munmap(buffer,_rb_page_round(size));
+#else
+	free(buffer);
+#endif
+}
+
+/**
+ * Query the page faults of the calling thread so far (getrusage(RUSAGE_THREAD)).
+ *
+ * Call it from the realtime thread itself (i.e. every nth cycle, it's a system call) and
+ * compare the counts over a number of cycles: a thread working only on prefaulted or locked
+ * buffers shouldn't fault after startup.
+ *
+ * @param minor pointer to a variable for the count of faults served without I/O (first touch, page cache).
+ * @param major pointer to a variable for the count of faults that needed I/O (i.e. swap).
+ *
+ * @return 1 if successful; 0 otherwise (i.e. no per-thread counts on this system).
+ */
+//=============================================================================
+static inline int rb_page_faults(uint64_t *minor, uint64_t *major)
+{
+	*minor=0;
+	*major=0;
+#if !defined(WIN_BUILD) && defined(RUSAGE_THREAD)
+	struct rusage usage;
+	if(getrusage(RUSAGE_THREAD,&usage)) {return 0;}
+	*minor=usage.ru_minflt;
+	*major=usage.ru_majflt;
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+/**
+ * This is a wrapper to rb_new_audio().
+ *
+ * Allocate a ringbuffer data structure of a specified size.
+ * The caller must arrange for a call to rb_free() to release
+ * the memory associated with the ringbuffer after use.
+ *
+ * The ringbuffer is allocated in heap memory with malloc() unless 
+ * #RB_DEFAULT_USE_SHM is set at compile time in which case new_shared*()
+ * methods will be called implicitely.
+ *
+ * @param size ringbuffer size in bytes, >0
+ *
+ * @return pointer to a new rb_t if successful; NULL otherwise.
+ */
+//=============================================================================
+static inline rb_t *rb_new(uint64_t size)
+{
+	const char *a="anonymous";
+	return rb_new_audio(size,a,0,1,1);
+}
+
+/**
+ * This is a wrapper to rb_new_audio().
+ *
+ * Allocate a ringbuffer data structure of a specified size with a given name.
+ * The caller must arrange for a call to rb_free() to release
+ * the memory associated with the ringbuffer after use.
+ *
+ * The ringbuffer is allocated in heap memory with malloc() unless 
+ * #RB_DEFAULT_USE_SHM is set at compile time in which case new_shared*()
+ * methods will be called implicitely.
+ *
+ * @param size ringbuffer size in bytes, >0
+ * @param name name of the ringbuffer, less than 256 bytes (ASCII characters) long 
+ *
+ * @return pointer to a new rb_t if successful; NULL otherwise.
+ */
+//=============================================================================
+static inline rb_t *rb_new_named(uint64_t size, const char *name)
+{
+	return rb_new_audio(size,name,0,1,1);
+}
+
+/**
+ * This is a wrapper to rb_new_audio().
+ *
+ * Allocate a ringbuffer data structure to be used with audiosample data with given properties.
+ * The caller must arrange for a call to rb_free() to release
+ * the memory associated with the ringbuffer after use.
+ *
+ * The ringbuffer is allocated in heap memory with malloc() unless 
+ * #RB_DEFAULT_USE_SHM is set at compile time in which case new_shared*()
+ * methods will be called implicitely.
+ *
+ * The size is rounded up with rb_audio_size_pow2() so that the buffer
+ * can use the power of two fast path.
+ *
+ * @param seconds duration [s] of audiosample data (with given properties) the ringbuffer can hold
+ * @param name name of the ringbuffer, less than 256 bytes (ASCII characters) long 
+ * @param sample_rate Sample rate of audiosample data (i.e. 48000)
+ * @param channel_count Count of interleaved channels in audiosample data
+ * @param bytes_per_sample Count of bytes per audiosample value of one channel (i.e. float sample: 4 bytes)
+ *
+ * @return pointer to a new rb_t if successful; NULL otherwise.
+ */
+//=============================================================================
+static inline rb_t *rb_new_audio_seconds(double seconds, const char *name, int sample_rate, int channel_count, int bytes_per_sample)
+{
+	uint64_t size=rb_second_to_byte_count(seconds,sample_rate,channel_count,bytes_per_sample);
+	return rb_new_audio(rb_audio_size_pow2(size,channel_count,bytes_per_sample),name,sample_rate,channel_count, bytes_per_sample);
+}
+
+/**
+ * Allocate a ringbuffer data structure to be used with audiosample data with given properties.
+ * The caller must arrange for a call to rb_free() to release
+ * the memory associated with the ringbuffer after use.
+ *
+ * The ringbuffer is allocated in heap memory with malloc() unless 
+ * #RB_DEFAULT_USE_SHM is set at compile time in which case rb_new_shared_audio()
+ * will be called implicitely.
+ *
+ * @param size ringbuffer size in bytes, >0
+ * @param name name of the ringbuffer, less than 256 bytes (ASCII characters) long 
+ * @param sample_rate Sample rate of audiosample data (i.e. 48000)
+ * @param channel_count Count of interleaved channels in audiosample data
+ * @param bytes_per_sample Count of bytes per audiosample value of one channel (i.e. float sample: 4 bytes)
+ *
+ * @return pointer to a new rb_t if successful; NULL otherwise.
+ */
+//=============================================================================
+static inline rb_t *rb_new_audio(uint64_t size, const char *name, int sample_rate, int channel_count, int bytes_per_sample)
+{
+#ifndef RB_DISABLE_SHM
+	#ifdef RB_DEFAULT_USE_SHM
+		return rb_new_shared_audio(size,name,sample_rate,channel_count,bytes_per_sample);
+	#endif
+#endif
+	if(size<1) {return NULL;}
+
+	rb_t *rb;
+
+	//allocate space for rb_t struct and buffer, aligned so that the reader and writer
+	//parts of rb_t each occupy their own cache line (large buffers: a whole hugepage
+	//if requested by the allocation policy)
+#ifndef _WIN32
+	uint64_t alignment=((rb_get_alloc_policy() & RB_ALLOC_HUGEPAGES) && size>=RB_HUGEPAGE_SIZE)
+		? RB_HUGEPAGE_SIZE : RB_CACHE_LINE_SIZE;
+	if(posix_memalign((void**)&rb,alignment,sizeof(rb_t) + size)) {return NULL;}
+#else
+	rb=(rb_t*)malloc(sizeof(rb_t) + size);
+	if(rb==NULL) {return NULL;}
+#endif
+
+	//the attached buffer is in the same malloced space
+	//right after rb_t (at offset sizeof(rb_t))
+	rb_set_common_init_values(rb);
+	rb->size=size;
+	rb->in_shared_memory=0;
+	_rb_set_audio_properties(rb,name,sample_rate,channel_count,bytes_per_sample);
+	if(!_rb_apply_alloc_policy(rb))
+	{
+		rb_free(rb);
+		return NULL;
+	}
+	return rb;
+}
+
+/**
+ * n/a
+ */
+//=============================================================================
+static inline rb_t *rb_new_shared(uint64_t size)
+{
+	const char *a="anonymous";
+	return rb_new_shared_audio(size,a,0,1,1);
+}
+
+/**
+ * n/a
+ */
+//=============================================================================
+static inline rb_t *rb_new_shared_named(uint64_t size, const char *name)
+{
+	return rb_new_shared_audio(size,name,0,1,1);
+}
+
+/**
+ * n/a
+ */
+//=============================================================================
+static inline rb_t *rb_new_shared_audio_seconds(double seconds, const char *name, int sample_rate, int channel_count, int bytes_per_sample)
+{
+	uint64_t size=rb_second_to_byte_count(seconds,sample_rate,channel_count,bytes_per_sample);
+	return rb_new_shared_audio(rb_audio_size_pow2(size,channel_count,bytes_per_sample),name,sample_rate,channel_count, bytes_per_sample);
+}
+
+/**
+ * Allocate a ringbuffer data structure to be used with audiosample data with given properties.
+ * The caller must arrange for a call to rb_free() to release
+ * the memory associated with the ringbuffer after use.
+ *
+ * The ringbuffer is allocated as a file in shared memory with a name similar to
+ * 'b6310884-9938-11e5-bf8c-74d435e313ae'. Shared memory is normally visible in the
+ * filesystem under /dev/shm/ on a Linux sytem. The generated name ought to be unique (UUID) and 
+ * can be accessed via rb_shared_memory_handle(). 
+ *
+ * Ringbuffers allocated in shared memory can be accessed by other processes.
+ *
+ * Not calling rb_free() after use means to leave a file in /dev/shm/.
+ * This can can be intentional or not.
+ *
+ * Inspecting a ringbuffer in /dev/shm/ for debug purposes can be done from a
+ * shell using i.e. hexdump.
+ *
+ * Example to see what's going on in a small buffer:
+ *
+\verbatim
+	watch -d -n 0.1 hexdump -c /dev/shm/b6310884-9938-11e5-bf8c-74d435e313ae
+\endverbatim
+ *
+ * The source code repository of rb.h includes rb_show_fill.c which can be used 
+ * to display properties and fill levels of one or more ringbuffers in shared memory 
+ * identified via the UUID handle. see rb_debug_linearbar() or refer to 
+ * 'rb_show_fill' for more information.
+ *
+ * rb_tap.c (next to rb.h, 'make tap') lists the ringbuffers in /dev/shm/ and opens one
+ * read-only with rb_shadow_open() to display levels or record the data passing through it.
+ *
+ * @param size ringbuffer size in bytes, >0
+ * @param name name of the ringbuffer, less than 256 bytes (ASCII characters) long 
+ * @param sample_rate Sample rate of audiosample data (i.e. 48000)
+ * @param channel_count Count of interleaved channels in audiosample data
+ * @param bytes_per_sample Count of bytes per audiosample value of one channel (i.e. float sample: 4 bytes)
+ *
+ * @return pointer to a new rb_t if successful; NULL otherwise.
+ */
+
+//=============================================================================
+static inline rb_t *rb_new_shared_audio(uint64_t size, const char *name, int sample_rate, int channel_count, int bytes_per_sample)
+{
+#ifdef RB_DISABLE_SHM
+	return NULL;
+#else
+	if(size<1) {return NULL;}
+
+	rb_t *rb;
+
+	//create rb_t in shared memory
+	uuid_t uuid;
+	uuid_generate_time_safe(uuid);
+	char shm_handle[37]; //i.e. "b6310884-9938-11e5-bf8c-74d435e313ae" + "\0"
+	uuid_unparse_lower(uuid, shm_handle);
+
+	//O_TRUNC |
+	int fd=_shm_open(shm_handle,O_CREAT | O_RDWR, 0666);
+	if(fd<0) {return NULL;}
+
+	int r=ftruncate(fd,sizeof(rb_t) + size);
+	if(r!=0)
+	{	close(fd);
+		_shm_unlink(shm_handle);
+		return NULL;
+	}
+
+	//void *mmap(void *addr, uint64_t length, int prot, int flags, int fd, off_t offset);
+	rb=(rb_t*)mmap(0, sizeof(rb_t) + size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if(rb==NULL || rb==MAP_FAILED)
+	{
+		fprintf(stderr,"rb.h: MAP_FAILED %d %s\n",errno,strerror(errno));
+		_shm_unlink(shm_handle);
+		return NULL;
+	}
+//	fprintf(stderr,"rb address %lu\n",(unsigned long int)rb);
+//	fprintf(stderr,"buffer address %lu\n",(unsigned long int)buf_ptr(rb));
+
+	rb_set_common_init_values(rb);
+	memcpy(rb->shm_handle,shm_handle,37);
+	rb->size=size;
+	rb->in_shared_memory=1;
+	_rb_set_audio_properties(rb,name,sample_rate,channel_count,bytes_per_sample);
+	if(!_rb_apply_alloc_policy(rb))
+	{
+		rb_free(rb);
+		return NULL;
+	}
+
+//	rb_debug_linearbar(rb);
+
+	return rb;
+#endif
+}//end rb_new_shared_audio()
+
+/**
+ * This is a wrapper to rb_new_mirrored_audio().
+ */
+//=============================================================================
+static inline rb_t *rb_new_mirrored(uint64_t size)
+{
+	const char *a="anonymous";
+	return rb_new_mirrored_audio(size,a,0,1,1);
+}
+
+/**
+ * This is a wrapper to rb_new_mirrored_audio().
+ */
+//=============================================================================
+static inline rb_t *rb_new_mirrored_audio_seconds(double seconds, const char *name, int sample_rate, int channel_count, int bytes_per_sample)
+{
+	uint64_t size=rb_second_to_byte_count(seconds,sample_rate,channel_count,bytes_per_sample);
+	return rb_new_mirrored_audio(rb_audio_size_pow2(size,channel_count,bytes_per_sample),name,sample_rate,channel_count, bytes_per_sample);
+}
+
+/**
+ * Allocate a mirrored ringbuffer data structure.
+ * The caller must arrange for a call to rb_free() to release
+ * the memory associated with the ringbuffer after use.
+ *
+ * The buffer is backed by a memory file (memfd) which is mapped twice, back to back.
+ * Bytes written past the end of the buffer appear at its start, so that any
+ * readable or writable span is one contiguous piece of memory. rb_read_ptr() and
+ * rb_write_ptr() return such spans, rb_read() and rb_write() never split a copy.
+ *
+ * The size is rounded up to a multiple of the page size.
+ *
+ * If #RB_DEFAULT_USE_SHM is set at compile time rb_new_shared_mirrored_audio() is called
+ * implicitely. If the buffer can't be mapped twice (no memfd on this system), a plain
+ * buffer is returned. Use rb_is_mirrored() to tell.
+ *
+ * @param size ringbuffer size in bytes, >0
+ * @param name name of the ringbuffer, less than 256 bytes (ASCII characters) long 
+ * @param sample_rate Sample rate of audiosample data (i.e. 48000)
+ * @param channel_count Count of interleaved channels in audiosample data
+ * @param bytes_per_sample Count of bytes per audiosample value of one channel (i.e. float sample: 4 bytes)
+ *
+ * @return pointer to a new rb_t if successful; NULL otherwise.
+ */
+//=============================================================================
+static inline rb_t *rb_new_mirrored_audio(uint64_t size, const char *name, int sample_rate, int channel_count, int bytes_per_sample)
+{
+#ifndef RB_DISABLE_SHM
+	#ifdef RB_DEFAULT_USE_SHM
+		return rb_new_shared_mirrored_audio(size,name,sample_rate,channel_count,bytes_per_sample);
+	#endif
+#endif
+	if(size<1) {return NULL;}
+
+	size=_rb_page_round(size);
+	rb_t *rb=NULL;
+
+#if defined(__linux__) && defined(SYS_memfd_create)
+	int fd=syscall(SYS_memfd_create, name, 0);
+	if(fd>=0)
+	{
+		rb=_rb_new_mirrored_fd(fd,size);
+		close(fd);
+	}
+#endif
+	if(rb==NULL)
+	{
+		return rb_new_audio(size,name,sample_rate,channel_count,bytes_per_sample);
+	}
+
+	rb->in_shared_memory=0;
+	_rb_set_audio_properties(rb,name,sample_rate,channel_count,bytes_per_sample);
+	if(!_rb_apply_alloc_policy(rb))
+	{
+		rb_free(rb);
+		return NULL;
+	}
+	return rb;
+}
+
+/**
+ * Allocate a mirrored ringbuffer data structure in shared memory.
+ *
+ * Like rb_new_shared_audio(), the ringbuffer is a file in shared memory (normally
+ * under /dev/shm/) that other processes can open with rb_open_shared().
+ * Like rb_new_mirrored_audio(), the buffer part of the file is mapped twice back to
+ * back. rb_open_shared() maps it the same way in the other process.
+ *
+ * The size is rounded up to a multiple of the page size.
+ *
+ * @param size ringbuffer size in bytes, >0
+ * @param name name of the ringbuffer, less than 256 bytes (ASCII characters) long 
+ * @param sample_rate Sample rate of audiosample data (i.e. 48000)
+ * @param channel_count Count of interleaved channels in audiosample data
+ * @param bytes_per_sample Count of bytes per audiosample value of one channel (i.e. float sample: 4 bytes)
+ *
+ * @return pointer to a new rb_t if successful; NULL otherwise.
+ */
+//=============================================================================
+static inline rb_t *rb_new_shared_mirrored_audio(uint64_t size, const char *name, int sample_rate, int channel_count, int bytes_per_sample)
+{
+#ifdef RB_DISABLE_SHM
+	return NULL;
+#else
+	if(size<1) {return NULL;}
+
+	size=_rb_page_round(size);
+
+	uuid_t uuid;
+	uuid_generate_time_safe(uuid);
+	char shm_handle[37]; //i.e. "b6310884-9938-11e5-bf8c-74d435e313ae" + "\0"
+	uuid_unparse_lower(uuid, shm_handle);
+
+	int fd=_shm_open(shm_handle,O_CREAT | O_RDWR, 0666);
+	if(fd<0) {return NULL;}
+
+	rb_t *rb=_rb_new_mirrored_fd(fd,size);
+	close(fd);
+
+	if(rb==NULL)
+	{
+		_shm_unlink(shm_handle);
+		return NULL;
+	}
+
+	memcpy(rb->shm_handle,shm_handle,37);
+	rb->in_shared_memory=1;
+	_rb_set_audio_properties(rb,name,sample_rate,channel_count,bytes_per_sample);
+	if(!_rb_apply_alloc_policy(rb))
+	{
+		rb_free(rb);
+		return NULL;
+	}
+	return rb;
+#endif
+}//end rb_new_shared_mirrored_audio()
+
+/**
+ * Open an existing ringbuffer data structure in shared memory.
+ *
+ * The ringbuffer to open must be available as a file in shared memory.
+ * Shared memory is normally visible in the filesystem under /dev/shm/ on a Linux system.
+ *
+ * Not calling rb_free() after use means to leave a file in /dev/shm/. This can be
+ * intentional or not.
+ *
+ * @param shm_handle handle (UUID) identifying the ringbuffer (without leading path to /dev/shm/) to open
+ *
+ * @return pointer to a previously created rb_t in shared memory if successful; NULL otherwise.
+ */
+//=============================================================================
+static inline rb_t *rb_open_shared(const char *shm_handle)
+{
+#ifdef RB_DISABLE_SHM
+	return NULL;
+#else
+	rb_t *rb;
+	//O_TRUNC | O_CREAT | 
+	int fd=_shm_open(shm_handle,O_RDWR, 0666);
+	if(fd<0) {return NULL;}
+
+//??
+//	int r=ftruncate(fd,sizeof(rb_t));
+//	if(r!=0) {return NULL;}
+
+	//void *mmap(void *addr, uint64_t length, int prot, int flags, int fd, off_t offset);
+	rb=(rb_t*)mmap(0, sizeof(rb_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+	if(rb==NULL || rb==MAP_FAILED)
+	{
+		close(fd);
+		fprintf(stderr,"rb.h: MAP_FAILED %d %s\n",errno,strerror(errno));
+		_shm_unlink(shm_handle);
+		return NULL;
+	}
+
+	if(strncmp(rb->magic,RB_MAGIC,8))
+	{
+		fprintf(stderr,"MAGIC did not match! Was looking for '%s', found '%s'\n"
+			,RB_MAGIC,rb->magic);
+		close(fd);
+		munmap(rb,sizeof(rb_t));
+		_shm_unlink(shm_handle);
+		return NULL;
+	}
+
+	if(rb->version != RB_VERSION)
+	{
+		fprintf(stderr,"Version mismatch! Was looking for '%.3f', found '%.3f'\n"
+			,RB_VERSION,rb->version);
+		close(fd);
+		munmap(rb,sizeof(rb_t));
+		_shm_unlink(shm_handle);
+		return NULL;
+	}
+
+//	fprintf(stderr,"size %" PRId64 "\n",rb->size);
+	uint64_t size=rb->size;
+	int mirrored=rb->mirrored;
+	uint64_t header_size=rb->buffer_offset;
+
+	//unmap and remap fully (knowing size now)
+	munmap(rb,sizeof(rb_t));
+	if(mirrored)
+	{
+		rb=_rb_map_mirrored(fd, header_size, size, PROT_READ | PROT_WRITE);
+	}
+	else
+	{
+		rb=(rb_t*)mmap(0, sizeof(rb_t) + size , PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	}
+	close(fd);
+
+	if(rb==NULL || rb==MAP_FAILED)
+	{
+		_shm_unlink(shm_handle);
+		return NULL;
+	}
+
+//	fprintf(stderr,"rb address %lu\n",(unsigned long int)rb);
+//	fprintf(stderr,"buffer address %lu\n",(unsigned long int)buf_ptr(rb));
+
+	return rb;
+#endif
+}//end rb_open_shared()
+
+/**
+ * Free the ringbuffer data structure allocated by an earlier call to rb_new().
+ *
+ * Any active reader and/or writer should be done before calling rb_free().
+ *
+ * @param rb pointer to the ringbuffer structure.
+ */
+//=============================================================================
+static inline void rb_free(rb_t *rb)
+{
+	if(rb==NULL) {return;}
+	rb->unlink_requested=1;
+#ifndef RB_DISABLE_MLOCK
+	if(rb->memory_locked)
+	{
+		munlock(rb,_rb_mapped_size(rb));
+	}
+#endif
+	if(rb->mirrored)
+	{
+		uint64_t mapped_size=_rb_mapped_size(rb);
+#ifndef RB_DISABLE_SHM
+		int shared=rb->in_shared_memory;
+		char handle[256];
+		memcpy(handle,rb->shm_handle,256);
+#endif
+		rb->size=0;
+		munmap(rb,mapped_size);
+#ifndef RB_DISABLE_SHM
+		if(shared) {_shm_unlink(handle);}
+#endif
+		return;
+	}
+#ifndef RB_DISABLE_SHM
+	if(rb->in_shared_memory)
+	{
+		//shm_unlink(rb->shm_handle);
+		char handle[256];
+		memcpy(handle,rb->shm_handle,256);
+		//size is needed for munmap, invalidate after reading
+		uint64_t size=rb->size;
+		rb->size=0;
+		munmap(rb,sizeof(rb_t)+size);
+		_shm_unlink(handle);
+		rb=NULL;
+		return;
+	}
+#endif
+	rb->size=0;
+	free(rb);
+}
+
+/**
+ * Lock a ringbuffer data block into memory.
+ *
+ * Uses the mlock() system call.
+ *
+ * This is not a realtime operation.
+ *
+ * @param rb pointer to the ringbuffer structure.
+ *
+ * @return 1 if successful; 0 otherwise.
+ */
+//=============================================================================
+static inline int rb_mlock(rb_t *rb)
+{
+#ifndef RB_DISABLE_MLOCK
+	if(mlock(rb,_rb_mapped_size(rb))) {return 0;}
+	rb->memory_locked=1;
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+/**
+ * Unlock a previously locked ringbuffer data block in memory.
+ *
+ * Uses the munlock() system call.
+ *
+ * This is not a realtime operation.
+ *
+ * @param rb pointer to the ringbuffer structure.
+ *
+ * @return 1 if successful; 0 otherwise.
+ */
+//=============================================================================
+static inline int rb_munlock(rb_t *rb)
+{
+#ifndef RB_DISABLE_MLOCK
+	if(munlock(rb,_rb_mapped_size(rb))) {return 0;}
+	rb->memory_locked=0;
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+/**
+ * Reset statistics associated with this ringbuffer:
+ *
+ * 'total_bytes_read', 'total_bytes_write', 'total_bytes_peek', 'total_underflows', 'total_overflows'
+ *
+ * @param rb pointer to the ringbuffer structure.
+ */
+//=============================================================================
+static inline void rb_reset_stats(rb_t *rb)
+{
+	rb->total_bytes_read=0;
+	rb->total_bytes_write=0;
+	rb->total_bytes_peek=0;
+	rb->total_underflows=0;
+	rb->total_overflows=0;
+}
+
+/**
+ * Reset the read and write indices and statistics, making it an empty buffer.
+ *
+ * Any active reader and/or writer should be done before calling rb_reset().
+ *
+ * @param rb pointer to the ringbuffer structure.
+ */
+//=============================================================================
+static inline void rb_reset(rb_t *rb)
+{
+	rb->read_index=0;
+	rb->write_index=0;
+	rb->read_index_cache=0;
+	rb->write_index_cache=0;
+	rb_reset_stats(rb);
+}
+
+/**
+ * Return the count of bytes available for reading.
+ *
+ * This is count of bytes in front of the read index up to the write index.
+ *
+ * @param rb pointer to the ringbuffer structure.
+ *
+ * @return count of bytes available to read.
+ */
+//=============================================================================
+static inline uint64_t rb_can_read(const rb_t *rb)
+{
+	return _rb_used(rb);
+}
+
+/**
+ * n/a
+ */
+//=============================================================================
+static inline uint64_t rb_can_read_frames(const rb_t *rb)
+{
+	return rb_byte_to_frame_count(rb,rb_can_read(rb));
+}
+
+/**
+ * Return the count of bytes available for writing.
+ *
+ * This is the number of bytes in front of the write index up to the read index.
+ *
+ * @param rb pointer to the ringbuffer structure.
+ *
+ * @return amount of free space (in bytes) available for writing.
+ */
+//=============================================================================
+static inline uint64_t rb_can_write(const rb_t *rb)
+{
+	return rb->size-_rb_used(rb);
+}
+
+/**
+ * n/a
+ */
+//=============================================================================
+static inline uint64_t rb_can_write_frames(const rb_t *rb)
+{
+	return rb_byte_to_frame_count(rb,rb_can_write(rb));
+}
+
+/**
+ * n/a
+ */
+//=============================================================================
+static inline uint64_t rb_generic_read(rb_t *rb, char *destination, uint64_t count, int over)
+{
+	if(count==0) {return 0;}
+
+	uint64_t can_read_count;
+	uint64_t do_read_count;
+	uint64_t r=rb->read_index;
+
+	if(over)
+	{
+		//refresh the cache: read_index may pass the old cached value even if it stays
+		//behind write_index
+		rb->write_index_cache=_rb_load(&rb->write_index);
+		can_read_count=rb->write_index_cache-r;
+		//limit to whole buffer
+		do_read_count=rb_MIN(rb->size,count);
+	}
+	else
+	{
+		if(!(can_read_count=_rb_reader_available(rb,count)))
+		{
+			rb->total_underflows++;
+			return 0;
+		}
+		do_read_count=count>can_read_count ? can_read_count : count;
+	}
+
+	_rb_copy_out(rb,destination,r,do_read_count);
+	r+=do_read_count;
+	_rb_store(&rb->read_index,r);
+
+	//if write index was overpassed, move up to read index
+	if(over && can_read_count<do_read_count)
+	{
+		_rb_store(&rb->write_index,r);
+		rb->write_index_cache=r;
+		rb->read_index_cache=r;
+	}
+
+	rb->total_bytes_read+=do_read_count;
+	if(do_read_count<count){rb->total_underflows++;}
+
+	return do_read_count;
+}//end rb_generic_read()
+
+/**
+ * Read data from the ringbuffer and move the read index accordingly.
+ * This is a copying data reader.
+ *
+ * The count of bytes effectively read can be less than the requested
+ * count, which is limited to rb_can_read() bytes.
+ *
+ * @param rb pointer to the ringbuffer structure.
+ * @param destination pointer to a buffer where data read from the
+ * ringbuffer will be copied to.
+ * @param count count of bytes to read.
+ *
+ * @return count of bytes read, which may range from 0 to count.
+ */
+//=============================================================================
+static inline uint64_t rb_read(rb_t *rb, char *destination, uint64_t count)
+{
+	return rb_generic_read(rb,destination,count,0);
+}
+
+/**
+ * Read data from the ringbuffer and move the read index accordingly.
+ * Opposed to rb_read() this function will read over the limit given 
+ * by the current write index.
+ * If the read goes beyond the write index the write index will be set 
+ * equal to the resulting read index of this function. A writer will 
+ * see the buffer having a write capacity equal to the buffer size.
+ *
+ * Since rb_overread() could move the write index, it should be called
+ * only if there is no ongoing rb_write operation.
+ *
+ * This is a copying data reader.
+ *
+ * The count of bytes effectively read can be less than the requested
+ * count, which is limited to rb_size() bytes.
+ *
+ * @param rb pointer to the ringbuffer structure.
+ * @param destination pointer to a buffer where data read from the
+ * ringbuffer will be copied to.
+ * @param count count of bytes to read.
+ *
+ * @return count of bytes read, which may range from 0 to rb_size().
+ */
+//=============================================================================
+static inline uint64_t rb_overread(rb_t *rb, char *destination, uint64_t count)
+{
+	return rb_generic_read(rb,destination,count,1);
+}
+
+/**
+ * Write data into the ringbuffer and move the write index accordingly.
+ * This is a copying data writer.
+ *
+ * The count of bytes effectively written can be less than the requested
+ * count, which is limited to rb_can_write() bytes.
+ * 
+ * @param rb pointer to the ringbuffer structure.
+ * @param source pointer to the data to be written to the ringbuffer.
+ * @param count count of bytes to write.
+ *
+ * @return count of bytes written, which may range from 0 to count
+ */
+//=============================================================================
+static inline uint64_t rb_write(rb_t *rb, const char *source, uint64_t count)
+{
+	if(count==0) {return 0;}
+
+	uint64_t can_write_count;
+	uint64_t do_write_count;
+
+	if(!(can_write_count=_rb_writer_space(rb,count)))
+	{
+		rb->total_overflows++;
+		return 0;
+	}
+
+	do_write_count=count>can_write_count ? can_write_count : count;
+
+	uint64_t w=rb->write_index;
+	_rb_copy_in(rb,source,w,do_write_count);
+	_rb_store(&rb->write_index,w+do_write_count);
+
+	rb->total_bytes_write+=do_write_count;
+	if(do_write_count<count){rb->total_overflows++;}
+	return do_write_count;
+}//end rb_write()
+
+/**
+ * Read data from the ringbuffer. Opposed to rb_read()
+ * this function does not move the read index. Thus it's
+ * a convenient way to inspect data in the ringbuffer in a
+ * continuous fashion. The data is copied into a buffer provided by the caller.
+ * For non-copy inspection of the data in the ringbuffer
+ * use rb_get_read_regions() or rb_get_next_read_region().
+ *
+ * The count of bytes effectively read can be less than the requested
+ * count, which is limited to rb_can_read() bytes.
+ *
+ * @param rb pointer to the ringbuffer structure.
+ * @param destination pointer to a buffer where data read from the
+ * ringbuffer will be copied to.
+ * @param count count of bytes to read.
+ *
+ * @return count of bytes read, which may range from 0 to count.
+ */
+//=============================================================================
+static inline uint64_t rb_peek(rb_t *rb, char *destination, uint64_t count)
+{
+	return rb_peek_at(rb,destination,count,0);
+}
+
+/**
+ * Read data from the ringbuffer. Opposed to rb_read()
+ * this function does not move the read index. Thus it's
+ * a convenient way to inspect data in the ringbuffer in a
+ * continuous fashion. The data is copied into a buffer provided by the caller.
+ * For non-copy inspection of the data in the ringbuffer
+ * use rb_get_read_regions() or rb_get_next_read_region().
+ *
+ * The count of bytes effectively read can be less than the requested
+ * count, which is limited to rb_can_read() bytes.
+ *
+ * @param rb pointer to the ringbuffer structure.
+ * @param destination pointer to a buffer where data read from the
+ * ringbuffer will be copied to.
+ * @param count count of bytes to read.
+ * @param offset count of bytes to skip at the start of readable ringbuffer data.
+ *
+ * @return count of bytes read, which may range from 0 to count.
+ */
+//=============================================================================
+static inline uint64_t rb_peek_at(rb_t *rb, char *destination, uint64_t count, uint64_t offset)
+{
+	if(count==0) {return 0;}
+	uint64_t can_read_count;
+	//can not read more than offset, no chance to read from there
+	if((can_read_count=_rb_reader_available(rb,offset+count))<=offset)
+	{
+		rb->total_underflows++;
+		return 0;
+	}
+	//limit read count respecting offset
+	uint64_t do_read_count=count>can_read_count-offset ? can_read_count-offset : count;
+
+	_rb_copy_out(rb,destination,rb->read_index+offset,do_read_count);
+
+	rb->total_bytes_peek+=do_read_count;
+	if(do_read_count<count){rb->total_underflows++;}
+
+	return do_read_count;
+}//end rb_peek_at()
+
+/**
+ * Drop / ignore all data available to read.
+ * This moves the read index up to the current write index
+ * (nothing left to read) using rb_advance_read_index().
+ *
+ * @param rb pointer to the ringbuffer structure.
+ *
+ * @return count of bytes dropped, which may range from 0 to rb->size.
+ */
+//=============================================================================
+static inline uint64_t rb_drop(rb_t *rb)
+{
+	return rb_advance_read_index(rb,rb_can_read(rb));
+}
+
+/**
+ * Search for a given byte in the ringbuffer's readable space.
+ * The index at which the byte was found is copied to the
+ * offset variable provided by the caller. The index is relative to
+ * the start of the ringbuffer's readable space.
+ *
+ * @param rb pointer to the ringbuffer structure.
+ * @param byte byte to search in the ringbuffer's readable space
+ * @param offset pointer to a uint64_t variable
+ *
+ * @return 1 if found; 0 otherwise.
+ */
+//=============================================================================
+static inline int rb_find_byte(rb_t *rb, char byte, uint64_t *offset)
+{
+	uint64_t off=0;
+	char c;
+	while(rb_peek_byte_at(rb,&c,off))
+	{
+		if(c==byte)
+		{
+			memcpy(offset,&(off),sizeof(uint64_t)); //hmmm.
+			return 1;
+		}
+		off++;
+	}
+	off=0;
+	memcpy(offset,&(off),sizeof(uint64_t));
+	return 0;
+}
+
+/**
+ * Read one byte from the ringbuffer.
+ * This advances the read index by one byte if at least one byte
+ * is available in the ringbuffer's readable space.
+ *
+ * This is a copying data reader.
+ *
+ * @param rb pointer to the ringbuffer structure.
+ * @param destination pointer to a variable where the byte read from the
+ * ringbuffer will be copied to.
+ *
+ * @return count of bytes read, which may range from 0 to 1.
+ */
+//=============================================================================
+static inline uint64_t rb_read_byte(rb_t *rb, char *destination)
+{
+	return rb_read(rb,destination,1);
+}
+
+/**
+ * Peek one byte from the ringbuffer (don't move the read index).
+ * This is a copying data reader.
+ *
+ * @param rb pointer to the ringbuffer structure.
+ * @param destination pointer to a variable where the byte read from the
+ * ringbuffer will be copied to.
+ *
+ * @return count of bytes read, which may range from 0 to 1.
+ */
+//=============================================================================
+static inline uint64_t rb_peek_byte(rb_t *rb, char *destination)
+{
+	return rb_peek_byte_at(rb,destination,0);
+}
+
+/**
+ * Peek one byte from the ringbuffer at the given offset (don't move the read index).
+ * This is a copying data reader.
+ *
+ * @param rb pointer to the ringbuffer structure.
+ * @param destination pointer to a variable where the byte read from the
+ * ringbuffer will be copied to.
+ * @param offset count of bytes to skip at the start of readable ringbuffer data.
+ *
+ * @return count of bytes read, which may range from 0 to 1.
+ */
+//=============================================================================
+static inline uint64_t rb_peek_byte_at(rb_t *rb, char *destination, uint64_t offset)
+{
+	if(_rb_reader_available(rb,offset+1)<=offset)
+	{
+		rb->total_underflows++;
+		return 0;
+	}
+
+	*destination=((char*)buf_ptr(rb))[_rb_offset(rb,rb->read_index+offset)];
+
+	rb->total_bytes_peek+=1;
+
+	return 1;
+}
+
+/**
+ * Drop / ignore one byte available to read.
+ * This advances the read index by one byte if at least one byte
+ * is available in the ringbuffer's readable space.
+ *
+ * @param rb pointer to the ringbuffer structure.
+ *
+ * @return count of bytes skipped, which may range from 0 to 1.
+ */
+//=============================================================================
+static inline uint64_t rb_skip_byte(rb_t *rb)
+{
+	return rb_advance_read_index(rb,1);
+}
+
+/**
+ * Write one byte to the ringbuffer.
+ * This advances the write index by one byte if at least one byte
+ * can be written to the ringbuffer's writable space.
+ *
+ * @param rb pointer to the ringbuffer structure.
+ * @param source pointer to the variable containing the byte to be written
+ * to the ringbuffer.
+ *
+ * @return count of bytes written, which may range from 0 to 1.
+ */
+//=============================================================================
+static inline uint64_t rb_write_byte(rb_t *rb, const char *source)
+{
+	return rb_write(rb,source,1);
+}
+
+/**
+ * n/a
+ */
+//=============================================================================
+static inline uint64_t rb_deinterleave_items(rb_t *rb, char *destination
+	,uint64_t item_count, uint64_t item_size, uint64_t initial_item_offset, uint64_t item_block_size)
+{
+/*
+              offset
+              |                       |                       |                        |
+              0                       8                       16                       24 
+can_read min one channel: initial_offset * item_size + (item_count -1 ) * item_size * block_size + item_size)
+              |  |  |  |  |           |  |  |  |  |           |  |  |  |  |
+
+                          |absolute min read (less than requested)        |request satisfied
+                                                                                       |for all channels in block
+*/
+
+	uint64_t initial_bytepos=initial_item_offset * item_size;
+	uint64_t concerned_block_size=(item_count - 1) * item_size * item_block_size + item_size;
+
+	if(rb_can_read(rb) < initial_bytepos + concerned_block_size) {return 0;}
+
+	char *destination_ptr=destination;
+
+	uint64_t offset=_rb_offset(rb,rb->read_index);
+	if(rb->mirrored || offset + initial_bytepos + concerned_block_size <= rb->size)
+	{
+		//all items in one piece: copy them straight from the buffer
+		const char *source=(const char*)buf_ptr(rb) + offset + initial_bytepos;
+		uint64_t i;
+		for(i=0;i<item_count;i++)
+		{
+			memcpy(destination_ptr,source,item_size);
+			destination_ptr+=item_size;
+			source+=item_size * item_block_size;
+		}
+		rb->total_bytes_peek+=item_count*item_size;
+		return item_count*item_size;
+	}
+
+	uint64_t bytepos=0;
+	for(bytepos=0;bytepos < initial_bytepos + concerned_block_size;bytepos+=item_size * item_block_size)
+	{
+//		fprintf(stderr,"offset + bytepos: %" PRId64 "\n",initial_bytepos+bytepos);
+		rb_peek_at(rb, destination_ptr,item_size,initial_bytepos+bytepos);
+		destination_ptr+=item_size;
+	}
+	return item_count*item_size;
+}
+
+/**
+ * n/a
+ */
+//=============================================================================
+static inline uint64_t rb_deinterleave_audio(rb_t *rb, char *destination ,uint64_t frame_count, uint64_t frame_offset)
+{
+	return rb_deinterleave_items(rb, destination
+		,frame_count, rb->bytes_per_sample, frame_offset, rb->channel_count);
+}
+
+/**
+ * Deinterleave frame_count audio frames of all channels in one pass.
+ *
+ * Frames are taken from the start of the readable space without advancing the read
+ * index (like rb_deinterleave_audio()). Channel c is copied to destinations[c].
+ * Calling rb_deinterleave_audio() once per channel scans the interleaved data once per
+ * channel, this function scans it once.
+ *
+ * Float samples with 1, 2, 6 or a multiple of 4 channels use SSE kernels on x86 (AVX for
+ * 2 and 8 channels if enabled at compile time), all other formats a loop over blocks of
+ * frames.
+ * See #RB_DISABLE_SIMD.
+ *
+ * @param rb pointer to the ringbuffer structure.
+ * @param destinations array of rb_channel_count() pointers, each to space for frame_count samples.
+ * @param frame_count count of frames to deinterleave.
+ *
+ * @return count of frames deinterleaved: frame_count, or 0 if less than frame_count frames are readable.
+ */
+//=============================================================================
+static inline uint64_t rb_deinterleave_audio_channels(rb_t *rb, char **destinations, uint64_t frame_count)
+{
+	uint64_t frame_size=rb->frame_size;
+	uint64_t count=rb_frame_to_byte_count(rb,frame_count);
+	if(count==0 || _rb_reader_available(rb,count)<count) {return 0;}
+
+	rb_region_t regions[2];
+	_rb_fill_regions(rb,_rb_offset(rb,rb->read_index),count,regions);
+
+	//whole frames up to the buffer end
+	uint64_t done=regions[0].size/frame_size;
+	_rb_deinterleave_block(regions[0].buffer,destinations,0,done,rb->channel_count,rb->bytes_per_sample);
+
+	if(done<frame_count)
+	{
+		//a frame split by the buffer end (buffer size not a multiple of the frame size)
+		uint64_t split=regions[0].size-done*frame_size;
+		if(split>0)
+		{
+			char frame[frame_size];
+			_rb_copy_out(rb,frame,rb->read_index+done*frame_size,frame_size);
+			_rb_deinterleave_block(frame,destinations,done,1,rb->channel_count,rb->bytes_per_sample);
+			done++;
+		}
+		_rb_deinterleave_block(regions[1].buffer+(split>0 ? frame_size-split : 0),destinations,done
+			,frame_count-done,rb->channel_count,rb->bytes_per_sample);
+	}
+
+	rb->total_bytes_peek+=count;
+	return frame_count;
+}
+
+/**
+ * Interleave frame_count audio frames from separate channel buffers into the ringbuffer.
+ *
+ * This is the reverse of rb_deinterleave_audio_channels(), i.e. for recording.
+ * sources[c] holds frame_count samples of channel c. The frames are written
+ * and the write index is advanced. Either all frames are written or none.
+ *
+ * @param rb pointer to the ringbuffer structure.
+ * @param sources array of rb_channel_count() pointers, each to frame_count samples.
+ * @param frame_count count of frames to interleave.
+ *
+ * @return count of frames written: frame_count, or 0 if there isn't enough space.
+ */
+//=============================================================================
+static inline uint64_t rb_interleave_audio_channels(rb_t *rb, const char **sources, uint64_t frame_count)
+{
+	uint64_t frame_size=rb->frame_size;
+	uint64_t count=rb_frame_to_byte_count(rb,frame_count);
+	if(count==0) {return 0;}
+	if(_rb_writer_space(rb,count)<count)
+	{
+		rb->total_overflows++;
+		return 0;
+	}
+
+	rb_region_t regions[2];
+	_rb_fill_regions(rb,_rb_offset(rb,rb->write_index),count,regions);
+
+	uint64_t done=regions[0].size/frame_size;
+	_rb_interleave_block(regions[0].buffer,sources,0,done,rb->channel_count,rb->bytes_per_sample);
+
+	if(done<frame_count)
+	{
+		uint64_t split=regions[0].size-done*frame_size;
+		if(split>0)
+		{
+			char frame[frame_size];
+			_rb_interleave_block(frame,sources,done,1,rb->channel_count,rb->bytes_per_sample);
+			_rb_copy_in(rb,frame,rb->write_index+done*frame_size,frame_size);
+			done++;
+		}
+		_rb_interleave_block(regions[1].buffer+(split>0 ? frame_size-split : 0),sources,done
+			,frame_count-done,rb->channel_count,rb->bytes_per_sample);
+	}
+
+	_rb_store(&rb->write_index,rb->write_index+count);
+	rb->total_bytes_write+=count;
+	return frame_count;
+}
+
+/**
+ * n/a
+ */
+//=============================================================================
+static inline uint64_t rb_generic_advance_read_index(rb_t *rb, uint64_t count, int over)
+{
+	if(count==0) {return 0;}
+	uint64_t can_read_count;
+	uint64_t do_advance_count;
+	uint64_t r=rb->read_index;
+
+	if(over)
+	{
+		//refresh the cache: read_index may pass the old cached value even if it stays
+		//behind write_index
+		rb->write_index_cache=_rb_load(&rb->write_index);
+		can_read_count=rb->write_index_cache-r;
+		//limit to whole buffer
+		do_advance_count=rb_MIN(rb->size,count);
+	}
+	else
+	{
+		if(!(can_read_count=_rb_reader_available(rb,count)))
+		{
+			rb->total_underflows++;
+			return 0;
+		}
+		do_advance_count=count>can_read_count ? can_read_count : count;
+	}
+
+	r+=do_advance_count;
+	_rb_store(&rb->read_index,r);
+
+	//if write index was overpassed, move up to read index
+	if(over && can_read_count<do_advance_count)
+	{
+		_rb_store(&rb->write_index,r);
+		rb->write_index_cache=r;
+		rb->read_index_cache=r;
+	}
+
+	rb->total_bytes_read+=do_advance_count;
+	if(do_advance_count<count){rb->total_underflows++;}
+
+	return do_advance_count;
+}//rb_generic_advance_read_index()
+
+/**
+ * Advance the read index.
+ *
+ * After data have been read from the ringbuffer using the pointers
+ * returned by rb_get_read_regions() or rb_get_next_read_region(), use this
+ * function to advance the read index, making that space available for 
+ * future write operations.
+ *
+ * The count of the read index advance can be less than the requested
+ * count, which is limited to rb_can_read() bytes.
+ *
+ * Advancing the read index without prior reading the involved bytes 
+ * means dropping/ignoring data.
+ * 
+ * @param rb pointer to the ringbuffer structure.
+ * @param count count of bytes to advance.
+ *
+ * @return count of bytes advanced, which may range from 0 to count.
+ */
+//=============================================================================
+static inline uint64_t rb_advance_read_index(rb_t *rb, uint64_t count)
+{
+	return rb_generic_advance_read_index(rb,count,0);
+}
+
+/**
+* n/a
+*/
+//=============================================================================
+static inline uint64_t rb_overadvance_read_index(rb_t *rb, uint64_t count)
+{
+	return rb_generic_advance_read_index(rb,count,1);
+}
+
+/**
+ * Advance the write index.
+ *
+ * After data have been written to the ringbuffer using the pointers
+ * returned by rb_get_write_regions() or rb_get_next_write_region() use this
+ * function to advance the write index, making the data available for
+ * future read operations.
+ *
+ * The count of the write index advance can be less than the requested
+ * count, which is limited to rb_can_write() bytes.
+ *
+ * Advancing the write index without prior writing the involved bytes
+ * means leaving arbitrary data or data that was written in the last "round"
+ * in the ringbuffer.
+ *
+ * @param rb pointer to the ringbuffer structure.
+ * @param count count of bytes to advance.
+ *
+ * @return count of bytes advanced, which may range from 0 to count
+ */
+//=============================================================================
+static inline uint64_t rb_advance_write_index(rb_t *rb, uint64_t count)
+{
+	if(count==0) {return 0;}
+	uint64_t can_write_count;
+	if(!(can_write_count=_rb_writer_space(rb,count)))
+	{
+		rb->total_overflows++;
+		return 0;
+	}
+
+	uint64_t do_advance_count=count>can_write_count ? can_write_count : count;
+	_rb_store(&rb->write_index,rb->write_index+do_advance_count);
+
+	rb->total_bytes_write+=do_advance_count;
+	if(do_advance_count<count){rb->total_overflows++;}
+
+	return do_advance_count;
+}
+
+/**
+ * Fill a data structure with a description of the current readable
+ * data held in the ringbuffer. This description is returned in a two
+ * element array of rb_region_t. Two elements are needed
+ * because the data to be read may be split across the end of the
+ * ringbuffer.
+ *
+ * The first element will always contain a valid @a len field, which
+ * may be zero or greater. If the @a len field is non-zero, then data
+ * can be read in a continuous fashion using the address given in the
+ * corresponding @a buf field.
+ *
+ * If the second element has a non-zero @a len field, then a second
+ * continuous stretch of data can be read from the address given in
+ * its corresponding @a buf field.
+ * 
+ * This method allows to read data from the ringbuffer directly using
+ * pointers to the ringbuffer's readable spaces.
+ *
+ * If data was read this way, the caller must manually advance the read
+ * index accordingly using rb_advance_read_index().
+ *
+ * @param rb pointer to the ringbuffer structure.
+ * @param regions pointer to a 2 element array of rb_region_t.
+ *
+ */
+//=============================================================================
+static inline void rb_get_read_regions(const rb_t *rb, rb_region_t *regions)
+{
+	_rb_fill_regions(rb,_rb_offset(rb,rb->read_index),rb_can_read(rb),regions);
+}
+
+/**
+ * Fill a data structure with a description of the current writable
+ * space in the ringbuffer. The description is returned in a two
+ * element array of rb_region_t. Two elements are needed
+ * because the space available for writing may be split across the end
+ * of the ringbuffer.
+ *
+ * The first element will always contain a valid @a len field, which
+ * may be zero or greater. If the @a len field is non-zero, then data
+ * can be written in a continuous fashion using the address given in
+ * the corresponding @a buf field.
+ *
+ * If the second element has a non-zero @a len field, then a second
+ * continuous stretch of data can be written to the address given in
+ * the corresponding @a buf field.
+ *
+ * This method allows to write data to the ringbuffer directly using
+ * pinters to the ringbuffer's writable spaces.
+ *
+ * If data was written this way, the caller must manually advance the write
+ * index accordingly using rb_advance_write_index().
+ *
+ * @param rb pointer to the ringbuffer structure.
+ * @param regions pointer to a 2 element array of rb_region_t.
+ */
+//=============================================================================
+static inline void rb_get_write_regions(const rb_t *rb, rb_region_t *regions)
+{
+	_rb_fill_regions(rb,_rb_offset(rb,rb->write_index),rb_can_write(rb),regions);
+}
+
+/**
+ * This function is similar to rb_get_write_regions().
+ * Opposed to rb_get_write_regions(), it will only return the first (next) region
+ * instead of an array of two regions. The region is returned to the caller by 
+ * setting the rb_region_t variable provided by the caller.
+ * If data was read using the provided pointer and size in rb_region_t, the read
+ * index must be manually advanced using rb_advance_read_index().
+ *
+ * @param rb pointer to the ringbuffer structure.
+ * @param region pointer to a variable of type rb_region_t.
+ */
+//=============================================================================
+static inline void rb_get_next_read_region(const rb_t *rb, rb_region_t *region)
+{
+	uint64_t can_read_count=rb_can_read(rb);
+	uint64_t r=_rb_offset(rb,rb->read_index);
+
+	region->buffer=&(  ((char*)buf_ptr(rb))  [r]);
+	region->size=rb_MIN(can_read_count,rb->size-r);
+}
+/**
+ * This function is similar to rb_get_read_regions().
+ * Opposed to rb_get_read_regions(), it will only return the first (next) region
+ * instead of an array of two regions. The region is returned to the caller by 
+ * setting the rb_region_t variable provided by the caller.
+ * If data was written using the provided pointer and size in rb_region_t, the write
+ * index must be manually advanced using rb_advance_write_index().
+ *
+ * @param rb pointer to the ringbuffer structure.
+ * @param region pointer to a variable of type rb_region_t.
+ */
+//=============================================================================
+static inline void rb_get_next_write_region(const rb_t *rb, rb_region_t *region)
+{
+	uint64_t can_write_count=rb_can_write(rb);
+	uint64_t w=_rb_offset(rb,rb->write_index);
+
+	region->buffer=&(  ((char*)buf_ptr(rb))  [w]);
+	region->size=rb_MIN(can_write_count,rb->size-w);
+}
+
+/**
+ * Get a pointer to the readable data and the count of bytes that can be read there in one piece.
+ *
+ * For a mirrored ringbuffer (see rb_new_mirrored_audio()) this is all readable data,
+ * also if it crosses the end of the buffer. For other ringbuffers it's the readable
+ * data up to the end of the buffer, like rb_get_next_read_region().
+ *
+ * The data can be used in place. The read index must then be advanced using
+ * rb_advance_read_index(). Only the reader may use this function.
+ *
+ * @param rb pointer to the ringbuffer structure.
+ * @param count pointer to a variable receiving the count of readable bytes at the returned pointer.
+ *
+ * @return pointer to the first readable byte.
+ */
+//=============================================================================
+static inline char *rb_read_ptr(rb_t *rb, uint64_t *count)
+{
+	uint64_t r=_rb_offset(rb,rb->read_index);
+	uint64_t can_read_count=_rb_reader_available(rb,rb->size);
+
+	*count=rb->mirrored ? can_read_count : rb_MIN(can_read_count,rb->size-r);
+	return (char*)buf_ptr(rb)+r;
+}
+
+/**
+ * Get a pointer to the writable space and the count of bytes that can be written there in one piece.
+ *
+ * For a mirrored ringbuffer (see rb_new_mirrored_audio()) this is all writable space,
+ * also if it crosses the end of the buffer. For other ringbuffers it's the writable
+ * space up to the end of the buffer, like rb_get_next_write_region().
+ *
+ * After writing data there, the write index must be advanced using rb_advance_write_index().
+ * Only the writer may use this function.
+ *
+ * @param rb pointer to the ringbuffer structure.
+ * @param count pointer to a variable receiving the count of writable bytes at the returned pointer.
+ *
+ * @return pointer to the first writable byte.
+ */
+//=============================================================================
+static inline char *rb_write_ptr(rb_t *rb, uint64_t *count)
+{
+	uint64_t w=_rb_offset(rb,rb->write_index);
+	uint64_t can_write_count=_rb_writer_space(rb,rb->size);
+
+	*count=rb->mirrored ? can_write_count : rb_MIN(can_write_count,rb->size-w);
+	return (char*)buf_ptr(rb)+w;
+}
+
+/**
+ * Reserve space to write up to count bytes directly into the ringbuffer.
+ *
+ * This lets a producer (i.e. a decoder or a network receive call) put data into
+ * ringbuffer memory without an intermediate buffer. The reserved space is described in
+ * a two element array of rb_region_t, like with rb_get_write_regions(), but limited to
+ * count bytes. The second region is only used if the space wraps around the end of
+ * the buffer. It is never used for a mirrored ringbuffer.
+ *
+ * The data becomes visible to the reader with rb_write_commit().
+ * Less than the reserved count can be committed.
+ * Only the writer may use this function.
+ *
+ * Example use:
+ * @code
+ * rb_region_t regions[2];
+ * if(rb_write_reserve(rb,count,regions)==count && regions[1].size==0)
+ * {
+ *   int got=recv(socket,regions[0].buffer,count,0);
+ *   if(got>0) {rb_write_commit(rb,got);}
+ * }
+ * @endcode
+ *
+ * @param rb pointer to the ringbuffer structure.
+ * @param count count of bytes to reserve.
+ * @param regions pointer to a 2 element array of rb_region_t.
+ *
+ * @return count of bytes reserved, which may range from 0 to count.
+ */
+//=============================================================================
+static inline uint64_t rb_write_reserve(rb_t *rb, uint64_t count, rb_region_t *regions)
+{
+	uint64_t reserved=rb_MIN(count,_rb_writer_space(rb,count));
+	if(reserved<count) {rb->total_overflows++;}
+
+	_rb_fill_regions(rb,_rb_offset(rb,rb->write_index),reserved,regions);
+	return reserved;
+}
+
+/**
+ * Publish count bytes previously written into the space returned by rb_write_reserve().
+ *
+ * @param rb pointer to the ringbuffer structure.
+ * @param count count of bytes to publish, at most the reserved count.
+ *
+ * @return count of bytes published.
+ */
+//=============================================================================
+static inline uint64_t rb_write_commit(rb_t *rb, uint64_t count)
+{
+	return rb_advance_write_index(rb,count);
+}
+
+/**
+ * Reserve up to count bytes of readable data to be used directly in ringbuffer memory.
+ *
+ * This is the reader side of rb_write_reserve(). The data is described in a two element
+ * array of rb_region_t, like with rb_get_read_regions(), but limited to count bytes.
+ * The data stays in the buffer until rb_read_commit() is called.
+ * Only the reader may use this function.
+ *
+ * @param rb pointer to the ringbuffer structure.
+ * @param count count of bytes to reserve.
+ * @param regions pointer to a 2 element array of rb_region_t.
+ *
+ * @return count of bytes reserved, which may range from 0 to count.
+ */
+//=============================================================================
+static inline uint64_t rb_read_reserve(rb_t *rb, uint64_t count, rb_region_t *regions)
+{
+	uint64_t reserved=rb_MIN(count,_rb_reader_available(rb,count));
+	if(reserved<count) {rb->total_underflows++;}
+
+	_rb_fill_regions(rb,_rb_offset(rb,rb->read_index),reserved,regions);
+	return reserved;
+}
+
+/**
+ * Release count bytes of data previously reserved with rb_read_reserve(),
+ * making that space available for future write operations.
+ *
+ * @param rb pointer to the ringbuffer structure.
+ * @param count count of bytes to release, at most the reserved count.
+ *
+ * @return count of bytes released.
+ */
+//=============================================================================
+static inline uint64_t rb_read_commit(rb_t *rb, uint64_t count)
+{
+	return rb_advance_read_index(rb,count);
+}
+
+/**
+ * Create a notifier to wake a thread that waits for data or space in a ringbuffer.
+ *
+ * The waiting side blocks in rb_wait_readable(), rb_wait_writable() or rb_notifier_wait().
+ * The other side calls rb_notify() after it wrote (read) data. rb_notify() is realtime safe:
+ * as long as nobody waits or the waiter's watermark isn't reached it costs a memory fence and
+ * a load, otherwise one non-blocking write() to an eventfd. Unlike pthread_cond_signal() guarded
+ * by a pthread_mutex_trylock() no wakeup is lost: a wakeup sent before the waiter blocks makes
+ * its wait return immediately.
+ *
+ * The eventfd (rb_notifier_fd()) can be waited for with poll(), select() or epoll together with
+ * other file descriptors, see rb_notifier_arm().
+ *
+ * One notifier serves one waiting thread. The caller must arrange for a call to
+ * rb_notifier_free() after use.
+ *
+ * Example use (disk thread filling a buffer, process() reading it):
+ * @code
+ * //disk thread
+ * while(rb_wait_writable(rb,n,chunk_bytes,-1)) { //read chunk_bytes from disk and rb_write() them }
+ * //process()
+ * rb_read(rb,destination,count);
+ * rb_notify(n);
+ * @endcode
+ *
+ * @return pointer to a new rb_notifier_t if successful; NULL otherwise.
+ */
+//=============================================================================
+static inline rb_notifier_t *rb_notifier_new()
+{
+#ifndef WIN_BUILD
+	rb_notifier_t *n=(rb_notifier_t*)calloc(1,sizeof(rb_notifier_t));
+	if(n==NULL) {return NULL;}
+	n->fd=eventfd(0,EFD_NONBLOCK | EFD_CLOEXEC);
+	if(n->fd<0)
+	{
+		fprintf(stderr,"rb.h: eventfd failed %d %s\n",errno,strerror(errno));
+		free(n);
+		return NULL;
+	}
+	return n;
+#else
+	return NULL;
+#endif
+}
+
+/**
+ * Free a notifier created by rb_notifier_new().
+ *
+ * Nobody should wait or notify when calling rb_notifier_free().
+ *
+ * @param n pointer to the notifier.
+ */
+//=============================================================================
+static inline void rb_notifier_free(rb_notifier_t *n)
+{
+	if(n==NULL) {return;}
+#ifndef WIN_BUILD
+	close(n->fd);
+#endif
+	free(n);
+}
+
+/**
+ * Return the file descriptor of the notifier. It is readable while a wakeup is pending.
+ *
+ * @param n pointer to the notifier.
+ *
+ * @return eventfd file descriptor.
+ */
+//=============================================================================
+static inline int rb_notifier_fd(const rb_notifier_t *n)
+{
+	return n->fd;
+}
+
+//=============================================================================
+static inline int _rb_notifier_condition_met(const rb_notifier_t *n)
+{
+	switch(n->condition)
+	{
+	case RB_WAIT_READABLE:
+		return rb_can_read(n->rb)>=n->watermark;
+	case RB_WAIT_WRITABLE:
+		return rb_can_write(n->rb)>=n->watermark;
+	}
+	return 1;
+}
+
+//=============================================================================
+//wake the waiting side: the armed flag makes sure only one of several rb_notify() calls writes
+static inline int _rb_notifier_signal(rb_notifier_t *n)
+{
+#ifndef WIN_BUILD
+	if(!__atomic_exchange_n(&n->armed,0,__ATOMIC_ACQ_REL)) {return 0;}
+	uint64_t one=1;
+	if(write(n->fd,&one,sizeof(one))!=(ssize_t)sizeof(one)) {return 0;}
+	__atomic_fetch_add(&n->total_notifications,1,__ATOMIC_RELAXED);
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+/**
+ * Announce the waiting side what it waits for, before it blocks.
+ *
+ * This is only needed when waiting on rb_notifier_fd() with poll(), select() or epoll directly.
+ * rb_wait_readable(), rb_wait_writable() and rb_notifier_wait() call it internally.
+ *
+ * Example use:
+ * @code
+ * if(!rb_notifier_arm(n,rb,RB_WAIT_READABLE,1))
+ * {
+ *   //add rb_notifier_fd(n) and other fds to the poll() set and wait
+ *   //if rb_notifier_fd(n) is readable: rb_notifier_clear(n)
+ * }
+ * //read from rb
+ * @endcode
+ *
+ * @param n pointer to the notifier.
+ * @param rb pointer to the ringbuffer the condition refers to (unused for #RB_WAIT_ANY).
+ * @param condition #RB_WAIT_ANY, #RB_WAIT_READABLE or #RB_WAIT_WRITABLE
+ * @param watermark count of bytes that need to be readable (writable) to wake the waiting side.
+ *
+ * @return 1 if the condition is met already (don't wait, the notifier is not armed); 0 otherwise.
+ */
+//=============================================================================
+static inline int rb_notifier_arm(rb_notifier_t *n, const rb_t *rb, int condition, uint64_t watermark)
+{
+	n->rb=rb;
+	n->condition=condition;
+	n->watermark=watermark;
+	__atomic_store_n(&n->armed,1,__ATOMIC_RELEASE);
+	//pairs with the fence in rb_notify(): either the other side sees armed set or this side
+	//sees the changed fill level
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if(condition!=RB_WAIT_ANY && _rb_notifier_condition_met(n))
+	{
+		__atomic_store_n(&n->armed,0,__ATOMIC_RELAXED);
+		return 1;
+	}
+	return 0;
+}
+
+/**
+ * Consume pending wakeups after rb_notifier_fd() was found readable.
+ *
+ * @param n pointer to the notifier.
+ *
+ * @return 1 if there was a pending wakeup; 0 otherwise.
+ */
+//=============================================================================
+static inline int rb_notifier_clear(rb_notifier_t *n)
+{
+#ifndef WIN_BUILD
+	uint64_t value=0;
+	__atomic_store_n(&n->armed,0,__ATOMIC_RELAXED);
+	return read(n->fd,&value,sizeof(value))==(ssize_t)sizeof(value) && value>0;
+#else
+	return 0;
+#endif
+}
+
+/**
+ * Wake the waiting side if its condition is met (see rb_notifier_arm()).
+ *
+ * To be called after writing to (reading from) the ringbuffer the waiting side waits for.
+ * Realtime safe, see rb_notifier_new().
+ *
+ * @param n pointer to the notifier.
+ *
+ * @return 1 if the waiting side was woken; 0 otherwise.
+ */
+//=============================================================================
+static inline int rb_notify(rb_notifier_t *n)
+{
+	if(n==NULL) {return 0;}
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if(!__atomic_load_n(&n->armed,__ATOMIC_ACQUIRE)) {return 0;}
+	if(!_rb_notifier_condition_met(n)) {return 0;}
+	return _rb_notifier_signal(n);
+}
+
+/**
+ * Wake the waiting side regardless of its condition, i.e. to make it handle a request
+ * other than data or space in the ringbuffer. If the waiting side doesn't wait at the time of
+ * the call, its next wait returns immediately.
+ *
+ * @param n pointer to the notifier.
+ *
+ * @return 1 if the wakeup was sent; 0 otherwise.
+ */
+//=============================================================================
+static inline int rb_notifier_wake(rb_notifier_t *n)
+{
+#ifndef WIN_BUILD
+	if(n==NULL) {return 0;}
+	uint64_t one=1;
+	__atomic_store_n(&n->armed,0,__ATOMIC_RELAXED);
+	if(write(n->fd,&one,sizeof(one))!=(ssize_t)sizeof(one)) {return 0;}
+	__atomic_fetch_add(&n->total_notifications,1,__ATOMIC_RELAXED);
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+//=============================================================================
+static inline int _rb_notifier_wait(rb_notifier_t *n, const rb_t *rb, int condition, uint64_t watermark, int timeout_ms)
+{
+#ifndef WIN_BUILD
+	if(rb_notifier_arm(n,rb,condition,watermark)) {return 1;}
+
+	struct pollfd p;
+	p.fd=n->fd;
+	p.events=POLLIN;
+	p.revents=0;
+	int ret=poll(&p,1,timeout_ms);
+	rb_notifier_clear(n);
+	if(ret<=0) {return 0;}
+	return _rb_notifier_condition_met(n);
+#else
+	return 0;
+#endif
+}
+
+/**
+ * Block until any rb_notify() or rb_notifier_wake() call or the timeout.
+ *
+ * @param n pointer to the notifier.
+ * @param timeout_ms maximum time to wait in milliseconds, -1: no timeout.
+ *
+ * @return 1 if woken; 0 on timeout.
+ */
+//=============================================================================
+static inline int rb_notifier_wait(rb_notifier_t *n, int timeout_ms)
+{
+	return _rb_notifier_wait(n,NULL,RB_WAIT_ANY,0,timeout_ms);
+}
+
+/**
+ * Block until at least watermark bytes can be read from the ringbuffer.
+ *
+ * The writing side must call rb_notify() after writing. It only wakes this side when the
+ * watermark is reached. The function also returns on rb_notifier_wake() or the timeout, the
+ * caller should check its state and the fill level again.
+ *
+ * @param rb pointer to the ringbuffer structure.
+ * @param n pointer to the notifier.
+ * @param watermark count of bytes that need to be readable, <=rb_size().
+ * @param timeout_ms maximum time to wait in milliseconds, -1: no timeout.
+ *
+ * @return 1 if watermark bytes can be read; 0 otherwise.
+ */
+//=============================================================================
+static inline int rb_wait_readable(rb_t *rb, rb_notifier_t *n, uint64_t watermark, int timeout_ms)
+{
+	return _rb_notifier_wait(n,rb,RB_WAIT_READABLE,watermark,timeout_ms);
+}
+
+/**
+ * Block until at least watermark bytes can be written to the ringbuffer.
+ *
+ * The reading side must call rb_notify() after reading. See rb_wait_readable().
+ *
+ * @param rb pointer to the ringbuffer structure.
+ * @param n pointer to the notifier.
+ * @param watermark count of bytes that need to be writable, <=rb_size().
+ * @param timeout_ms maximum time to wait in milliseconds, -1: no timeout.
+ *
+ * @return 1 if watermark bytes can be written; 0 otherwise.
+ */
+//=============================================================================
+static inline int rb_wait_writable(rb_t *rb, rb_notifier_t *n, uint64_t watermark, int timeout_ms)
+{
+	return _rb_notifier_wait(n,rb,RB_WAIT_WRITABLE,watermark,timeout_ms);
+}
+
+//=============================================================================
+static inline void _rb_shadow_init(rb_shadow_t *s, const rb_t *rb)
+{
+	s->rb=rb;
+	s->buffer=(const char*)buf_ptr(rb);
+	s->size=rb->size;
+	s->frame_size=rb->frame_size>0 ? rb->frame_size : 1;
+	s->mirrored=rb->mirrored;
+	s->guard=s->size/4;
+	s->position=_rb_load(&rb->write_index);
+}
+
+//=============================================================================
+//oldest position that can be read safely with the writer at position w (at a frame boundary)
+static inline uint64_t _rb_shadow_oldest(const rb_shadow_t *s, uint64_t w)
+{
+	if(w+s->guard<=s->size) {return 0;}
+	uint64_t oldest=w+s->guard-s->size;
+	return (oldest+s->frame_size-1)/s->frame_size*s->frame_size;
+}
+
+//=============================================================================
+//move the shadow cursor to the readable space with the writer at position w
+static inline void _rb_shadow_follow(rb_shadow_t *s, uint64_t w)
+{
+	if(w<s->position)
+	{
+		//the ringbuffer was reset, the writer started over at 0
+		s->position=0;
+	}
+	uint64_t oldest=_rb_shadow_oldest(s,w);
+	if(oldest>s->position)
+	{
+		s->total_bytes_lost+=oldest-s->position;
+		s->total_overruns++;
+		s->position=oldest;
+	}
+}
+
+/**
+ * Create a shadow read cursor for a ringbuffer of this process, see rb_shadow_t.
+ *
+ * The shadow cursor starts at the current write position: only data written after this call is seen.
+ *
+ * @param rb pointer to the ringbuffer structure to follow.
+ *
+ * @return pointer to a new rb_shadow_t if successful; NULL otherwise.
+ */
+//=============================================================================
+static inline rb_shadow_t *rb_shadow_new(const rb_t *rb)
+{
+	if(rb==NULL || rb->size<1) {return NULL;}
+	rb_shadow_t *s=(rb_shadow_t*)calloc(1,sizeof(rb_shadow_t));
+	if(s==NULL) {return NULL;}
+	_rb_shadow_init(s,rb);
+	return s;
+}
+
+/**
+ * Open a ringbuffer in shared memory read-only and create a shadow read cursor for it.
+ *
+ * Unlike rb_open_shared(), the mapping can't change the ringbuffer: another process can meter,
+ * record or analyse the data that passes through it without interfering with its reader or writer.
+ * The file is never unlinked, not on failure either.
+ *
+ * The shadow cursor starts at the current write position: only data written after this call is seen.
+ *
+ * @param shm_handle handle (UUID) identifying the ringbuffer (without leading path to /dev/shm/) to open
+ *
+ * @return pointer to a new rb_shadow_t if successful; NULL otherwise.
+ */
+//=============================================================================
+static inline rb_shadow_t *rb_shadow_open(const char *shm_handle)
+{
+#if defined(RB_DISABLE_SHM) || defined(WIN_BUILD)
+	return NULL;
+#else
+	int fd=_shm_open(shm_handle,O_RDONLY,0);
+	if(fd<0) {return NULL;}
+
+	//check a copy of the header before mapping anything
+	rb_t header;
+	struct stat st;
+	if(fstat(fd,&st) || pread(fd,&header,sizeof(rb_t),0)!=(ssize_t)sizeof(rb_t)
+		|| strncmp(header.magic,RB_MAGIC,8) || header.version != RB_VERSION
+		|| header.size<1 || (uint64_t)st.st_size < header.buffer_offset + header.size)
+	{
+		close(fd);
+		return NULL;
+	}
+
+	rb_t *rb;
+	if(header.mirrored)
+	{
+		rb=_rb_map_mirrored(fd, header.buffer_offset, header.size, PROT_READ);
+	}
+	else
+	{
+		rb=(rb_t*)mmap(0, header.buffer_offset + header.size, PROT_READ, MAP_SHARED, fd, 0);
+		if(rb==MAP_FAILED)
+		{
+			fprintf(stderr,"rb.h: MAP_FAILED %d %s\n",errno,strerror(errno));
+			rb=NULL;
+		}
+	}
+	close(fd);
+	if(rb==NULL) {return NULL;}
+
+	rb_shadow_t *s=(rb_shadow_t*)calloc(1,sizeof(rb_shadow_t));
+	if(s==NULL)
+	{
+		munmap(rb,_rb_mapped_size(&header));
+		return NULL;
+	}
+	//geometry from the checked copy, the owner could change the header meanwhile
+	_rb_shadow_init(s,rb);
+	s->size=header.size;
+	s->frame_size=header.frame_size>0 ? header.frame_size : 1;
+	s->mirrored=header.mirrored;
+	s->guard=s->size/4;
+	s->mapped_size=_rb_mapped_size(&header);
+	return s;
+#endif
+}//end rb_shadow_open()
+
+/**
+ * Free a shadow read cursor created by rb_shadow_new() or rb_shadow_open().
+ *
+ * A ringbuffer opened with rb_shadow_open() is unmapped (never unlinked).
+ *
+ * @param s pointer to the shadow cursor.
+ */
+//=============================================================================
+static inline void rb_shadow_free(rb_shadow_t *s)
+{
+	if(s==NULL) {return;}
+#if !defined(RB_DISABLE_SHM) && !defined(WIN_BUILD)
+	if(s->mapped_size>0)
+	{
+		munmap((void*)s->rb,s->mapped_size);
+	}
+#endif
+	free(s);
+}
+
+/**
+ * Access the (read-only) ringbuffer a shadow cursor follows, i.e. to query rb_human_name().
+ *
+ * @param s pointer to the shadow cursor.
+ *
+ * @return pointer to the ringbuffer structure.
+ */
+//=============================================================================
+static inline const rb_t *rb_shadow_rb(const rb_shadow_t *s)
+{
+	return s->rb;
+}
+
+/**
+ * Move the shadow cursor to the current write position, dropping anything not yet read.
+ *
+ * @param s pointer to the shadow cursor.
+ */
+//=============================================================================
+static inline void rb_shadow_sync(rb_shadow_t *s)
+{
+	s->position=_rb_load(&s->rb->write_index);
+}
+
+/**
+ * Return the number of bytes that can be read with rb_shadow_read().
+ *
+ * Moves the shadow cursor forward if the writer has lapped it.
+ *
+ * @param s pointer to the shadow cursor.
+ *
+ * @return count of bytes (at most size - guard).
+ */
+//=============================================================================
+static inline uint64_t rb_shadow_can_read(rb_shadow_t *s)
+{
+	uint64_t w=_rb_load(&s->rb->write_index);
+	_rb_shadow_follow(s,w);
+	return w-s->position;
+}
+
+/**
+ * Copy data the writer put to the ringbuffer, without consuming it.
+ *
+ * Whole frames are copied for audio ringbuffers. If the writer has lapped the shadow cursor,
+ * the overwritten data is skipped (see rb_shadow_t total_bytes_lost). Data that the writer
+ * overwrote during the copy is removed from the destination.
+ *
+ * @param s pointer to the shadow cursor.
+ * @param destination pointer to a buffer of at least count bytes.
+ * @param count number of bytes to copy at most.
+ *
+ * @return count of bytes copied, 0 if no new data is available.
+ */
+//=============================================================================
+static inline uint64_t rb_shadow_read(rb_shadow_t *s, char *destination, uint64_t count)
+{
+	uint64_t w=_rb_load(&s->rb->write_index);
+	_rb_shadow_follow(s,w);
+	count=rb_MIN(count,w-s->position);
+	count-=count%s->frame_size;
+	if(count==0) {return 0;}
+
+	uint64_t offset=s->position%s->size;
+	uint64_t copy_count_1=s->mirrored ? count : rb_MIN(count,s->size-offset);
+	memcpy(destination, s->buffer+offset, copy_count_1);
+	if(copy_count_1<count)
+	{
+		memcpy(destination+copy_count_1, s->buffer, count-copy_count_1);
+	}
+
+	//check if the writer got to the copied bytes in the meantime (the copy happens before the load)
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	uint64_t oldest=_rb_shadow_oldest(s,_rb_load(&s->rb->write_index));
+	if(oldest>s->position)
+	{
+		uint64_t lost=rb_MIN(oldest-s->position,count);
+		memmove(destination,destination+lost,count-lost);
+		count-=lost;
+		s->position+=lost;
+		s->total_bytes_lost+=lost;
+		s->total_overruns++;
+	}
+
+	s->position+=count;
+	s->total_bytes_read+=count;
+	return count;
+}//end rb_shadow_read()
+
+/**
+ * Search for a given byte sequence in the ringbuffer's readable space.
+ * The index at which the byte sequence was found is copied to the
+ * offset variable provided by the caller. The index is relative to
+ * the start of the ringbuffer's readable space.
+ *
+ * @param rb pointer to the ringbuffer structure.
+ * @param pattern byte sequence to search in the ringbuffer's readable space
+ * @param pattern_offset offset to apply to the byte sequence
+ * @param count count of bytes to consider for matching in the byte sequence, starting from offset
+ * @param offset pointer to a uint64_t variable
+ *
+ * @return 1 if found; 0 otherwise.
+ */
+//=============================================================================
+static inline int rb_find_byte_sequence(rb_t *rb, char *pattern, uint64_t pattern_offset, uint64_t count, uint64_t *offset)
+{
+	char *tmp_pattern=pattern;
+	tmp_pattern+=pattern_offset;
+
+	char compare_buffer[count];
+	uint64_t off=0;
+	char c;
+	while(rb_peek_byte_at(rb,&c,off))
+	{
+		if(c==tmp_pattern[0])//found start
+		{
+			//read to compare buffer
+			if(rb_peek_at(rb,compare_buffer,count,off)==count)
+			{
+				if(!memcmp(tmp_pattern,compare_buffer,count))
+				{
+					memcpy(offset,&(off),sizeof(uint64_t)); //hmmm.
+					return 1;
+				}
+			}
+			else {goto _not_found;}
+		}
+		off++;
+	}
+_not_found:
+	off=0;
+	memcpy(offset,&(off),sizeof(uint64_t));
+	return 0;
+}
+
+/**
+ * Internal method to handle pointer indirections.
+ * A user of rb.h must not call this function directly.
+ * 
+ * Every process that attaches a common shared memory region with mmap() will get a different pointer value (address).
+ * 
+ * A pointer in a shared datastructure in shared memory to another chunk of memory can be problematic:
+ *
+ * -Every process accessing the main shared structure must also have access to the referenced resource.
+ *
+ * -Processes that memory map the referenced chunk will get a different pointer value (address).
+ *
+ * -> A common pointer in shared memory will point to an invalid address except for the process that created it.
+ * 
+ * This problem can be solved by using a known common base and an offset.
+ *
+ * Every process that has a pointer to the start of an rb_t can easily calculate the pointer
+ * to the buffer by offsetting it by sizeof(rb_t) since the buffer is allocated in the same chunk of memory
+ * and attached directly after rb_t members. buf_ptr() does just that.
+ *
+\verbatim
+ ->.------------- start of allocated space == start of rb_t
+   |
+   | rb_t "header"
+   |
+ ->|------ end of rb_t == start of buffer
+   |
+   | buffer (size bytes)
+   |
+   |
+   |
+   .------------- end of allocated space == end of buffer
+
+ 
+  Total size = sizeof(rb_t) + size
+\endverbatim
+ *
+ * @param rb pointer to the ringbuffer structure.
+ *
+ * @return pointer to the data buffer of this rb_t.
+ */
+static inline void *buf_ptr(const rb_t *rb)
+{
+	return (char*)rb+rb->buffer_offset;
+}
+
+/**
+ * Return the byte count for a given (multichannel) frame count using the audiosample data 
+ * properties associated with the given ringbuffer.
+ *
+ * @param rb pointer to the ringbuffer structure.
+ *
+ * @return count of bytes corresponding to the given multichannel frame count.
+ */
+//=============================================================================
+static inline uint64_t rb_frame_to_byte_count(const rb_t *rb, uint64_t count)
+{
+	return rb->frame_shift>=0 ? count << rb->frame_shift : count * rb->frame_size;
+}
+
+/**
+ * Return the (multichannel) frame count for a given byte count using the audiosample data 
+ * properties associated with the given ringbuffer.
+ *
+ * @param rb pointer to the ringbuffer structure.
+ *
+ * @return count of multichannel frames corresponding to the given byte count.
+ */
+//=============================================================================
+static inline uint64_t rb_byte_to_frame_count(const rb_t *rb, uint64_t count)
+{
+	//shift for the common power of two frame sizes (i.e. 1, 2 or 8 channels float), integer division otherwise
+	return rb->frame_shift>=0 ? count >> rb->frame_shift : count / rb->frame_size;
+}
+
+/**
+ * Convert seconds to a byte count using the given audiosample data properties.
+ * 
+ * @param sample_rate Sample rate of audiosample data (i.e. 48000)
+ * @param channel_count Count of interleaved channels in audiosample data
+ * @param bytes_per_sample Count of bytes per audiosample value of one channel (i.e. float sample: 4 bytes)
+ *
+ * @return duration [s] of audio corresponding to the given audiosample data properties.
+ */
+//=============================================================================
+static inline uint64_t rb_second_to_byte_count(double seconds, int sample_rate, int channel_count, int bytes_per_sample)
+{
+	uint64_t frames=ceil(seconds*sample_rate);
+	return frames * channel_count * bytes_per_sample;
+}
+
+/**
+ * Round an audio buffer size up to the next power of two.
+ *
+ * A power of two sized buffer takes the mask fast path for all position
+ * arithmetic. Rounding is only done if the frame size (channel_count * bytes_per_sample)
+ * is itself a power of two so that the buffer still holds a whole number of frames.
+ * Otherwise size is returned unchanged.
+ *
+ * @param size Size in bytes
+ * @param channel_count Count of interleaved channels in audiosample data
+ * @param bytes_per_sample Count of bytes per audiosample value of one channel
+ *
+ * @return size rounded up to the next power of two, or size.
+ */
+//=============================================================================
+static inline uint64_t rb_audio_size_pow2(uint64_t size, int channel_count, int bytes_per_sample)
+{
+	uint64_t frame_size=(uint64_t)channel_count*bytes_per_sample;
+	if(size<2 || frame_size==0 || (frame_size & (frame_size-1))) {return size;}
+	uint64_t pow2=1;
+	while(pow2<size) {pow2<<=1;}
+	return pow2;
+}
+
+/**
+ * Try to lock the ringbuffer for exclusive read.
+ * Only one process can lock the ringbuffer for reading at a time.
+ * Other processes can not read from the ringbuffer while it is locked.
+ * A process that successfully locks the ringbuffer must arrange for a call
+ * to rb_release_read() when the lock is not needed any longer.
+ *
+ * @param rb pointer to the ringbuffer structure.
+ *
+ * @return 1 if locked; 0 otherwise.
+ */
+//=============================================================================
+static inline int rb_try_exclusive_read(rb_t *rb)
+{
+#ifndef RB_DISABLE_RW_MUTEX
+	if(pthread_mutex_trylock(&rb->read_lock)) {return 0;}
+	else {return 1;}
+#else
+	return 0;
+#endif
+}
+
+/**
+ * Release a previously acquired write lock (see rb_try_exclusive_write()).
+ *
+ * Only processes that successfully locked the ringbuffer previously are allowed to call this function.
+ *
+ * @param rb pointer to the ringbuffer structure.
+ */
+//=============================================================================
+static inline void rb_release_read(rb_t *rb)
+{
+#ifndef RB_DISABLE_RW_MUTEX
+	pthread_mutex_unlock(&rb->read_lock);
+#endif
+}
+
+/**
+ * Try to lock the ringbuffer for exclusive write.
+ * Only one process can lock the ringbuffer for reading at a time.
+ * Other processes can not read from the ringbuffer while it is locked.
+ * A process that successfully locks the ringbuffer must arrange for a call
+ * to rb_release_write() when the lock is not needed any longer.
+ *
+ * @param rb pointer to the ringbuffer structure.
+ *
+ * @return 1 if locked; 0 otherwise.
+ */
+//=============================================================================
+static inline int rb_try_exclusive_write(rb_t *rb)
+{
+#ifndef RB_DISABLE_RW_MUTEX
+	if(pthread_mutex_trylock(&rb->write_lock)) {return 0;}
+	else {return 1;}
+#else
+	return 0;
+#endif
+}
+
+/**
+ * Release a previously acquired write lock (see rb_try_exclusive_write()).
+ *
+ * Only processes that successfully locked the ringbuffer previously are allowed to call this function.
+ *
+ * @param rb pointer to the ringbuffer structure.
+ */
+//=============================================================================
+static inline void rb_release_write(rb_t *rb)
+{
+#ifndef RB_DISABLE_RW_MUTEX
+	pthread_mutex_unlock(&rb->write_lock);
+#endif
+}
+
+/**
+ * Print out brief information about ringbuffer to stderr.
+ *
+ * Example outputs:
+\verbatim
+  can read: 0 @ 0  can write: 1 @ 0 last was: read. mlock: no. shm: no. malloc()
+  
+  can read: 0 @ 0  can write: 1 @ 0 last was: read. mlock: yes. shm: yes. 0a665956-fe9a-11e5-9718-74d435e313ae
+\endverbatim
+ *
+ * Also see 'rb_show_fill.c' included in the source code repository of rb.h. 
+ */
+//=============================================================================
+static inline void rb_debug(const rb_t *rb)
+{
+	if(rb==NULL)
+	{
+		fprintf(stderr,"rb is NULL\n");
+		return;
+	}
+	fprintf(stderr,"can read: %" PRId64 " @ %" PRId64 "  can write: %" PRId64 " @ %" PRId64 " mlock: %s shm: %s %s\n"
+		,rb_can_read(rb)
+		,_rb_offset(rb,rb->read_index)
+		,rb_can_write(rb)
+		,_rb_offset(rb,rb->write_index)
+		,rb->memory_locked ? "yes." : "no."
+		,rb->in_shared_memory ? "yes." : "no."
+		,rb->in_shared_memory ? rb->shm_handle : "malloc()"
+	);
+}
+
+/**
+ * Print out information to stderr about ringbuffer including a bar graph to indicate
+ * the buffer's fill level.
+ *
+ * Example output:
+ *
+\verbatim
+  3882a050-fe7d-11e5-b075-74d435e313ae (v0.210): buffer 1
+  audio:   2 channels @  48000 Hz,  4 bytes per sample, capacity     1.900 s
+  multichannel frames can read:    39680 can write:    51520
+  r/w 0.832 w 1886208 r 1568768 d 317440 p 1568768 o 0 u 0 
+  fill 0.435088 [===================>                          ]     0.827 s
+\endverbatim
+ *
+ * Also see 'rb_show_fill.c' included in the source code repository of rb.h. 
+ */
+//=============================================================================
+static inline void rb_debug_linearbar(const rb_t *rb)
+{
+	if(rb==NULL)
+	{
+		fprintf(stderr,"rb is NULL\n");
+		return;
+	}
+	fprintf(stderr,"%s (v%.3f): %s\n"
+		,rb->in_shared_memory ? rb->shm_handle : "Ringbuffer"
+		,rb->version
+		,rb->human_name);
+	if(rb->sample_rate>0)
+	{
+		fprintf(stderr,"audio: %3d channels @ %6d Hz, %2d bytes per sample, capacity %9.3f s\nmultichannel frames can read: %8" PRId64 " can write: %8" PRId64 "\n"
+			,rb->channel_count
+			,rb->sample_rate
+			,rb->bytes_per_sample
+			,(float)rb->size/rb->bytes_per_sample/rb->sample_rate/rb->channel_count
+			,rb_can_read_frames(rb)
+			,rb_can_write_frames(rb)
+		);
+	}
+
+	fprintf(stderr,"r/w %.3f w %" PRId64 " r %" PRId64 " d %" PRId64 " p %" PRId64 " o %" PRId64 " u %" PRId64 " \n"
+		,rb->total_bytes_write!=0 ?
+			(float)rb->total_bytes_read/rb->total_bytes_write 
+			: 0
+		,rb->total_bytes_write
+		,rb->total_bytes_read
+		,rb->total_bytes_write>rb->total_bytes_read ?
+			rb->total_bytes_write - rb->total_bytes_read 
+			: rb->total_bytes_read - rb->total_bytes_write
+		,rb->total_bytes_peek
+		,rb->total_overflows
+		,rb->total_underflows
+	);
+
+	int bar_ticks_count=45;
+	uint64_t can_w=rb_can_write(rb);
+	float fill_level;
+	if(can_w==0)
+	{
+		fill_level=1;
+	}
+	else if(can_w==rb->size)
+	{
+		fill_level=0;
+	}
+	else
+	{
+		fill_level=1-(float)can_w/rb->size;
+	}
+	int bar_ticks_show=fill_level*bar_ticks_count;
+	if(rb->sample_rate>0)
+	{
+		fprintf(stderr,"fill %.6f [%*.*s%s%*s] %9.3f s\n"
+			,fill_level
+			,bar_ticks_show
+			,bar_ticks_show
+			,bar_string
+			,fill_level==0 ? "_" : (fill_level==1 ? "^" : ">")
+			,(bar_ticks_count-bar_ticks_show)
+			,""
+			,(float)(rb->size-can_w)/rb->bytes_per_sample/rb->sample_rate/rb->channel_count
+		);
+	}
+	else
+	{
+		fprintf(stderr,"fill %.6f [%*.*s%s%*s] %10" PRId64 "\n"
+			,fill_level
+			,bar_ticks_show
+			,bar_ticks_show
+			,bar_string
+			,fill_level==0 ? "_" : (fill_level==1 ? "^" : ">")
+			,(bar_ticks_count-bar_ticks_show)
+			,""
+			,rb->size-can_w
+		);
+	}
+}//end rb_debug_linearbar()
+
+/**
+ * ..............
+ * Example outputs:
+\verbatim
+...
+\endverbatim
+ *
+ * Also see 'rb_show_fill.c' included in the source code repository of rb.h. 
+ */
+//=============================================================================
+static inline void rb_print_regions(const rb_t *rb)
+{
+	rb_region_t data[2];
+	rb_get_read_regions(rb,data);
+	fprintf(stderr,"read region size  %" PRId64 " %" PRId64 " =%" PRId64 "  "
+		,data[0].size
+		,data[1].size
+		,data[0].size+data[1].size
+	);
+
+	rb_get_write_regions(rb,data);
+	fprintf(stderr,"write region size %" PRId64 " %" PRId64 " =%" PRId64 "\n"
+		,data[0].size
+		,data[1].size
+		,data[0].size+data[1].size
+	);
+}
+
+//=============================================================================
+//"ALIASES"
+
+/**\brief This is an alias to rb_advance_read_index().*/
+static inline uint64_t rb_skip(rb_t *rb, uint64_t count) {return rb_advance_read_index(rb,count);}
+
+/**\brief This is an alias to rb_drop().*/
+static inline uint64_t rb_skip_all(rb_t *rb) {return rb_drop(rb);}
+
+/**\brief This is an alias to rb_overadvance_read_index().*/
+static inline uint64_t rb_overskip(rb_t *rb, uint64_t count) {return rb_overadvance_read_index(rb,count);}
+
+/**\brief This is an alias to rb_shared_memory_handle() (name used by rb.h <= 0.21).*/
+static inline char *rb_get_shared_memory_handle(rb_t *rb) {return rb_shared_memory_handle(rb);}
+
+//doxygen sets this to include normally unset preprocessor defines in the documentation
+#ifdef DOXYGEN
+	#define RB_ALIASES_1
+	/**< If defined (without value), add method aliases set 1.*/
+	#define RB_ALIASES_2
+	/**< If defined (without value), add method aliases set 2.*/
+#endif
+
+//#define RB_ALIASES_1
+#ifdef RB_ALIASES_1
+//if rb.h is used as a jack_ringbuffer replacement these wrappers simplify source modification
+//(sed 's/jack_ringbuffer_/rb_/g')
+
+/**\brief This is an alias to rb_new(). Part of aliases set 1 (RB_ALIASES_1).*/
+static inline rb_t *rb_create(uint64_t size)			{return rb_new(size);}
+/**\brief This is an alias to rb_can_read(). Part of aliases set 1 (RB_ALIASES_1).*/
+static inline uint64_t rb_read_space(const rb_t *rb)		{return rb_can_read(rb);}
+/**\brief This is an alias to rb_can_write(). Part of aliases set 1 (RB_ALIASES_1).*/
+static inline uint64_t rb_write_space(const rb_t *rb)		{return rb_can_write(rb);}
+/**\brief This is an alias to rb_advance_read_index(). Part of aliases set 1 (RB_ALIASES_1).*/
+static inline uint64_t rb_read_advance(rb_t *rb, uint64_t count)	{return rb_advance_read_index(rb,count);}
+/**\brief This is an alias to rb_advance_write_index(). Part of aliases set 1 (RB_ALIASES_1).*/
+static inline uint64_t rb_write_advance(rb_t *rb, uint64_t count)	{return rb_advance_write_index(rb,count);}
+/**\brief This is an alias to rb_rb_get_read_regions). Part of aliases set 1 (RB_ALIASES_1).*/
+static inline void rb_get_read_vector(const rb_t *rb, rb_region_t *regions) {return rb_get_read_regions(rb,regions);}
+/**\brief This is an alias to rb_rb_get_write_regions(). Part of aliases set 1 (RB_ALIASES_1).*/
+static inline void rb_get_write_vector(const rb_t *rb, rb_region_t *regions) {return rb_get_write_regions(rb,regions);}
+#endif
+
+//#define RB_ALIASES_2
+#ifdef RB_ALIASES_2
+//inspired by https://github.com/xant/libhl/blob/master/src/rbuf.c,
+//http://svn.drobilla.net/lad/trunk/raul/raul/RingBuffer.hpp
+
+/**\brief This is an alias to rb_size(). Part of aliases set 2 (RB_ALIASES_2).*/
+static inline uint64_t rb_capacity(rb_t *rb)	{return rb_size(rb);}
+/**\brief This is an alias to rb_reset(). Part of aliases set 2 (RB_ALIASES_2).*/
+static inline void rb_clear(rb_t *rb)		{rb_reset(rb);}
+/**\brief This is an alias to rb_free(). Part of aliases set 2 (RB_ALIASES_2).*/
+static inline void rb_destroy(rb_t *rb)		{rb_free(rb);}
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //header guard
+
+/**
+\page call_graphs Call graphs
+\section cb_ret_rb_t Call graph of functions returning a pointer to an rb_t structure (RB_DEFAULT_USE_SHM undefined):
+\dot
+
+digraph callgraph {
+"rb_new_named" -> "rb_new_audio" [style=solid];
+"rb_new_shared_named" -> "rb_new_shared_audio" [style=solid];
+"rb_new_shared_audio" -> "rb_set_common_init_values" [style=solid];
+"rb_new_shared_audio_seconds" -> "rb_second_to_byte_count" [style=solid];
+"rb_new_shared_audio_seconds" -> "rb_new_shared_audio" [style=solid];
+"rb_new_shared" -> "rb_new_shared_audio" [style=solid];
+"rb_new_audio" -> "rb_set_common_init_values" [style=solid];
+"rb_new_audio_seconds" -> "rb_new_audio" [style=solid];
+"rb_new_audio_seconds" -> "rb_second_to_byte_count" [style=solid];
+"callgraph_of_functions_returning_rb_t" -> "rb_open_shared" [style=solid];
+"callgraph_of_functions_returning_rb_t" -> "rb_new_shared" [style=solid];
+"callgraph_of_functions_returning_rb_t" -> "rb_new_audio_seconds" [style=solid];
+"callgraph_of_functions_returning_rb_t" -> "rb_new" [style=solid];
+"callgraph_of_functions_returning_rb_t" -> "rb_new_named" [style=solid];
+"callgraph_of_functions_returning_rb_t" -> "rb_new_shared_named" [style=solid];
+"callgraph_of_functions_returning_rb_t" -> "rb_new_shared_audio_seconds" [style=solid];
+"rb_new" -> "rb_new_audio" [style=solid];
+}
+\enddot
+*
+* The graph above shows that any creation of a new rb_t will call either rb_new_audio() or rb_new_shared_audio().
+* The term 'audio' in the function doesn't mean it's only for audio.
+* However it can imply that some members of rb_t are left untouched if the ringbuffer is not used with audiosample data.
+* The overhead is possibly neglectable and depends mainly on the size of the ringbuffer.
+\section cb_ret_rb_t_shm Call graph of functions returning a pointer to an rb_t structure (RB_DEFAULT_USE_SHM set):
+\dot
+
+digraph callgraph {
+"rb_new_named" -> "rb_new_audio" [style=solid];
+"rb_new_shared_named" -> "rb_new_shared_audio" [style=solid];
+"rb_new_shared_audio" -> "rb_set_common_init_values" [style=solid];
+"rb_new_shared_audio_seconds" -> "rb_second_to_byte_count" [style=solid];
+"rb_new_shared_audio_seconds" -> "rb_new_shared_audio" [style=solid];
+"rb_new_shared" -> "rb_new_shared_audio" [style=solid];
+"rb_new_audio" -> "rb_new_shared_audio" [style=solid];
+"rb_new_audio_seconds" -> "rb_new_audio" [style=solid];
+"rb_new_audio_seconds" -> "rb_second_to_byte_count" [style=solid];
+"callgraph_of_functions_returning_rb_t" -> "rb_open_shared" [style=solid];
+"callgraph_of_functions_returning_rb_t" -> "rb_new_shared" [style=solid];
+"callgraph_of_functions_returning_rb_t" -> "rb_new_audio_seconds" [style=solid];
+"callgraph_of_functions_returning_rb_t" -> "rb_new" [style=solid];
+"callgraph_of_functions_returning_rb_t" -> "rb_new_named" [style=solid];
+"callgraph_of_functions_returning_rb_t" -> "rb_new_shared_named" [style=solid];
+"callgraph_of_functions_returning_rb_t" -> "rb_new_shared_audio_seconds" [style=solid];
+"rb_new" -> "rb_new_audio" [style=solid];
+}
+\enddot
+*
+* Notice that rb_new_audio() is redirected to rb_new_shared_audio() in the graph above 
+* letting rb_new_shared_audio() handle any call to rb_new_*().
+*
+* Programs not explicitly calling rb_new_shared_*() but rb_new_(!shared)*() functions can be forced to 
+* use the rb_new_shared_*() functions by setting #RB_DEFAULT_USE_SHM.
+* This allows to inspect the ringbuffer data for debugging purposes with external tools while the program using rb.h runs as normal.
+* For the program using rb.h it should make (almost?) no difference if the structure is created on the heap or in shared memory.
+* However the program inlcuding rb.h must set #RB_DEFAULT_USE_SHM at compile time in order to enforce the implicit use of shared memory 
+* for newly created ringbuffers (brief: #RB_DEFAULT_USE_SHM is not a runtime setting).
+*/
+//EOF
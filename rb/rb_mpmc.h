@@ -0,0 +1,557 @@
+/** @file rb_mpmc.h
+ * rb_mpmc.h -- A bounded queue of fixed-size slots for multiple producers and multiple consumers.
+ *
+ * rb_t (rb.h) is a byte stream for exactly one reader and one writer. Multiple readers or writers
+ * have to take turns with rb_try_exclusive_read() / rb_try_exclusive_write(). rb_mpmc_t
+ * holds whole messages (slots) of a size fixed at creation instead. Any count of threads or
+ * processes can push and pop at the same time without a lock.
+ *
+ * Every slot carries a sequence number (D. Vyukov's bounded MPMC queue). A producer claims a
+ * slot by advancing the enqueue position with compare and swap when the slot's sequence shows
+ * it as free, copies the message and then publishes it by storing a new sequence. Consumers do
+ * the same with the dequeue position. Producers don't wait for other producers to complete
+ * (and consumers don't wait for consumers), but a consumer can only take a slot once its producer has
+ * published it.
+ *
+ * Like rb_t, a queue can live in heap memory or in shared memory (rb_mpmc_new_shared(),
+ * rb_mpmc_open_shared()), can be locked to memory (rb_mpmc_mlock()) and counts pushes, pops,
+ * overflows and underflows. The same compile time switches apply (#RB_DISABLE_SHM,
+ * #RB_DISABLE_MLOCK, #RB_DEFAULT_USE_SHM), new queues follow rb_set_alloc_policy().
+ *
+ * Example use:
+ * @code
+ * rb_mpmc_t *q=rb_mpmc_new(1024,sizeof(message_t));
+ * //any producer thread
+ * if(!rb_mpmc_push(q,(const char*)&message)) { //queue full }
+ * //any consumer thread
+ * if(rb_mpmc_pop(q,(char*)&message)) { //do stuff }
+ * rb_mpmc_free(q);
+ * @endcode
+ *
+ * Copyright (C) 2016 Thomas Brand
+ */
+
+#ifndef _RB_MPMC_H
+#define _RB_MPMC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "rb.h"
+
+static const char RB_MPMC_MAGIC[8]={'r','b','_','m','p','m','c','\0'};
+
+//as rb_t: the producers' and the consumers' position each own one cache line. slots follow
+//the header, sizeof(rb_mpmc_t) is a multiple of RB_CACHE_LINE_SIZE (checked below).
+typedef struct
+{
+  //cache line 0: set at creation, rarely written
+  char magic[8];		/**< \brief Identifies the start of a rb_mpmc_t (see #RB_MPMC_MAGIC).*/
+  float version;		/**< \brief Version of rb.h (#RB_VERSION) that created the queue.*/
+  int32_t memory_locked;	/**< \brief Whether or not the queue is locked to memory.*/
+  uint64_t slot_count;		/**< \brief Count of slots, a power of two.*/
+  uint64_t slot_mask;		/**< \brief slot_count-1.*/
+  uint64_t slot_size;		/**< \brief Count of bytes of one message (payload of a slot).*/
+  uint64_t slot_stride;		/**< \brief Count of bytes from one slot to the next (sequence number and payload, multiple of 8).*/
+  int32_t in_shared_memory;	/**< \brief Whether or not the queue is allocated as a file in shared memory.*/
+  int32_t memory_lockable;	/**< \brief 0 if compiled with RB_DISABLE_MLOCK, 1 otherwise.*/
+  int32_t memory_shareable;	/**< \brief 0 if compiled with RB_DISABLE_SHM, 1 otherwise.*/
+  int32_t unlink_requested;	/**< \brief If set to 1, producers and consumers should consider the queue deleted.*/
+
+  //cache line 1: producers
+  uint64_t enqueue_position;	/**< \brief Count of slots ever claimed by producers.*/
+  uint64_t total_pushes;	/**< \brief Count of messages pushed. rb_mpmc_reset_stats() will reset this value.*/
+  uint64_t total_overflows;	/**< \brief Count of push attempts on a full queue. rb_mpmc_reset_stats() will reset this value.*/
+  char pad_producer[40];
+
+  //cache line 2: consumers
+  uint64_t dequeue_position;	/**< \brief Count of slots ever claimed by consumers.*/
+  uint64_t total_pops;		/**< \brief Count of messages popped. rb_mpmc_reset_stats() will reset this value.*/
+  uint64_t total_underflows;	/**< \brief Count of pop attempts on an empty queue. rb_mpmc_reset_stats() will reset this value.*/
+  char pad_consumer[40];
+
+  char shm_handle[256];		/**< \brief Name of shared memory file, alphanumeric handle.*/
+  char human_name[256];		/**< \brief Name of queue, alphanumeric.*/
+}
+rb_mpmc_t;
+
+typedef char rb_mpmc_t_size_check[(sizeof(rb_mpmc_t)%RB_CACHE_LINE_SIZE==0) ? 1 : -1];
+
+/** Access rb_mpmc_t member 'slot_count' via method.*/
+static inline uint64_t rb_mpmc_slot_count(const rb_mpmc_t *q) {return q->slot_count;}
+/** Access rb_mpmc_t member 'slot_size' via method.*/
+static inline uint64_t rb_mpmc_slot_size(const rb_mpmc_t *q) {return q->slot_size;}
+/** Access rb_mpmc_t member 'memory_locked' via method.*/
+static inline int rb_mpmc_is_mlocked(const rb_mpmc_t *q) {return q->memory_locked;}
+/** Access rb_mpmc_t member 'in_shared_memory' via method.*/
+static inline int rb_mpmc_is_shared(const rb_mpmc_t *q) {return q->in_shared_memory;}
+/** Access rb_mpmc_t member 'shm_handle' via method.*/
+static inline char *rb_mpmc_shared_memory_handle(rb_mpmc_t *q) {return q->shm_handle;}
+/** Access rb_mpmc_t member 'human_name' via method.*/
+static inline char *rb_mpmc_human_name(rb_mpmc_t *q) {return q->human_name;}
+/** Access rb_mpmc_t member 'unlink_requested' via method.*/
+static inline int rb_mpmc_is_unlink_requested(const rb_mpmc_t *q) {return q->unlink_requested;}
+
+static inline rb_mpmc_t *rb_mpmc_new(uint64_t slot_count, uint64_t slot_size);
+static inline rb_mpmc_t *rb_mpmc_new_named(uint64_t slot_count, uint64_t slot_size, const char *name);
+static inline rb_mpmc_t *rb_mpmc_new_shared(uint64_t slot_count, uint64_t slot_size, const char *name);
+static inline rb_mpmc_t *rb_mpmc_open_shared(const char *shm_handle);
+static inline void rb_mpmc_free(rb_mpmc_t *q);
+static inline int rb_mpmc_mlock(rb_mpmc_t *q);
+static inline int rb_mpmc_munlock(rb_mpmc_t *q);
+static inline void rb_mpmc_reset_stats(rb_mpmc_t *q);
+static inline int rb_mpmc_push(rb_mpmc_t *q, const char *source);
+static inline int rb_mpmc_pop(rb_mpmc_t *q, char *destination);
+static inline uint64_t rb_mpmc_can_read(const rb_mpmc_t *q);
+static inline uint64_t rb_mpmc_can_write(const rb_mpmc_t *q);
+
+//=============================================================================
+//sequence number at the start of the slot for an absolute position
+static inline uint64_t *_rb_mpmc_sequence(const rb_mpmc_t *q, uint64_t position)
+{
+	return (uint64_t*)((char*)q + sizeof(rb_mpmc_t) + (position & q->slot_mask) * q->slot_stride);
+}
+
+//=============================================================================
+static inline uint64_t _rb_mpmc_bytes(uint64_t slot_count, uint64_t slot_stride)
+{
+	return sizeof(rb_mpmc_t) + slot_count * slot_stride;
+}
+
+//=============================================================================
+//round up to a power of two, >=2
+static inline uint64_t _rb_mpmc_pow2(uint64_t value)
+{
+	uint64_t p=2;
+	while(p<value) {p<<=1;}
+	return p;
+}
+
+/**
+ * Used internally while creating new instances of rb_mpmc_t.
+ * Every slot i starts out free for the producer that claims position i.
+ */
+//=============================================================================
+static inline void _rb_mpmc_init(rb_mpmc_t *q, uint64_t slot_count, uint64_t slot_size, const char *name)
+{
+	uint64_t i;
+	memcpy(q->magic,RB_MPMC_MAGIC,8);
+	q->version=RB_VERSION;
+	q->memory_locked=0;
+	q->slot_count=slot_count;
+	q->slot_mask=slot_count-1;
+	q->slot_size=slot_size;
+	q->slot_stride=(sizeof(uint64_t) + slot_size + 7) & ~(uint64_t)7;
+	q->in_shared_memory=0;
+	q->unlink_requested=0;
+	q->enqueue_position=0;
+	q->dequeue_position=0;
+	rb_mpmc_reset_stats(q);
+	q->shm_handle[0]='\0';
+	strncpy(q->human_name,name,255);
+	q->human_name[255]='\0';
+
+#ifndef RB_DISABLE_MLOCK
+	q->memory_lockable=1;
+#else
+	q->memory_lockable=0;
+#endif
+
+#ifndef RB_DISABLE_SHM
+	q->memory_shareable=1;
+#else
+	q->memory_shareable=0;
+#endif
+
+	for(i=0;i<slot_count;i++) {*_rb_mpmc_sequence(q,i)=i;}
+}
+
+//=============================================================================
+//apply the allocation policy of rb.h (rb_set_alloc_policy()) to a new queue.
+//returns 0 if it had to be locked but couldn't
+static inline int _rb_mpmc_apply_alloc_policy(rb_mpmc_t *q)
+{
+	uint64_t bytes=_rb_mpmc_bytes(q->slot_count,q->slot_stride);
+	_rb_prepare_alloc(q,bytes,q,bytes);
+	if((rb_get_alloc_policy() & RB_ALLOC_MLOCK) && !rb_mpmc_mlock(q))
+	{
+		_rb_mlock_failed(bytes,errno);
+		return 0;
+	}
+	return 1;
+}
+
+/**
+ * This is a wrapper to rb_mpmc_new_named().
+ */
+//=============================================================================
+static inline rb_mpmc_t *rb_mpmc_new(uint64_t slot_count, uint64_t slot_size)
+{
+	const char *a="anonymous";
+	return rb_mpmc_new_named(slot_count,slot_size,a);
+}
+
+/**
+ * Allocate a queue of slot_count messages of slot_size bytes each.
+ * The caller must arrange for a call to rb_mpmc_free() to release
+ * the memory associated with the queue after use.
+ *
+ * The queue is allocated in heap memory unless #RB_DEFAULT_USE_SHM is set
+ * at compile time in which case rb_mpmc_new_shared() is called implicitely.
+ *
+ * @param slot_count count of messages the queue can hold, rounded up to a power of two
+ * @param slot_size size of one message in bytes, >0
+ * @param name name of the queue, less than 256 bytes (ASCII characters) long
+ *
+ * @return pointer to a new rb_mpmc_t if successful; NULL otherwise.
+ */
+//=============================================================================
+static inline rb_mpmc_t *rb_mpmc_new_named(uint64_t slot_count, uint64_t slot_size, const char *name)
+{
+#ifndef RB_DISABLE_SHM
+	#ifdef RB_DEFAULT_USE_SHM
+		return rb_mpmc_new_shared(slot_count,slot_size,name);
+	#endif
+#endif
+	if(slot_count<1 || slot_size<1) {return NULL;}
+
+	rb_mpmc_t *q;
+	slot_count=_rb_mpmc_pow2(slot_count);
+	uint64_t bytes=_rb_mpmc_bytes(slot_count,(sizeof(uint64_t) + slot_size + 7) & ~(uint64_t)7);
+
+#ifndef _WIN32
+	if(posix_memalign((void**)&q,RB_CACHE_LINE_SIZE,bytes)) {return NULL;}
+#else
+	q=(rb_mpmc_t*)malloc(bytes);
+	if(q==NULL) {return NULL;}
+#endif
+
+	_rb_mpmc_init(q,slot_count,slot_size,name);
+	if(!_rb_mpmc_apply_alloc_policy(q))
+	{
+		rb_mpmc_free(q);
+		return NULL;
+	}
+	return q;
+}
+
+/**
+ * Allocate a queue as a file in shared memory (see rb_new_shared_audio()).
+ * Other processes can access it with rb_mpmc_open_shared(), the handle is
+ * available via rb_mpmc_shared_memory_handle().
+ *
+ * @param slot_count count of messages the queue can hold, rounded up to a power of two
+ * @param slot_size size of one message in bytes, >0
+ * @param name name of the queue, less than 256 bytes (ASCII characters) long
+ *
+ * @return pointer to a new rb_mpmc_t if successful; NULL otherwise.
+ */
+//=============================================================================
+static inline rb_mpmc_t *rb_mpmc_new_shared(uint64_t slot_count, uint64_t slot_size, const char *name)
+{
+#ifdef RB_DISABLE_SHM
+	return NULL;
+#else
+	if(slot_count<1 || slot_size<1) {return NULL;}
+
+	rb_mpmc_t *q;
+	slot_count=_rb_mpmc_pow2(slot_count);
+	uint64_t bytes=_rb_mpmc_bytes(slot_count,(sizeof(uint64_t) + slot_size + 7) & ~(uint64_t)7);
+
+	uuid_t uuid;
+	uuid_generate_time_safe(uuid);
+	char shm_handle[37];
+	uuid_unparse_lower(uuid, shm_handle);
+
+	int fd=_shm_open(shm_handle,O_CREAT | O_RDWR, 0666);
+	if(fd<0) {return NULL;}
+
+	if(ftruncate(fd,bytes)!=0)
+	{
+		close(fd);
+		_shm_unlink(shm_handle);
+		return NULL;
+	}
+
+	q=(rb_mpmc_t*)mmap(0, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if(q==NULL || q==MAP_FAILED)
+	{
+		fprintf(stderr,"rb_mpmc.h: MAP_FAILED %d %s\n",errno,strerror(errno));
+		_shm_unlink(shm_handle);
+		return NULL;
+	}
+
+	_rb_mpmc_init(q,slot_count,slot_size,name);
+	memcpy(q->shm_handle,shm_handle,37);
+	q->in_shared_memory=1;
+	if(!_rb_mpmc_apply_alloc_policy(q))
+	{
+		rb_mpmc_free(q);
+		return NULL;
+	}
+	return q;
+#endif
+}//end rb_mpmc_new_shared()
+
+/**
+ * Open a queue previously created with rb_mpmc_new_shared() (possibly by another process).
+ *
+ * @param shm_handle handle (UUID) identifying the queue (without leading path to /dev/shm/) to open
+ *
+ * @return pointer to the rb_mpmc_t in shared memory if successful; NULL otherwise.
+ */
+//=============================================================================
+static inline rb_mpmc_t *rb_mpmc_open_shared(const char *shm_handle)
+{
+#ifdef RB_DISABLE_SHM
+	return NULL;
+#else
+	rb_mpmc_t *q;
+	int fd=_shm_open(shm_handle,O_RDWR, 0666);
+	if(fd<0) {return NULL;}
+
+	q=(rb_mpmc_t*)mmap(0, sizeof(rb_mpmc_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if(q==NULL || q==MAP_FAILED)
+	{
+		close(fd);
+		fprintf(stderr,"rb_mpmc.h: MAP_FAILED %d %s\n",errno,strerror(errno));
+		return NULL;
+	}
+
+	if(strncmp(q->magic,RB_MPMC_MAGIC,8) || q->version != RB_VERSION)
+	{
+		fprintf(stderr,"rb_mpmc.h: not a queue of this version: '%s' %.3f\n",q->magic,q->version);
+		close(fd);
+		munmap(q,sizeof(rb_mpmc_t));
+		return NULL;
+	}
+
+	//remap fully (knowing the size now)
+	uint64_t bytes=_rb_mpmc_bytes(q->slot_count,q->slot_stride);
+	munmap(q,sizeof(rb_mpmc_t));
+	q=(rb_mpmc_t*)mmap(0, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if(q==NULL || q==MAP_FAILED) {return NULL;}
+	return q;
+#endif
+}//end rb_mpmc_open_shared()
+
+/**
+ * Free the queue allocated by an earlier call to rb_mpmc_new*().
+ * A queue in shared memory is unmapped and unlinked.
+ *
+ * Any active producer and/or consumer should be done before calling rb_mpmc_free().
+ *
+ * @param q pointer to the queue structure.
+ */
+//=============================================================================
+static inline void rb_mpmc_free(rb_mpmc_t *q)
+{
+	if(q==NULL) {return;}
+	q->unlink_requested=1;
+#ifndef RB_DISABLE_MLOCK
+	if(q->memory_locked) {munlock(q,_rb_mpmc_bytes(q->slot_count,q->slot_stride));}
+#endif
+#ifndef RB_DISABLE_SHM
+	if(q->in_shared_memory)
+	{
+		uint64_t bytes=_rb_mpmc_bytes(q->slot_count,q->slot_stride);
+		char handle[256];
+		memcpy(handle,q->shm_handle,256);
+		munmap(q,bytes);
+		_shm_unlink(handle);
+		return;
+	}
+#endif
+	free(q);
+}
+
+/**
+ * Lock the queue into memory (see rb_mlock()).
+ *
+ * @param q pointer to the queue structure.
+ *
+ * @return 1 if successful; 0 otherwise.
+ */
+//=============================================================================
+static inline int rb_mpmc_mlock(rb_mpmc_t *q)
+{
+#ifndef RB_DISABLE_MLOCK
+	if(mlock(q,_rb_mpmc_bytes(q->slot_count,q->slot_stride))) {return 0;}
+	q->memory_locked=1;
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+/**
+ * Unlock a previously locked queue (see rb_munlock()).
+ *
+ * @param q pointer to the queue structure.
+ *
+ * @return 1 if successful; 0 otherwise.
+ */
+//=============================================================================
+static inline int rb_mpmc_munlock(rb_mpmc_t *q)
+{
+#ifndef RB_DISABLE_MLOCK
+	if(munlock(q,_rb_mpmc_bytes(q->slot_count,q->slot_stride))) {return 0;}
+	q->memory_locked=0;
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+/**
+ * Reset statistics associated with this queue:
+ *
+ * 'total_pushes', 'total_overflows', 'total_pops', 'total_underflows'
+ *
+ * @param q pointer to the queue structure.
+ */
+//=============================================================================
+static inline void rb_mpmc_reset_stats(rb_mpmc_t *q)
+{
+	q->total_pushes=0;
+	q->total_overflows=0;
+	q->total_pops=0;
+	q->total_underflows=0;
+}
+
+/**
+ * Copy one message of rb_mpmc_slot_size() bytes to the queue.
+ *
+ * Can be called from any count of threads at the same time. Doesn't block:
+ * if the queue is full, nothing is written and 'total_overflows' is incremented.
+ *
+ * @param q pointer to the queue structure.
+ * @param source pointer to rb_mpmc_slot_size() bytes.
+ *
+ * @return 1 if the message was put to the queue; 0 otherwise.
+ */
+//=============================================================================
+static inline int rb_mpmc_push(rb_mpmc_t *q, const char *source)
+{
+	uint64_t position=__atomic_load_n(&q->enqueue_position,__ATOMIC_RELAXED);
+	uint64_t *sequence;
+	while(1)
+	{
+		sequence=_rb_mpmc_sequence(q,position);
+		int64_t diff=(int64_t)(__atomic_load_n(sequence,__ATOMIC_ACQUIRE)-position);
+		if(diff==0)
+		{
+			//slot is free: claim it (position is updated on failure)
+			if(__atomic_compare_exchange_n(&q->enqueue_position,&position,position+1
+				,1,__ATOMIC_RELAXED,__ATOMIC_RELAXED)) {break;}
+		}
+		else if(diff<0)
+		{
+			//slot still holds the message from one round before: full
+			__atomic_fetch_add(&q->total_overflows,1,__ATOMIC_RELAXED);
+			return 0;
+		}
+		else
+		{
+			//another producer claimed the slot
+			position=__atomic_load_n(&q->enqueue_position,__ATOMIC_RELAXED);
+		}
+	}
+
+	memcpy(sequence+1,source,q->slot_size);
+	//publish to consumers
+	__atomic_store_n(sequence,position+1,__ATOMIC_RELEASE);
+	__atomic_fetch_add(&q->total_pushes,1,__ATOMIC_RELAXED);
+	return 1;
+}//end rb_mpmc_push()
+
+/**
+ * Copy one message of rb_mpmc_slot_size() bytes from the queue.
+ *
+ * Can be called from any count of threads at the same time. Doesn't block:
+ * if the queue is empty, nothing is read and 'total_underflows' is incremented.
+ *
+ * @param q pointer to the queue structure.
+ * @param destination pointer to space for rb_mpmc_slot_size() bytes.
+ *
+ * @return 1 if a message was taken from the queue; 0 otherwise.
+ */
+//=============================================================================
+static inline int rb_mpmc_pop(rb_mpmc_t *q, char *destination)
+{
+	uint64_t position=__atomic_load_n(&q->dequeue_position,__ATOMIC_RELAXED);
+	uint64_t *sequence;
+	while(1)
+	{
+		sequence=_rb_mpmc_sequence(q,position);
+		int64_t diff=(int64_t)(__atomic_load_n(sequence,__ATOMIC_ACQUIRE)-(position+1));
+		if(diff==0)
+		{
+			//slot is published: claim it
+			if(__atomic_compare_exchange_n(&q->dequeue_position,&position,position+1
+				,1,__ATOMIC_RELAXED,__ATOMIC_RELAXED)) {break;}
+		}
+		else if(diff<0)
+		{
+			//not yet written: empty (or the producer of this slot hasn't finished)
+			__atomic_fetch_add(&q->total_underflows,1,__ATOMIC_RELAXED);
+			return 0;
+		}
+		else
+		{
+			//another consumer took the slot
+			position=__atomic_load_n(&q->dequeue_position,__ATOMIC_RELAXED);
+		}
+	}
+
+	memcpy(destination,sequence+1,q->slot_size);
+	//free the slot for the producer one round later
+	__atomic_store_n(sequence,position+q->slot_mask+1,__ATOMIC_RELEASE);
+	__atomic_fetch_add(&q->total_pops,1,__ATOMIC_RELAXED);
+	return 1;
+}//end rb_mpmc_pop()
+
+/**
+ * Return the count of messages in the queue.
+ *
+ * With concurrent producers and consumers this is a snapshot: it may already
+ * be outdated when returned. Messages that are claimed but not yet completely
+ * written or read are included.
+ *
+ * @param q pointer to the queue structure.
+ *
+ * @return count of messages in the queue.
+ */
+//=============================================================================
+static inline uint64_t rb_mpmc_can_read(const rb_mpmc_t *q)
+{
+	uint64_t d=__atomic_load_n(&q->dequeue_position,__ATOMIC_ACQUIRE);
+	uint64_t e=__atomic_load_n(&q->enqueue_position,__ATOMIC_ACQUIRE);
+	//a consumer can claim a slot between the two loads, not beyond e
+	return e>d ? rb_MIN(e-d,q->slot_count) : 0;
+}
+
+/**
+ * Return the count of free slots in the queue (snapshot, see rb_mpmc_can_read()).
+ *
+ * @param q pointer to the queue structure.
+ *
+ * @return count of messages that can be pushed.
+ */
+//=============================================================================
+static inline uint64_t rb_mpmc_can_write(const rb_mpmc_t *q)
+{
+	return q->slot_count-rb_mpmc_can_read(q);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //header guard
+//EOF
@@ -0,0 +1,469 @@
+/*
+rb_tap: follow a rb.h ringbuffer in shared memory without consuming its data
+
+any ringbuffer created with rb_new_shared*() (or rb_new*() with -DRB_DEFAULT_USE_SHM, i.e. the
+buffers of jack_playfile and jack_tty) can be opened by handle or by name. the ringbuffer is
+mapped read-only and a shadow read cursor (rb_shadow_t) follows the writer: the reader and the
+writer of the ringbuffer don't see the tap, no JACK ports are involved.
+
+-list ringbuffers found in /dev/shm
+-display peak and RMS level per channel of an audio ringbuffer
+-record the data passing through the ringbuffer to a .wav file (or raw to stdout)
+
+gcc -o rb_tap rb_tap.c -D_GNU_SOURCE=1 -lrt -lm `pkg-config --libs --cflags uuid`
+(or 'make tap')
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <getopt.h>
+#include <dirent.h>
+#include <time.h>
+
+#include "rb.h"
+
+#define SHM_DIR "/dev/shm"
+
+static char *my_name;
+static volatile sig_atomic_t shutdown_requested=0;
+
+//===================================================================
+static void show_usage(void)
+{
+	fprintf(stderr, "\nUsage: %s [options] <handle or name>\n", my_name);
+	fprintf(stderr, "Follow a rb.h ringbuffer in shared memory read-only, without consuming its data.\n\n");
+	fprintf(stderr, "Options:\n");
+	fprintf(stderr, "        -l, --list              List ringbuffers in " SHM_DIR " and exit\n");
+	fprintf(stderr, "        -o, --output <file>     Record to a .wav file ('-': raw data to stdout)\n");
+	fprintf(stderr, "        -q, --quiet             Don't display levels\n");
+	fprintf(stderr, "        -d, --duration <sec>    Stop after <sec> seconds\n");
+	fprintf(stderr, "        -i, --interval <ms>     Level display interval, default 200\n");
+	fprintf(stderr, "        -h, --help              Display this help message\n\n");
+	fprintf(stderr, "The tap stops when the owner of the ringbuffer frees it.\n\n");
+	fprintf(stderr, "Examples:\n");
+	fprintf(stderr, "  %s -l\n", my_name);
+	fprintf(stderr, "  %s deinterleaved\n", my_name);
+	fprintf(stderr, "  %s -o capture.wav -d 10 b6310884-9938-11e5-bf8c-74d435e313ae\n", my_name);
+	fprintf(stderr, "  %s -q -o - interleaved | sox -t f32 -r 48000 -c 2 - -n stat\n\n", my_name);
+}
+
+//===================================================================
+static void signal_handler(int sig)
+{
+	shutdown_requested=1;
+}
+
+//===================================================================
+static double now_seconds()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec + ts.tv_nsec/1000000000.0;
+}
+
+//read the header of a file in shared memory to header
+//return 1 if it is a ringbuffer of this rb.h version, -1 if it is a ringbuffer of another version, 0 otherwise
+//===================================================================
+static int probe(const char *handle, rb_t *header)
+{
+	int fd=shm_open(handle,O_RDONLY,0);
+	if(fd<0) {return 0;}
+	ssize_t got=pread(fd,header,sizeof(rb_t),0);
+	close(fd);
+	if(got<(ssize_t)sizeof(header->magic)+(ssize_t)sizeof(header->version)
+		|| strncmp(header->magic,RB_MAGIC,8)) {return 0;}
+	if(got!=(ssize_t)sizeof(rb_t) || header->version != RB_VERSION) {return -1;}
+	return 1;
+}
+
+//===================================================================
+static int list_buffers()
+{
+	DIR *dir=opendir(SHM_DIR);
+	if(dir==NULL)
+	{
+		fprintf(stderr,"could not open %s: %s\n",SHM_DIR,strerror(errno));
+		return 1;
+	}
+
+	//flags: m mirrored, l locked to memory, e writer finished, u unlink requested
+	fprintf(stdout,"%-36s  %-20s %10s %6s %3s %3s %5s %16s %s\n"
+		,"handle","name","size","rate","ch","bps","fill","written","flags");
+
+	struct dirent *entry;
+	rb_t header;
+	while((entry=readdir(dir))!=NULL)
+	{
+		if(entry->d_name[0]=='.') {continue;}
+		int ret=probe(entry->d_name,&header);
+		if(ret==0) {continue;}
+		if(ret<0)
+		{
+			fprintf(stdout,"%-36s  (rb.h version %.3f, this is %.3f)\n"
+				,entry->d_name,header.version,RB_VERSION);
+			continue;
+		}
+		uint64_t w=header.write_index;
+		uint64_t r=header.read_index;
+		uint64_t used=rb_MIN(w-r,header.size);
+		fprintf(stdout,"%-36s  %-20.20s %10" PRId64 " %6d %3d %3d %4.0f%% %16" PRId64 " %s%s%s%s\n"
+			,entry->d_name
+			,header.human_name
+			,header.size
+			,header.sample_rate
+			,header.channel_count
+			,header.bytes_per_sample
+			,header.size>0 ? 100.0*used/header.size : 0
+			,w
+			,header.mirrored ? "m" : ""
+			,header.memory_locked ? "l" : ""
+			,header.no_more_input_data ? "e" : ""
+			,header.unlink_requested ? "u" : ""
+		);
+	}
+	closedir(dir);
+	return 0;
+}
+
+//find the handle of a ringbuffer given by handle or by name (first match)
+//===================================================================
+static int find_handle(const char *handle_or_name, char *handle)
+{
+	rb_t header;
+	if(probe(handle_or_name,&header)>0)
+	{
+		snprintf(handle,256,"%s",handle_or_name);
+		return 1;
+	}
+
+	DIR *dir=opendir(SHM_DIR);
+	if(dir==NULL) {return 0;}
+	int found=0;
+	struct dirent *entry;
+	while((entry=readdir(dir))!=NULL)
+	{
+		if(entry->d_name[0]=='.') {continue;}
+		if(probe(entry->d_name,&header)<=0 || strncmp(header.human_name,handle_or_name,256)) {continue;}
+		if(!found)
+		{
+			snprintf(handle,256,"%s",entry->d_name);
+		}
+		found++;
+	}
+	closedir(dir);
+	if(found>1)
+	{
+		fprintf(stderr,"%d ringbuffers named '%s', using %s\n",found,handle_or_name,handle);
+	}
+	return found>0;
+}
+
+//===================================================================
+static void put_u16(FILE *f, uint16_t v)
+{
+	fputc(v & 0xff,f);
+	fputc((v>>8) & 0xff,f);
+}
+
+//===================================================================
+static void put_u32(FILE *f, uint32_t v)
+{
+	put_u16(f,v & 0xffff);
+	put_u16(f,(v>>16) & 0xffff);
+}
+
+//RIFF WAVE header, 4 byte samples are taken as float (like JACK audio), others as integer PCM
+//===================================================================
+static void write_wav_header(FILE *f, const rb_t *rb, uint32_t data_bytes)
+{
+	fwrite("RIFF",1,4,f);
+	put_u32(f,data_bytes+36);
+	fwrite("WAVEfmt ",1,8,f);
+	put_u32(f,16);
+	put_u16(f,rb->bytes_per_sample==4 ? 3 : 1);
+	put_u16(f,rb->channel_count);
+	put_u32(f,rb->sample_rate);
+	put_u32(f,rb->sample_rate*rb->frame_size);
+	put_u16(f,rb->frame_size);
+	put_u16(f,rb->bytes_per_sample*8);
+	fwrite("data",1,4,f);
+	put_u32(f,data_bytes);
+}
+
+//accumulate peak and sum of squares per channel (float or 16 bit samples)
+//===================================================================
+static void meter_update(const rb_t *rb, const char *data, uint64_t count, float *peak, double *sum)
+{
+	int channel_count=rb->channel_count;
+	uint64_t samples=count/rb->bytes_per_sample;
+	uint64_t i;
+	for(i=0;i<samples;i++)
+	{
+		float v;
+		if(rb->bytes_per_sample==4)
+		{
+			memcpy(&v,data+i*4,4);
+		}
+		else
+		{
+			int16_t v16;
+			memcpy(&v16,data+i*2,2);
+			v=v16/32768.0f;
+		}
+		int c=i%channel_count;
+		v=fabsf(v);
+		if(v>peak[c]) {peak[c]=v;}
+		sum[c]+=v*v;
+	}
+}
+
+//===================================================================
+static void print_level(float value)
+{
+	if(value<=0)
+	{
+		fprintf(stderr,"  -inf");
+		return;
+	}
+	fprintf(stderr," %5.1f",20*log10(value));
+}
+
+//===================================================================
+int main(int argc, char *argv[])
+{
+	int list=0;
+	int quiet=0;
+	char *output=NULL;
+	double duration=0;
+	int interval_ms=200;
+	int c;
+	int option_index;
+
+	struct option long_options[]=
+	{
+		{ "list", 0, 0, 'l' },
+		{ "output", 1, 0, 'o' },
+		{ "quiet", 0, 0, 'q' },
+		{ "duration", 1, 0, 'd' },
+		{ "interval", 1, 0, 'i' },
+		{ "help", 0, 0, 'h' },
+		{ 0, 0, 0, 0 }
+	};
+
+	my_name=strrchr(argv[0], '/');
+	if(my_name==0)
+	{
+		my_name=argv[0];
+	}else
+	{
+		my_name ++;
+	}
+
+	while((c=getopt_long(argc, argv, "lo:qd:i:h", long_options, &option_index)) >= 0)
+	{
+		switch(c)
+		{
+		case 'l':
+			list=1;
+			break;
+		case 'o':
+			output=optarg;
+			break;
+		case 'q':
+			quiet=1;
+			break;
+		case 'd':
+			duration=atof(optarg);
+			break;
+		case 'i':
+			interval_ms=atoi(optarg);
+			if(interval_ms<1) {interval_ms=1;}
+			break;
+		case 'h':
+		default:
+			show_usage();
+			return 1;
+			break;
+		}
+	}//end while getopt
+
+	if(list)
+	{
+		return list_buffers();
+	}
+
+	if(optind>=argc)
+	{
+		show_usage();
+		return 1;
+	}
+
+	char handle[256];
+	if(!find_handle(argv[optind],handle))
+	{
+		fprintf(stderr,"no ringbuffer '%s' found in %s\n",argv[optind],SHM_DIR);
+		return 1;
+	}
+
+	rb_shadow_t *s=rb_shadow_open(handle);
+	if(s==NULL)
+	{
+		fprintf(stderr,"could not open ringbuffer %s\n",handle);
+		return 1;
+	}
+	const rb_t *rb=rb_shadow_rb(s);
+	int is_audio=rb->sample_rate>0 && rb->channel_count>0 && rb->bytes_per_sample>0;
+	int can_meter=is_audio && (rb->bytes_per_sample==4 || rb->bytes_per_sample==2);
+
+	fprintf(stderr,"%s '%s': %" PRId64 " bytes",handle,rb->human_name,s->size);
+	if(is_audio)
+	{
+		fprintf(stderr,", %d Hz, %d channels, %d bytes per sample"
+			,rb->sample_rate,rb->channel_count,rb->bytes_per_sample);
+	}
+	fprintf(stderr,"\n");
+
+	FILE *out=NULL;
+	int wav=0;
+	if(output!=NULL)
+	{
+		if(!strcmp(output,"-"))
+		{
+			out=stdout;
+		}
+		else
+		{
+			if(!is_audio)
+			{
+				fprintf(stderr,"'%s' is not an audio ringbuffer, use '-o -' to record raw data\n",rb->human_name);
+				rb_shadow_free(s);
+				return 1;
+			}
+			out=fopen(output,"wb");
+			if(out==NULL)
+			{
+				fprintf(stderr,"could not open %s: %s\n",output,strerror(errno));
+				rb_shadow_free(s);
+				return 1;
+			}
+			wav=1;
+			//sizes are updated when done
+			write_wav_header(out,rb,0);
+		}
+	}
+
+	//poll often enough that the writer can't lap the shadow cursor:
+	//a quarter of the time the readable part of the buffer lasts
+	int poll_ms=interval_ms;
+	if(is_audio)
+	{
+		double readable_ms=1000.0*(s->size-s->guard)/((double)rb->sample_rate*rb->frame_size);
+		poll_ms=rb_MIN(poll_ms,(int)(readable_ms/4));
+		if(poll_ms<1) {poll_ms=1;}
+	}
+	struct timespec poll_interval;
+	poll_interval.tv_sec=poll_ms/1000;
+	poll_interval.tv_nsec=(poll_ms%1000)*1000000L;
+
+	char *buffer=(char*)malloc(s->size);
+	int channel_count=rb->channel_count>0 ? rb->channel_count : 1;
+	float *peak=(float*)calloc(channel_count,sizeof(float));
+	double *sum=(double*)calloc(channel_count,sizeof(double));
+	if(buffer==NULL || peak==NULL || sum==NULL)
+	{
+		fprintf(stderr,"out of memory\n");
+		rb_shadow_free(s);
+		return 1;
+	}
+
+	signal(SIGINT, signal_handler);
+	signal(SIGTERM, signal_handler);
+	signal(SIGPIPE, signal_handler);
+
+	double start=now_seconds();
+	double last_display=start;
+	uint64_t bytes_since_display=0;
+	uint64_t bytes_recorded=0;
+	int i;
+
+	while(!shutdown_requested)
+	{
+		uint64_t count;
+		while((count=rb_shadow_read(s,buffer,s->size))>0)
+		{
+			if(out!=NULL)
+			{
+				if(fwrite(buffer,1,count,out)!=count)
+				{
+					fprintf(stderr,"write failed: %s\n",strerror(errno));
+					shutdown_requested=1;
+					break;
+				}
+				bytes_recorded+=count;
+			}
+			if(can_meter && !quiet)
+			{
+				meter_update(rb,buffer,count,peak,sum);
+			}
+			bytes_since_display+=count;
+		}
+
+		double now=now_seconds();
+		if(!quiet && now-last_display>=interval_ms/1000.0)
+		{
+			fprintf(stderr,"%8.2f s %8.1f kB/s lost %" PRId64 " |"
+				,now-start
+				,bytes_since_display/1000.0/(now-last_display)
+				,s->total_bytes_lost);
+			if(can_meter)
+			{
+				uint64_t frames=bytes_since_display/rb->frame_size;
+				for(i=0;i<rb->channel_count;i++)
+				{
+					print_level(peak[i]);
+					print_level(frames>0 ? sqrt(sum[i]/frames) : 0);
+					fprintf(stderr," |");
+					peak[i]=0;
+					sum[i]=0;
+				}
+			}
+			fprintf(stderr,"\n");
+			last_display=now;
+			bytes_since_display=0;
+		}
+
+		if(duration>0 && now-start>=duration) {break;}
+		if(__atomic_load_n(&rb->unlink_requested,__ATOMIC_RELAXED))
+		{
+			fprintf(stderr,"ringbuffer was freed by its owner\n");
+			break;
+		}
+		nanosleep(&poll_interval,NULL);
+	}//end while
+
+	if(wav)
+	{
+		//patch sizes, a file that isn't seekable keeps the placeholder sizes
+		if(!fseek(out,0,SEEK_SET))
+		{
+			write_wav_header(out,rb,bytes_recorded);
+		}
+		fclose(out);
+	}
+	else if(out!=NULL)
+	{
+		fflush(out);
+	}
+
+	fprintf(stderr,"read %" PRId64 " bytes, lost %" PRId64 " bytes in %" PRId64 " overruns\n"
+		,s->total_bytes_read,s->total_bytes_lost,s->total_overruns);
+
+	free(buffer);
+	free(peak);
+	free(sum);
+	rb_shadow_free(s);
+	return 0;
+}
+//EOF
@@ -0,0 +1,487 @@
+/* part of jack_tools
+ *
+ * This program is free software; feel free to redistribute it and/or
+ * modify it.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. bla.
+*/
+
+//microbenchmark for rb.h
+//
+//throughput: a writer puts chunks with rb_write(), a reader takes them with rb_read().
+//-st: writer and reader alternate in one thread (cost of the calls alone)
+//-spsc: writer and reader in two threads (single producer, single consumer)
+//layout 'single': transfers start at a multiple of the chunk size, no transfer is split
+//layout 'wrapped': transfers start half a chunk off, every transfer crossing the buffer
+//end needs two copies
+//'pow2' columns use a power of two sized buffer (positions masked), 'mod' columns
+//a buffer one chunk smaller (positions taken modulo size).
+//
+//frames: cost of rb_can_read_frames() for a frame size that is a power of two (shift),
+//one that is not (division) and the former floating point conversion for reference.
+//
+//deinterleave: one period of float frames to planar channels, channel by channel with
+//rb_deinterleave_audio() vs. one pass with rb_deinterleave_audio_channels(), and the reverse
+//with rb_interleave_audio_channels(). ns per sample should not grow with the channel count.
+//
+//contention: 2, 4 and 8 threads, half producers, half consumers, passing 16 byte messages
+//through one queue. rb_mpmc.h (lock-free slots) vs. rb.h with rb_try_exclusive_write() /
+//rb_try_exclusive_read() around every rb_write() / rb_read().
+//
+//latency: a small message is sent to a second thread and echoed back over another buffer.
+//one way latency is half the round trip.
+//
+//usage: bench_rb [MB per throughput run (default 512)] [latency round trips (default 100000)]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <math.h>
+
+#include "../rb.h"
+#include "../rb_mpmc.h"
+
+//chunks per buffer for layout 'single'
+#define CHUNKS_PER_BUFFER 16
+
+static uint64_t total_bytes=512*1024*1024;
+static int round_trips=100000;
+
+typedef struct
+{
+	rb_t *rb;
+	uint64_t chunk;
+	uint64_t total;
+	char *data;
+}
+transfer_t;
+
+//=============================================================================
+static double now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec+ts.tv_nsec/1000000000.0;
+}
+
+//new ringbuffer for a given chunk size and layout
+//=============================================================================
+static rb_t *new_buffer(uint64_t chunk, int wrapped, int pow2)
+{
+	rb_t *rb=rb_new(chunk*(pow2 ? CHUNKS_PER_BUFFER : CHUNKS_PER_BUFFER-1));
+	if(wrapped)
+	{
+		rb_advance_write_index(rb,chunk/2);
+		rb_advance_read_index(rb,chunk/2);
+	}
+	return rb;
+}
+
+//=============================================================================
+static void *writer_thread(void *arg)
+{
+	transfer_t *t=(transfer_t*)arg;
+	uint64_t pos=0;
+	while(pos<t->total)
+	{
+		uint64_t put=rb_write(t->rb,t->data,t->chunk);
+		if(put==0) {sched_yield();}
+		pos+=put;
+	}
+	return NULL;
+}
+
+//=============================================================================
+static double run_st(uint64_t chunk, int wrapped, int pow2)
+{
+	rb_t *rb=new_buffer(chunk,wrapped,pow2);
+	char *data=(char*)calloc(1,chunk);
+	uint64_t pos=0;
+
+	double start=now();
+	while(pos<total_bytes)
+	{
+		rb_write(rb,data,chunk);
+		pos+=rb_read(rb,data,chunk);
+	}
+	double seconds=now()-start;
+
+	rb_free(rb);
+	free(data);
+	return total_bytes/seconds/1000000000.0;
+}
+
+//=============================================================================
+static double run_spsc(uint64_t chunk, int wrapped, int pow2)
+{
+	transfer_t t;
+	pthread_t thread;
+	char *data=(char*)calloc(1,chunk);
+	uint64_t pos=0;
+
+	t.rb=new_buffer(chunk,wrapped,pow2);
+	t.chunk=chunk;
+	t.total=total_bytes;
+	t.data=(char*)calloc(1,chunk);
+
+	double start=now();
+	pthread_create(&thread,NULL,writer_thread,&t);
+	while(pos<total_bytes)
+	{
+		uint64_t got=rb_read(t.rb,data,chunk);
+		if(got==0) {sched_yield();}
+		pos+=got;
+	}
+	pthread_join(thread,NULL);
+	double seconds=now()-start;
+
+	rb_free(t.rb);
+	free(t.data);
+	free(data);
+	return total_bytes/seconds/1000000000.0;
+}
+
+//=============================================================================
+static uint64_t frames_float(const rb_t *rb)
+{
+	//conversion as done up to rb.h 0.26
+	return floor((double)rb_can_read(rb)/rb->channel_count/rb->bytes_per_sample);
+}
+
+//ns per call of a frame count function, summing the results so the calls can't be dropped
+//=============================================================================
+static double run_frames(int channel_count, int bytes_per_sample, int use_float, uint64_t *sum)
+{
+	rb_t *rb=rb_new_audio(65536*channel_count*bytes_per_sample,"frames",48000,channel_count,bytes_per_sample);
+	uint64_t calls=total_bytes/16;
+	uint64_t i;
+	*sum=0;
+
+	double start=now();
+	for(i=0;i<calls;i++)
+	{
+		//vary the fill level so the result can't be hoisted out of the loop
+		rb->write_index=rb->read_index+(i&0xffff);
+		*sum+=use_float ? frames_float(rb) : rb_can_read_frames(rb);
+	}
+	double seconds=now()-start;
+
+	rb_free(rb);
+	return seconds/calls*1000000000.0;
+}
+
+//=============================================================================
+static void run_frames_all()
+{
+	//{channel_count, bytes_per_sample}: 8 bytes (shift), 6 bytes (division)
+	int frames[2][2]={{2,4},{3,2}};
+	uint64_t sum_int;
+	uint64_t sum_float;
+	int i;
+
+	printf("\nrb_can_read_frames()\n");
+	printf("%8s %8s %10s %10s %6s\n","frame","path","ns","float ns","same");
+	for(i=0;i<2;i++)
+	{
+		int frame_size=frames[i][0]*frames[i][1];
+		double ns_int=run_frames(frames[i][0],frames[i][1],0,&sum_int);
+		double ns_float=run_frames(frames[i][0],frames[i][1],1,&sum_float);
+		printf("%8d %8s %10.2f %10.2f %6s\n"
+			,frame_size
+			,(frame_size & (frame_size-1)) ? "div" : "shift"
+			,ns_int
+			,ns_float
+			,sum_int==sum_float ? "yes" : "NO");
+	}
+}
+
+//ns per sample for one period of channel_count channels. mode 0: channel by channel,
+//1: one pass, 2: interleave
+//=============================================================================
+static double run_deinterleave(int channel_count, int mode)
+{
+	uint64_t period=1024;
+	uint64_t period_bytes=period*channel_count*sizeof(float);
+	rb_t *rb=rb_new_audio(period_bytes*2,"deinterleave",48000,channel_count,sizeof(float));
+	char *planar=(char*)calloc(channel_count,period*sizeof(float));
+	char *destinations[64];
+	const char *sources[64];
+	char *data=(char*)calloc(1,period_bytes);
+	uint64_t rounds=rb_MAX(1,total_bytes/period_bytes);
+	uint64_t i;
+	int c;
+
+	for(c=0;c<channel_count;c++)
+	{
+		destinations[c]=planar+c*period*sizeof(float);
+		sources[c]=destinations[c];
+	}
+	//start half a period before the buffer end so that the data wraps
+	rb_advance_write_index(rb,period_bytes*3/2);
+	rb_advance_read_index(rb,period_bytes*3/2);
+	rb_write(rb,data,period_bytes);
+
+	double start=now();
+	for(i=0;i<rounds;i++)
+	{
+		if(mode==0)
+		{
+			for(c=0;c<channel_count;c++) {rb_deinterleave_audio(rb,destinations[c],period,c);}
+		}
+		else if(mode==1)
+		{
+			rb_deinterleave_audio_channels(rb,destinations,period);
+		}
+		else
+		{
+			rb_advance_read_index(rb,period_bytes);
+			rb_interleave_audio_channels(rb,sources,period);
+		}
+	}
+	double seconds=now()-start;
+
+	rb_free(rb);
+	free(planar);
+	free(data);
+	return seconds/rounds/period/channel_count*1000000000.0;
+}
+
+//=============================================================================
+static void run_deinterleave_all()
+{
+	int channel_counts[]={2,4,6,8,16,32,64};
+	int i;
+
+	printf("\ndeinterleave 1024 frames float, ns per sample\n");
+	printf("%8s %12s %12s %12s\n","channels","per channel","one pass","interleave");
+	for(i=0;i<(int)(sizeof(channel_counts)/sizeof(channel_counts[0]));i++)
+	{
+		printf("%8d %12.3f %12.3f %12.3f\n"
+			,channel_counts[i]
+			,run_deinterleave(channel_counts[i],0)
+			,run_deinterleave(channel_counts[i],1)
+			,run_deinterleave(channel_counts[i],2));
+		fflush(stdout);
+	}
+}
+
+//=============================================================================
+#define CONTENTION_MESSAGE 16
+
+typedef struct
+{
+	rb_t *rb;
+	rb_mpmc_t *q;
+	uint64_t count;
+}
+contention_t;
+
+//=============================================================================
+static void *mpmc_producer(void *arg)
+{
+	contention_t *t=(contention_t*)arg;
+	char msg[CONTENTION_MESSAGE]={0};
+	uint64_t i;
+	for(i=0;i<t->count;i++)
+	{
+		while(!rb_mpmc_push(t->q,msg)) {sched_yield();}
+	}
+	return NULL;
+}
+
+//=============================================================================
+static void *mpmc_consumer(void *arg)
+{
+	contention_t *t=(contention_t*)arg;
+	char msg[CONTENTION_MESSAGE];
+	uint64_t i;
+	for(i=0;i<t->count;i++)
+	{
+		while(!rb_mpmc_pop(t->q,msg)) {sched_yield();}
+	}
+	return NULL;
+}
+
+//=============================================================================
+static void *mutex_producer(void *arg)
+{
+	contention_t *t=(contention_t*)arg;
+	char msg[CONTENTION_MESSAGE]={0};
+	uint64_t i;
+	for(i=0;i<t->count;)
+	{
+		if(!rb_try_exclusive_write(t->rb)) {sched_yield(); continue;}
+		uint64_t put=rb_can_write(t->rb)>=CONTENTION_MESSAGE ? rb_write(t->rb,msg,CONTENTION_MESSAGE) : 0;
+		rb_release_write(t->rb);
+		if(put==0) {sched_yield(); continue;}
+		i++;
+	}
+	return NULL;
+}
+
+//=============================================================================
+static void *mutex_consumer(void *arg)
+{
+	contention_t *t=(contention_t*)arg;
+	char msg[CONTENTION_MESSAGE];
+	uint64_t i;
+	for(i=0;i<t->count;)
+	{
+		if(!rb_try_exclusive_read(t->rb)) {sched_yield(); continue;}
+		uint64_t got=rb_can_read(t->rb)>=CONTENTION_MESSAGE ? rb_read(t->rb,msg,CONTENTION_MESSAGE) : 0;
+		rb_release_read(t->rb);
+		if(got==0) {sched_yield(); continue;}
+		i++;
+	}
+	return NULL;
+}
+
+//million messages per second through one queue shared by thread_count threads
+//=============================================================================
+static double run_contention(int thread_count, int use_mpmc)
+{
+	pthread_t threads[8];
+	contention_t t;
+	uint64_t messages=rb_MAX(1,total_bytes/CONTENTION_MESSAGE/16);
+	int i;
+
+	t.rb=use_mpmc ? NULL : rb_new(1024*CONTENTION_MESSAGE);
+	t.q=use_mpmc ? rb_mpmc_new(1024,CONTENTION_MESSAGE) : NULL;
+	t.count=messages/(thread_count/2);
+
+	double start=now();
+	for(i=0;i<thread_count;i++)
+	{
+		if(use_mpmc) {pthread_create(&threads[i],NULL,i%2 ? mpmc_consumer : mpmc_producer,&t);}
+		else {pthread_create(&threads[i],NULL,i%2 ? mutex_consumer : mutex_producer,&t);}
+	}
+	for(i=0;i<thread_count;i++) {pthread_join(threads[i],NULL);}
+	double seconds=now()-start;
+
+	rb_free(t.rb);
+	rb_mpmc_free(t.q);
+	return t.count*(thread_count/2)/seconds/1000000.0;
+}
+
+//=============================================================================
+static void run_contention_all()
+{
+	int thread_counts[]={2,4,8};
+	int i;
+
+	printf("\ncontention %d byte messages (M messages/s)\n",CONTENTION_MESSAGE);
+	printf("%8s %10s %10s\n","threads","rb_mpmc","rb+mutex");
+	for(i=0;i<3;i++)
+	{
+		printf("%8d %10.3f %10.3f\n"
+			,thread_counts[i]
+			,run_contention(thread_counts[i],1)
+			,run_contention(thread_counts[i],0));
+		fflush(stdout);
+	}
+}
+
+//=============================================================================
+static void *echo_thread(void *arg)
+{
+	rb_t **rbs=(rb_t**)arg;
+	double msg;
+	int i;
+	for(i=0;i<round_trips;i++)
+	{
+		while(rb_can_read(rbs[0])<sizeof(msg)) {sched_yield();}
+		rb_read(rbs[0],(char*)&msg,sizeof(msg));
+		rb_write(rbs[1],(char*)&msg,sizeof(msg));
+	}
+	return NULL;
+}
+
+//=============================================================================
+static int compare_double(const void *a, const void *b)
+{
+	double d=*(const double*)a-*(const double*)b;
+	return d<0 ? -1 : (d>0 ? 1 : 0);
+}
+
+//=============================================================================
+static void run_latency()
+{
+	rb_t *rbs[2];
+	pthread_t thread;
+	double *samples=(double*)malloc(round_trips*sizeof(double));
+	double msg;
+	double sum=0;
+	int i;
+
+	rbs[0]=rb_new(4096);
+	rbs[1]=rb_new(4096);
+
+	pthread_create(&thread,NULL,echo_thread,rbs);
+	for(i=0;i<round_trips;i++)
+	{
+		msg=now();
+		rb_write(rbs[0],(char*)&msg,sizeof(msg));
+		while(rb_can_read(rbs[1])<sizeof(msg)) {sched_yield();}
+		rb_read(rbs[1],(char*)&msg,sizeof(msg));
+		//one way, ns
+		samples[i]=(now()-msg)/2*1000000000.0;
+		sum+=samples[i];
+	}
+	pthread_join(thread,NULL);
+
+	qsort(samples,round_trips,sizeof(double),compare_double);
+	printf("\nlatency one way (%d round trips, %d byte message)\n",round_trips,(int)sizeof(msg));
+	printf("%10s %10s %10s %10s\n","avg ns","median ns","p99 ns","max ns");
+	printf("%10.0f %10.0f %10.0f %10.0f\n"
+		,sum/round_trips
+		,samples[round_trips/2]
+		,samples[(int)(round_trips*0.99)]
+		,samples[round_trips-1]);
+
+	rb_free(rbs[0]);
+	rb_free(rbs[1]);
+	free(samples);
+}
+
+//=============================================================================
+int main(int argc, char *argv[])
+{
+	uint64_t chunks[]={16,64,256,1024,4096,65536};
+	int i;
+	int wrapped;
+
+	if(argc>1) {total_bytes=strtoull(argv[1],NULL,10)*1024*1024;}
+	if(argc>2) {round_trips=atoi(argv[2]);}
+	if(round_trips<1) {round_trips=1;}
+
+	printf("rb.h %.2f, %" PRIu64 " MB per throughput run\n\n",RB_VERSION,total_bytes/1024/1024);
+	printf("%8s %8s %10s %10s %10s %10s   (GB/s)\n","chunk","layout","st pow2","st mod","spsc pow2","spsc mod");
+
+	for(i=0;i<(int)(sizeof(chunks)/sizeof(chunks[0]));i++)
+	{
+		for(wrapped=0;wrapped<=1;wrapped++)
+		{
+			printf("%8" PRIu64 " %8s %10.3f %10.3f %10.3f %10.3f\n"
+				,chunks[i]
+				,wrapped ? "wrapped" : "single"
+				,run_st(chunks[i],wrapped,1)
+				,run_st(chunks[i],wrapped,0)
+				,run_spsc(chunks[i],wrapped,1)
+				,run_spsc(chunks[i],wrapped,0));
+			fflush(stdout);
+		}
+	}
+
+	run_frames_all();
+	run_deinterleave_all();
+	run_contention_all();
+	run_latency();
+	return 0;
+}
+//EOF
@@ -0,0 +1,1237 @@
+/* part of jack_tools
+ *
+ * This program is free software; feel free to redistribute it and/or
+ * modify it.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. bla.
+*/
+
+//unit tests for rb.h and rb_mpmc.h
+//every test starts with a fresh buffer. the interesting cases put the read/write index
+//close to the buffer end first (rotate()) so that operations have to wrap.
+//exit status is the count of failed checks (0: all ok)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <sched.h>
+#include <poll.h>
+
+#include "../rb.h"
+#include "../rb_mpmc.h"
+
+static int checks=0;
+static int failed=0;
+
+#define CHECK(cond) do { checks++; if(!(cond)) { failed++; \
+	fprintf(stderr,"%s:%d: %s: check failed: %s\n",__FILE__,__LINE__,__func__,#cond); } } while(0)
+
+//fill with a position dependent byte pattern
+//=============================================================================
+static void pattern(char *buf, uint64_t count, uint64_t start)
+{
+	uint64_t i;
+	for(i=0;i<count;i++) {buf[i]=(char)((start+i)*7+3);}
+}
+
+//=============================================================================
+static int is_pattern(const char *buf, uint64_t count, uint64_t start)
+{
+	uint64_t i;
+	for(i=0;i<count;i++) {if(buf[i]!=(char)((start+i)*7+3)) {return 0;}}
+	return 1;
+}
+
+//move read and write index to position pos of an empty buffer
+//=============================================================================
+static void rotate(rb_t *rb, uint64_t pos)
+{
+	rb_advance_write_index(rb,pos);
+	rb_advance_read_index(rb,pos);
+	rb_reset_stats(rb);
+}
+
+//=============================================================================
+static void test_new()
+{
+	rb_t *rb=rb_new(1000);
+	CHECK(rb!=NULL);
+	CHECK(rb_size(rb)==1000);
+	CHECK(rb_can_read(rb)==0);
+	CHECK(rb_can_write(rb)==1000);
+	CHECK(!strncmp(rb->magic,RB_MAGIC,8));
+	CHECK(buf_ptr(rb)==(char*)rb+sizeof(rb_t));
+	//reader and writer positions on separate cache lines, buffer aligned
+	CHECK((uintptr_t)rb%RB_CACHE_LINE_SIZE==0);
+	CHECK(sizeof(rb_t)%RB_CACHE_LINE_SIZE==0);
+	CHECK(offsetof(rb_t,write_index)%RB_CACHE_LINE_SIZE==0);
+	CHECK(offsetof(rb_t,read_index)%RB_CACHE_LINE_SIZE==0);
+	CHECK(offsetof(rb_t,read_index_cache)/RB_CACHE_LINE_SIZE==offsetof(rb_t,write_index)/RB_CACHE_LINE_SIZE);
+	CHECK(offsetof(rb_t,total_overflows)/RB_CACHE_LINE_SIZE==offsetof(rb_t,write_index)/RB_CACHE_LINE_SIZE);
+	CHECK(offsetof(rb_t,total_underflows)/RB_CACHE_LINE_SIZE==offsetof(rb_t,read_index)/RB_CACHE_LINE_SIZE);
+	rb_free(rb);
+
+	rb=rb_new_audio(480*2*4,"audio",48000,2,4);
+	CHECK(rb_sample_rate(rb)==48000);
+	CHECK(rb_channel_count(rb)==2);
+	CHECK(rb_bytes_per_sample(rb)==4);
+	CHECK(rb_can_write_frames(rb)==480);
+	CHECK(rb_frame_to_byte_count(rb,10)==80);
+	CHECK(rb_byte_to_frame_count(rb,80)==10);
+	CHECK(!strcmp(rb_human_name(rb),"audio"));
+	rb_free(rb);
+
+	CHECK(rb_second_to_byte_count(0.5,48000,2,4)==192000);
+}
+
+//=============================================================================
+static void test_write_read()
+{
+	char in[100];
+	char out[100];
+	rb_t *rb=rb_new(64);
+
+	pattern(in,100,0);
+	CHECK(rb_write(rb,in,0)==0);
+	CHECK(rb_write(rb,in,40)==40);
+	CHECK(rb_can_read(rb)==40);
+	CHECK(rb_can_write(rb)==24);
+
+	//partial write when full
+	CHECK(rb_write(rb,in+40,60)==24);
+	CHECK(rb_can_read(rb)==64);
+	CHECK(rb_can_write(rb)==0);
+	CHECK(rb_write(rb,in,1)==0);
+	CHECK(rb->total_overflows==2);
+
+	//partial read when empty
+	CHECK(rb_read(rb,out,100)==64);
+	CHECK(is_pattern(out,64,0));
+	CHECK(rb_can_read(rb)==0);
+	CHECK(rb_can_write(rb)==64);
+	CHECK(rb_read(rb,out,1)==0);
+
+	CHECK(rb->total_bytes_write==64);
+	CHECK(rb->total_bytes_read==64);
+	CHECK(rb->total_underflows==2);
+
+	rb_reset(rb);
+	CHECK(rb_can_read(rb)==0);
+	CHECK(rb->total_bytes_read==0);
+	rb_free(rb);
+}
+
+//=============================================================================
+static void test_wrap()
+{
+	char in[64];
+	char out[64];
+	rb_t *rb=rb_new(64);
+	uint64_t pos;
+
+	//every start position, write and read across the buffer end
+	for(pos=0;pos<64;pos++)
+	{
+		rb_reset(rb);
+		rotate(rb,pos);
+		pattern(in,50,pos);
+		memset(out,0,64);
+		CHECK(rb_write(rb,in,50)==50);
+		CHECK(rb->write_index==pos+50);
+		CHECK(rb_can_read(rb)==50);
+		CHECK(rb_read(rb,out,50)==50);
+		CHECK(is_pattern(out,50,pos));
+		CHECK(rb->read_index==rb->write_index);
+		CHECK(rb_can_read(rb)==0);
+	}
+
+	//completely full buffer starting at any position
+	for(pos=0;pos<64;pos++)
+	{
+		rb_reset(rb);
+		rotate(rb,pos);
+		pattern(in,64,pos);
+		CHECK(rb_write(rb,in,64)==64);
+		CHECK(rb_can_write(rb)==0);
+		CHECK(rb_read(rb,out,64)==64);
+		CHECK(is_pattern(out,64,pos));
+	}
+	rb_free(rb);
+}
+
+//=============================================================================
+static void test_pow2()
+{
+	char in[64];
+	char out[64];
+	uint64_t pos;
+
+	//power of two size: mask, otherwise modulo
+	rb_t *rb=rb_new(64);
+	CHECK(rb->size_mask==63);
+	CHECK(rb->frame_size==1);
+	CHECK(rb->frame_shift==0);
+	rb_free(rb);
+
+	//same operations as test_wrap() on the modulo path
+	rb=rb_new(60);
+	CHECK(rb->size_mask==0);
+	for(pos=0;pos<60;pos++)
+	{
+		rb_reset(rb);
+		rotate(rb,pos);
+		pattern(in,50,pos);
+		CHECK(rb_write(rb,in,50)==50);
+		CHECK(rb_read(rb,out,50)==50);
+		CHECK(is_pattern(out,50,pos));
+	}
+	rb_free(rb);
+
+	//frame conversions: shift (2 * 4 bytes) and division (3 * 2 bytes)
+	rb=rb_new_audio(4096,"pow2",48000,2,4);
+	CHECK(rb->frame_shift==3);
+	CHECK(rb_can_write_frames(rb)==512);
+	CHECK(rb_byte_to_frame_count(rb,15)==1);
+	CHECK(rb_frame_to_byte_count(rb,3)==24);
+	rb_free(rb);
+
+	rb=rb_new_audio(600,"frame6",48000,3,2);
+	CHECK(rb->frame_size==6);
+	CHECK(rb->frame_shift==-1);
+	CHECK(rb_can_write_frames(rb)==100);
+	CHECK(rb_byte_to_frame_count(rb,17)==2);
+	CHECK(rb_frame_to_byte_count(rb,3)==18);
+	rb_free(rb);
+
+	//seconds constructors round up to the next power of two if frames still fit exactly
+	CHECK(rb_audio_size_pow2(192000,2,4)==262144);
+	CHECK(rb_audio_size_pow2(262144,2,4)==262144);
+	CHECK(rb_audio_size_pow2(288000,3,2)==288000);
+	rb=rb_new_audio_seconds(0.5,"seconds",48000,2,4);
+	CHECK(rb_size(rb)==262144);
+	CHECK(rb->size_mask==262143);
+	CHECK(rb_can_write_frames(rb)==32768);
+	rb_free(rb);
+}
+
+//=============================================================================
+static void test_mirrored()
+{
+	char in[4096];
+	char out[4096];
+	uint64_t count;
+	uint64_t pos;
+	rb_t *rb=rb_new_mirrored(1000);
+	CHECK(rb!=NULL);
+	if(rb==NULL) {return;}
+	CHECK(rb_is_mirrored(rb));
+	CHECK(rb_size(rb)==4096);
+	CHECK((uintptr_t)buf_ptr(rb)%4096==0);
+
+	//second view: a byte written at the start shows up after the end
+	((char*)buf_ptr(rb))[0]=42;
+	CHECK(((char*)buf_ptr(rb))[4096]==42);
+
+	//readable and writable spans crossing the end are one piece
+	for(pos=0;pos<4096;pos+=511)
+	{
+		rb_reset(rb);
+		rotate(rb,pos);
+		char *w=rb_write_ptr(rb,&count);
+		CHECK(count==4096);
+		pattern(w,3000,pos);
+		CHECK(rb_advance_write_index(rb,3000)==3000);
+
+		char *r=rb_read_ptr(rb,&count);
+		CHECK(count==3000);
+		CHECK(r==w);
+		CHECK(is_pattern(r,3000,pos));
+
+		//rb_read() sees the same data
+		CHECK(rb_read(rb,out,3000)==3000);
+		CHECK(is_pattern(out,3000,pos));
+	}
+
+	//plain buffers: up to the buffer end
+	rb_t *plain=rb_new(4096);
+	rotate(plain,4000);
+	pattern(in,200,0);
+	rb_write(plain,in,200);
+	CHECK(!rb_is_mirrored(plain));
+	rb_read_ptr(plain,&count);
+	CHECK(count==96);
+	rb_write_ptr(plain,&count);
+	CHECK(count==3896);
+	rb_free(plain);
+
+	rb_free(rb);
+
+	rb=rb_new_mirrored_audio_seconds(0.1,"mirrored audio",48000,2,4);
+	CHECK(rb_is_mirrored(rb));
+	CHECK(rb_size(rb)==65536);
+	CHECK(rb_can_write_frames(rb)==8192);
+	rb_free(rb);
+}
+
+//=============================================================================
+static void test_peek()
+{
+	char in[64];
+	char out[64];
+	rb_t *rb=rb_new(64);
+	uint64_t pos;
+	uint64_t offset;
+
+	for(pos=0;pos<64;pos+=5)
+	{
+		rb_reset(rb);
+		rotate(rb,pos);
+		pattern(in,60,pos);
+		rb_write(rb,in,60);
+
+		CHECK(rb_peek(rb,out,60)==60);
+		CHECK(is_pattern(out,60,pos));
+
+		//data starting at offset, split or not
+		for(offset=0;offset<60;offset++)
+		{
+			memset(out,0,64);
+			CHECK(rb_peek_at(rb,out,60,offset)==60-offset);
+			CHECK(is_pattern(out,60-offset,pos+offset));
+
+			char c=0;
+			CHECK(rb_peek_byte_at(rb,&c,offset)==1);
+			CHECK(c==in[offset]);
+		}
+		CHECK(rb_peek_at(rb,out,1,60)==0);
+		CHECK(rb_can_read(rb)==60);
+	}
+	rb_free(rb);
+}
+
+//=============================================================================
+static void test_advance()
+{
+	char in[64];
+	char out[64];
+	rb_t *rb=rb_new(64);
+
+	rotate(rb,50);
+	pattern(in,30,0);
+	rb_write(rb,in,30);
+	CHECK(rb_advance_read_index(rb,20)==20);
+	CHECK(rb->read_index%64==6);
+	CHECK(rb_read(rb,out,10)==10);
+	CHECK(is_pattern(out,10,20));
+	CHECK(rb_advance_read_index(rb,1)==0);
+	CHECK(rb_advance_write_index(rb,100)==64);
+	CHECK(rb_can_write(rb)==0);
+	CHECK(rb_drop(rb)==64);
+	CHECK(rb_can_read(rb)==0);
+
+	//read beyond the write index: write index follows
+	rb_reset(rb);
+	rb_write(rb,in,10);
+	CHECK(rb_overadvance_read_index(rb,30)==30);
+	CHECK(rb->write_index==rb->read_index);
+	CHECK(rb_can_write(rb)==64);
+
+	rb_reset(rb);
+	rb_write(rb,in,10);
+	CHECK(rb_overread(rb,out,20)==20);
+	CHECK(is_pattern(out,10,0));
+	CHECK(rb_can_read(rb)==0);
+	rb_free(rb);
+}
+
+//=============================================================================
+//overread within the written data must not leave a stale write_index_cache behind read_index
+static void test_overread_cache()
+{
+	char in[256];
+	char out[256];
+	memset(in,1,sizeof(in));
+	rb_t *rb=rb_new(256);
+	CHECK(rb!=NULL);
+	if(rb==NULL) {return;}
+	CHECK(rb_write(rb,in,100)==100);
+	CHECK(rb_read(rb,out,10)==10);
+	CHECK(rb_write(rb,in,100)==100);
+	CHECK(rb_overread(rb,out,120)==120);
+	CHECK(rb_read(rb,out,200)==70);
+	CHECK(rb->read_index==rb->write_index);
+	CHECK(rb_can_read(rb)==0);
+	CHECK(rb_can_write(rb)==256);
+
+	//same for the non-copying variant
+	rb_reset(rb);
+	CHECK(rb_write(rb,in,100)==100);
+	CHECK(rb_read(rb,out,10)==10);
+	CHECK(rb_write(rb,in,100)==100);
+	CHECK(rb_overadvance_read_index(rb,120)==120);
+	CHECK(rb_advance_read_index(rb,200)==70);
+	CHECK(rb_can_read(rb)==0);
+	CHECK(rb_can_write(rb)==256);
+	rb_free(rb);
+}
+
+//=============================================================================
+static void test_regions()
+{
+	char in[64];
+	rb_region_t regions[2];
+	rb_region_t region;
+	rb_t *rb=rb_new(64);
+
+	//empty, write space split at 40
+	rotate(rb,40);
+	rb_get_read_regions(rb,regions);
+	CHECK(regions[0].size==0);
+	CHECK(regions[1].size==0);
+	rb_get_write_regions(rb,regions);
+	CHECK(regions[0].buffer==(char*)buf_ptr(rb)+40);
+	CHECK(regions[0].size==24);
+	CHECK(regions[1].buffer==(char*)buf_ptr(rb));
+	CHECK(regions[1].size==40);
+	rb_get_next_write_region(rb,&region);
+	CHECK(region.size==24);
+
+	//fill via regions, read back via rb_read
+	pattern(in,64,0);
+	memcpy(regions[0].buffer,in,regions[0].size);
+	memcpy(regions[1].buffer,in+24,30);
+	CHECK(rb_advance_write_index(rb,54)==54);
+
+	rb_get_read_regions(rb,regions);
+	CHECK(regions[0].size==24);
+	CHECK(regions[1].size==30);
+	CHECK(is_pattern(regions[0].buffer,24,0));
+	CHECK(is_pattern(regions[1].buffer,30,24));
+	rb_get_next_read_region(rb,&region);
+	CHECK(region.buffer==regions[0].buffer);
+	CHECK(region.size==24);
+
+	rb_get_write_regions(rb,regions);
+	CHECK(regions[0].size==10);
+	CHECK(regions[1].size==0);
+
+	//not wrapped
+	rb_advance_read_index(rb,30);
+	rb_get_read_regions(rb,regions);
+	CHECK(regions[0].size==24);
+	CHECK(regions[1].size==0);
+	CHECK(is_pattern(regions[0].buffer,24,30));
+	rb_free(rb);
+}
+
+//=============================================================================
+static void test_reserve()
+{
+	char in[64];
+	char out[64];
+	rb_region_t regions[2];
+	rb_t *rb=rb_new(64);
+
+	//reserve across the end, fill, commit part of it
+	rotate(rb,50);
+	CHECK(rb_write_reserve(rb,30,regions)==30);
+	CHECK(regions[0].buffer==(char*)buf_ptr(rb)+50);
+	CHECK(regions[0].size==14);
+	CHECK(regions[1].buffer==(char*)buf_ptr(rb));
+	CHECK(regions[1].size==16);
+	CHECK(rb_can_read(rb)==0);
+
+	pattern(in,30,0);
+	memcpy(regions[0].buffer,in,14);
+	memcpy(regions[1].buffer,in+14,16);
+	CHECK(rb_write_commit(rb,20)==20);
+	CHECK(rb_can_read(rb)==20);
+	CHECK(rb->total_overflows==0);
+
+	//read side sees the committed part only
+	CHECK(rb_read_reserve(rb,64,regions)==20);
+	CHECK(rb->total_underflows==1);
+	CHECK(regions[0].size==14);
+	CHECK(regions[1].size==6);
+	CHECK(is_pattern(regions[0].buffer,14,0));
+	CHECK(is_pattern(regions[1].buffer,6,14));
+	CHECK(rb_read_commit(rb,14)==14);
+	CHECK(rb_read_reserve(rb,6,regions)==6);
+	CHECK(regions[0].buffer==(char*)buf_ptr(rb));
+	CHECK(regions[1].size==0);
+	CHECK(rb_read_commit(rb,6)==6);
+	CHECK(rb_can_read(rb)==0);
+
+	//full: reserve is limited to the free space
+	CHECK(rb_write(rb,in,60)==60);
+	CHECK(rb_write_reserve(rb,10,regions)==4);
+	CHECK(regions[0].size+regions[1].size==4);
+	CHECK(rb->total_overflows==1);
+	CHECK(rb_read(rb,out,60)==60);
+	CHECK(is_pattern(out,30,0));
+	rb_free(rb);
+
+	//mirrored: always one region
+	rb=rb_new_mirrored(4096);
+	rotate(rb,4000);
+	CHECK(rb_write_reserve(rb,1000,regions)==1000);
+	CHECK(regions[0].size==1000);
+	CHECK(regions[1].size==0);
+	rb_free(rb);
+}
+
+//=============================================================================
+static void test_bytes()
+{
+	rb_t *rb=rb_new(16);
+	char seq[4]={'a','b','c','d'};
+	char c;
+	uint64_t off;
+	int i;
+
+	rotate(rb,13);
+	for(i=0;i<10;i++)
+	{
+		c='0'+i;
+		CHECK(rb_write_byte(rb,&c)==1);
+	}
+	rb_write(rb,seq,4);
+
+	CHECK(rb_find_byte(rb,'5',&off)==1);
+	CHECK(off==5);
+	CHECK(rb_find_byte(rb,'x',&off)==0);
+	CHECK(rb_find_byte_sequence(rb,seq,0,4,&off)==1);
+	CHECK(off==10);
+	CHECK(rb_find_byte_sequence(rb,seq,1,2,&off)==1);
+	CHECK(off==11);
+
+	CHECK(rb_peek_byte(rb,&c)==1 && c=='0');
+	CHECK(rb_skip_byte(rb)==1);
+	CHECK(rb_read_byte(rb,&c)==1 && c=='1');
+	CHECK(rb_can_read(rb)==12);
+	rb_free(rb);
+}
+
+//=============================================================================
+static void test_deinterleave()
+{
+	//4 frames, 3 channels, 2 bytes per sample. sample value: frame*10+channel
+	rb_t *rb=rb_new_audio(5*3*2,"deinterleave",48000,3,2);
+	int16_t frames[4*3];
+	int16_t out[4];
+	int f;
+	int ch;
+
+	for(f=0;f<4;f++) {for(ch=0;ch<3;ch++) {frames[f*3+ch]=f*10+ch;}}
+
+	rotate(rb,17);
+	rb_write(rb,(char*)frames,sizeof(frames));
+
+	for(ch=0;ch<3;ch++)
+	{
+		memset(out,0,sizeof(out));
+		CHECK(rb_deinterleave_audio(rb,(char*)out,4,ch)==4*2);
+		for(f=0;f<4;f++) {CHECK(out[f]==f*10+ch);}
+	}
+	//more frames than available
+	CHECK(rb_deinterleave_audio(rb,(char*)out,5,0)==0);
+	CHECK(rb_can_read(rb)==sizeof(frames));
+	rb_free(rb);
+}
+
+//=============================================================================
+static void test_deinterleave_channels()
+{
+	//every kernel and the generic loop, float and 16 bit, all start positions around
+	//the buffer end incl. frames split by the end (size is not a multiple of the frame size)
+	int channel_counts[]={1,2,3,4,6,8,16};
+	int bytes[]={4,2};
+	uint64_t frame_count=37;
+	int b;
+	int n;
+
+	for(b=0;b<2;b++)
+	{
+		for(n=0;n<7;n++)
+		{
+			int channels=channel_counts[n];
+			int bps=bytes[b];
+			uint64_t frame_size=channels*bps;
+			uint64_t size=frame_count*frame_size+frame_size/2+1;
+			rb_t *rb=rb_new_audio(size,"deinterleave channels",48000,channels,bps);
+			char in[37*16*4];
+			char planar[16][37*4];
+			char *destinations[16];
+			const char *sources[16];
+			int ok=1;
+			uint64_t pos;
+			int c;
+
+			for(c=0;c<channels;c++) {destinations[c]=planar[c]; sources[c]=planar[c];}
+			pattern(in,frame_count*frame_size,0);
+
+			for(pos=0;pos<size;pos+=3)
+			{
+				rb_reset(rb);
+				rotate(rb,pos);
+				rb_write(rb,in,frame_count*frame_size);
+				memset(planar,0,sizeof(planar));
+
+				if(rb_deinterleave_audio_channels(rb,destinations,frame_count)!=frame_count) {ok=0;}
+				//same result as channel by channel
+				for(c=0;c<channels;c++)
+				{
+					char out[37*4];
+					rb_deinterleave_audio(rb,out,frame_count,c);
+					if(memcmp(out,planar[c],frame_count*bps)) {ok=0;}
+				}
+				if(rb_can_read(rb)!=frame_count*frame_size) {ok=0;}
+
+				//interleave back at the same position
+				rb_reset(rb);
+				rotate(rb,pos);
+				if(rb_interleave_audio_channels(rb,sources,frame_count)!=frame_count) {ok=0;}
+				char back[37*16*4];
+				rb_read(rb,back,frame_count*frame_size);
+				if(!is_pattern(back,frame_count*frame_size,0)) {ok=0;}
+			}
+			if(!ok) {fprintf(stderr,"channels %d bytes per sample %d\n",channels,bps);}
+			CHECK(ok);
+
+			//not enough data or space
+			rb_reset(rb);
+			CHECK(rb_deinterleave_audio_channels(rb,destinations,1)==0);
+			CHECK(rb_interleave_audio_channels(rb,sources,frame_count+2)==0);
+			CHECK(rb_can_read(rb)==0);
+			rb_free(rb);
+		}
+	}
+}
+
+#ifndef RB_DISABLE_SHM
+//=============================================================================
+static void test_shared()
+{
+	char in[100];
+	char out[100];
+	rb_t *rb=rb_new_shared_named(100,"test_rb");
+	CHECK(rb!=NULL);
+	if(rb==NULL) {return;}
+	CHECK(rb_is_shared(rb));
+
+	//second mapping of the same buffer
+	rb_t *rb2=rb_open_shared(rb_shared_memory_handle(rb));
+	CHECK(rb2!=NULL);
+	if(rb2==NULL) {rb_free(rb); return;}
+	CHECK(rb2!=rb);
+	CHECK(rb_size(rb2)==100);
+
+	rotate(rb,90);
+	pattern(in,100,0);
+	CHECK(rb_write(rb,in,100)==100);
+	CHECK(rb_can_read(rb2)==100);
+	CHECK(rb_read(rb2,out,100)==100);
+	CHECK(is_pattern(out,100,0));
+	CHECK(rb_can_read(rb)==0);
+
+	munmap(rb2,sizeof(rb_t)+rb_size(rb2));
+	rb_free(rb);
+
+	//mirrored: the other process maps both views too
+	rb=rb_new_shared_mirrored_audio(5000,"test_rb mirrored",48000,1,4);
+	CHECK(rb!=NULL);
+	if(rb==NULL) {return;}
+	CHECK(rb_is_shared(rb));
+	CHECK(rb_is_mirrored(rb));
+	CHECK(rb_size(rb)==8192);
+
+	rb2=rb_open_shared(rb_shared_memory_handle(rb));
+	CHECK(rb2!=NULL);
+	if(rb2==NULL) {rb_free(rb); return;}
+	CHECK(rb_is_mirrored(rb2));
+
+	rotate(rb,8150);
+	pattern(in,100,0);
+	CHECK(rb_write(rb,in,100)==100);
+	uint64_t count;
+	char *r=rb_read_ptr(rb2,&count);
+	CHECK(count==100);
+	CHECK(is_pattern(r,100,0));
+	CHECK(rb_advance_read_index(rb2,100)==100);
+	CHECK(rb_can_read(rb)==0);
+
+	munmap(rb2,_rb_mapped_size(rb2));
+	rb_free(rb);
+}
+#endif
+
+//=============================================================================
+static void test_alloc_policy()
+{
+	char desc[64];
+	CHECK(rb_parse_alloc_policy("")==0);
+	CHECK(rb_parse_alloc_policy("none")==0);
+	CHECK(rb_parse_alloc_policy("prefault")==RB_ALLOC_PREFAULT);
+	CHECK(rb_parse_alloc_policy("hugepages,prefault")==(RB_ALLOC_HUGEPAGES | RB_ALLOC_PREFAULT));
+	CHECK(rb_parse_alloc_policy("mlock")==(RB_ALLOC_MLOCK | RB_ALLOC_PREFAULT));
+	CHECK(rb_parse_alloc_policy("prefault,lock")==-1);
+	rb_alloc_policy_string(0,desc,sizeof(desc));
+	CHECK(!strcmp(desc,"none"));
+	rb_alloc_policy_string(RB_ALLOC_MLOCK | RB_ALLOC_PREFAULT | RB_ALLOC_HUGEPAGES,desc,sizeof(desc));
+	CHECK(rb_parse_alloc_policy(desc)==(RB_ALLOC_MLOCK | RB_ALLOC_PREFAULT | RB_ALLOC_HUGEPAGES));
+	rb_alloc_policy_string(RB_ALLOC_HUGEPAGES,desc,sizeof(desc));
+	CHECK(!strcmp(desc,"hugepages"));
+	rb_alloc_policy_string(RB_ALLOC_MLOCK,desc,sizeof(desc));
+	CHECK(!strcmp(desc,"mlock"));
+
+	uint64_t minor=0, major=0;
+#ifndef WIN_BUILD
+	CHECK(rb_page_faults(&minor,&major)==1);
+#endif
+
+	//prefaulted buffers work like any other
+	rb_set_alloc_policy(RB_ALLOC_PREFAULT | RB_ALLOC_HUGEPAGES);
+	CHECK(rb_get_alloc_policy()==(RB_ALLOC_PREFAULT | RB_ALLOC_HUGEPAGES));
+	rb_t *rb=rb_new_audio(4096,"test_rb prefault",48000,2,4);
+	CHECK(rb!=NULL);
+	if(rb!=NULL)
+	{
+		CHECK(rb_write(rb,"abcd",4)==4);
+		rb_free(rb);
+	}
+	rb=rb_new_mirrored_audio(4096,"test_rb prefault mirrored",48000,2,4);
+	CHECK(rb!=NULL);
+	if(rb!=NULL) {rb_free(rb);}
+
+	char *scratch=(char*)rb_alloc_scratch(10000);
+	CHECK(scratch!=NULL);
+	if(scratch!=NULL)
+	{
+		CHECK(scratch[0]==0 && scratch[9999]==0);
+		rb_free_scratch(scratch,10000);
+	}
+
+	rb_mpmc_t *q=rb_mpmc_new(16,100);
+	CHECK(q!=NULL);
+	if(q!=NULL)
+	{
+		CHECK(rb_mpmc_push(q,"abcd")==1);
+		rb_mpmc_free(q);
+	}
+
+	//a thread working on prefaulted memory doesn't fault
+	scratch=(char*)rb_alloc_scratch(1024*1024);
+	CHECK(scratch!=NULL);
+	if(scratch!=NULL)
+	{
+		uint64_t minor2=0, major2=0;
+		CHECK(rb_page_faults(&minor,&major)==1);
+		int i;
+		for(i=0;i<1024*1024;i+=64) {scratch[i]=(char)i;}
+		CHECK(rb_page_faults(&minor2,&major2)==1);
+		CHECK(minor2-minor<4);
+		rb_free_scratch(scratch,1024*1024);
+	}
+
+	//locking can fail (RLIMIT_MEMLOCK), then nothing is returned
+	rb_set_alloc_policy(RB_ALLOC_MLOCK | RB_ALLOC_PREFAULT);
+	rb=rb_new_audio(4096,"test_rb mlock",48000,2,4);
+#ifdef RB_DISABLE_MLOCK
+	CHECK(rb==NULL);
+#endif
+	if(rb!=NULL)
+	{
+		CHECK(rb->memory_locked==1);
+		rb_free(rb);
+	}
+	q=rb_mpmc_new(16,100);
+#ifdef RB_DISABLE_MLOCK
+	CHECK(q==NULL);
+#endif
+	if(q!=NULL)
+	{
+		CHECK(rb_mpmc_is_mlocked(q)==1);
+		rb_mpmc_free(q);
+	}
+	rb_set_alloc_policy(0);
+}
+
+//=============================================================================
+static void test_shadow()
+{
+	char in[1000];
+	char out[1000];
+	rb_t *rb=rb_new_audio(800,"test_rb shadow",48000,2,2);
+	CHECK(rb!=NULL);
+	if(rb==NULL) {return;}
+	rotate(rb,792);
+
+	//starts at the write position, follows without consuming
+	rb_shadow_t *s=rb_shadow_new(rb);
+	CHECK(s!=NULL);
+	if(s==NULL) {rb_free(rb); return;}
+	CHECK(s->guard==200);
+	CHECK(rb_shadow_can_read(s)==0);
+	pattern(in,400,0);
+	CHECK(rb_write(rb,in,400)==400);
+	CHECK(rb_shadow_can_read(s)==400);
+	CHECK(rb_shadow_read(s,out,102)==100);
+	CHECK(is_pattern(out,100,0));
+	CHECK(rb_shadow_read(s,out,1000)==300);
+	CHECK(is_pattern(out,300,100));
+	CHECK(rb_can_read(rb)==400);
+	CHECK(rb->total_bytes_read==0);
+	CHECK(rb_read(rb,out,400)==400);
+
+	//the writer laps the shadow cursor: the oldest bytes are skipped at a frame boundary
+	uint64_t start=s->position;
+	CHECK(rb_write(rb,in,400)==400);
+	CHECK(rb_read(rb,out,400)==400);
+	pattern(in,500,400);
+	CHECK(rb_write(rb,in,500)==500);
+	CHECK(rb_shadow_can_read(s)==600);
+	CHECK(s->total_bytes_lost==300);
+	CHECK(s->total_overruns==1);
+	CHECK(s->position==start+300);
+	CHECK(s->position%4==0);
+	CHECK(rb_shadow_read(s,out,1000)==600);
+	CHECK(is_pattern(out,100,300));
+	CHECK(is_pattern(out+100,500,400));
+	CHECK(s->total_bytes_read==1000);
+
+	//sync drops the rest, reset restarts
+	CHECK(rb_read(rb,out,500)==500);
+	CHECK(rb_write(rb,in,100)==100);
+	rb_shadow_sync(s);
+	CHECK(rb_shadow_can_read(s)==0);
+	rb_reset(rb);
+	CHECK(rb_write(rb,in,100)==100);
+	CHECK(rb_shadow_read(s,out,1000)==100);
+	CHECK(is_pattern(out,100,400));
+
+	rb_shadow_free(s);
+	rb_free(rb);
+
+#ifndef RB_DISABLE_SHM
+	//another process' mirrored buffer, mapped read-only
+	rb=rb_new_shared_mirrored_audio(5000,"test_rb shadow",48000,1,4);
+	CHECK(rb!=NULL);
+	if(rb==NULL) {return;}
+	rotate(rb,8152);
+	s=rb_shadow_open(rb_shared_memory_handle(rb));
+	CHECK(s!=NULL);
+	if(s==NULL) {rb_free(rb); return;}
+	CHECK((const void*)rb_shadow_rb(s)!=(const void*)rb);
+	CHECK(!strcmp(rb_shadow_rb(s)->human_name,"test_rb shadow"));
+	CHECK(s->frame_size==4);
+	pattern(in,100,0);
+	CHECK(rb_write(rb,in,100)==100);
+	CHECK(rb_shadow_read(s,out,1000)==100);
+	CHECK(is_pattern(out,100,0));
+	CHECK(rb_can_read(rb)==100);
+	rb_shadow_free(s);
+
+	//not a ringbuffer
+	rb_mpmc_t *q=rb_mpmc_new_shared(16,8,"test_rb shadow");
+	CHECK(q!=NULL);
+	CHECK(rb_shadow_open(rb_mpmc_shared_memory_handle(q))==NULL);
+	rb_mpmc_free(q);
+	CHECK(rb_shadow_open("no such buffer")==NULL);
+
+	//the file is left alone
+	s=rb_shadow_open(rb_shared_memory_handle(rb));
+	CHECK(s!=NULL);
+	rb_shadow_free(s);
+	rb_free(rb);
+#endif
+}
+
+//writer thread puts a running byte counter in varying chunk sizes,
+//reader thread checks every byte
+//=============================================================================
+#define SPSC_TOTAL (64*1024*1024)
+
+static void *spsc_writer(void *arg)
+{
+	rb_t *rb=(rb_t*)arg;
+	char chunk[1000];
+	uint64_t pos=0;
+	uint64_t n=1;
+	while(pos<SPSC_TOTAL)
+	{
+		uint64_t count=n<SPSC_TOTAL-pos ? n : SPSC_TOTAL-pos;
+		pattern(chunk,count,pos);
+		uint64_t put=rb_write(rb,chunk,count);
+		//don't starve the reader on a single core
+		if(put==0) {sched_yield();}
+		pos+=put;
+		n=n%997+1;
+	}
+	return NULL;
+}
+
+//=============================================================================
+static void test_spsc()
+{
+	rb_t *rb=rb_new(4093);
+	pthread_t thread;
+	char chunk[1000];
+	uint64_t pos=0;
+	uint64_t n=1;
+	int errors=0;
+
+	pthread_create(&thread,NULL,spsc_writer,rb);
+	while(pos<SPSC_TOTAL)
+	{
+		uint64_t got=rb_read(rb,chunk,n);
+		if(got==0) {sched_yield();}
+		if(!is_pattern(chunk,got,pos)) {errors++;}
+		pos+=got;
+		n=n%991+1;
+	}
+	pthread_join(thread,NULL);
+	CHECK(errors==0);
+	CHECK(rb_can_read(rb)==0);
+	rb_free(rb);
+}
+
+//=============================================================================
+static void test_notifier()
+{
+	char data[100];
+	rb_t *rb=rb_new(100);
+	rb_notifier_t *n=rb_notifier_new();
+	CHECK(n!=NULL);
+	if(n==NULL) {rb_free(rb); return;}
+	struct pollfd p;
+	p.fd=rb_notifier_fd(n);
+	p.events=POLLIN;
+
+	//nothing to wait for: timeout
+	CHECK(rb_wait_readable(rb,n,10,0)==0);
+	CHECK(rb_notifier_wait(n,0)==0);
+	//nobody waits: no wakeup sent
+	CHECK(rb_notify(n)==0);
+
+	//condition met already: no blocking
+	CHECK(rb_wait_writable(rb,n,100,-1)==1);
+	rb_write(rb,data,10);
+	CHECK(rb_wait_readable(rb,n,10,-1)==1);
+
+	//watermark: only the write reaching 50 readable bytes wakes
+	CHECK(rb_notifier_arm(n,rb,RB_WAIT_READABLE,50)==0);
+	rb_write(rb,data,30);
+	CHECK(rb_notify(n)==0);
+	CHECK(poll(&p,1,0)==0);
+	rb_write(rb,data,10);
+	CHECK(rb_notify(n)==1);
+	//once
+	CHECK(rb_notify(n)==0);
+	CHECK(poll(&p,1,0)==1);
+	CHECK(rb_notifier_clear(n)==1);
+	CHECK(poll(&p,1,0)==0);
+	CHECK(n->total_notifications==1);
+
+	//writable watermark
+	CHECK(rb_notifier_arm(n,rb,RB_WAIT_WRITABLE,80)==0);
+	rb_read(rb,data,10);
+	CHECK(rb_notify(n)==0);
+	rb_read(rb,data,20);
+	CHECK(rb_notify(n)==1);
+	CHECK(rb_notifier_clear(n)==1);
+
+	//wake before wait: the wait returns immediately
+	CHECK(rb_notifier_wake(n)==1);
+	CHECK(rb_notifier_wait(n,-1)==1);
+	CHECK(rb_wait_readable(rb,n,100,0)==0);
+
+	rb_notifier_free(n);
+	rb_free(rb);
+}
+
+//writer puts a byte counter with rb_notify() after each write, reader only blocks in
+//rb_wait_readable() (no sleeping, no spinning)
+//=============================================================================
+#define NOTIFY_TOTAL (8*1024*1024)
+#define NOTIFY_WATERMARK 256
+
+static rb_notifier_t *notify_reader=NULL;
+static rb_notifier_t *notify_writer=NULL;
+
+static void *notify_writer_thread(void *arg)
+{
+	rb_t *rb=(rb_t*)arg;
+	char chunk[100];
+	uint64_t pos=0;
+	while(pos<NOTIFY_TOTAL)
+	{
+		uint64_t count=rb_MIN(sizeof(chunk),NOTIFY_TOTAL-pos);
+		if(!rb_wait_writable(rb,notify_writer,count,-1)) {continue;}
+		pattern(chunk,count,pos);
+		pos+=rb_write(rb,chunk,count);
+		rb_notify(notify_reader);
+	}
+	//the last bytes may stay below the watermark
+	rb_notifier_wake(notify_reader);
+	return NULL;
+}
+
+//=============================================================================
+static void test_notifier_threads()
+{
+	rb_t *rb=rb_new(4096);
+	pthread_t thread;
+	char chunk[NOTIFY_WATERMARK];
+	uint64_t pos=0;
+	int errors=0;
+
+	notify_reader=rb_notifier_new();
+	notify_writer=rb_notifier_new();
+	pthread_create(&thread,NULL,notify_writer_thread,rb);
+	while(pos<NOTIFY_TOTAL)
+	{
+		uint64_t count=rb_MIN(NOTIFY_WATERMARK,NOTIFY_TOTAL-pos);
+		if(!rb_wait_readable(rb,notify_reader,count,-1)) {continue;}
+		uint64_t got=rb_read(rb,chunk,count);
+		if(!is_pattern(chunk,got,pos)) {errors++;}
+		pos+=got;
+		rb_notify(notify_writer);
+	}
+	pthread_join(thread,NULL);
+	CHECK(errors==0);
+	CHECK(pos==NOTIFY_TOTAL);
+	//at most one wakeup per watermark reached
+	CHECK(notify_reader->total_notifications<=NOTIFY_TOTAL/NOTIFY_WATERMARK+1);
+	rb_notifier_free(notify_reader);
+	rb_notifier_free(notify_writer);
+	rb_free(rb);
+}
+
+//=============================================================================
+static void test_mpmc()
+{
+	char in[13];
+	char out[13];
+	uint64_t i;
+	rb_mpmc_t *q=rb_mpmc_new(5,sizeof(in));
+	CHECK(q!=NULL);
+	if(q==NULL) {return;}
+	CHECK(rb_mpmc_slot_count(q)==8);
+	CHECK(rb_mpmc_slot_size(q)==13);
+	CHECK(q->slot_stride==24);
+	CHECK((uintptr_t)q%RB_CACHE_LINE_SIZE==0);
+	CHECK(offsetof(rb_mpmc_t,enqueue_position)%RB_CACHE_LINE_SIZE==0);
+	CHECK(offsetof(rb_mpmc_t,dequeue_position)%RB_CACHE_LINE_SIZE==0);
+	CHECK(rb_mpmc_can_read(q)==0);
+	CHECK(rb_mpmc_can_write(q)==8);
+	CHECK(rb_mpmc_pop(q,out)==0);
+	CHECK(q->total_underflows==1);
+
+	//several rounds so that positions wrap the slots, keeping three messages in the queue
+	for(i=0;i<103;i++)
+	{
+		pattern(in,sizeof(in),i);
+		CHECK(rb_mpmc_push(q,in)==1);
+		if(i<3) {continue;}
+		CHECK(rb_mpmc_pop(q,out)==1);
+		CHECK(is_pattern(out,sizeof(out),i-3));
+		CHECK(rb_mpmc_can_read(q)==3);
+	}
+	rb_mpmc_free(q);
+
+	q=rb_mpmc_new(8,sizeof(in));
+	for(i=0;i<8;i++)
+	{
+		pattern(in,sizeof(in),i);
+		CHECK(rb_mpmc_push(q,in)==1);
+	}
+	CHECK(rb_mpmc_can_read(q)==8);
+	CHECK(rb_mpmc_can_write(q)==0);
+	CHECK(rb_mpmc_push(q,in)==0);
+	CHECK(q->total_overflows==1);
+	for(i=0;i<8;i++)
+	{
+		CHECK(rb_mpmc_pop(q,out)==1);
+		CHECK(is_pattern(out,sizeof(out),i));
+	}
+	CHECK(rb_mpmc_pop(q,out)==0);
+	CHECK(q->total_pushes==8);
+	CHECK(q->total_pops==8);
+	rb_mpmc_reset_stats(q);
+	CHECK(q->total_pushes==0 && q->total_overflows==0 && q->total_underflows==0);
+	rb_mpmc_free(q);
+
+	CHECK(rb_mpmc_new(0,10)==NULL);
+	CHECK(rb_mpmc_new(10,0)==NULL);
+}
+
+#ifndef RB_DISABLE_SHM
+//=============================================================================
+static void test_mpmc_shared()
+{
+	char in[100];
+	char out[100];
+	rb_mpmc_t *q=rb_mpmc_new_shared(16,sizeof(in),"test_rb mpmc");
+	CHECK(q!=NULL);
+	if(q==NULL) {return;}
+	CHECK(rb_mpmc_is_shared(q));
+
+	rb_mpmc_t *q2=rb_mpmc_open_shared(rb_mpmc_shared_memory_handle(q));
+	CHECK(q2!=NULL);
+	if(q2==NULL) {rb_mpmc_free(q); return;}
+	CHECK(q2!=q);
+	CHECK(rb_mpmc_slot_count(q2)==16);
+	CHECK(!strcmp(rb_mpmc_human_name(q2),"test_rb mpmc"));
+
+	pattern(in,sizeof(in),5);
+	CHECK(rb_mpmc_push(q,in)==1);
+	CHECK(rb_mpmc_can_read(q2)==1);
+	CHECK(rb_mpmc_pop(q2,out)==1);
+	CHECK(is_pattern(out,sizeof(out),5));
+	CHECK(q->total_pops==1);
+
+	//not a queue
+	rb_t *rb=rb_new_shared(100);
+	CHECK(rb_mpmc_open_shared(rb_shared_memory_handle(rb))==NULL);
+	rb_free(rb);
+
+	munmap(q2,_rb_mpmc_bytes(q2->slot_count,q2->slot_stride));
+	rb_mpmc_free(q);
+}
+#endif
+
+//producers push (producer, counter) pairs, consumers check that every message arrives once
+//and that the messages of one producer arrive in order
+//=============================================================================
+#define MPMC_THREADS 4
+#define MPMC_COUNT 200000
+
+typedef struct
+{
+	uint32_t producer;
+	uint32_t counter;
+	char payload[12];
+}
+mpmc_message_t;
+
+typedef struct
+{
+	rb_mpmc_t *q;
+	int id;
+	uint64_t popped;
+	int errors;
+}
+mpmc_thread_t;
+
+static uint64_t mpmc_total_popped=0;
+static uint32_t mpmc_seen[MPMC_THREADS];
+
+static void *mpmc_producer(void *arg)
+{
+	mpmc_thread_t *t=(mpmc_thread_t*)arg;
+	mpmc_message_t m;
+	uint32_t i;
+	for(i=0;i<MPMC_COUNT;i++)
+	{
+		m.producer=t->id;
+		m.counter=i;
+		pattern(m.payload,sizeof(m.payload),i);
+		while(!rb_mpmc_push(t->q,(const char*)&m)) {sched_yield();}
+	}
+	return NULL;
+}
+
+static void *mpmc_consumer(void *arg)
+{
+	mpmc_thread_t *t=(mpmc_thread_t*)arg;
+	mpmc_message_t m;
+	int64_t last[MPMC_THREADS];
+	int i;
+	for(i=0;i<MPMC_THREADS;i++) {last[i]=-1;}
+	while(__atomic_load_n(&mpmc_total_popped,__ATOMIC_RELAXED)<MPMC_THREADS*MPMC_COUNT)
+	{
+		if(!rb_mpmc_pop(t->q,(char*)&m)) {sched_yield(); continue;}
+		__atomic_fetch_add(&mpmc_total_popped,1,__ATOMIC_RELAXED);
+		t->popped++;
+		if(m.producer>=MPMC_THREADS || (int64_t)m.counter<=last[m.producer]
+			|| !is_pattern(m.payload,sizeof(m.payload),m.counter)) {t->errors++; continue;}
+		last[m.producer]=m.counter;
+		__atomic_fetch_add(&mpmc_seen[m.producer],1,__ATOMIC_RELAXED);
+	}
+	return NULL;
+}
+
+//=============================================================================
+static void test_mpmc_threads()
+{
+	pthread_t threads[MPMC_THREADS*2];
+	mpmc_thread_t producers[MPMC_THREADS];
+	mpmc_thread_t consumers[MPMC_THREADS];
+	rb_mpmc_t *q=rb_mpmc_new(64,sizeof(mpmc_message_t));
+	uint64_t popped=0;
+	int errors=0;
+	int i;
+
+	for(i=0;i<MPMC_THREADS;i++)
+	{
+		producers[i].q=consumers[i].q=q;
+		producers[i].id=consumers[i].id=i;
+		producers[i].popped=consumers[i].popped=0;
+		producers[i].errors=consumers[i].errors=0;
+		pthread_create(&threads[i],NULL,mpmc_consumer,&consumers[i]);
+		pthread_create(&threads[MPMC_THREADS+i],NULL,mpmc_producer,&producers[i]);
+	}
+	for(i=0;i<MPMC_THREADS*2;i++) {pthread_join(threads[i],NULL);}
+	for(i=0;i<MPMC_THREADS;i++)
+	{
+		popped+=consumers[i].popped;
+		errors+=consumers[i].errors;
+		CHECK(mpmc_seen[i]==MPMC_COUNT);
+	}
+	CHECK(errors==0);
+	CHECK(popped==MPMC_THREADS*MPMC_COUNT);
+	CHECK(q->total_pushes==MPMC_THREADS*MPMC_COUNT);
+	CHECK(q->total_pops==MPMC_THREADS*MPMC_COUNT);
+	CHECK(rb_mpmc_can_read(q)==0);
+	rb_mpmc_free(q);
+}
+
+//=============================================================================
+int main(int argc, char *argv[])
+{
+	test_new();
+	test_write_read();
+	test_wrap();
+	test_pow2();
+	test_mirrored();
+	test_peek();
+	test_advance();
+	test_overread_cache();
+	test_regions();
+	test_reserve();
+	test_bytes();
+	test_deinterleave();
+	test_deinterleave_channels();
+#ifndef RB_DISABLE_SHM
+	test_shared();
+#endif
+	test_shadow();
+	test_alloc_policy();
+	test_spsc();
+	test_notifier();
+	test_notifier_threads();
+	test_mpmc();
+#ifndef RB_DISABLE_SHM
+	test_mpmc_shared();
+#endif
+	test_mpmc_threads();
+
+	fprintf(stderr,"rb.h %.2f: %d checks, %d failed\n",RB_VERSION,checks,failed);
+	return failed;
+}
+//EOF